@@ -0,0 +1,260 @@
+// File Inclusion
+#include "Clock.h"
+#include <plib.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* --------------------------------------------------------------------------
+   PPS disciplined clock
+
+   Time is the core timer extended to 64 bits and scaled to microseconds
+   by a slope that the GPS 1PPS pulses keep correct:
+   - the rate is the filtered number of core ticks between pulses, which
+     takes out the crystal error
+   - the phase is slewed, at most CLOCK_SLEW_MAX_US per second, so that
+     pulses land on whole seconds
+
+   The clock never steps backwards. The only jump is forward, onto the next
+   whole second, at the first pulse. Without pulses it free runs on the
+   last rate.
+
+   UTC: an RMC whose time is a whole second describes the second that began
+   at the most recent pulse, so that pulse becomes the UTC reference.
+   -------------------------------------------------------------------------- */
+#define SLOPE_SHIFT	32		// Slope is us per core tick, Q32
+#define REANCHOR	400000000UL	// Core ticks (10 s) before the anchor is moved up
+
+static uint64_t extTicks = 0;			// Last extended core timer value
+static uint64_t anchorTick = 0;			// Clock is anchorUs at anchorTick
+static uint64_t anchorUs = 0;
+static uint64_t lastMicros = 0;		// Highest value handed out
+static uint64_t slope;					// us per tick, Q32
+static uint32_t tickRate = CLOCK_NOMINAL_HZ;	// Measured ticks per second
+static uint64_t lastPpsTick = 0;
+static uint64_t lastPpsUs = 0;
+static BOOL ppsSeen = FALSE;
+static uint64_t utcBaseUs = 0;			// System time of utcBaseMs
+static uint32_t utcBaseMs = 0;			// UTC ms of day
+static unsigned int utcDate = 0;
+static BOOL utcValid = FALSE;
+
+///* --- Function Prototyping --- */
+static uint64_t ExtendTicks(unsigned int coreTick);
+static uint64_t MicrosAt(uint64_t tick);
+
+/* -------------------------------- Clock_init -------------------------------
+ @ Summary
+    Starts the clock at zero on the nominal core timer rate
+  ---------------------------------------------------------------------------- */
+void Clock_init(void) {
+	unsigned int intStatus;
+
+	intStatus = INTDisableInterrupts();
+	extTicks = ReadCoreTimer();
+	anchorTick = extTicks;
+	anchorUs = 0;
+	lastMicros = 0;
+	tickRate = CLOCK_NOMINAL_HZ;
+	slope = (1000000ULL << SLOPE_SHIFT) / tickRate;
+	ppsSeen = FALSE;
+	utcValid = FALSE;
+	INTRestoreInterrupts(intStatus);
+}
+
+/* ------------------------------- Clock_micros ------------------------------
+ @ Summary
+    Monotonic microseconds since Clock_init
+ @ Notes
+    Must be called at least every 50 s so the core timer wrap is seen, the
+    main loop does so far more often.
+  ---------------------------------------------------------------------------- */
+uint64_t Clock_micros(void) {
+	unsigned int intStatus;
+	uint64_t tick;
+	uint64_t now;
+
+	intStatus = INTDisableInterrupts();
+	tick = ExtendTicks(ReadCoreTimer());
+	now = MicrosAt(tick);
+	if ((tick - anchorTick) > REANCHOR) {	// Keep the product well inside 64 bits
+		anchorUs = now;
+		anchorTick = tick;
+	}
+	if (now < lastMicros) {
+		now = lastMicros;		// Read just before a pulse that slowed the clock
+	}
+	lastMicros = now;
+	INTRestoreInterrupts(intStatus);
+	return now;
+}
+
+/* ------------------------------- Clock_widen -------------------------------
+ @ Summary
+    Full time of a sensor stamp kept as the low 32 bits of Clock_micros
+ @ Parameters
+    @ param1 : stamp
+ @ Return Value
+    uint64_t : the time nearest now with those low bits
+ @ Notes
+    Samples carry 32 bit stamps to keep them small and atomic. They are
+    unambiguous within 35 minutes of now, far longer than any is kept.
+  ---------------------------------------------------------------------------- */
+uint64_t Clock_widen(uint32_t stamp) {
+	uint64_t now = Clock_micros();
+
+	return now - (int64_t) (int32_t) ((uint32_t) now - stamp);
+}
+
+/* ------------------------------- Clock_ppsEdge -----------------------------
+ @ Summary
+    Disciplines the clock on a rising PPS edge
+ @ Parameters
+    @ param1 : core timer read as early as possible in the interrupt
+ @ Return Value
+    None
+ @ Notes
+    Called from the change notice interrupt. An interval outside
+    CLOCK_PPS_TOLERANCE of the current rate (a missed or noisy pulse) only
+    re-references the phase.
+  ---------------------------------------------------------------------------- */
+void Clock_ppsEdge(unsigned int coreTick) {
+	unsigned int intStatus;
+	uint64_t tick;
+	uint64_t now;
+	uint64_t second;
+	int32_t interval;
+	int32_t error;
+
+	intStatus = INTDisableInterrupts();
+	tick = ExtendTicks(coreTick);
+	now = MicrosAt(tick);
+
+	if (ppsSeen) {
+		interval = (int32_t) (tick - lastPpsTick);
+		if ((interval > (int32_t) (tickRate - CLOCK_PPS_TOLERANCE))
+				&& (interval < (int32_t) (tickRate + CLOCK_PPS_TOLERANCE))) {
+			tickRate += (interval - (int32_t) tickRate) >> CLOCK_RATE_SHIFT;
+		}
+		second = ((now + 500000) / 1000000) * 1000000;	// Nearest whole second
+		error = (int32_t) (now - second);
+	}
+	else {
+		second = ((now / 1000000) + 1) * 1000000;		// Step forward, never back
+		now = second;
+		error = 0;
+	}
+
+	// Over the next second remove half the phase error, within the slew limit
+	error /= 2;
+	if (error > CLOCK_SLEW_MAX_US) {
+		error = CLOCK_SLEW_MAX_US;
+	}
+	else if (error < -CLOCK_SLEW_MAX_US) {
+		error = -CLOCK_SLEW_MAX_US;
+	}
+	slope = ((uint64_t) (1000000 - error) << SLOPE_SHIFT) / tickRate;
+	anchorUs = now;
+	anchorTick = tick;
+
+	lastPpsTick = tick;
+	lastPpsUs = second;
+	ppsSeen = TRUE;
+	INTRestoreInterrupts(intStatus);
+}
+
+/* ------------------------------ Clock_ppsLocked ----------------------------
+ @ Summary
+    TRUE while pulses are arriving
+  ---------------------------------------------------------------------------- */
+BOOL Clock_ppsLocked(void) {
+	return ppsSeen && ((Clock_micros() - lastPpsUs) < CLOCK_PPS_TIMEOUT);
+}
+
+/* ------------------------------- Clock_gpsTime -----------------------------
+ @ Summary
+    Ties the clock to UTC from an RMC time
+ @ Parameters
+    @ param1 : UTC time of the fix, hhmmss
+    @ param2 : milliseconds of the fix
+    @ param3 : UTC date, ddmmyy
+ @ Return Value
+    None
+ @ Notes
+    Call as each RMC arrives. With PPS lock only whole second fixes are
+    used and the reference is the pulse, so it is exact to the pulse. Without
+    PPS the arrival time is used, late by the sentence and bus latency (tens
+    of ms), and is replaced as soon as the lock comes back.
+  ---------------------------------------------------------------------------- */
+void Clock_gpsTime(unsigned int hhmmss, unsigned int ms, unsigned int ddmmyy) {
+	uint32_t dayMs;
+	uint64_t now = Clock_micros();
+	BOOL locked = Clock_ppsLocked();
+
+	if (locked && (ms != 0)) {
+		return;
+	}
+	dayMs = ((hhmmss / 10000) * 3600 + ((hhmmss / 100) % 100) * 60 + (hhmmss % 100)) * 1000 + ms;
+	utcBaseMs = dayMs;
+	utcBaseUs = (locked && ((now - lastPpsUs) < 1000000)) ? lastPpsUs : now;
+	utcDate = ddmmyy;
+	utcValid = TRUE;
+}
+
+/* -------------------------------- Clock_toUtc ------------------------------
+ @ Summary
+    Converts a Clock_micros time stamp to UTC
+ @ Parameters
+    @ param1 : time stamp
+    @ param2 : UTC milliseconds of day
+    @ param3 : UTC date of the reference fix, may be NULL
+ @ Return Value
+    BOOL : FALSE until a GPS time has been seen
+ @ Notes
+    Wraps at midnight, the date is not rolled over.
+  ---------------------------------------------------------------------------- */
+BOOL Clock_toUtc(uint64_t micros, uint32_t *dayMs, unsigned int *ddmmyy) {
+	int64_t offset;
+
+	if (!utcValid) {
+		return FALSE;
+	}
+	offset = ((int64_t) (micros - utcBaseUs)) / 1000 + utcBaseMs;
+	offset %= (int64_t) (CLOCK_US_PER_DAY / 1000);
+	if (offset < 0) {
+		offset += CLOCK_US_PER_DAY / 1000;
+	}
+	*dayMs = (uint32_t) offset;
+	if (ddmmyy != NULL) {
+		*ddmmyy = utcDate;
+	}
+	return TRUE;
+}
+
+/* -------------------------------- ExtendTicks ------------------------------
+ @ Summary
+    Extends a 32 bit core timer reading to 64 bits
+ @ Notes
+    Interrupts must be off. A reading taken slightly before the last one
+    seen (an ISR that read the timer first) comes out slightly earlier
+    instead of a whole wrap later.
+  ---------------------------------------------------------------------------- */
+static uint64_t ExtendTicks(unsigned int coreTick) {
+	int32_t delta = (int32_t) (coreTick - (uint32_t) extTicks);
+
+	if (delta > 0) {
+		extTicks += delta;
+		return extTicks;
+	}
+	return extTicks + delta;
+}
+
+/* --------------------------------- MicrosAt --------------------------------
+ @ Summary
+    Clock value at an extended tick, interrupts must be off
+  ---------------------------------------------------------------------------- */
+static uint64_t MicrosAt(uint64_t tick) {
+	if (tick < anchorTick) {
+		return anchorUs;				// Read before the last re-anchor
+	}
+	return anchorUs + (((tick - anchorTick) * slope) >> SLOPE_SHIFT);
+}
@@ -0,0 +1,23 @@
+#ifndef __CLOCK_H__
+	#define __CLOCK_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define CLOCK_NOMINAL_HZ	40000000UL	// Core timer, half the system clock
+	#define CLOCK_PPS_TOLERANCE	20000		// Core ticks (500 ppm) a PPS interval may be off
+	#define CLOCK_RATE_SHIFT	3			// Rate estimate moves 1/8 per pulse
+	#define CLOCK_SLEW_MAX_US	500			// Largest phase correction per second
+	#define CLOCK_PPS_TIMEOUT	2000000		// us without a pulse before the lock is lost
+	#define CLOCK_US_PER_DAY	86400000000ULL
+
+	// Function Prototypes
+	void     Clock_init(void);
+	uint64_t Clock_micros(void);
+	uint64_t Clock_widen(uint32_t stamp);
+	void     Clock_ppsEdge(unsigned int coreTick);
+	BOOL     Clock_ppsLocked(void);
+	void     Clock_gpsTime(unsigned int hhmmss, unsigned int ms, unsigned int ddmmyy);
+	BOOL     Clock_toUtc(uint64_t micros, uint32_t *dayMs, unsigned int *ddmmyy);
+#endif
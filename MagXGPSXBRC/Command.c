@@ -0,0 +1,254 @@
+// File Inclusion
+#include "Command.h"
+#include "Mission.h"
+#include "HeadingHold.h"
+#include "Navigate.h"
+#include "Geofence.h"
+#include "Mode.h"
+#include "Cruise.h"
+#include "Link.h"
+#include "Gamepad.h"
+#include "FixedMath.h"
+#include "GPS_I2C.h"
+#include "uart2.h"
+#include "hardware.h"
+#include <plib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* --------------------------------------------------------------------------
+   XBee line dispatcher
+
+   Every NUL terminated line from the link comes through here. Lines that
+   start with a command letter go to their module, which writes one reply
+   line; anything else is a gamepad report, answered with "A" as before.
+   Commands and gamepad reports that parse whole count as frames for the
+   link supervisor; other lines do not keep the link up.
+
+     M.. / F..                   Mission and fence, see Mission.c
+     HG [<kp> <ki> <kd>]         Heading hold gains (Q16), set or read back
+     HR [<ms>]                   Heading hold loop period, set or read back
+     HH <cdeg> / HX              Hold a heading / stop steering
+     CG [<kp> <ki>]              Cruise gains (Q16), set or read back
+     CS <centiknots> / CX        Hold a speed / throttle to neutral
+                                 HH and CS are for assisted, where the
+                                 heading hold and cruise control run;
+                                 from manual they go to assisted first
+                                 (Mode.c), elsewhere the reply is
+                                 "HF refused" / "CF refused"
+     LS                          Link statistics: "LS <frames> <losses>
+                                 <longest gap> <worst detection past
+                                 the timeout>", ms
+     LT [<ms>]                   Link loss timeout, set or read back
+     PF                          Fixed point math timing: "PF <atan2>
+                                 <sincos> <sqrt> <sqrt64> <atan2f>", core
+                                 timer ticks per call (two CPU cycles
+                                 each), atan2f the soft float baseline
+     PH                          Heading hold timing: "PH <last> <max>",
+                                 core timer ticks per update
+     PN                          Waypoint navigation timing: "PN <last>
+                                 <max>", core timer ticks per update
+     PG                          Geofence timing: "PG <last> <max>", core
+                                 timer ticks per check
+   -------------------------------------------------------------------------- */
+#define COMMAND_REPLY_MAX	MISSION_REPLY_MAX
+
+///* --- Function Prototyping --- */
+static BOOL HeadingCommand(const char *line, char *reply);
+static BOOL CruiseCommand(const char *line, char *reply);
+static BOOL LinkCommand(const char *line, char *reply);
+static BOOL ProfileCommand(const char *line, char *reply);
+
+/* ----------------------------- Command_dispatch ----------------------------
+ @ Summary
+    Routes one received line and sends its reply
+ @ Parameters
+    @ param1 : NUL terminated line
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+void Command_dispatch(const char *line) {
+	char reply[COMMAND_REPLY_MAX];
+
+	if (Mission_command(line, reply) || HeadingCommand(line, reply) || CruiseCommand(line, reply)
+		|| LinkCommand(line, reply) || ProfileCommand(line, reply)) {
+		Link_frame(millisec);
+		putsU2(reply);
+		return;
+	}
+
+	if (HandleInput()) {				// Gamepad report, parsed out of dmaBuff
+		Link_frame(millisec);
+	}
+	putsU2("A");
+}
+
+/* ----------------------------- HeadingCommand ------------------------------
+ @ Summary
+    Handles the H lines, tuning and engaging the heading hold
+ @ Return Value
+    BOOL : FALSE if the line is not one of them
+  ---------------------------------------------------------------------------- */
+static BOOL HeadingCommand(const char *line, char *reply) {
+	int32_t kp, ki, kd;
+	int32_t heading;
+	char *end;
+
+	if ((line[0] != 'H') || (line[1] == 0) || ((line[2] != ' ') && (line[2] != 0))) {
+		return FALSE;
+	}
+
+	switch (line[1]) {
+		case 'G':
+			if (line[2] != 0) {
+				kp = strtol(&line[2], &end, 10);
+				ki = strtol(end, &end, 10);
+				kd = strtol(end, NULL, 10);
+				HeadingHold_setGains(kp, ki, kd);
+			}
+			HeadingHold_getGains(&kp, &ki, &kd);
+			sprintf(reply, "HG %ld %ld %ld", (long) kp, (long) ki, (long) kd);
+			break;
+		case 'R':
+			if (line[2] != 0) {
+				HeadingHold_setRate((unsigned int) strtoul(&line[2], NULL, 10));
+			}
+			sprintf(reply, "HR %u", HeadingHold_rate());
+			break;
+		case 'H':
+			heading = strtol(&line[2], NULL, 10);
+			if (Mode_current() == MODE_MANUAL) {
+				Mode_event(MODE_EV_START);
+			}
+			if (Mode_current() != MODE_ASSISTED) {
+				sprintf(reply, "HF refused");		// The route steers, or failsafe
+				break;
+			}
+			Mode_hold(heading);
+			sprintf(reply, "HH %ld", (long) heading);
+			break;
+		case 'X':
+			HeadingHold_disengage();
+			sprintf(reply, "HX");
+			break;
+		default:
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* ------------------------------ CruiseCommand ------------------------------
+ @ Summary
+    Handles the C lines, tuning and engaging the cruise control
+ @ Return Value
+    BOOL : FALSE if the line is not one of them
+  ---------------------------------------------------------------------------- */
+static BOOL CruiseCommand(const char *line, char *reply) {
+	int32_t kp, ki;
+	int32_t speed;
+	char *end;
+
+	if ((line[0] != 'C') || (line[1] == 0) || ((line[2] != ' ') && (line[2] != 0))) {
+		return FALSE;
+	}
+
+	switch (line[1]) {
+		case 'G':
+			if (line[2] != 0) {
+				kp = strtol(&line[2], &end, 10);
+				ki = strtol(end, NULL, 10);
+				Cruise_setGains(kp, ki);
+			}
+			Cruise_getGains(&kp, &ki);
+			sprintf(reply, "CG %ld %ld", (long) kp, (long) ki);
+			break;
+		case 'S':
+			speed = strtol(&line[2], NULL, 10);
+			if (Mode_current() == MODE_MANUAL) {
+				Mode_event(MODE_EV_START);
+			}
+			if (Mode_current() != MODE_ASSISTED) {
+				sprintf(reply, "CF refused");		// The route sets the speed, or failsafe
+				break;
+			}
+			Cruise_set(GPS_MMPS(speed));			// Move() leaves the throttle to it now
+			sprintf(reply, "CS %ld", (long) speed);
+			break;
+		case 'X':
+			Cruise_stop();
+			sprintf(reply, "CX");
+			break;
+		default:
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* ------------------------------- LinkCommand -------------------------------
+ @ Summary
+    Handles the L lines, link statistics and timeout
+ @ Return Value
+    BOOL : FALSE if the line is not one of them
+  ---------------------------------------------------------------------------- */
+static BOOL LinkCommand(const char *line, char *reply) {
+	LINK_STATS stats;
+
+	if ((line[0] != 'L') || (line[1] == 0) || ((line[2] != ' ') && (line[2] != 0))) {
+		return FALSE;
+	}
+
+	switch (line[1]) {
+		case 'S':
+			Link_stats(&stats);
+			sprintf(reply, "LS %lu %lu %lu %lu", (unsigned long) stats.frames, (unsigned long) stats.losses,
+					(unsigned long) stats.maxGap, (unsigned long) stats.maxLatency);
+			break;
+		case 'T':
+			if (line[2] != 0) {
+				Link_setTimeout((unsigned int) strtoul(&line[2], NULL, 10));
+			}
+			sprintf(reply, "LT %u", Link_timeout());
+			break;
+		default:
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* ----------------------------- ProfileCommand ------------------------------
+ @ Summary
+    Handles the P lines, execution time measured on the board
+ @ Return Value
+    BOOL : FALSE if the line is not one of them
+  ---------------------------------------------------------------------------- */
+static BOOL ProfileCommand(const char *line, char *reply) {
+	FIXED_BENCH fixed;
+	unsigned int last, max;
+
+	if ((line[0] != 'P') || (line[1] == 0) || ((line[2] != ' ') && (line[2] != 0))) {
+		return FALSE;
+	}
+
+	switch (line[1]) {
+		case 'F':
+			FixedMath_bench(&fixed);
+			sprintf(reply, "PF %u %u %u %u %u", fixed.atan2, fixed.sinCos, fixed.sqrt, fixed.sqrt64,
+					fixed.atan2Float);
+			break;
+		case 'H':
+			HeadingHold_cycles(&last, &max);
+			sprintf(reply, "PH %u %u", last, max);
+			break;
+		case 'N':
+			Navigate_cycles(&last, &max);
+			sprintf(reply, "PN %u %u", last, max);
+			break;
+		case 'G':
+			Geofence_cycles(&last, &max);
+			sprintf(reply, "PG %u %u", last, max);
+			break;
+		default:
+			return FALSE;
+	}
+	return TRUE;
+}
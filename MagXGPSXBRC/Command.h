@@ -0,0 +1,8 @@
+#ifndef __COMMAND_H__
+	#define __COMMAND_H__
+
+	#include <plib.h>
+
+	// Function Prototypes
+	void Command_dispatch(const char *line);
+#endif
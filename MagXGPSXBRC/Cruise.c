@@ -0,0 +1,338 @@
+// File Inclusion
+#include "Cruise.h"
+#include "RC.h"
+#include <plib.h>
+#include <stdint.h>
+
+/* --------------------------------------------------------------------------
+   Cruise control
+
+   Regulates speed over ground (mm/s) by setting the speed controller
+   throttle (Q16 percent of full forward).
+
+   - Feed-forward: a map from speed to the throttle that holds it, one
+     point every CRUISE_BIN_MMPS. It starts as a parabola and is
+     learned: at each fix after the throttle has stayed within
+     CRUISE_LEARN_BAND for CRUISE_LEARN_MS, the two points either side of
+     the measured speed move towards the throttle in use. The map is kept
+     rising.
+   - PI on what the map does not explain (wind, battery, load), the
+     integrator clamped and frozen while the throttle is pinned.
+   - The throttle is slew limited, slower up than down.
+
+   Fixes only arrive at the GPS rate, so between them the speed is dead
+   reckoned from the last fix: it moves with time constant CRUISE_TAU_MS
+   towards the fix speed plus the change the map gives for the throttle
+   since the fix. Only the difference of two map speeds is used, so a
+   boat that is slower or faster than the map at every throttle is still
+   predicted at its measured speed. Predicting towards the map speed
+   itself pulled the estimate to the map between fixes, and the loop then
+   held such a boat short of the setpoint. Each fix resets the prediction
+   to the measured speed.
+   -------------------------------------------------------------------------- */
+#define PERCENT_Q16		(100L << 16)
+#define EST_SHIFT		8			// Speed estimate fraction bits
+
+static BOOL engaged = FALSE;
+static int32_t setpoint = 0;		// mm/s
+static int32_t estimate = 0;		// mm/s, Q8
+static int32_t throttle = 0;		// Q16 percent
+static int64_t integral = 0;		// Q16 percent
+static int32_t kp = CRUISE_KP_DEFAULT;
+static int32_t ki = CRUISE_KI_DEFAULT;
+static int32_t map[CRUISE_BINS];	// Throttle to hold each speed, Q16 percent
+static BOOL haveFix = FALSE;
+static int32_t lastFixSpeed;
+static int32_t fixThrottle;		// Throttle when the last fix came
+static unsigned int lastFixStamp;
+static int32_t steadyThrottle;		// Throttle has stayed near this
+static unsigned int steadyMs;		// for this long
+
+///* --- Function Prototyping --- */
+static int32_t MapThrottle(int32_t speed);
+static int32_t MapSpeed(int32_t level);
+static void Learn(int32_t speed, int32_t level);
+static void SetThrottle(void);
+
+/* ------------------------------- Cruise_reset ------------------------------
+ @ Summary
+    Disengages and puts the feed-forward map back to its starting shape
+ @ Notes
+    Hull drag goes with speed squared, so the map starts as a parabola up
+    to full throttle at the top point.
+  ---------------------------------------------------------------------------- */
+void Cruise_reset(void) {
+	int bin;
+
+	for (bin = 0; bin < CRUISE_BINS; bin++) {
+		map[bin] = (int32_t) ((PERCENT_Q16 * bin * bin) / ((CRUISE_BINS - 1) * (CRUISE_BINS - 1)));
+	}
+	engaged = FALSE;
+	integral = 0;
+	throttle = 0;
+	estimate = 0;
+	haveFix = FALSE;
+	steadyThrottle = 0;
+	steadyMs = 0;
+}
+
+/* -------------------------------- Cruise_set -------------------------------
+ @ Summary
+    Holds a speed, mm/s (0 brings the throttle back to neutral)
+  ---------------------------------------------------------------------------- */
+void Cruise_set(int32_t speed) {
+	if (!engaged) {
+		integral = 0;
+		throttle = 0;
+	}
+	setpoint = (speed > 0) ? speed : 0;
+	engaged = TRUE;
+}
+
+/* ------------------------------- Cruise_stop -------------------------------
+ @ Summary
+    Disengages with the throttle at neutral straight away
+  ---------------------------------------------------------------------------- */
+void Cruise_stop(void) {
+	engaged = FALSE;
+	throttle = 0;
+	integral = 0;
+	SetThrottle();
+}
+
+/* ----------------------------- Cruise_setGains -----------------------------
+ @ Summary
+    Sets the PI gains, Q16 percent per mm/s (ki per mm/s second)
+  ---------------------------------------------------------------------------- */
+void Cruise_setGains(int32_t newKp, int32_t newKi) {
+	kp = (newKp > 0) ? newKp : 0;
+	ki = (newKi > 0) ? newKi : 0;
+	if (ki == 0) {
+		integral = 0;
+	}
+}
+
+/* ----------------------------- Cruise_getGains -----------------------------
+ @ Summary
+    Reads back the PI gains
+  ---------------------------------------------------------------------------- */
+void Cruise_getGains(int32_t *gainP, int32_t *gainI) {
+	*gainP = kp;
+	*gainI = ki;
+}
+
+/* -------------------------------- Cruise_fix -------------------------------
+ @ Summary
+    Takes the speed from a GPS fix
+ @ Parameters
+    @ param1 : speed over ground, mm/s (GPS_MMPS of gps.speed)
+    @ param2 : millisec the fix arrived
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+void Cruise_fix(int32_t speed, unsigned int now) {
+	int32_t accel;
+	int32_t before;
+	unsigned int dt = now - lastFixStamp;
+
+	// Learn only once the throttle has been still long enough for the
+	// speed to have caught up with it
+	if (haveFix && engaged && (steadyMs >= CRUISE_LEARN_MS) && (dt > 0) && (dt < 2000)) {
+		accel = ((speed - lastFixSpeed) * 1000) / (int32_t) dt;
+		if ((accel < CRUISE_LEARN_ACCEL) && (accel > -CRUISE_LEARN_ACCEL)) {
+			// Move the map and take the same out of the integrator, so the
+			// throttle does not jump
+			before = MapThrottle(setpoint);
+			Learn(speed, throttle);
+			integral -= MapThrottle(setpoint) - before;
+		}
+	}
+
+	estimate = speed << EST_SHIFT;
+	lastFixSpeed = speed;
+	fixThrottle = throttle;
+	lastFixStamp = now;
+	haveFix = TRUE;
+}
+
+/* ------------------------------ Cruise_update ------------------------------
+ @ Summary
+    Runs one CRUISE_RATE_MS period and sets the throttle
+ @ Return Value
+    int : speed controller setting sent to set_rc, percent, -1 when
+          disengaged
+  ---------------------------------------------------------------------------- */
+int Cruise_update(void) {
+	int32_t error;
+	int64_t target;
+	int64_t step;
+	int32_t slew;
+	int32_t predicted;
+
+	// Speed between fixes, from the map alone until there has been one
+	predicted = MapSpeed(throttle);
+	if (haveFix) {
+		predicted += lastFixSpeed - MapSpeed(fixThrottle);
+		if (predicted < 0) {
+			predicted = 0;
+		}
+	}
+	estimate += ((predicted << EST_SHIFT) - estimate) / (CRUISE_TAU_MS / CRUISE_RATE_MS);
+
+	if (!engaged) {
+		return -1;
+	}
+
+	if (setpoint == 0) {
+		target = 0;
+		integral = 0;
+	}
+	else {
+		error = setpoint - (estimate >> EST_SHIFT);
+		target = (int64_t) MapThrottle(setpoint) + (int64_t) kp * error + integral;
+
+		// Integrate unless already pinned that way
+		step = ((int64_t) ki * error * CRUISE_RATE_MS) / 1000;
+		if (!((target >= PERCENT_Q16) && (step > 0)) && !((target <= 0) && (step < 0))) {
+			integral += step;
+			if (integral > PERCENT_Q16 / 2) {
+				integral = PERCENT_Q16 / 2;
+			}
+			else if (integral < -PERCENT_Q16 / 2) {
+				integral = -PERCENT_Q16 / 2;
+			}
+			target += step;
+		}
+		if (target > PERCENT_Q16) {
+			target = PERCENT_Q16;
+		}
+		else if (target < 0) {
+			target = 0;
+		}
+	}
+
+	// Slew limit
+	slew = (int32_t) ((((int64_t) CRUISE_SLEW_UP << 16) * CRUISE_RATE_MS) / 1000);
+	if (target > throttle + slew) {
+		target = throttle + slew;
+	}
+	slew = (int32_t) ((((int64_t) CRUISE_SLEW_DOWN << 16) * CRUISE_RATE_MS) / 1000);
+	if (target < throttle - slew) {
+		target = throttle - slew;
+	}
+	throttle = (int32_t) target;
+
+	if ((throttle - steadyThrottle > CRUISE_LEARN_BAND) || (steadyThrottle - throttle > CRUISE_LEARN_BAND)) {
+		steadyThrottle = throttle;
+		steadyMs = 0;
+	}
+	else if (steadyMs < CRUISE_LEARN_MS) {
+		steadyMs += CRUISE_RATE_MS;
+	}
+
+	SetThrottle();
+	return RC2Pos;
+}
+
+/* ------------------------------ Cruise_engaged -----------------------------
+ @ Summary
+    Whether cruise control has the throttle
+  ---------------------------------------------------------------------------- */
+BOOL Cruise_engaged(void) {
+	return engaged;
+}
+
+/* ------------------------------- Cruise_speed ------------------------------
+ @ Summary
+    Speed estimate, mm/s
+  ---------------------------------------------------------------------------- */
+int32_t Cruise_speed(void) {
+	return estimate >> EST_SHIFT;
+}
+
+/* -------------------------------- Cruise_map -------------------------------
+ @ Summary
+    Learned throttle for bin * CRUISE_BIN_MMPS, Q16 percent
+  ---------------------------------------------------------------------------- */
+int32_t Cruise_map(int bin) {
+	if ((bin < 0) || (bin >= CRUISE_BINS)) {
+		return 0;
+	}
+	return map[bin];
+}
+
+/* -------------------------------- MapThrottle ------------------------------
+ @ Summary
+    Throttle the map gives for a speed, interpolated
+  ---------------------------------------------------------------------------- */
+static int32_t MapThrottle(int32_t speed) {
+	int bin = speed / CRUISE_BIN_MMPS;
+	int32_t frac = speed % CRUISE_BIN_MMPS;
+
+	if (bin >= CRUISE_BINS - 1) {
+		return map[CRUISE_BINS - 1];
+	}
+	return map[bin] + (int32_t) (((int64_t) (map[bin + 1] - map[bin]) * frac) / CRUISE_BIN_MMPS);
+}
+
+/* --------------------------------- MapSpeed --------------------------------
+ @ Summary
+    Speed the map gives for a throttle, the inverse of MapThrottle
+  ---------------------------------------------------------------------------- */
+static int32_t MapSpeed(int32_t level) {
+	int bin;
+
+	for (bin = 0; bin < CRUISE_BINS - 1; bin++) {
+		if (level < map[bin + 1]) {
+			if (map[bin + 1] == map[bin]) {
+				return bin * CRUISE_BIN_MMPS;
+			}
+			return bin * CRUISE_BIN_MMPS
+					+ (int32_t) (((int64_t) (level - map[bin]) * CRUISE_BIN_MMPS) / (map[bin + 1] - map[bin]));
+		}
+	}
+	return (CRUISE_BINS - 1) * CRUISE_BIN_MMPS;
+}
+
+/* ----------------------------------- Learn ---------------------------------
+ @ Summary
+    Moves the two map points around a steady speed towards its throttle
+ @ Notes
+    Each point moves by its interpolation weight. Point 0 stays at 0.
+  ---------------------------------------------------------------------------- */
+static void Learn(int32_t speed, int32_t level) {
+	int bin = speed / CRUISE_BIN_MMPS;
+	int32_t frac = speed % CRUISE_BIN_MMPS;
+	int i;
+
+	if ((speed <= 0) || (bin >= CRUISE_BINS - 1)) {
+		return;
+	}
+	map[bin] += (int32_t) ((((int64_t) (level - map[bin]) * (CRUISE_BIN_MMPS - frac)) / CRUISE_BIN_MMPS)
+						   >> CRUISE_LEARN_SHIFT);
+	map[bin + 1] += (int32_t) ((((int64_t) (level - map[bin + 1]) * frac) / CRUISE_BIN_MMPS) >> CRUISE_LEARN_SHIFT);
+
+	// Keep it rising, the points just learned win over their neighbours
+	map[0] = 0;
+	for (i = bin - 1; i > 0; i--) {
+		if (map[i] > map[i + 1]) {
+			map[i] = map[i + 1];
+		}
+	}
+	for (i = bin + 2; i < CRUISE_BINS; i++) {
+		if (map[i] < map[i - 1]) {
+			map[i] = map[i - 1];
+		}
+	}
+}
+
+/* -------------------------------- SetThrottle ------------------------------
+ @ Summary
+    Sends the throttle to both speed controllers
+ @ Notes
+    Full forward is 50 percent of set_rc away from neutral.
+  ---------------------------------------------------------------------------- */
+static void SetThrottle(void) {
+	RC2Pos = 50 + CRUISE_THROTTLE_SIGN * (int) ((throttle + (1L << 16)) >> 17);
+	set_rc(RC2Pos, RC2Pos, RC1Pos, RC1Pos);
+}
@@ -0,0 +1,35 @@
+#ifndef __CRUISE_H__
+	#define __CRUISE_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define CRUISE_RATE_MS			50		// Cruise_update period
+	#define CRUISE_BINS				16		// Feed-forward map points
+	#define CRUISE_BIN_MMPS			320		// Speed between map points
+	#define CRUISE_TAU_MS			1500	// Speed response time for prediction
+	#define CRUISE_SLEW_UP			20		// Throttle percent per second, rising
+	#define CRUISE_SLEW_DOWN		100		// and falling
+	#define CRUISE_LEARN_MS			4000	// Throttle still this long before learning
+	#define CRUISE_LEARN_BAND		(3L << 16)	// "Still": within 3 percent
+	#define CRUISE_LEARN_ACCEL		300		// mm/s^2 between fixes, also required
+	#define CRUISE_LEARN_SHIFT		3		// Map moves 1/8 of the way per fix
+	#define CRUISE_THROTTLE_SIGN	-1		// Forward lowers RC2Pos, as ForwardPos
+
+	// Gains, Q16 throttle percent per mm/s of error (ki per mm/s second)
+	#define CRUISE_KP_DEFAULT		3932	// 6 % per 100 mm/s
+	#define CRUISE_KI_DEFAULT		655		// 1 % per 100 mm/s second
+
+	// Function Prototypes
+	void Cruise_reset(void);
+	void Cruise_set(int32_t speed);
+	void Cruise_stop(void);
+	void Cruise_setGains(int32_t kp, int32_t ki);
+	void Cruise_getGains(int32_t *kp, int32_t *ki);
+	void Cruise_fix(int32_t speed, unsigned int now);
+	int Cruise_update(void);
+	BOOL Cruise_engaged(void);
+	int32_t Cruise_speed(void);
+	int32_t Cruise_map(int bin);
+#endif
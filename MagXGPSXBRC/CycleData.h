@@ -6,6 +6,7 @@
  */
 
 #include "Gamepad.h"
+#include <stdint.h>
 
 #pragma once
 
@@ -23,10 +24,10 @@ typedef struct cycleData
 	char GPS_NorthSouth;
 	char GPS_Status;
 	char GPS_EastWest;
-	float GPS_Latitude;
-	float GPS_Longitude;
-	float GPS_Speed;
-	float GPS_Angle;
+	int32_t GPS_Latitude;		// 1e-7 degree, south negative
+	int32_t GPS_Longitude;		// 1e-7 degree, west negative
+	int32_t GPS_Speed;			// Centiknots
+	int32_t GPS_Angle;			// Centidegrees
 
 
 } Cycle;
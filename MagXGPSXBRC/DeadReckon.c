@@ -0,0 +1,103 @@
+// File Inclusion
+#include "DeadReckon.h"
+#include "FixedMath.h"
+#include <plib.h>
+#include <stdint.h>
+
+/* --------------------------------------------------------------------------
+   Dead reckoning between GPS fixes
+
+   Each fix sets an anchor position and the speed to use. Every control
+   tick the distance covered since the last tick is resolved along the
+   current heading into north and east micrometers from the anchor, and
+   the position estimate is the anchor plus that offset. All integer: the
+   offset stays in micrometers (good for 2 km, far more than DR_MAX_AGE at
+   boat speed) and is only turned into 1e-7 degree when asked for.
+   -------------------------------------------------------------------------- */
+static int32_t anchorLat = 0;		// 1e-7 degree
+static int32_t anchorLon = 0;
+static int32_t cosLat = Q15_ONE;	// Q15, shrinks the east scale
+static int32_t speed = 0;			// mm/s
+static int32_t north = 0;			// Micrometers from the anchor
+static int32_t east = 0;
+static unsigned int fixStamp;
+static unsigned int lastStamp;
+static BOOL anchored = FALSE;
+
+/* ------------------------------ DeadReckon_fix -----------------------------
+ @ Summary
+    Restarts the estimate from a GPS fix
+ @ Parameters
+    @ param1 : fix, lat/lon in 1e-7 degree and speed in centiknots
+    @ param2 : millisec the fix arrived
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+void DeadReckon_fix(const struct gps_time *fix, unsigned int stamp) {
+	int32_t sine;
+
+	anchorLat = fix->lat;
+	anchorLon = fix->lon;
+	FixedSinCos(fix->lat / (GPS_DEG_SCALE / 100), &sine, &cosLat);
+	if (cosLat < DR_MIN_COS_Q15) {
+		cosLat = DR_MIN_COS_Q15;
+	}
+	speed = GPS_MMPS(fix->speed);
+	north = 0;
+	east = 0;
+	fixStamp = stamp;
+	lastStamp = stamp;
+	anchored = TRUE;
+}
+
+/* ---------------------------- DeadReckon_update ----------------------------
+ @ Summary
+    Moves the estimate along the heading for the time since the last call
+ @ Parameters
+    @ param1 : heading, centidegrees
+    @ param2 : millisec now
+ @ Return Value
+    None
+ @ Notes
+    Call at the control rate. Speed times ms gives micrometers directly.
+  ---------------------------------------------------------------------------- */
+void DeadReckon_update(int32_t heading, unsigned int now) {
+	int32_t sine, cosine;
+	int32_t step;
+	unsigned int dt;
+
+	if (!anchored) {
+		return;
+	}
+	dt = now - lastStamp;
+	lastStamp = now;
+	if ((now - fixStamp) > DR_MAX_AGE) {
+		return;
+	}
+	if (dt > DR_MAX_STEP) {
+		dt = DR_MAX_STEP;
+	}
+
+	step = speed * (int32_t) dt;
+	FixedSinCos(heading, &sine, &cosine);
+	north += (int32_t) (((int64_t) step * cosine) >> 15);
+	east += (int32_t) (((int64_t) step * sine) >> 15);
+}
+
+/* --------------------------- DeadReckon_position ---------------------------
+ @ Summary
+    Current position estimate
+ @ Parameters
+    @ param1 : latitude, 1e-7 degree
+    @ param2 : longitude, 1e-7 degree
+ @ Return Value
+    BOOL : FALSE if there has been no fix or the last one is too old
+  ---------------------------------------------------------------------------- */
+BOOL DeadReckon_position(int32_t *lat, int32_t *lon) {
+	if (!anchored || ((lastStamp - fixStamp) > DR_MAX_AGE)) {
+		return FALSE;
+	}
+	*lat = anchorLat + north / DR_UM_PER_LAT;
+	*lon = anchorLon + (int32_t) (((int64_t) east << 15) / ((int64_t) cosLat * DR_UM_PER_LAT));
+	return TRUE;
+}
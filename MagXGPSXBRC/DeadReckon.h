@@ -0,0 +1,18 @@
+#ifndef __DEADRECKON_H__
+	#define __DEADRECKON_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+	#include "GPS_I2C.h"
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define DR_MAX_AGE			3000	// ms past the last fix before giving up
+	#define DR_MAX_STEP			100		// ms, longer gaps are clamped
+	#define DR_UM_PER_LAT		11132	// Micrometers per 1e-7 degree of latitude
+	#define DR_MIN_COS_Q15		1024	// Clamp on cos(lat), ~88 deg
+
+	// Function Prototypes
+	void DeadReckon_fix(const struct gps_time *fix, unsigned int stamp);
+	void DeadReckon_update(int32_t heading, unsigned int now);
+	BOOL DeadReckon_position(int32_t *lat, int32_t *lon);
+#endif
@@ -0,0 +1,285 @@
+// File Inclusion
+#include "FixedMath.h"
+#include <plib.h>
+#include <stdint.h>
+#include <math.h>
+
+/* ------------------------- CORDIC angle table ---------------------------
+   atan(2^-i) in centidegrees scaled by 256 (Q8). 16 steps resolve the angle
+   to well under 0.01 degree. */
+#define CORDIC_STEPS	16
+#define CORDIC_SHIFT	8
+#define CORDIC_GAIN_Q29	326016437	// 1/1.64676 (product of the step gains), Q29
+
+static const int32_t cordicAtan[CORDIC_STEPS] = {
+	1152000, 680065, 359328, 182400, 91554, 45822, 22916, 11459,
+	5730, 2865, 1432, 716, 358, 179, 90, 45
+};
+
+/* -------------------------------- FixedAtan2 -------------------------------
+ @ Summary
+    Four quadrant arc tangent of y/x using integer CORDIC vectoring
+ @ Parameters
+    @ param1 : y component, any int32 with |y| < 2^28
+    @ param2 : x component, any int32 with |x| < 2^28
+ @ Return Value
+    int32_t : angle in centidegrees, -18000 to +18000 (0 for 0,0)
+ @ Notes
+    Only the ratio of the inputs matters, so they are scaled up to at least
+    2^24 first to keep the shifts from throwing away precision. Worst case
+    error is 0.68 centidegree, see tests/test_fixedmath.c.
+  ---------------------------------------------------------------------------- */
+int32_t FixedAtan2(int32_t y, int32_t x) {
+	int32_t angle = 0;
+	int32_t xNew;
+	int step;
+
+	if ((x == 0) && (y == 0)) {
+		return 0;
+	}
+
+	// Rotate into the right half plane, CORDIC only converges for |angle| < 99 deg
+	if (x < 0) {
+		xNew = x;
+		if (y >= 0) {
+			x = y;
+			y = -xNew;
+			angle = CDEG_90 << CORDIC_SHIFT;
+		}
+		else {
+			x = -y;
+			y = xNew;
+			angle = -(CDEG_90 << CORDIC_SHIFT);
+		}
+	}
+
+	// x >= 0 here, bring the larger component to 2^24..2^25
+	while ((x < (1 << 24)) && (y < (1 << 24)) && (y > -(1 << 24))) {
+		x <<= 1;
+		y <<= 1;
+	}
+
+	for (step = 0; step < CORDIC_STEPS; step++) {
+		if (y > 0) {
+			xNew = x + (y >> step);
+			y -= (x >> step);
+			angle += cordicAtan[step];
+		}
+		else {
+			xNew = x - (y >> step);
+			y += (x >> step);
+			angle -= cordicAtan[step];
+		}
+		x = xNew;
+	}
+
+	// Round back to centidegrees
+	if (angle >= 0) {
+		return (angle + (1 << (CORDIC_SHIFT - 1))) >> CORDIC_SHIFT;
+	}
+	return -((-angle + (1 << (CORDIC_SHIFT - 1))) >> CORDIC_SHIFT);
+}
+
+/* ------------------------------- FixedWrap360 ------------------------------
+ @ Summary
+    Wraps an angle into 0 to 35999 centidegrees
+ @ Parameters
+    @ param1 : angle in centidegrees
+ @ Return Value
+    int32_t : the same direction in 0 <= angle < 36000
+  ---------------------------------------------------------------------------- */
+int32_t FixedWrap360(int32_t angle) {
+	angle %= CDEG_360;
+	if (angle < 0) {
+		angle += CDEG_360;
+	}
+	return angle;
+}
+
+/* -------------------------------- FixedSqrt --------------------------------
+ @ Summary
+    Integer square root, rounded down
+ @ Parameters
+    @ param1 : value
+ @ Return Value
+    uint32_t : floor(sqrt(value))
+ @ Notes
+    Bit by bit, 16 iterations, no multiply or divide.
+  ---------------------------------------------------------------------------- */
+uint32_t FixedSqrt(uint32_t value) {
+	uint32_t root = 0;
+	uint32_t bit = 1UL << 30;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+/* ------------------------------- FixedSqrt64 -------------------------------
+ @ Summary
+    Integer square root of a 64 bit value, rounded down
+ @ Parameters
+    @ param1 : value
+ @ Return Value
+    uint32_t : floor(sqrt(value))
+ @ Notes
+    Same bit by bit method as FixedSqrt, 32 iterations.
+  ---------------------------------------------------------------------------- */
+uint32_t FixedSqrt64(uint64_t value) {
+	uint64_t root = 0;
+	uint64_t bit = 1ULL << 62;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t) root;
+}
+
+/* ------------------------------- FixedSinCos -------------------------------
+ @ Summary
+    Sine and cosine of an angle using integer CORDIC rotation
+ @ Parameters
+    @ param1 : angle in centidegrees, any value
+    @ param2 : sine, Q15
+    @ param3 : cosine, Q15
+ @ Return Value
+    None
+ @ Notes
+    Same table as FixedAtan2. The vector starts pre-scaled by the CORDIC
+    gain in Q29 and is rounded to Q15 at the end, error is within 1 LSB.
+    Both results span -32768 to 32768.
+  ---------------------------------------------------------------------------- */
+void FixedSinCos(int32_t angle, int32_t *sine, int32_t *cosine) {
+	int32_t x = CORDIC_GAIN_Q29;
+	int32_t y = 0;
+	int32_t xNew;
+	int32_t z;
+	int flip = 0;
+	int step;
+
+	// Bring the angle to -90..+90, outside that both results change sign
+	angle = FixedWrap360(angle);
+	if (angle > CDEG_180) {
+		angle -= CDEG_360;
+	}
+	if (angle > CDEG_90) {
+		angle -= CDEG_180;
+		flip = 1;
+	}
+	else if (angle < -CDEG_90) {
+		angle += CDEG_180;
+		flip = 1;
+	}
+
+	z = angle << CORDIC_SHIFT;
+	for (step = 0; step < CORDIC_STEPS; step++) {
+		if (z >= 0) {
+			xNew = x - (y >> step);
+			y += (x >> step);
+			z -= cordicAtan[step];
+		}
+		else {
+			xNew = x + (y >> step);
+			y -= (x >> step);
+			z += cordicAtan[step];
+		}
+		x = xNew;
+	}
+
+	x = (x + (1 << 13)) >> 14;
+	y = (y + (1 << 13)) >> 14;
+	if (flip) {
+		x = -x;
+		y = -y;
+	}
+	*sine = y;
+	*cosine = x;
+}
+
+/* ------------------------------ FixedMath_bench ----------------------------
+ @ Summary
+    Times each function on the target with the core timer
+ @ Parameters
+    @ param1 : core timer ticks per call, filled in
+ @ Return Value
+    None
+ @ Notes
+    Each function runs FIXED_BENCH_CALLS times over a spread of inputs with
+    interrupts off, less the same loop with no call in it. One core timer
+    tick is two instruction cycles. atan2f is timed on the same inputs as
+    FixedAtan2, scaled to centidegrees, to show what the float version
+    it replaced costs. Blocks for a few milliseconds, for the PF command
+    only.
+  ---------------------------------------------------------------------------- */
+void FixedMath_bench(FIXED_BENCH *ticks) {
+	volatile int32_t sink = 0;
+	int32_t s, c;
+	unsigned int status;
+	unsigned int tStart;
+	unsigned int empty;
+	int i;
+
+	status = INTDisableInterrupts();
+
+	tStart = ReadCoreTimer();
+	for (i = 0; i < FIXED_BENCH_CALLS; i++) {
+		sink = i * 4099 - 1200000;
+	}
+	empty = ReadCoreTimer() - tStart;
+
+	tStart = ReadCoreTimer();
+	for (i = 0; i < FIXED_BENCH_CALLS; i++) {
+		sink = FixedAtan2(i * 4099 - 1200000, 700000 - i * 2053);
+	}
+	ticks->atan2 = (ReadCoreTimer() - tStart - empty) / FIXED_BENCH_CALLS;
+
+	tStart = ReadCoreTimer();
+	for (i = 0; i < FIXED_BENCH_CALLS; i++) {
+		FixedSinCos(i * 71 - 18000, &s, &c);
+		sink = s + c;
+	}
+	ticks->sinCos = (ReadCoreTimer() - tStart - empty) / FIXED_BENCH_CALLS;
+
+	tStart = ReadCoreTimer();
+	for (i = 0; i < FIXED_BENCH_CALLS; i++) {
+		sink = FixedSqrt((uint32_t) i * 8388593u);
+	}
+	ticks->sqrt = (ReadCoreTimer() - tStart - empty) / FIXED_BENCH_CALLS;
+
+	tStart = ReadCoreTimer();
+	for (i = 0; i < FIXED_BENCH_CALLS; i++) {
+		sink = FixedSqrt64((uint64_t) i * 36028797018963913ull);
+	}
+	ticks->sqrt64 = (ReadCoreTimer() - tStart - empty) / FIXED_BENCH_CALLS;
+
+	tStart = ReadCoreTimer();
+	for (i = 0; i < FIXED_BENCH_CALLS; i++) {
+		sink = (int32_t) (atan2f((float) (i * 4099 - 1200000), (float) (700000 - i * 2053))
+						  * (CDEG_180 / 3.14159265f));
+	}
+	ticks->atan2Float = (ReadCoreTimer() - tStart - empty) / FIXED_BENCH_CALLS;
+
+	INTRestoreInterrupts(status);
+	(void) sink;
+}
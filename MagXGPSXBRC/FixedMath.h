@@ -0,0 +1,31 @@
+#ifndef __FIXEDMATH_H__
+	#define __FIXEDMATH_H__
+
+	#include <stdint.h>
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define CDEG_90			9000	// Angles are in centidegrees (0.01 deg)
+	#define CDEG_180		18000
+	#define CDEG_360		36000
+
+	#define Q15_ONE			32767	// Largest Q15 value, ~1.0
+
+	#define FIXED_BENCH_CALLS	256		// Calls per function in FixedMath_bench
+
+	// Core timer ticks per call, from FixedMath_bench
+	typedef struct {
+		unsigned int atan2;
+		unsigned int sinCos;
+		unsigned int sqrt;
+		unsigned int sqrt64;
+		unsigned int atan2Float;	// Soft float atan2f to cdeg, the baseline for atan2
+	} FIXED_BENCH;
+
+	// Function Prototypes
+	int32_t FixedAtan2(int32_t y, int32_t x);
+	int32_t FixedWrap360(int32_t angle);
+	uint32_t FixedSqrt(uint32_t value);
+	uint32_t FixedSqrt64(uint64_t value);
+	void FixedSinCos(int32_t angle, int32_t *sine, int32_t *cosine);
+	void FixedMath_bench(FIXED_BENCH *ticks);
+#endif
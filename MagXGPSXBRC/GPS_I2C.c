@@ -6,12 +6,41 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdarg.h>
 
 #include "i2c_lib.h"
-#include "swDelay.h"
+#include "NMEA.h"
 
-// Global Variables
-BYTE gpsStr[256]= {0};
+// Background stream reads
+static I2C_ASYNC_REQ streamReq;
+static BYTE streamChunk[GPS_CHUNK_SIZE];
+static BOOL streamIssued = FALSE;
+static unsigned int streamNext = 0;
+static BYTE streamLast = 0;
+
+///* --- Function Prototyping --- */
+static int BuildPacket(char *packet, int size, int command, const char *format, va_list args);
+static void CommandAck(void);
+static void CommandTimeout(void);
+
+// Command waiting for its $PMTK001, kept whole so it can be sent again
+static char cmdPacket[GPS_CMD_MAX];
+static int cmdNumber;
+static int cmdTries;
+static unsigned int cmdSent;
+static GPS_CMD_STATE cmdState = GPS_CMD_IDLE;
+
+// Fix rates tried at startup, fastest first
+static const struct {
+	int period;		// ms between fixes (PMTK300) and sentences (PMTK220)
+	int hz;
+} rateLadder[] = {
+	{100,  10},
+	{200,  5},
+	{500,  2},
+	{1000, 1}
+};
+#define RATE_STEPS	(sizeof(rateLadder) / sizeof(rateLadder[0]))
 
 /* ------------------------------- setGPS_RMC --------------------------------
   @ Summary
@@ -23,91 +52,139 @@ BYTE gpsStr[256]= {0};
   ---------------------------------------------------------------------------- */
 I2C_RESULT setGPS_RMC(void) {
 	I2C_RESULT i2cFlag;
-	int dly = 0;
-	do {
-		i2cFlag = sendMTKpacket(PMTK_SET_NMEA_OUTPUT_RMCONLY);
-		DelayMs(MAXWAITSENTENCE);
-	} while (dly);
+
+	i2cFlag = GPS_command(314, "0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0");
+	if ((i2cFlag == I2C_SUCCESS) && !GPS_commandWait()) {
+		i2cFlag = I2C_ERROR;
+	}
 	
 	return i2cFlag;
 }
 
-/* ----------------------------- GPS_DECODE_RMC ------------------------------
+/* ------------------------------- GPS_service -------------------------------
   @ Summary
-	 Reads the $GNRMC message of the GPS
+	 Reads the GPS a chunk at a time in the background and parses it
   @ Description
-	 The struct in GPS_I2C.h has values filled upon function call
+	 Each call hands a finished chunk to the NMEA parser and, when it is
+	 time, queues the next GPS_CHUNK_SIZE byte read on the I2C interrupt.
+	 It never waits on the bus, so it can be called every loop pass.
   @ Parameters
-	 param1 : String read from the GPS that is to be parsed
+	 None
   @ Returns
-	 int : How long the parsed communication was
+	 BOOL : TRUE if an RMC sentence was taken into gps during this call
+  @ Notes
+	 With its buffer empty the module answers with 0x0A filler. A 0x0A
+	 that does not follow a CR is filler and is dropped. A chunk of nothing
+	 but filler means the next fix is not ready, so reads back off to
+	 GPS_IDLE_MS. A read that stalls on the bus is failed by
+	 I2C_AsyncWatchdog and handled like any other failed read.
   ---------------------------------------------------------------------------- */
-int GPS_DECODE_RMC(BYTE *str) {
-	char *s2, *pos, *eol;
-	int len = 0;
-
-	// Ignore all substrings that do not have $GNRMC in them
-	s2 = strstr(str, "$GNRMC");
-	if (s2 != NULL) {
-		eol = strchr(s2, LF);
-		if (eol != NULL) {
-			len = (int) (eol - s2);
-			if (len > 70) {	// Test for full message
-				s2[len - 1] = 0;
-				printf("%s --> %d \n\r", s2, len - 1);
-
-				// Read the serial communication, store results in corresponding gps struct
-				sscanf(s2,"$GNRMC,%d.000,%c,%f,%c,%f,%c,%f,%f,%d,,,%c*%x",\
-						   &gps.utc_time,&gps.status,&gps.lat,&gps.ns,&gps.lon,\
-						   &gps.ew,&gps.speed,&gps.angle,&gps.date,&gps.mode,\
-						   &gps.cksum);
-			}
-			else {
-				printf("%s --> %d \n\r", s2, len - 1);
-				len = 0;
+BOOL GPS_service(void) {
+	BOOL newFix = FALSE;
+	BOOL data = FALSE;
+	int i;
+
+	I2C_AsyncWatchdog();
+	if (streamIssued) {
+		if (streamReq.busy) {
+			return FALSE;
+		}
+		streamIssued = FALSE;
+		if (streamReq.result == I2C_SUCCESS) {
+			for (i = 0; i < GPS_CHUNK_SIZE; i++) {
+				if ((streamChunk[i] == LF) && (streamLast != '\r')) {
+					continue;
+				}
+				streamLast = streamChunk[i];
+				data = TRUE;
+				switch (NMEA_parse(streamChunk[i], &gps)) {
+					case NMEA_RMC:
+						newFix = TRUE;
+						break;
+					case NMEA_PMTK_ACK:
+						CommandAck();
+						break;
+					default:
+						break;
+				}
 			}
 		}
+		streamNext = millisec + (data ? GPS_CHUNK_MS : GPS_IDLE_MS);
 	}
-	
-	return len;
+
+	CommandTimeout();
+
+	if ((int) (millisec - streamNext) >= 0) {
+		streamReq.dev_id = GPS_DEV_ID;
+		streamReq.read_only = TRUE;
+		streamReq.data = streamChunk;
+		streamReq.len = GPS_CHUNK_SIZE;
+		streamReq.done = NULL;
+		if (I2C_WriteReadAsync(&streamReq) == I2C_SUCCESS) {
+			streamIssued = TRUE;
+		}
+	}
+
+	return newFix;
 }
 
-/* -------------------------------- ReportGPS --------------------------------
+/* ---------------------------- GPS_negotiateRate ----------------------------
   @ Summary
-	 Reads from the GPS, and returns the value as a result
+	 Finds the fastest fix rate the module and the bus keep up with
   @ Description
-	 Function for actually filling a struct with GPS results
+	 Steps down the rate ladder from 10 Hz. At each step the fix and output
+	 rates are set, the first GPS_RATE_SETTLE_MS of output is discarded and
+	 the distinct RMC times seen in GPS_RATE_WINDOW_MS are counted. The first
+	 rate that delivers 90% of its fixes is kept.
   @ Parameters
-	 @ param1 : Boolean on whether or not to output each GPS read
+	 None
   @ Returns
-	 I2C_RESULT : Struct to fill with GPS results
+	 int : fix rate in Hz, 0 if no rate delivered (left at 1 Hz)
+  @ Notes
+	 Blocking, up to 16 s, meant for startup. Output should already be
+	 limited to RMC so the sentences fit the bus at 10 Hz. A rate that only
+	 repeats the last fix (older firmware at 10 Hz) does not count, as its
+	 RMC time does not change.
   ---------------------------------------------------------------------------- */
-I2C_RESULT ReportGPS (int show) {
-	I2C_RESULT i2cFlag;
-	int len = 255;
-	static int hour, min, sec;
-	int pkt_len = 0;
-
-	DelayMs(5);	 // Give GPS time to up load new buffer
-	len = MAX_PACKET_SIZE;
-	i2cFlag = I2C_Read(I2C1, GPS_DEV_ID, gpsStr, &len);
-
-	if (i2cFlag == I2C_SUCCESS && (len > 73) && (len < 256)); {
-		gpsStr[len] = 0;
-		pkt_len = GPS_DECODE_RMC(gpsStr);
-		if (show) {
-			hour = (gps.utc_time / 10000);
-			min = (gps.utc_time - hour * 10000) / 100;
-			sec = (gps.utc_time - (hour * 10000 + min * 100));
-			hour -= 7;
-			if (hour < 0)
-				hour += 24;  
-			printf("Time: %2d:%2d:%2d  LAT:%f  LON:%f\n\r",\
-					hour, min, sec, gps.lon, gps.lat);
+int GPS_negotiateRate(void) {
+	unsigned int tStart;
+	unsigned int lastTime;
+	unsigned int lastMs;
+	int fixes;
+	int step;
+
+	for (step = 0; step < RATE_STEPS; step++) {
+		GPS_command(300, "%d,0,0,0,0", rateLadder[step].period);
+		if (!GPS_commandWait()) {
+			continue;		// Fix rate not accepted, try the next one down
+		}
+		GPS_command(220, "%d", rateLadder[step].period);
+		GPS_commandWait();
+
+		tStart = millisec;
+		while ((millisec - tStart) < GPS_RATE_SETTLE_MS) {
+			GPS_service();
+		}
+
+		fixes = 0;
+		lastTime = 0xFFFFFFFF;
+		lastMs = 0;
+		tStart = millisec;
+		while ((millisec - tStart) < GPS_RATE_WINDOW_MS) {
+			if (GPS_service() && ((gps.utc_time != lastTime) || (gps.utc_ms != lastMs))) {
+				lastTime = gps.utc_time;
+				lastMs = gps.utc_ms;
+				fixes++;
+			}
+		}
+
+		printf("GPS %d Hz: %d fixes in %d ms\n\r", rateLadder[step].hz, fixes, GPS_RATE_WINDOW_MS);
+		if ((fixes * 1000 * 10) >= (rateLadder[step].hz * GPS_RATE_WINDOW_MS * 9)) {
+			return rateLadder[step].hz;
 		}
 	}
-		
-	return i2cFlag;   
+
+	return 0;
 }
 
 /* ------------------------------ sendMTKpacket ------------------------------
@@ -129,10 +206,196 @@ I2C_RESULT sendMTKpacket (char *packet) {
 		i2cFlag = I2C_ERROR;
 	}
 	else {
-		printf("GPS command: %s", packet);
-		i2cFlag = I2C_Write(I2C1, GPS_DEV_ID, packet, &len);
+		i2cFlag = I2C_Write(I2C1, GPS_DEV_ID, (BYTE *) packet, &len);
 	}
-	DelayMs(MAXWAITSENTENCE);
 	
 	return i2cFlag;
+}
+
+/* ------------------------------ calcCRCforMTK ------------------------------
+  @ Summary
+	 Works out the NMEA checksum of a sentence
+  @ Parameters
+	 @ param1 : sentence, a leading '$' is skipped, stops at '*' or the end
+	 @ param2 : two hex digits and a terminator are written here, may be NULL
+  @ Returns
+	 BYTE : XOR of the bytes between $ and *
+  ---------------------------------------------------------------------------- */
+BYTE calcCRCforMTK(char *sentence, char *crcStr) {
+	static const char hex[] = "0123456789ABCDEF";
+	BYTE crc = 0;
+
+	if (*sentence == '$') {
+		sentence++;
+	}
+	while ((*sentence != 0) && (*sentence != '*')) {
+		crc ^= (BYTE) *sentence++;
+	}
+	if (crcStr != NULL) {
+		crcStr[0] = hex[crc >> 4];
+		crcStr[1] = hex[crc & 0x0F];
+		crcStr[2] = 0;
+	}
+
+	return crc;
+}
+
+/* ----------------------------- buildMTKpacket ------------------------------
+  @ Summary
+	 Formats a complete PMTK sentence: $PMTKnnn,<args>*hh<CR><LF>
+  @ Parameters
+	 @ param1 : buffer for the sentence
+	 @ param2 : size of the buffer
+	 @ param3 : PMTK command number
+	 @ param4 : printf format of the arguments, "" or NULL for none
+  @ Returns
+	 int : length of the sentence, 0 if it does not fit
+  ---------------------------------------------------------------------------- */
+int buildMTKpacket(char *packet, int size, int command, const char *format, ...) {
+	va_list args;
+	int len;
+
+	va_start(args, format);
+	len = BuildPacket(packet, size, command, format, args);
+	va_end(args);
+
+	return len;
+}
+
+/* ------------------------------- GPS_command -------------------------------
+  @ Summary
+	 Builds and sends a PMTK command, then tracks its acknowledgement
+  @ Parameters
+	 @ param1 : PMTK command number
+	 @ param2 : printf format of the arguments, then the arguments
+  @ Returns
+	 I2C_RESULT : I2C_ERROR if the sentence cannot be built or sent
+  @ Notes
+	 One command is tracked at a time, a new one replaces the old. GPS_service
+	 matches the $PMTK001 reply and resends after GPS_ACK_TIMEOUT_MS, up to
+	 GPS_CMD_RETRIES times. Poll GPS_commandState or use GPS_commandWait.
+  ---------------------------------------------------------------------------- */
+I2C_RESULT GPS_command(int command, const char *format, ...) {
+	I2C_RESULT i2cFlag;
+	va_list args;
+
+	va_start(args, format);
+	if (BuildPacket(cmdPacket, sizeof(cmdPacket), command, format, args) == 0) {
+		va_end(args);
+		cmdState = GPS_CMD_FAILED;
+		return I2C_ERROR;
+	}
+	va_end(args);
+
+	cmdNumber = command;
+	cmdTries = 0;
+	cmdSent = millisec;
+	cmdState = GPS_CMD_PENDING;
+	i2cFlag = sendMTKpacket(cmdPacket);
+
+	return i2cFlag;
+}
+
+/* ---------------------------- GPS_commandState -----------------------------
+  @ Summary
+	 Where the last GPS_command has got to
+  ---------------------------------------------------------------------------- */
+GPS_CMD_STATE GPS_commandState(void) {
+	return cmdState;
+}
+
+/* ----------------------------- GPS_commandWait -----------------------------
+  @ Summary
+	 Runs the GPS stream until the last command is acknowledged or fails
+  @ Returns
+	 BOOL : TRUE if the module acknowledged it
+  @ Notes
+	 Blocking, at most (GPS_CMD_RETRIES + 1) * GPS_ACK_TIMEOUT_MS. Usually
+	 returns within a few tens of ms, as soon as the $PMTK001 arrives.
+  ---------------------------------------------------------------------------- */
+BOOL GPS_commandWait(void) {
+	while (cmdState == GPS_CMD_PENDING) {
+		GPS_service();
+	}
+
+	return (cmdState == GPS_CMD_ACKED);
+}
+
+/* ------------------------------- BuildPacket -------------------------------
+  @ Summary
+	 buildMTKpacket with the arguments already gathered
+  ---------------------------------------------------------------------------- */
+static int BuildPacket(char *packet, int size, int command, const char *format, va_list args) {
+	int len;
+	int more;
+
+	len = snprintf(packet, size, "$PMTK%03d", command);
+	if ((format != NULL) && (*format != 0) && (len < size)) {
+		packet[len++] = ',';
+		more = vsnprintf(&packet[len], size - len, format, args);
+		if (more < 0) {
+			return 0;
+		}
+		len += more;
+	}
+	// '*', two hex digits, CR, LF and the terminator
+	if ((len + 6) > size) {
+		return 0;
+	}
+	packet[len++] = '*';
+	calcCRCforMTK(packet, &packet[len]);
+	len += 2;
+	packet[len++] = '\r';
+	packet[len++] = '\n';
+	packet[len] = 0;
+
+	return len;
+}
+
+/* ------------------------------- CommandAck --------------------------------
+  @ Summary
+	 Matches a $PMTK001 to the command being tracked
+  @ Notes
+	 A command that was understood but failed is sent again, invalid or
+	 unsupported ones are not.
+  ---------------------------------------------------------------------------- */
+static void CommandAck(void) {
+	int command;
+	int flag;
+
+	NMEA_lastAck(&command, &flag);
+	if ((cmdState != GPS_CMD_PENDING) || (command != cmdNumber)) {
+		return;
+	}
+	if (flag == PMTK_ACK_SUCCESS) {
+		cmdState = GPS_CMD_ACKED;
+	}
+	else if ((flag == PMTK_ACK_FAILED) && (cmdTries < GPS_CMD_RETRIES)) {
+		cmdTries++;
+		cmdSent = millisec;
+		sendMTKpacket(cmdPacket);
+	}
+	else {
+		printf("GPS rejected PMTK%03d (%d)\n\r", cmdNumber, flag);
+		cmdState = GPS_CMD_FAILED;
+	}
+}
+
+/* ----------------------------- CommandTimeout ------------------------------
+  @ Summary
+	 Resends a command whose acknowledgement is overdue
+  ---------------------------------------------------------------------------- */
+static void CommandTimeout(void) {
+	if ((cmdState != GPS_CMD_PENDING) || ((millisec - cmdSent) < GPS_ACK_TIMEOUT_MS)) {
+		return;
+	}
+	if (cmdTries < GPS_CMD_RETRIES) {
+		cmdTries++;
+		cmdSent = millisec;
+		sendMTKpacket(cmdPacket);
+	}
+	else {
+		printf("GPS did not acknowledge PMTK%03d\n\r", cmdNumber);
+		cmdState = GPS_CMD_FAILED;
+	}
 }
\ No newline at end of file
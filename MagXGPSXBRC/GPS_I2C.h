@@ -1,6 +1,8 @@
 /* --------------------- Guarding against multiple inclusion ----------------- */
 #ifndef __GPS_I2C_H__
 	#define __GPS_I2C_H__
+
+	#include <stdint.h>
    
 	/* ----------------- Public Global Variables / Constants ----------------- */
 	#define GPS_MPH_PER_KNOT    1.15077945
@@ -8,25 +10,47 @@
 	#define GPS_KMPH_PER_KNOT   1.852
 	#define GPS_MILES_PER_METER 0.00062137112
 	#define GPS_KM_PER_METER    0.001
+	#define GPS_DEG_SCALE       10000000	// lat/lon units per degree
+	// Centiknots (gps.speed) to mm/s, rounded: a knot is exactly 463/900 m/s
+	#define GPS_MMPS(centiknots) ((((int32_t) (centiknots)) * 463 + 45) / 90)
 
 	#define LF                  0x0A
 	#define GPS_DEV_ID          0x10    // I2C device address
 
 	#define MAX_PACKET_SIZE     255
+	#define GPS_CHUNK_SIZE      32      // Bytes per background read
+	#define GPS_CHUNK_MS        5       // Between reads while the module has data
+	#define GPS_IDLE_MS         50      // After a read that was all filler
+	#define GPS_RATE_SETTLE_MS  1000    // Ignore fixes right after a rate change
+	#define GPS_RATE_WINDOW_MS  3000    // Fixes are counted over this long
+	#define GPS_CMD_MAX         80      // Longest PMTK sentence that can be built
+	#define GPS_ACK_TIMEOUT_MS  300     // Wait for $PMTK001 before sending again
+	#define GPS_CMD_RETRIES     2       // Resends before a command has failed
+
+	/* ------------------- $PMTK001 acknowledgement flags -------------------- */
+	#define PMTK_ACK_INVALID    0
+	#define PMTK_ACK_UNSUPPORTED 1
+	#define PMTK_ACK_FAILED     2
+	#define PMTK_ACK_SUCCESS    3
 
 	/* --------- Structure to hold the information in the GPS Packet --------- */
 	struct gps_time {
 		unsigned int utc_time;
+		unsigned int utc_ms;		// Fraction of utc_time
 		char status;
-		float lat;
+		int32_t lat;			// 1e-7 degree, south negative
 		char ns;
-		float lon;
+		int32_t lon;			// 1e-7 degree, west negative
 		char ew;
-		float speed;
-		float angle;
+		int32_t speed;			// Centiknots
+		int32_t angle;			// Course, centidegrees
 		unsigned int date;
 		char mode;
 		int cksum;
+		unsigned char quality;		// GGA fix quality, 0 = no fix
+		unsigned char satellites;	// GGA satellites in use
+		int32_t hdop;			// Hundredths
+		int32_t altitude;		// GGA, cm above mean sea level
 	};
 
 	/* ------------------- Commands to set the update rate ------------------- */
@@ -41,7 +65,9 @@
 	#define PMTK_API_SET_FIX_CTL_100_MILLIHERTZ  "$PMTK300,10000,0,0,0,0*2C\r\n"	// .1 Hz
 	#define PMTK_API_SET_FIX_CTL_200_MILLIHERTZ  "$PMTK300,5000,0,0,0,0*18\r\n"		// .2 Hz
 	#define PMTK_API_SET_FIX_CTL_1HZ  "$PMTK300,1000,0,0,0,0*1C\r\n"				// 1 Hz
+	#define PMTK_API_SET_FIX_CTL_2HZ  "$PMTK300,500,0,0,0,0*28\r\n"					// 2 Hz
 	#define PMTK_API_SET_FIX_CTL_5HZ  "$PMTK300,200,0,0,0,0*2F\r\n"					// 5 Hz, max refresh rate
+	#define PMTK_API_SET_FIX_CTL_10HZ "$PMTK300,100,0,0,0,0*2C\r\n"					// 10 Hz, newer firmware only
 
 	#define PMTK_SET_BAUD_57600 "$PMTK251,57600*2C\r\n"
 	#define PMTK_SET_BAUD_9600  "$PMTK251,9600*17\r\n"
@@ -79,15 +105,25 @@
 	#define MAXWAITSENTENCE         10
 
 	#include <plib.h>
+
+	typedef enum {
+		GPS_CMD_IDLE = 0,
+		GPS_CMD_PENDING,		// Sent, waiting for $PMTK001
+		GPS_CMD_ACKED,
+		GPS_CMD_FAILED			// Rejected, or no ACK after the retries
+	} GPS_CMD_STATE;
 	
 	struct gps_time gps;
-	extern BYTE gpsStr[256];
     
 	/* ---------------------- Public Function declarations ------------------- */
 	I2C_RESULT GPS_I2C_Read(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE *str, int *len);
-	int GPS_DECODE_RMC(BYTE *str);
-	I2C_RESULT ReportGPS(int show);
 	I2C_RESULT sendMTKpacket(char *command);
 	I2C_RESULT setGPS_RMC(void);
+	BOOL GPS_service(void);
+	int GPS_negotiateRate(void);
 	BYTE calcCRCforMTK(char *sentence, char *crcStr); //XORs all bytes between $ and *
+	int buildMTKpacket(char *packet, int size, int command, const char *format, ...);
+	I2C_RESULT GPS_command(int command, const char *format, ...);
+	GPS_CMD_STATE GPS_commandState(void);
+	BOOL GPS_commandWait(void);
 #endif
\ No newline at end of file
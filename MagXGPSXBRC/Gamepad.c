@@ -7,6 +7,9 @@
 #include "uart4.h"
 #include "hardware.h"
 #include "RC.h"
+#include "Mode.h"
+#include "Cruise.h"
+#include "Gamepad.h"
 
 #include "DMA_UART2.h"
 #include <plib.h>
@@ -41,22 +44,6 @@ enum GamepadVariables{
     GAME_BUTTON_BACK
 };
 
-typedef struct pair
-{
-	int m_CompOne;
-	int m_CompTwo;
-} 
-Pair;
-
-typedef struct buttons
-{
-	int m_ButtonY;
-	int m_ButtonB;
-	int m_ButtonA;
-	int m_ButtonX;
-}
-Buttons;
-
 typedef struct gamepadInput
 {
 	unsigned int m_LeftTrigger;
@@ -81,7 +68,20 @@ GamepadInput;
 // The main object that handles input
 static GamepadInput GamepadInputManager;
 
+// The last complete report, published for everything else to read.
+// Only the main loop writes it. PublishedSeq is odd while it is being
+// written, so a reader that lands part way through tries again; an
+// interrupt never writes it, it posts an event instead.
+static volatile GamepadFrame PublishedFrame;
+static volatile unsigned int PublishedSeq = 0;
+
+// Bumped by interrupts, GamepadEvents() acts on each change
+static volatile unsigned int CenterPosted = 0;
+static unsigned int CenterHandled = 0;
+
 static void MoveLeft(int movement);
+static void ModeInput();
+static void Publish();
 
 //
 // GamepadInit()
@@ -118,6 +118,7 @@ int GamepadInit()
     GamepadInputManager.m_Buttons.m_ButtonY = 0;
     GamepadInputManager.m_Buttons.m_ButtonX = 0;
 
+    Publish();
 }
 
 //
@@ -125,6 +126,8 @@ int GamepadInit()
 // Parses the string and places all of the 
 // approp. variables into their corresponding
 // vars in the GamepadInputManager object.
+// Returns 0 for a whole report, every field
+// there and a number, -1 for anything else.
 //
 int ParseInput(char* String)
 {
@@ -133,6 +136,7 @@ int ParseInput(char* String)
 	int j = 0;
 	int Variable = GAME_TIME;
 	int FullVariable = 0;
+	int Bad = 0;
 	char Temp[16];
 	int time = 0;
 	char* end;
@@ -145,16 +149,18 @@ int ParseInput(char* String)
 	}
 
 	// Parsing the string
-	for (i = 0; i < 512; i++)
+	for (i = 0; i < 512 && String[i] != 0; i++)
 	{
 
 		if (!isspace(String[i]))
 		{
 			// Copying contents of this variable
-			for (j = 0; j < 16 && !isspace(String[i]); j++, i++)
+			for (j = 0; j < 15 && String[i] != 0 && !isspace(String[i]); j++, i++)
 			{
 				Temp[j] = String[i];
 			}
+			if (String[i] != 0 && !isspace(String[i]))
+				Bad = 1;			// Longer than any number
 
 			Temp[j] = 0;			// Append null termination
 			end = &(Temp[j - 1]);	// ptr to end of this section
@@ -173,6 +179,7 @@ int ParseInput(char* String)
 			case GAME_TRIGGER_LEFT:
 
 				time = strtol(Temp, &end, 10);
+                GamepadInputManager.m_LeftTrigger = time;
             #ifdef Debug
 				printf("GAME_TRIGGER_LEFT %s\n", Temp);
             #endif
@@ -187,6 +194,7 @@ int ParseInput(char* String)
 				break;
 			case GAME_TRIGGER_RIGHT:
 				time = strtol(Temp, &end, 10);
+                GamepadInputManager.m_RightTrigger = time;
                 #ifdef Debug
 				printf("GAME_TRIGGER_RIGHT %s\n", Temp);
                 #endif
@@ -268,12 +276,14 @@ int ParseInput(char* String)
 			case GAME_BUTTON_START:
 
 				time = strtol(Temp, &end, 10);
+                GamepadInputManager.m_StartButton = time;
 				//printf("GAME_BUTTON_START %d\n", time);
 
 				break;
 			case GAME_BUTTON_BACK:
 
 				time = strtol(Temp, &end, 10);
+                GamepadInputManager.m_BackButton = time;
 				//printf("GAME_BUTTON_BACK %d\n", time);
 
 				break;
@@ -282,16 +292,27 @@ int ParseInput(char* String)
 				break;
 			}
 
+			// Not all of the field was a number
+			if (Variable <= GAME_BUTTON_BACK && *end != 0)
+				Bad = 1;
+
 			// Move to the next variable
 			Variable++;
+			if (String[i] == 0)
+				break;
 		}
 	}
+
+	if (Bad || Variable <= GAME_BUTTON_BACK)
+		return -1;
+	return 0;
 }
 
 //
 // HandleInput()
 // Call this function to handle all input from the 
-// gamepad and XBee modules.
+// gamepad and XBee modules. Returns 1 if it was a
+// whole report and went out, 0 if it was dropped.
 //
 int HandleInput()
 {
@@ -306,12 +327,13 @@ int HandleInput()
 	if (CharReceived)
 	{
 		// Adding this character to the approp. position in the object
-        for(i; dmaBuff[i] != 0; i++)
+        for(i; dmaBuff[i] != 0 && GamepadInputManager.m_Offset < 511; i++)
         {
             GamepadInputManager.m_InputString[GamepadInputManager.m_Offset] = dmaBuff[i];
             // Incrementing the offset of this array
             GamepadInputManager.m_Offset++;
         }
+        GamepadInputManager.m_InputString[GamepadInputManager.m_Offset] = 0;
 
 		// If the null char was present
 		
@@ -322,9 +344,115 @@ int HandleInput()
 			//printf("%s \nFull string received\n", GamepadInputManager.m_InputString);
             
             
-			ParseInput(GamepadInputManager.m_InputString);
+			if(ParseInput(GamepadInputManager.m_InputString) != 0)
+				return 0;
+			Publish();
+			ModeInput();
 	}
-	return 0;
+	return 1;
+}
+
+//
+// ModeInput()
+// Start and Back change the mode on the press, not
+// while held, as every report repeats them. Back wins
+// if both are down. The triggers go to the assisted
+// mode heading trim.
+//
+static void ModeInput()
+{
+    static int lastStart = 0;
+    static int lastBack = 0;
+    GamepadFrame Frame;
+
+    if(!GamepadSnapshot(&Frame))
+        return;
+
+    if (Frame.m_BackButton && !lastBack)
+    {
+        Mode_event(MODE_EV_BACK);
+    }
+    else if (Frame.m_StartButton && !lastStart)
+    {
+        Mode_event(MODE_EV_START);
+    }
+    lastStart = Frame.m_StartButton;
+    lastBack = Frame.m_BackButton;
+
+    Mode_trim(Frame.m_LeftTrigger, Frame.m_RightTrigger);
+}
+
+//
+// Publish()
+// Copies the parsed report out for GamepadSnapshot().
+// Main loop only.
+//
+static void Publish()
+{
+    PublishedSeq++;
+    PublishedFrame.m_Version = (PublishedSeq + 1) / 2;
+    PublishedFrame.m_LeftTrigger = GamepadInputManager.m_LeftTrigger;
+    PublishedFrame.m_RightTrigger = GamepadInputManager.m_RightTrigger;
+    PublishedFrame.m_SendTime = GamepadInputManager.m_SendTime;
+    PublishedFrame.m_LeftBumper = GamepadInputManager.m_LeftBumper;
+    PublishedFrame.m_RightBumper = GamepadInputManager.m_RightBumper;
+    PublishedFrame.m_StartButton = GamepadInputManager.m_StartButton;
+    PublishedFrame.m_BackButton = GamepadInputManager.m_BackButton;
+    PublishedFrame.m_LeftSticks = GamepadInputManager.m_LeftSticks;
+    PublishedFrame.m_RightSticks = GamepadInputManager.m_RightSticks;
+    PublishedFrame.m_DirPad = GamepadInputManager.m_DirPad;
+    PublishedFrame.m_Buttons = GamepadInputManager.m_Buttons;
+    PublishedSeq++;
+}
+
+//
+// GamepadSnapshot()
+// Copies the last published report into Frame, all
+// from the same report. Never waits on the writer: an
+// interrupt that lands part way through a publish gets
+// 0 back and should keep the frame it had.
+//
+int GamepadSnapshot(GamepadFrame* Frame)
+{
+    unsigned int seq;
+    int tries;
+
+    for(tries = 0; tries < GAMEPAD_SNAPSHOT_TRIES; tries++)
+    {
+        seq = PublishedSeq;
+        *Frame = PublishedFrame;
+        if(!(seq & 1) && (seq == PublishedSeq))
+            return 1;
+    }
+    return 0;
+}
+
+//
+// GamepadPostCenter()
+// Called from the change notice interrupt in place of
+// centering there: it only counts, GamepadEvents() does
+// the work in the main loop.
+//
+void GamepadPostCenter()
+{
+    CenterPosted++;
+}
+
+//
+// GamepadEvents()
+// Call every main loop pass. Centers the rudder and clears
+// the stick once for however many centers were posted.
+//
+void GamepadEvents()
+{
+    unsigned int posted = CenterPosted;
+
+    if(posted != CenterHandled)
+    {
+        CenterHandled = posted;
+        SetDefaultServoPosition();
+        ClearLeftStick();
+    }
 }
 
 
@@ -371,42 +499,55 @@ void MoveRight(int movement)
 
 void Move()
 {
+    static unsigned int lastButtonA = 0;
+    GamepadFrame Frame;
     int temp = 0;
     
-    if(GamepadInputManager.m_Buttons.m_ButtonA)
+    if(!GamepadSnapshot(&Frame))
+        return;
+
+    // Once per report that has A down
+    if(Frame.m_Buttons.m_ButtonA && (Frame.m_Version != lastButtonA))
     {
         SetDefaultServoPosition();
-        GamepadInputManager.m_Buttons.m_ButtonA = 0;
-    }
-    if((temp = GamepadInputManager.m_LeftSticks.m_CompOne) < 0)   
-    {
-        //TurnLeftPos(-5);
-        TurnLeftPos(-temp);
-        //printf("tempL %d\n", temp);
+        lastButtonA = Frame.m_Version;
     }
-    else if((temp = GamepadInputManager.m_LeftSticks.m_CompOne) > 0 )
+    // Heading hold has the rudder outside manual mode
+    if(Mode_current() == MODE_MANUAL)
     {
-        TurnRightPos(temp);
-       // TurnRightPos(5);
-       // printf("tempR %d\n", temp);
+        if((temp = Frame.m_LeftSticks.m_CompOne) < 0)   
+        {
+            //TurnLeftPos(-5);
+            TurnLeftPos(-temp);
+            //printf("tempL %d\n", temp);
+        }
+        else if((temp = Frame.m_LeftSticks.m_CompOne) > 0 )
+        {
+            TurnRightPos(temp);
+           // TurnRightPos(5);
+           // printf("tempR %d\n", temp);
+        }
     }
-    if((temp = GamepadInputManager.m_LeftSticks.m_CompOne) < 0)   
+    // Cruise control has the throttle once CS engages it in assisted
+    if(Cruise_engaged())
+        return;
+    if((temp = Frame.m_LeftSticks.m_CompOne) < 0)   
     {
         //TurnLeftPos(-5);
         BackwardPos(-temp);
         //printf("tempL %d\n", temp);
     }
-    else if((temp = GamepadInputManager.m_LeftSticks.m_CompOne) > 0 )
+    else if((temp = Frame.m_LeftSticks.m_CompOne) > 0 )
     {
         ForwardPos(temp);
        // TurnRightPos(5);
        // printf("tempR %d\n", temp);
     }
-    DelayMs(20);
 }
 
 void ClearLeftStick()
 {
     GamepadInputManager.m_LeftSticks.m_CompOne = 0;
     GamepadInputManager.m_LeftSticks.m_CompTwo = 0;
+    Publish();
 }
\ No newline at end of file
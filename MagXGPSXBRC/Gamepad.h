@@ -7,7 +7,50 @@
 
 #pragma once
 
+typedef struct pair
+{
+	int m_CompOne;
+	int m_CompTwo;
+} 
+Pair;
+
+typedef struct buttons
+{
+	int m_ButtonY;
+	int m_ButtonB;
+	int m_ButtonA;
+	int m_ButtonX;
+}
+Buttons;
+
+// One complete gamepad report as handed to the rest of the
+// program, see GamepadSnapshot()
+typedef struct gamepadFrame
+{
+	unsigned int m_Version;		// Counts up with every published frame
+
+	unsigned int m_LeftTrigger;
+	unsigned int m_RightTrigger;
+
+	int m_SendTime;
+	int m_LeftBumper;
+	int m_RightBumper;
+	int m_StartButton;
+	int m_BackButton;
+
+	Pair m_LeftSticks;
+	Pair m_RightSticks;
+	Pair m_DirPad;
+	Buttons m_Buttons;
+}
+GamepadFrame;
+
+#define GAMEPAD_SNAPSHOT_TRIES 4	// Copies tried before giving up mid-publish
+
 void Move();
-int HandleInput();	// Call to handle gamepad input
+int HandleInput();	// Call to handle gamepad input, 1 for a whole report
 int GamepadInit();  // Call to initialize this input library
-void ClearLeftStick();
\ No newline at end of file
+void ClearLeftStick();
+int GamepadSnapshot(GamepadFrame* Frame);	// Consistent copy of the last report
+void GamepadPostCenter();	// Safe from interrupts, centers on the next GamepadEvents()
+void GamepadEvents();		// Main loop, acts on what interrupts posted
\ No newline at end of file
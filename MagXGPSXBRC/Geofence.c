@@ -0,0 +1,236 @@
+// File Inclusion
+#include "Geofence.h"
+#include "FixedMath.h"
+#include "Navigate.h"
+#include "GPS_I2C.h"
+#include <plib.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* --------------------------------------------------------------------------
+   Geofence
+
+   The permitted area is a simple polygon. When it is loaded every vertex is
+   projected to flat cm around the first one, and each edge gets a table
+   entry with everything the per fix check needs:
+   - slope and intercept for the crossing test: x = xAtMin + (y - yMin) *
+     slope, slope in Q16 so the product never leaves 64 bits
+   - start point, direction, squared length and unit normal (Q15) for the
+     distance to the edge
+
+   A check is then one pass over the edges with multiplies and compares
+   only: a ray cast for inside/outside and the nearest edge distance, with a
+   single square root at the end. Cost grows linearly with the vertices and
+   does not depend on where the boat is.
+   -------------------------------------------------------------------------- */
+typedef struct {
+	int32_t yMin;			// Crossing test: edge spans yMin <= y < yMax
+	int32_t yMax;
+	int32_t xAtMin;			// x at yMin
+	int64_t slope;			// dx/dy, Q16
+	int32_t ax;				// Distance: start point
+	int32_t ay;
+	int32_t dx;				// Direction to the end point
+	int32_t dy;
+	int64_t lengthSq;
+	int16_t nx;				// Unit normal, Q15
+	int16_t ny;
+} GEO_EDGE;
+
+static GEO_EDGE edges[GEO_MAX_VERTICES];
+static int edgeCount = 0;
+static int32_t originLat;
+static int32_t originLon;
+static int32_t originCos;			// Q15
+static unsigned int cyclesLast = 0;
+static unsigned int cyclesMax = 0;
+
+///* --- Function Prototyping --- */
+static BOOL Project(int32_t lat, int32_t lon, int32_t *x, int32_t *y);
+
+/* ------------------------------ Geofence_load ------------------------------
+ @ Summary
+    Builds the edge tables for a polygon
+ @ Parameters
+    @ param1 : vertices in order (either direction), the last joins the first
+    @ param2 : number of vertices, 3 to GEO_MAX_VERTICES, 0 removes the fence
+ @ Return Value
+    BOOL : FALSE if the polygon cannot be used, there is then no fence
+ @ Notes
+    The vertices are not needed afterwards, so they can be read from flash.
+  ---------------------------------------------------------------------------- */
+BOOL Geofence_load(const GEO_VERTEX *vertices, int count) {
+	int32_t sine;
+	int32_t ref;
+	int64_t delta;
+	int32_t x0, y0, x1, y1;
+	int32_t length;
+	GEO_EDGE *edge;
+	int i;
+
+	edgeCount = 0;
+	if ((vertices == NULL) || (count < 3) || (count > GEO_MAX_VERTICES)) {
+		return FALSE;
+	}
+
+	originLat = vertices[0].lat;
+	originLon = vertices[0].lon;
+	// cos of the whole centidegree, then down the slope for the rest:
+	// cut off, the rest is 1.6e-4 of x at 70 degrees, a metre at 6 km
+	ref = originLat / (GPS_DEG_SCALE / 100);
+	FixedSinCos(ref, &sine, &originCos);
+	delta = (((int64_t) originLat - ref * (GPS_DEG_SCALE / 100)) * NAV_RAD_PER_UNIT_Q50) >> 20;	// Radians, Q30
+	originCos -= (int32_t) ((sine * delta) >> 30);
+
+	for (i = 0; i < count; i++) {
+		edge = &edges[i];
+		if (!Project(vertices[i].lat, vertices[i].lon, &x0, &y0)
+				|| !Project(vertices[(i + 1) % count].lat, vertices[(i + 1) % count].lon, &x1, &y1)) {
+			return FALSE;
+		}
+
+		if (y0 <= y1) {
+			edge->yMin = y0;
+			edge->yMax = y1;
+			edge->xAtMin = x0;
+		}
+		else {
+			edge->yMin = y1;
+			edge->yMax = y0;
+			edge->xAtMin = x1;
+		}
+		edge->slope = (y0 != y1) ? (((int64_t) (x1 - x0)) << 16) / (y1 - y0) : 0;
+
+		edge->ax = x0;
+		edge->ay = y0;
+		edge->dx = x1 - x0;
+		edge->dy = y1 - y0;
+		edge->lengthSq = (int64_t) edge->dx * edge->dx + (int64_t) edge->dy * edge->dy;
+		length = (int32_t) FixedSqrt64((uint64_t) edge->lengthSq);
+		if (length == 0) {
+			edge->nx = edge->ny = 0;
+		}
+		else {
+			edge->nx = (int16_t) (((int64_t) -edge->dy * 32767) / length);
+			edge->ny = (int16_t) (((int64_t) edge->dx * 32767) / length);
+		}
+	}
+	edgeCount = count;
+	return TRUE;
+}
+
+/* ------------------------------ Geofence_check -----------------------------
+ @ Summary
+    Inside/outside, distance to the boundary and the speed allowed
+ @ Parameters
+    @ param1 : latitude, 1e-7 degree
+    @ param2 : longitude, 1e-7 degree
+    @ param3 : result
+ @ Return Value
+    BOOL : FALSE with no fence loaded (status then allows anything)
+ @ Notes
+    Inside within GEO_MARGIN_CM of the edge the limit ramps down from
+    GEO_MARGIN_SPEED to GEO_EDGE_SPEED. Outside it is 0 with hold set. Core timer ticks per
+    call are kept for Geofence_cycles.
+  ---------------------------------------------------------------------------- */
+BOOL Geofence_check(int32_t lat, int32_t lon, GEO_STATUS *status) {
+	unsigned int tStart = ReadCoreTimer();
+	const GEO_EDGE *edge;
+	int32_t x, y;
+	int32_t px, py;
+	int64_t along;
+	int64_t perp;
+	uint64_t distSq;
+	uint64_t bestSq = UINT64_MAX;
+	BOOL inside = FALSE;
+	int i;
+
+	status->inside = TRUE;
+	status->distance = INT32_MAX;
+	status->speedLimit = GEO_NO_LIMIT;
+	status->hold = FALSE;
+	if (edgeCount == 0) {
+		return FALSE;
+	}
+
+	if (!Project(lat, lon, &x, &y)) {
+		// Far beyond any edge
+		status->inside = FALSE;
+		status->speedLimit = 0;
+		status->hold = TRUE;
+		return TRUE;
+	}
+
+	for (i = 0, edge = edges; i < edgeCount; i++, edge++) {
+		// Ray to +x: count the edges it crosses
+		if ((y >= edge->yMin) && (y < edge->yMax)
+				&& (x < edge->xAtMin + (int32_t) (((int64_t) (y - edge->yMin) * edge->slope) >> 16))) {
+			inside = !inside;
+		}
+
+		// Nearest point on the edge: an end, or square off the middle
+		px = x - edge->ax;
+		py = y - edge->ay;
+		along = (int64_t) px * edge->dx + (int64_t) py * edge->dy;
+		if (along <= 0) {
+			distSq = (uint64_t) ((int64_t) px * px + (int64_t) py * py);
+		}
+		else if (along >= edge->lengthSq) {
+			px -= edge->dx;
+			py -= edge->dy;
+			distSq = (uint64_t) ((int64_t) px * px + (int64_t) py * py);
+		}
+		else {
+			perp = ((int64_t) px * edge->nx + (int64_t) py * edge->ny) >> 15;
+			distSq = (uint64_t) (perp * perp);
+		}
+		if (distSq < bestSq) {
+			bestSq = distSq;
+		}
+	}
+
+	status->inside = inside;
+	status->distance = (int32_t) FixedSqrt64(bestSq);
+	if (!inside) {
+		status->speedLimit = 0;
+		status->hold = TRUE;
+	}
+	else if (status->distance < GEO_MARGIN_CM) {
+		status->speedLimit = GEO_EDGE_SPEED
+				+ ((GEO_MARGIN_SPEED - GEO_EDGE_SPEED) * status->distance) / GEO_MARGIN_CM;
+	}
+
+	cyclesLast = ReadCoreTimer() - tStart;
+	if (cyclesLast > cyclesMax) {
+		cyclesMax = cyclesLast;
+	}
+	return TRUE;
+}
+
+/* ------------------------------ Geofence_cycles ----------------------------
+ @ Summary
+    Core timer ticks taken by the last and the slowest Geofence_check
+  ---------------------------------------------------------------------------- */
+void Geofence_cycles(unsigned int *last, unsigned int *max) {
+	*last = cyclesLast;
+	*max = cyclesMax;
+}
+
+/* --------------------------------- Project ---------------------------------
+ @ Summary
+    Flat cm east (x) and north (y) of the first vertex
+ @ Return Value
+    BOOL : FALSE if the point is more than GEO_MAX_EXTENT_CM out
+  ---------------------------------------------------------------------------- */
+static BOOL Project(int32_t lat, int32_t lon, int32_t *x, int32_t *y) {
+	int64_t dLat = (int64_t) lat - originLat;
+	int64_t dLon = (int64_t) lon - originLon;
+
+	if ((dLat > GPS_DEG_SCALE) || (dLat < -GPS_DEG_SCALE) || (dLon > 2LL * GPS_DEG_SCALE) || (dLon < -2LL * GPS_DEG_SCALE)) {
+		return FALSE;
+	}
+	*y = (int32_t) ((dLat * NAV_CM_PER_UNIT_Q16) >> 16);
+	*x = (int32_t) ((((dLon * originCos) >> 15) * NAV_CM_PER_UNIT_Q16) >> 16);
+	return (*x <= GEO_MAX_EXTENT_CM) && (*x >= -GEO_MAX_EXTENT_CM)
+			&& (*y <= GEO_MAX_EXTENT_CM) && (*y >= -GEO_MAX_EXTENT_CM);
+}
@@ -0,0 +1,33 @@
+#ifndef __GEOFENCE_H__
+	#define __GEOFENCE_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define GEO_MAX_VERTICES	200
+	#define GEO_MAX_EXTENT_CM	4000000		// Vertices within 40 km of the first one
+	#define GEO_MARGIN_CM		2000		// Slow down inside this much of the edge
+	#define GEO_MARGIN_SPEED	800			// Centiknots allowed entering the margin
+	#define GEO_EDGE_SPEED		200			// Centiknots allowed right at the edge
+	#define GEO_NO_LIMIT		INT32_MAX
+
+	/* -------------------------------- Vertex ------------------------------- */
+	typedef struct {
+		int32_t lat;			// 1e-7 degree, south negative
+		int32_t lon;			// 1e-7 degree, west negative
+	} GEO_VERTEX;
+
+	/* -------------------------------- Status ------------------------------- */
+	typedef struct {
+		BOOL inside;
+		int32_t distance;		// cm to the nearest edge
+		int32_t speedLimit;		// Centiknots, GEO_NO_LIMIT well inside
+		BOOL hold;				// Outside, stop
+	} GEO_STATUS;
+
+	// Function Prototypes
+	BOOL Geofence_load(const GEO_VERTEX *vertices, int count);
+	BOOL Geofence_check(int32_t lat, int32_t lon, GEO_STATUS *status);
+	void Geofence_cycles(unsigned int *last, unsigned int *max);
+#endif
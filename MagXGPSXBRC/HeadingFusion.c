@@ -0,0 +1,180 @@
+// File Inclusion
+#include "HeadingFusion.h"
+#include "FixedMath.h"
+#include <plib.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* --------------------------------------------------------------------------
+   Complementary heading filter
+
+   The magnetometer follows every turn but carries a slowly changing bias
+   (motor fields, calibration error, declination). GPS course over ground
+   has no bias but only means something when the boat is moving straight.
+   So the output is the mag heading minus a bias, and the bias is pulled
+   towards (mag - course) a little on every usable GPS fix: high pass on
+   the mag, low pass on the GPS.
+
+   Cycle budget: HeadingFusion_update is a few adds and compares, well under
+   100 instructions, run every FUSION_RATE_MS from the main loop.
+   HeadingFusion_gps adds one shift per fix (1-5 Hz).
+   -------------------------------------------------------------------------- */
+#define BIAS_FRAC	8		// Bias kept with 8 fraction bits
+
+static int32_t bias = 0;			// Cdeg << BIAS_FRAC
+static int32_t magHeading = 0;		// Latest mag heading, cdeg
+static int32_t turnRate = 0;		// Latest heading rate, cdeg/s
+static int32_t fused = 0;			// Output, cdeg 0-35999
+static int32_t errorAverage = 0;	// Mean |GPS error|, cdeg
+static int32_t outlierError = 0;	// Error of the last outlier, cdeg
+static int outlierRun = 0;			// Agreeing outliers in a row
+static BOOL haveMag = FALSE;
+static BOOL haveGps = FALSE;
+static unsigned int lastGps;
+static unsigned int lastUpdate;
+
+///* --- Function Prototyping --- */
+static int32_t Wrap180(int32_t angle);
+
+/* ---------------------------- HeadingFusion_reset --------------------------
+ @ Summary
+    Forgets the bias and all history
+  ---------------------------------------------------------------------------- */
+void HeadingFusion_reset(void) {
+	bias = 0;
+	errorAverage = 0;
+	outlierRun = 0;
+	haveMag = FALSE;
+	haveGps = FALSE;
+}
+
+/* --------------------------- HeadingFusion_update --------------------------
+ @ Summary
+    Takes the newest filtered mag heading and updates the output
+ @ Parameters
+    @ param1 : mag heading, cdeg
+    @ param2 : heading rate, cdeg/s
+    @ param3 : millisec now
+ @ Return Value
+    None
+ @ Notes
+    Call every FUSION_RATE_MS.
+  ---------------------------------------------------------------------------- */
+void HeadingFusion_update(int32_t heading, int32_t headingRate, unsigned int now) {
+	magHeading = heading;
+	turnRate = headingRate;
+	fused = FixedWrap360(magHeading - (bias >> BIAS_FRAC));
+	lastUpdate = now;
+	haveMag = TRUE;
+}
+
+/* ----------------------------- HeadingFusion_gps ---------------------------
+ @ Summary
+    Corrects the mag bias from a GPS fix
+ @ Parameters
+    @ param1 : course over ground, cdeg
+    @ param2 : speed over ground, centiknots
+    @ param3 : millisec of the fix
+ @ Return Value
+    None
+ @ Notes
+    Ignored while slow, while turning, or if the error is so large it is
+    more likely a bad fix than a bias. The first fix is always taken, and
+    so is the last of FUSION_RESNAP outliers in a row that agree with each
+    other: a bad first fix would otherwise hold the bias off for good,
+    with every correct fix after it rejected as an outlier.
+  ---------------------------------------------------------------------------- */
+void HeadingFusion_gps(int32_t course, int32_t speed, unsigned int now) {
+	int32_t error;
+
+	if (!haveMag || (speed < FUSION_MIN_SPEED)) {
+		return;
+	}
+	if ((turnRate > FUSION_MAX_TURN) || (turnRate < -FUSION_MAX_TURN)) {
+		return;
+	}
+
+	error = Wrap180(fused - course);
+	if (haveGps && ((error > FUSION_MAX_ERROR) || (error < -FUSION_MAX_ERROR))) {
+		if ((outlierRun > 0) && (Wrap180(error - outlierError) <= FUSION_MAX_ERROR)
+				&& (Wrap180(error - outlierError) >= -FUSION_MAX_ERROR)) {
+			outlierRun++;
+		}
+		else {
+			outlierRun = 1;
+		}
+		outlierError = error;
+		if (outlierRun < FUSION_RESNAP) {
+			return;
+		}
+		haveGps = FALSE;					// The bias is what was wrong
+	}
+	outlierRun = 0;
+
+	if (!haveGps) {
+		bias += error << BIAS_FRAC;			// Snap to the first good fix
+		haveGps = TRUE;
+	}
+	else {
+		bias += (error << BIAS_FRAC) >> FUSION_BIAS_SHIFT;
+	}
+	if (bias >= (CDEG_180 << BIAS_FRAC)) {
+		bias -= CDEG_360 << BIAS_FRAC;
+	}
+	else if (bias < -(CDEG_180 << BIAS_FRAC)) {
+		bias += CDEG_360 << BIAS_FRAC;
+	}
+
+	errorAverage += (((error < 0) ? -error : error) - errorAverage) >> 2;
+	fused = FixedWrap360(magHeading - (bias >> BIAS_FRAC));
+	lastGps = now;
+}
+
+/* --------------------------- HeadingFusion_heading -------------------------
+ @ Summary
+    Fused heading and how much to trust it
+ @ Parameters
+    @ param1 : confidence 0-100, may be NULL
+ @ Return Value
+    int32_t : heading, cdeg 0-35999
+ @ Notes
+    Confidence is FUSION_CONF_MAG for mag only. After a GPS correction it
+    starts at 100 less 1 per degree of recent GPS disagreement, then falls
+    back to the mag only value over FUSION_GPS_STALE ms.
+  ---------------------------------------------------------------------------- */
+int32_t HeadingFusion_heading(int *confidence) {
+	unsigned int age;
+	int conf = 0;
+
+	if (haveMag) {
+		conf = FUSION_CONF_MAG;
+		if (haveGps) {
+			conf = FUSION_CONF_MAX - (errorAverage / 100);
+			age = lastUpdate - lastGps;
+			if ((int) age < 0) {
+				age = 0;
+			}
+			if (age >= FUSION_GPS_STALE) {
+				conf = FUSION_CONF_MAG;
+			}
+			else {
+				conf -= ((conf - FUSION_CONF_MAG) * (int) age) / FUSION_GPS_STALE;
+			}
+			if (conf < FUSION_CONF_MAG) {
+				conf = FUSION_CONF_MAG;
+			}
+		}
+	}
+	if (confidence != NULL) {
+		*confidence = conf;
+	}
+	return fused;
+}
+
+/* --------------------------------- Wrap180 ---------------------------------
+ @ Summary
+    Wraps an angle into -18000 to 17999 cdeg
+  ---------------------------------------------------------------------------- */
+static int32_t Wrap180(int32_t angle) {
+	return FixedWrap360(angle + CDEG_180) - CDEG_180;
+}
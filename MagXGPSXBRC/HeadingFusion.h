@@ -0,0 +1,23 @@
+#ifndef __HEADINGFUSION_H__
+	#define __HEADINGFUSION_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define FUSION_RATE_MS		20		// HeadingFusion_update period
+	#define FUSION_MIN_SPEED	200		// Centiknots, slower course is noise
+	#define FUSION_MAX_TURN		500		// Cdeg/s, faster the GPS course lags
+	#define FUSION_BIAS_SHIFT	3		// Bias moves 1/8 of the error per fix
+	#define FUSION_MAX_ERROR	4500	// Cdeg, larger errors are treated as outliers
+	#define FUSION_RESNAP		5		// Agreeing outliers in a row that re-snap the bias
+	#define FUSION_GPS_STALE	5000	// ms without a fix before confidence drops
+	#define FUSION_CONF_MAX		100
+	#define FUSION_CONF_MAG		30		// Confidence with no GPS correction
+
+	// Function Prototypes
+	void    HeadingFusion_reset(void);
+	void    HeadingFusion_update(int32_t magHeading, int32_t headingRate, unsigned int now);
+	void    HeadingFusion_gps(int32_t course, int32_t speed, unsigned int now);
+	int32_t HeadingFusion_heading(int *confidence);
+#endif
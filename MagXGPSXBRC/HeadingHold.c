@@ -0,0 +1,201 @@
+// File Inclusion
+#include "HeadingHold.h"
+#include "FixedMath.h"
+#include "RC.h"
+#include <plib.h>
+#include <stdint.h>
+
+/* --------------------------------------------------------------------------
+   Heading hold
+
+   PID on the heading error, run by the caller every HeadingHold_rate() ms.
+   The integrator takes the time since the last update, not the configured
+   period: the main loop can run a period late, and Mode_due then skips
+   the ticks it missed rather than running them in a burst. The first
+   update after engaging counts as one period, and a gap is counted as at
+   most HH_RATE_MAX_MS so a stall does not dump into the integrator.
+
+   - P: error wrapped to +-180 degrees, so the rudder takes the short way
+   - I: integrates error * dt, held within the rudder limit. It only runs
+     within HH_INTEGRAL_BAND of the setpoint and while the output is not
+     saturated the same way, so a long turn does not wind it up
+   - D: on the measured turn rate, not the error, so a new setpoint does
+     not kick the rudder
+
+   Everything is Q16 rudder percent, so gains and the integrator keep their
+   meaning when the rate is changed.
+   -------------------------------------------------------------------------- */
+#define OUTPUT_LIMIT_Q16	((int64_t) HH_RUDDER_LIMIT << 16)
+
+static BOOL engaged = FALSE;
+static int32_t setpoint = 0;		// Centidegrees
+static int32_t kp = HH_KP_DEFAULT;
+static int32_t ki = HH_KI_DEFAULT;
+static int32_t kd = HH_KD_DEFAULT;
+static unsigned int periodMs = HH_RATE_MS;
+static int64_t integral = 0;		// Q16 percent
+static BOOL haveLast = FALSE;
+static unsigned int lastUpdate = 0;	// millisec
+static unsigned int cyclesLast = 0;
+static unsigned int cyclesMax = 0;
+
+/* ---------------------------- HeadingHold_engage ---------------------------
+ @ Summary
+    Holds a heading, centidegrees
+ @ Notes
+    The integrator is kept across setpoint changes while engaged, it holds
+    the trim for current and wind rather than anything about the old
+    heading.
+  ---------------------------------------------------------------------------- */
+void HeadingHold_engage(int32_t heading) {
+	if (!engaged) {
+		integral = 0;
+		haveLast = FALSE;
+	}
+	setpoint = FixedWrap360(heading);
+	engaged = TRUE;
+}
+
+/* -------------------------- HeadingHold_disengage --------------------------
+ @ Summary
+    Stops steering, the rudder is left where it is
+  ---------------------------------------------------------------------------- */
+void HeadingHold_disengage(void) {
+	engaged = FALSE;
+}
+
+/* --------------------------- HeadingHold_engaged ---------------------------
+ @ Summary
+    TRUE while holding a heading
+  ---------------------------------------------------------------------------- */
+BOOL HeadingHold_engaged(void) {
+	return engaged;
+}
+
+/* --------------------------- HeadingHold_setGains --------------------------
+ @ Summary
+    Sets the gains, Q16 rudder percent per centidegree (ki per cdeg second,
+    kd per cdeg/s)
+ @ Notes
+    Negative gains are taken as 0.
+  ---------------------------------------------------------------------------- */
+void HeadingHold_setGains(int32_t newKp, int32_t newKi, int32_t newKd) {
+	kp = (newKp > 0) ? newKp : 0;
+	ki = (newKi > 0) ? newKi : 0;
+	kd = (newKd > 0) ? newKd : 0;
+	if (ki == 0) {
+		integral = 0;
+	}
+}
+
+/* --------------------------- HeadingHold_getGains --------------------------
+ @ Summary
+    Reads back the gains
+  ---------------------------------------------------------------------------- */
+void HeadingHold_getGains(int32_t *gainP, int32_t *gainI, int32_t *gainD) {
+	*gainP = kp;
+	*gainI = ki;
+	*gainD = kd;
+}
+
+/* --------------------------- HeadingHold_setRate ---------------------------
+ @ Summary
+    Sets the loop period, ms, held to HH_RATE_MIN_MS..HH_RATE_MAX_MS
+  ---------------------------------------------------------------------------- */
+void HeadingHold_setRate(unsigned int newPeriodMs) {
+	if (newPeriodMs < HH_RATE_MIN_MS) {
+		newPeriodMs = HH_RATE_MIN_MS;
+	}
+	else if (newPeriodMs > HH_RATE_MAX_MS) {
+		newPeriodMs = HH_RATE_MAX_MS;
+	}
+	periodMs = newPeriodMs;
+}
+
+/* ----------------------------- HeadingHold_rate ----------------------------
+ @ Summary
+    The loop period, ms
+  ---------------------------------------------------------------------------- */
+unsigned int HeadingHold_rate(void) {
+	return periodMs;
+}
+
+/* ---------------------------- HeadingHold_update ---------------------------
+ @ Summary
+    Runs one period of the loop and sets the rudder
+ @ Parameters
+    @ param1 : heading, centidegrees
+    @ param2 : turn rate, centidegrees per second
+    @ param3 : millisec now
+ @ Return Value
+    int : rudder setting sent to set_rc, percent, -1 when disengaged
+ @ Notes
+    Both rudder servos get the setting, the speed controller channels keep
+    RC2Pos. Core timer ticks per call are kept for HeadingHold_cycles.
+  ---------------------------------------------------------------------------- */
+int HeadingHold_update(int32_t heading, int32_t rate, unsigned int now) {
+	unsigned int tStart = ReadCoreTimer();
+	unsigned int dt;
+	int32_t error;
+	int64_t output;
+	int64_t step;
+	int rudder;
+
+	if (!engaged) {
+		return -1;
+	}
+
+	dt = haveLast ? now - lastUpdate : periodMs;
+	if (dt > HH_RATE_MAX_MS) {
+		dt = HH_RATE_MAX_MS;
+	}
+	lastUpdate = now;
+	haveLast = TRUE;
+
+	error = FixedWrap360(setpoint - heading);
+	if (error > CDEG_180) {
+		error -= CDEG_360;
+	}
+
+	output = (int64_t) kp * error + integral - (int64_t) kd * rate;
+
+	// Integrate near the setpoint only, and never further into saturation
+	step = ((int64_t) ki * error * dt) / 1000;
+	if ((error < HH_INTEGRAL_BAND) && (error > -HH_INTEGRAL_BAND)
+			&& !((output >= OUTPUT_LIMIT_Q16) && (step > 0)) && !((output <= -OUTPUT_LIMIT_Q16) && (step < 0))) {
+		integral += step;
+		if (integral > OUTPUT_LIMIT_Q16) {
+			integral = OUTPUT_LIMIT_Q16;
+		}
+		else if (integral < -OUTPUT_LIMIT_Q16) {
+			integral = -OUTPUT_LIMIT_Q16;
+		}
+		output += step;
+	}
+
+	if (output > OUTPUT_LIMIT_Q16) {
+		output = OUTPUT_LIMIT_Q16;
+	}
+	else if (output < -OUTPUT_LIMIT_Q16) {
+		output = -OUTPUT_LIMIT_Q16;
+	}
+	rudder = HH_RUDDER_CENTER + HH_RUDDER_SIGN * (int) ((output + (1 << 15)) >> 16);
+
+	RC1Pos = rudder;
+	set_rc(RC2Pos, RC2Pos, rudder, rudder);
+
+	cyclesLast = ReadCoreTimer() - tStart;
+	if (cyclesLast > cyclesMax) {
+		cyclesMax = cyclesLast;
+	}
+	return rudder;
+}
+
+/* ---------------------------- HeadingHold_cycles ---------------------------
+ @ Summary
+    Core timer ticks taken by the last and the slowest HeadingHold_update
+  ---------------------------------------------------------------------------- */
+void HeadingHold_cycles(unsigned int *last, unsigned int *max) {
+	*last = cyclesLast;
+	*max = cyclesMax;
+}
@@ -0,0 +1,31 @@
+#ifndef __HEADINGHOLD_H__
+	#define __HEADINGHOLD_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define HH_RATE_MS			20		// Default loop period
+	#define HH_RATE_MIN_MS		5
+	#define HH_RATE_MAX_MS		200
+	#define HH_RUDDER_CENTER	50		// set_rc percent with the rudder straight
+	#define HH_RUDDER_LIMIT		50		// Percent either side of center
+	#define HH_RUDDER_SIGN		1		// -1 if a higher setting turns to port
+	#define HH_INTEGRAL_BAND	1000	// Cdeg, the integrator only runs inside this
+
+	// Gains, Q16 rudder percent per centidegree of error
+	#define HH_KP_DEFAULT		1966	// 3 % per degree
+	#define HH_KI_DEFAULT		131		// 0.2 % per degree second
+	#define HH_KD_DEFAULT		1966	// 3 % per degree/s of turn
+
+	// Function Prototypes
+	void HeadingHold_engage(int32_t heading);
+	void HeadingHold_disengage(void);
+	BOOL HeadingHold_engaged(void);
+	void HeadingHold_setGains(int32_t kp, int32_t ki, int32_t kd);
+	void HeadingHold_getGains(int32_t *kp, int32_t *ki, int32_t *kd);
+	void HeadingHold_setRate(unsigned int periodMs);
+	unsigned int HeadingHold_rate(void);
+	int HeadingHold_update(int32_t heading, int32_t rate, unsigned int now);
+	void HeadingHold_cycles(unsigned int *last, unsigned int *max);
+#endif
@@ -0,0 +1,142 @@
+// File Inclusion
+#include "Link.h"
+#include "Mode.h"
+#include "Gamepad.h"
+#include <plib.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* --------------------------------------------------------------------------
+   XBee link supervisor
+
+   Command_dispatch stamps every valid frame, a gamepad report or a command
+   line, with Link_frame. Link_check runs every main loop pass and declares
+   the link lost once no frame has come for the timeout. It then clears
+   the stored stick so nothing stale is applied later, and raises
+   MODE_EV_LINK_LOST: manual and assisted go to failsafe, which ramps the
+   throttle to neutral and centers the rudder, and autonomous carries on
+   since it does not need the link. The loss is raised once, so a route
+   that finishes before the link is back asks Link_lost and goes to
+   failsafe rather than manual, see Mode_event.
+
+   Detection is bounded by the timeout plus the longest main loop pass.
+   How far past the timeout each loss was seen is kept in the statistics
+   so the bound can be checked on the boat.
+
+   Supervision starts with the first frame, so a boat switched on without
+   the gamepad sits in manual with the throttle neutral rather than in
+   failsafe.
+   -------------------------------------------------------------------------- */
+static BOOL armed = FALSE;			// A frame has arrived since reset
+static BOOL lost = FALSE;
+static unsigned int lastFrame = 0;	// millisec
+static unsigned int timeout = LINK_TIMEOUT_MS;
+static LINK_STATS stats;
+
+/* -------------------------------- Link_reset -------------------------------
+ @ Summary
+    Clears the statistics and waits for the first frame again
+  ---------------------------------------------------------------------------- */
+void Link_reset(void) {
+	armed = FALSE;
+	lost = FALSE;
+	stats.frames = 0;
+	stats.losses = 0;
+	stats.maxGap = 0;
+	stats.maxLatency = 0;
+}
+
+/* -------------------------------- Link_frame -------------------------------
+ @ Summary
+    Records a valid frame
+ @ Parameters
+    @ param1 : millisec it arrived
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+void Link_frame(unsigned int now) {
+	unsigned int gap = now - lastFrame;
+
+	if (armed && (gap > stats.maxGap)) {
+		stats.maxGap = gap;
+	}
+	if (lost) {
+		printf("Link back after %u ms\n\r", gap);
+	}
+	lastFrame = now;
+	armed = TRUE;
+	lost = FALSE;
+	stats.frames++;
+}
+
+/* -------------------------------- Link_check -------------------------------
+ @ Summary
+    Declares the link lost when the timeout has passed without a frame
+ @ Parameters
+    @ param1 : millisec now
+ @ Return Value
+    BOOL : TRUE on the pass that found the loss
+  ---------------------------------------------------------------------------- */
+BOOL Link_check(unsigned int now) {
+	unsigned int gap = now - lastFrame;
+
+	if (!armed || lost || (gap < timeout)) {
+		return FALSE;
+	}
+
+	lost = TRUE;
+	stats.losses++;
+	if ((gap - timeout) > stats.maxLatency) {
+		stats.maxLatency = gap - timeout;
+	}
+	ClearLeftStick();
+	printf("Link lost, no frame for %u ms\n\r", gap);
+	Mode_event(MODE_EV_LINK_LOST);
+	return TRUE;
+}
+
+/* --------------------------------- Link_up ---------------------------------
+ @ Summary
+    TRUE once a frame has arrived and the link is not lost
+  ---------------------------------------------------------------------------- */
+BOOL Link_up(void) {
+	return armed && !lost;
+}
+
+/* -------------------------------- Link_lost --------------------------------
+ @ Summary
+    TRUE from a loss until the next frame, FALSE before the first frame
+  ---------------------------------------------------------------------------- */
+BOOL Link_lost(void) {
+	return armed && lost;
+}
+
+/* ----------------------------- Link_setTimeout -----------------------------
+ @ Summary
+    Sets the loss timeout, ms, clamped to LINK_TIMEOUT_MIN_MS..MAX_MS
+  ---------------------------------------------------------------------------- */
+void Link_setTimeout(unsigned int timeoutMs) {
+	if (timeoutMs < LINK_TIMEOUT_MIN_MS) {
+		timeoutMs = LINK_TIMEOUT_MIN_MS;
+	}
+	else if (timeoutMs > LINK_TIMEOUT_MAX_MS) {
+		timeoutMs = LINK_TIMEOUT_MAX_MS;
+	}
+	timeout = timeoutMs;
+}
+
+/* ------------------------------ Link_timeout -------------------------------
+ @ Summary
+    The loss timeout in use, ms
+  ---------------------------------------------------------------------------- */
+unsigned int Link_timeout(void) {
+	return timeout;
+}
+
+/* -------------------------------- Link_stats -------------------------------
+ @ Summary
+    Copies out the statistics
+  ---------------------------------------------------------------------------- */
+void Link_stats(LINK_STATS *out) {
+	*out = stats;
+}
@@ -0,0 +1,29 @@
+#ifndef __LINK_H__
+	#define __LINK_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define LINK_TIMEOUT_MS			300		// Default, no frame this long is a loss
+	#define LINK_TIMEOUT_MIN_MS		100		// Gamepad reports are 10 Hz at best
+	#define LINK_TIMEOUT_MAX_MS		5000
+
+	/* ----------------------------- Statistics ------------------------------ */
+	typedef struct {
+		uint32_t frames;		// Valid frames since reset
+		uint32_t losses;		// Times the link was declared lost
+		uint32_t maxGap;		// Longest time between frames, ms
+		uint32_t maxLatency;	// Longest detection past the timeout, ms
+	} LINK_STATS;
+
+	// Function Prototypes
+	void Link_reset(void);
+	void Link_frame(unsigned int now);
+	BOOL Link_check(unsigned int now);
+	BOOL Link_up(void);
+	BOOL Link_lost(void);
+	void Link_setTimeout(unsigned int timeoutMs);
+	unsigned int Link_timeout(void);
+	void Link_stats(LINK_STATS *stats);
+#endif
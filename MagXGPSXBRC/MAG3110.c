@@ -9,7 +9,10 @@
 #include <math.h>
 #include <float.h>
 #include <STDIO.h>
+#include <string.h>
 #include "Stepper.h"
+#include "MMA8652.h"
+#include "Clock.h"
 
 // Function Prototypes
 BOOL       MAG3110_initialize(void);
@@ -18,7 +21,7 @@ I2C_RESULT MAG3110_writeRegister(BYTE address, BYTE value);
 BOOL 	   MAG3110_dataReady(void);
 I2C_RESULT MAG3110_readMag(int16_t* x, int16_t* y, int16_t* z);
 I2C_RESULT MAG3110_readMicroTeslas(float* x, float* y, float* z);
-I2C_RESULT MAG3110_readHeading(float *heading);
+I2C_RESULT MAG3110_readHeading(int32_t *heading);
 I2C_RESULT MAG3110_setDR_OS(BYTE DROS);
 I2C_RESULT MAG3110_triggerMeasurement();
 I2C_RESULT MAG3110_rawData(BOOL raw);
@@ -41,6 +44,17 @@ I2C_RESULT MAG3110_reset(void);
 
 void MAG3110_EnvCalibrate();
 
+void MAG3110_startSampling(void);
+void MAG3110_stopSampling(void);
+BOOL MAG3110_getSample(MAG3110_SAMPLE *sample);
+unsigned int MAG3110_getOverruns(void);
+unsigned int MAG3110_getErrors(void);
+BOOL MAG3110_sampleVector(const MAG3110_SAMPLE *sample, int32_t *hx, int32_t *hy);
+
+void MAG3110_requestDR_OS(BYTE DROS);
+BOOL MAG3110_service(void);
+void MAG3110_adaptRate(int32_t headingRate);
+
 // Global Variables
 extern int16_t led_value;
 extern int angle;
@@ -51,15 +65,53 @@ int16_t x, y, z;
 static int16_t x_offset;
 static int16_t y_offset;
 static int16_t z_offset;
-static float x_scale;
-static float y_scale;
-static float z_scale;
+static int16_t softIron[3][3];     // Q12, applied after the offsets
   
 static BOOL calibrationMode;
 static BOOL activeMode;
 static BOOL rawMode;
 
+// Data-ready sampling. The INT0 and I2C interrupts fill the ring (head),
+// the main loop empties it (tail).
+static MAG3110_SAMPLE sampleRing[MAG3110_SAMPLE_DEPTH];
+static volatile unsigned int sampleHead = 0;
+static volatile unsigned int sampleTail = 0;
+static volatile unsigned int sampleOverruns = 0;
+static volatile unsigned int sampleErrors = 0;
+static volatile uint32_t sampleStamp;
+static volatile BOOL sampling = FALSE;
+static BYTE sampleData[6];
+static I2C_ASYNC_REQ sampleReq;
+
+// Newest reading, heading and field strength are worked out from this
+static MAG3110_SAMPLE lastSample;
+static BOOL lastValid = FALSE;
+
+// CTRL_REG1/CTRL_REG2 as last written. AUTO_MRST_EN always reads back as
+// 0, so the registers cannot simply be read to find out what they hold.
+static BYTE ctrlShadow[2];
+static BOOL ctrlKnown = FALSE;
+
+// Data rate change run from MAG3110_service()
+enum ReconfigStates {
+    RECONFIG_IDLE,
+    RECONFIG_STANDBY,       // Waiting for SYSMOD to show standby
+    RECONFIG_WRITE          // Write DR_OS, then go active again
+};
+static int reconfigState = RECONFIG_IDLE;
+static BYTE targetDROS = MAG3110_DR_OS_80_16;
+static BOOL reconfigResume;
+static unsigned int reconfigStart;
+static unsigned int calmSince;
+
 static int16_t MAG3110_readAxis(BYTE axis);
+static I2C_RESULT MAG3110_writeControl(BYTE address, BYTE value);
+static void MAG3110_kickSample(void);
+static void MAG3110_sampleDone(I2C_ASYNC_REQ *req);
+static BOOL MAG3110_waitSample(MAG3110_SAMPLE *sample);
+static void MAG3110_defaultSoftIron(void);
+static void MAG3110_correct(const MAG3110_SAMPLE *sample, int32_t *v);
+static BOOL MAG3110_tiltCompensate(const int32_t *v, const MMA8652_SAMPLE *accel, int32_t *hx, int32_t *hy);
 
 BOOL MAG3110_initialize(void) 
 {
@@ -70,9 +122,7 @@ BOOL MAG3110_initialize(void)
 	y_offset = Y_OFFSET;
 	z_offset = Z_OFFSET;
 
-	x_scale = X_GAIN;
-	y_scale = Y_GAIN;
-    z_scale = Z_GAIN;
+	MAG3110_defaultSoftIron();
 
 	if(MAG3110_readRegister(MAG3110_WHO_AM_I) != MAG3110_WHO_AM_I_RSP)
     { //Could not find MAG3110
@@ -93,18 +143,12 @@ BOOL MAG3110_initialize(void)
 BYTE MAG3110_readRegister(BYTE address)
 {
     I2C_RESULT i2c_result;
-    BYTE reg[2] = {0};
-    int len = 1;
+    BYTE reg = 0;
 
-    reg[0] = address;
-    i2c_result = I2C_Write(I2C1, MAG3110_I2C_ADDRESS, reg, &len);
-    usDelay(100);
+    // Pointer write and read share one transaction (repeated start)
+    i2c_result = I2C_WriteRead(I2C1, MAG3110_I2C_ADDRESS, address, &reg, 1);
     if(i2c_result == I2C_SUCCESS)
-    {
-        len = 1;
-        i2c_result = I2C_Read(I2C1, MAG3110_I2C_ADDRESS, reg, &len);
-        return reg[0];
-    }
+        return reg;
     else
         return 0;
 }
@@ -138,36 +182,31 @@ unsigned char dr_stat;
 I2C_RESULT MAG3110_readMag(int16_t* x, int16_t* y, int16_t* z)
 {
 I2C_RESULT i2c_result;
-BYTE reg[7] = {0};
-int len = 1;
+BYTE reg[6] = {0};
 int idx;
 uint16_t values[3];
 
-    reg[0] = MAG3110_OUT_X_MSB;
-
-	// Start readout at X MSB address
-    i2c_result = I2C_Write(I2C1, MAG3110_I2C_ADDRESS, reg, &len);
+	// Burst read all six output registers starting at X MSB address
+    i2c_result = I2C_WriteRead(I2C1, MAG3110_I2C_ADDRESS, MAG3110_OUT_X_MSB, reg, 6);
     if(i2c_result == I2C_SUCCESS)
     {
-        DelayMs(5);
-	// Read out data using multiple byte read mode
-        len = 6;
-        i2c_result = I2C_Read(I2C1, MAG3110_I2C_ADDRESS, reg, &len);	
-
-        if(i2c_result == I2C_SUCCESS)
-        {
  	// Combine registers
-            for(idx = 0; idx <= 2; idx++)
-            {
-                values[idx]  = reg[idx*2] << 8;       // MSB
-        		values[idx] |= reg[idx*2 + 1];        // LSB
-            }
+        for(idx = 0; idx <= 2; idx++)
+        {
+            values[idx]  = reg[idx*2] << 8;       // MSB
+            values[idx] |= reg[idx*2 + 1];        // LSB
+        }
 
 	// Put data into referenced variables
-            *x = (values[0]);
-            *y = (values[1]);
-            *z = (values[2]);
-        }
+        *x = (values[0]);
+        *y = (values[1]);
+        *z = (values[2]);
+
+        lastSample.x = *x;
+        lastSample.y = *y;
+        lastSample.z = *z;
+        lastSample.stamp = (uint32_t) Clock_micros();
+        lastValid = TRUE;
     }
     if(i2c_result != I2C_SUCCESS)
     {
@@ -176,43 +215,40 @@ uint16_t values[3];
     return i2c_result;
 }
 
+//Note: Uses the newest sample (readMag or the sample ring), no bus access
 I2C_RESULT MAG3110_readMicroTeslas(float* xf, float* yf, float* zf)
 {
-	// Using internal read function
-I2C_RESULT i2c_result;
-int16_t x_int, y_int, z_int;
+I2C_RESULT i2c_result = I2C_ERROR;
 
-	i2c_result = MAG3110_readMag(&x, &y, &z);
-
-	//Read each axis and scale to Teslas
-    if(i2c_result == I2C_SUCCESS)
+	//Scale each axis to Teslas
+    if(lastValid)
     {
-    	*xf = (float) x * 0.1f;
-        *yf = (float) y * 0.1f;
-    	*zf = (float) z * 0.1f;	
+    	*xf = (float) lastSample.x * 0.1f;
+        *yf = (float) lastSample.y * 0.1f;
+    	*zf = (float) lastSample.z * 0.1f;	
+        i2c_result = I2C_SUCCESS;
     }
     return i2c_result;
 }
 
 //Note: Must be calibrated to use readHeading!!!
-I2C_RESULT MAG3110_readHeading(float *heading)
+//Works from the newest sample, the offsets are applied here rather than by
+//the sensor so it must be in raw mode (a no-op once it already is)
+//Heading is in centidegrees, 0 to 35999, all integer math
+//Tilt compensated when there is a recent accelerometer reading
+I2C_RESULT MAG3110_readHeading(int32_t *heading)
 {
 I2C_RESULT i2c_result;	
-int16_t x,y,z;
-float xf = 0;
-float yf = 0;
+int32_t hx, hy;
 
     i2c_result = MAG3110_rawData(TRUE);
-	i2c_result |= MAG3110_readMag(&x, &y, &z);
+    if(!lastValid)
+        i2c_result = I2C_ERROR;
     if(i2c_result == I2C_SUCCESS)
     {
-    	xf = ((float) (x - x_offset))*x_scale;
-    	yf = ((float) (y - y_offset))*y_scale;
-        if((xf != 0.0) && (yf != 0.0))
-            *heading = (atan2f(xf, yf) * RAD2DEG) + MAG_DECLINATION ;    
-        else
-            *heading = 0.0;
-        //printf("X:%6d / %1.6f   Y: %6d / %1.6f  -> %8.2f\n\r",x, xf, y, yf, *heading);                
+        MAG3110_sampleVector(&lastSample, &hx, &hy);
+        *heading = FixedWrap360(FixedAtan2(hx, hy) + MAG_DECLINATION_CDEG);
+        //printf("X:%6d / %6d   Y: %6d / %6d  -> %6d\n\r",lastSample.x, v[0], lastSample.y, v[1], *heading);                
 	}
     else
     {
@@ -223,38 +259,119 @@ float yf = 0;
 	return ( i2c_result );
 }
 
+//Blocking version of MAG3110_requestDR_OS, for start up
 I2C_RESULT MAG3110_setDR_OS(BYTE DROS)
 {
 I2C_RESULT i2c_result = I2C_SUCCESS;	
-BOOL wasActive = activeMode;
-BYTE current;
-	
-	if(activeMode)
-		i2c_result |= MAG3110_enterStandby(); //Must be in standby to modify CTRL_REG1
-	
-	//If we attempt to write to CTRL_REG1 right after going into standby
-	//It might fail to modify the other bits
-	DelayMs(100);
-	
-	 //Get the current control register
-	current = MAG3110_readRegister(MAG3110_CTRL_REG1) & 0x07; //And chop off the 5 MSB
-	i2c_result |= MAG3110_writeRegister(MAG3110_CTRL_REG1, (current | DROS)); //Write back the register with new DR_OS set
-	
-	DelayMs(100);
-	
-	//Start sampling again if we were before
-	if(wasActive)
-		i2c_result |= MAG3110_exitStandby();
+unsigned int tStart = millisec;
+
+	MAG3110_requestDR_OS(DROS);
+	while(MAG3110_service())
+	{
+		if((millisec - tStart) > (2 * MAG3110_STANDBY_TIMEOUT))
+		{
+			i2c_result = I2C_ERROR;
+			break;
+		}
+	}
+	if((ctrlShadow[0] & MAG3110_DR_OS_MASK) != DROS)
+		i2c_result = I2C_ERROR;
     
     return i2c_result;
 }
 
+/* ************************************************************************** */
+// MAG3110_requestDR_OS()
+// Asks for a new data rate / oversample setting. MAG3110_service() makes the
+// change without blocking; a newer request simply replaces an older one.
+//
+void MAG3110_requestDR_OS(BYTE DROS)
+{
+	targetDROS = DROS & MAG3110_DR_OS_MASK;
+}
+
+/* ************************************************************************** */
+// MAG3110_service()
+// Call every pass of the main loop. Steps a data rate change through
+// standby, the register write and back to active, one step per call.
+// Returns TRUE while a change is in progress.
+//
+//If we attempt to write to CTRL_REG1 right after going into standby
+//It might fail to modify the other bits, so SYSMOD is checked first
+BOOL MAG3110_service(void)
+{
+	switch(reconfigState)
+	{
+		case RECONFIG_IDLE:
+			if(!ctrlKnown || ((ctrlShadow[0] & MAG3110_DR_OS_MASK) == targetDROS))
+				return FALSE;
+			reconfigResume = activeMode;
+			if(activeMode)
+			{
+				MAG3110_enterStandby(); //Must be in standby to modify CTRL_REG1
+				reconfigStart = millisec;
+				reconfigState = RECONFIG_STANDBY;
+			}
+			else
+			{
+				reconfigState = RECONFIG_WRITE;
+			}
+			break;
+
+		case RECONFIG_STANDBY:
+			// Carry on anyway after the timeout, as the old fixed delay did
+			if((MAG3110_getSysMode() == MAG3110_SYSMOD_STANDBY) ||
+			   ((millisec - reconfigStart) >= MAG3110_STANDBY_TIMEOUT))
+				reconfigState = RECONFIG_WRITE;
+			break;
+
+		case RECONFIG_WRITE:
+			MAG3110_writeControl(MAG3110_CTRL_REG1, (ctrlShadow[0] & 0x07) | targetDROS);
+			//Start sampling again if we were before
+			if(reconfigResume)
+				MAG3110_exitStandby();
+			reconfigState = RECONFIG_IDLE;
+			break;
+
+		default:
+			reconfigState = RECONFIG_IDLE;
+	}
+	return TRUE;
+}
+
+/* ************************************************************************** */
+// MAG3110_adaptRate()
+// Runs the sensor fast while the boat is turning and slow (with more
+// oversampling, so less noise) once it has held a course for a while.
+// Call with the filtered heading rate in cdeg/s.
+//
+void MAG3110_adaptRate(int32_t headingRate)
+{
+	if(headingRate < 0)
+		headingRate = -headingRate;
+
+	if(headingRate >= MAG3110_TURN_RATE)
+	{
+		MAG3110_requestDR_OS(MAG3110_TURN_DR_OS);
+		calmSince = millisec;
+	}
+	else if(headingRate > MAG3110_CRUISE_RATE)
+	{
+		calmSince = millisec;       // In between, keep whatever rate we have
+	}
+	else if((millisec - calmSince) >= MAG3110_CRUISE_HOLD)
+	{
+		MAG3110_requestDR_OS(MAG3110_CRUISE_DR_OS);
+	}
+}
+
 I2C_RESULT MAG3110_triggerMeasurement()
 {
 I2C_RESULT i2c_result = I2C_SUCCESS;	
-BYTE current;
-    current = MAG3110_readRegister(MAG3110_CTRL_REG1);
-	i2c_result = MAG3110_writeRegister(MAG3110_CTRL_REG1, (current |  0x02));
+
+    // TM clears itself when the measurement is done, so it is never kept
+    // in the shadow
+	i2c_result = MAG3110_writeRegister(MAG3110_CTRL_REG1, (ctrlShadow[0] | MAG3110_TRIGGER_MEASUREMENT));
     return i2c_result;
 }
 
@@ -267,12 +384,12 @@ I2C_RESULT i2c_result = I2C_SUCCESS;
 	if(raw) //Turn on raw (non-user corrected) mode
 	{
 		rawMode = TRUE;
-		i2c_result |= MAG3110_writeRegister(MAG3110_CTRL_REG2, MAG3110_AUTO_MRST_EN | (0x01 << 5) );
+		i2c_result |= MAG3110_writeControl(MAG3110_CTRL_REG2, MAG3110_AUTO_MRST_EN | MAG3110_RAW_MODE);
 	}
 	else //Turn off raw mode
 	{
 		rawMode = FALSE;
-		i2c_result |= MAG3110_writeRegister(MAG3110_CTRL_REG2, MAG3110_AUTO_MRST_EN & ~(0x01 << 5));
+		i2c_result |= MAG3110_writeControl(MAG3110_CTRL_REG2, MAG3110_AUTO_MRST_EN);
 	}
     return i2c_result;
 }
@@ -306,16 +423,17 @@ I2C_RESULT MAG3110_start()
 {
 I2C_RESULT i2c_result = I2C_SUCCESS;	
 	i2c_result = MAG3110_exitStandby();
+	return i2c_result;
 }
 
 /* ************************************************************************* */
 I2C_RESULT MAG3110_enterStandby(void)
 {
 I2C_RESULT i2c_result = I2C_SUCCESS;	
-BYTE current;
     activeMode = FALSE;
-	current = MAG3110_readRegister(MAG3110_CTRL_REG1);
 	//Clear bits 0 and 1 to enter low power standby mode
+	i2c_result = MAG3110_writeControl(MAG3110_CTRL_REG1,
+			ctrlShadow[0] & ~(MAG3110_ACTIVE_MODE | MAG3110_TRIGGER_MEASUREMENT));
     return i2c_result;
 }
 
@@ -323,13 +441,8 @@ BYTE current;
 I2C_RESULT  MAG3110_exitStandby()
 {
 I2C_RESULT i2c_result = I2C_SUCCESS;	
-BYTE current;
 	activeMode = TRUE;
-  	current = MAG3110_readRegister(MAG3110_CTRL_REG1);
-    DelayMs(10);
-    i2c_result |= MAG3110_writeRegister(MAG3110_CTRL_REG1, (current | MAG3110_ACTIVE_MODE));
-    DelayMs(10);
-    current = MAG3110_readRegister(MAG3110_CTRL_REG1);        
+    i2c_result |= MAG3110_writeControl(MAG3110_CTRL_REG1, (ctrlShadow[0] | MAG3110_ACTIVE_MODE));
     return i2c_result;	
 }
 
@@ -384,14 +497,21 @@ I2C_RESULT i2c_result = I2C_SUCCESS;
 /* ************************************************************************** */
 I2C_RESULT MAG3110_calibrate(void)
 {
-I2C_RESULT i2c_result = I2C_SUCCESS;	
-BOOL ready;
-int16_t x,y,z;
-    do
+I2C_RESULT i2c_result = I2C_ERROR;	
+MAG3110_SAMPLE sample;
+
+    // The data-ready interrupt delivers the reading, no need to poll DR_STATUS
+    if(MAG3110_waitSample(&sample))
     {
-        ready = MAG3110_dataReady();
-    }while(!ready);
-	i2c_result = MAG3110_readMag(&x, &y, &z);
+        x = sample.x;
+        y = sample.y;
+        z = sample.z;
+        i2c_result = I2C_SUCCESS;
+    }
+    else
+    {
+        printf("No MAG3110 sample\n\r");
+    }
     MAG3110_exitCalMode();
     return i2c_result;
 }
@@ -403,8 +523,9 @@ I2C_RESULT i2c_result = I2C_SUCCESS;
     printf("Hard Xoff:%6d  Yoff:%6d  Zoff:%6d\n\r",
             x_offset,y_offset,z_offset);
 	
-    printf("Xgain: %1.6f  Ygain: %1.6f  Zgain: %1.6f\n\r",
-            x_scale,y_scale,z_scale);
+    printf("Soft iron (Q12): %6d %6d %6d\n\r", softIron[0][0], softIron[0][1], softIron[0][2]);
+    printf("                 %6d %6d %6d\n\r", softIron[1][0], softIron[1][1], softIron[1][2]);
+    printf("                 %6d %6d %6d\n\r", softIron[2][0], softIron[2][1], softIron[2][2]);
 	//Use the offsets (set to normal mode)
 	MAG3110_rawData(FALSE);
     DelayMs(10);
@@ -425,6 +546,12 @@ I2C_RESULT i2c_result = I2C_SUCCESS;
     i2c_result |= MAG3110_enterStandby();
 	i2c_result |= MAG3110_writeRegister(MAG3110_CTRL_REG1, 0x00); //Set everything to 0
 	i2c_result |= MAG3110_writeRegister(MAG3110_CTRL_REG2, 0x80); //Enable Auto Mag Reset, non-raw mode
+	ctrlShadow[0] = 0x00;
+	ctrlShadow[1] = 0x80;
+	ctrlKnown = (i2c_result == I2C_SUCCESS);
+	targetDROS = ctrlShadow[0] & MAG3110_DR_OS_MASK;
+	reconfigState = RECONFIG_IDLE;
+	lastValid = FALSE;
 	
 	calibrationMode = FALSE;
 	activeMode = FALSE;
@@ -438,6 +565,24 @@ I2C_RESULT i2c_result = I2C_SUCCESS;
     return i2c_result;
 }
 
+/* ************************************************************************** */
+// Writes CTRL_REG1 or CTRL_REG2 only if the value differs from what the
+// sensor already holds
+static I2C_RESULT MAG3110_writeControl(BYTE address, BYTE value)
+{
+I2C_RESULT i2c_result = I2C_SUCCESS;
+BYTE *shadow = &ctrlShadow[address - MAG3110_CTRL_REG1];
+
+    if(!ctrlKnown || (*shadow != value))
+    {
+        i2c_result = MAG3110_writeRegister(address, value);
+        *shadow = value;
+        // After a failed write the register contents are unknown
+        ctrlKnown = (i2c_result == I2C_SUCCESS);
+    }
+    return i2c_result;
+}
+
 /* ************************************************************************** */
 // This is private because you must read each axis for the data ready bit to 
 // be cleared. It may be confusing for casual users
@@ -473,6 +618,10 @@ void MAG3110_EnvCalibrate()
 	int TotalY = 0;
 	int TotalZ = 0;
 	int Step = 0;
+	int Count = 0;
+	int Fit;
+	MAG3110_SAMPLE sample;
+	MAGCAL_RESULT Cal;
 
 	const int StepMax = 1625;
 
@@ -480,16 +629,20 @@ void MAG3110_EnvCalibrate()
 	// For each cycle, calibrate then
 	// step by a full step
 
+	MagCal_reset();
+
 	// While we are calibrating 
 	while (Step < StepMax)
 	{
-		// Get the data
-		MAG3110_readMag(&x, &y, &z);
-
-		// Add the results
-		TotalX += x;
-		TotalY += y;
-		TotalZ += z;
+		// Add every sample taken since the last step
+		while (MAG3110_getSample(&sample))
+		{
+			MagCal_addSample(sample.x, sample.y, sample.z);
+			TotalX += sample.x;
+			TotalY += sample.y;
+			TotalZ += sample.z;
+			Count++;
+		}
 
 		// Then move the stepper motor
 		step(1, 1);
@@ -498,15 +651,258 @@ void MAG3110_EnvCalibrate()
         Step++;
 	}
     
-    TotalX /= StepMax;
-    TotalY /= StepMax;
-    TotalZ /= StepMax;
-    
-    x_offset = TotalX;
-    y_offset = TotalY;
-    z_offset = TotalZ;
+    if (Count == 0)
+    {
+        printf("Environmental cal. failed, no samples\n");
+        return;
+    }
 
+    // Ellipsoid fit for hard and soft iron, plain averages if it fails
+    Fit = MagCal_solve(&Cal);
+    if (Fit != MAGCAL_FIT_NONE)
+    {
+        x_offset = Cal.offset[0];
+        y_offset = Cal.offset[1];
+        z_offset = Cal.offset[2];
+        memcpy(softIron, Cal.matrix, sizeof(softIron));
+        printf("Ellipsoid fit (%s) from %d samples\n", (Fit == MAGCAL_FIT_3D) ? "3D" : "planar", MagCal_count());
+    }
+    else
+    {
+        TotalX /= Count;
+        TotalY /= Count;
+        TotalZ /= Count;
+    
+        x_offset = TotalX;
+        y_offset = TotalY;
+        z_offset = TotalZ;
+        MAG3110_defaultSoftIron();
+        printf("Ellipsoid fit failed, using averages\n");
+    }
     
-    printf("Offsets %d %d %d\n" , TotalX, TotalY, TotalZ);
+    printf("Offsets %d %d %d (%d samples)\n" , x_offset, y_offset, z_offset, Count);
 	printf("Environmental cal. complete\n");
+}
+
+/* ************************************************************************** */
+// Soft iron matrix from the fixed X_GAIN/Y_GAIN/Z_GAIN
+static void MAG3110_defaultSoftIron(void)
+{
+    memset(softIron, 0, sizeof(softIron));
+    softIron[0][0] = MAG_GAIN_Q12(X_GAIN);
+    softIron[1][1] = MAG_GAIN_Q12(Y_GAIN);
+    softIron[2][2] = MAG_GAIN_Q12(Z_GAIN);
+}
+
+/* ************************************************************************** */
+// Applies the hard iron offsets and the soft iron matrix to a raw sample
+static void MAG3110_correct(const MAG3110_SAMPLE *sample, int32_t *v)
+{
+int32_t d[3];
+int row;
+
+    d[0] = sample->x - x_offset;
+    d[1] = sample->y - y_offset;
+    d[2] = sample->z - z_offset;
+    for(row = 0; row < 3; row++)
+    {
+        if(d[row] > MAG_CORRECT_LIMIT) d[row] = MAG_CORRECT_LIMIT;
+        if(d[row] < -MAG_CORRECT_LIMIT) d[row] = -MAG_CORRECT_LIMIT;
+    }
+    for(row = 0; row < 3; row++)
+    {
+        v[row] = (softIron[row][0] * d[0] + softIron[row][1] * d[1] + softIron[row][2] * d[2]) >> 12;
+    }
+}
+
+/* ************************************************************************** */
+// MAG3110_sampleVector()
+// Horizontal field of a raw sample after calibration and, when there is a
+// recent accelerometer reading, tilt compensation. hx is across the boat,
+// hy along it, heading is atan2(hx, hy). Returns TRUE if tilt compensated.
+//
+BOOL MAG3110_sampleVector(const MAG3110_SAMPLE *sample, int32_t *hx, int32_t *hy)
+{
+int32_t v[3];
+MMA8652_SAMPLE accel;
+
+    MAG3110_correct(sample, v);
+    *hx = v[0];
+    *hy = v[1];
+    if(MMA8652_getLatest(&accel))
+        return MAG3110_tiltCompensate(v, &accel, hx, hy);
+    return FALSE;
+}
+
+/* ************************************************************************** */
+// Projects the corrected field onto the horizontal plane. With a the
+// accelerometer reading, the forward (Y) axis laid flat is y - (y.a)a/|a|^2
+// and the horizontal axis to its right is y x a. The field along them,
+// both scaled to |a|^2 * |y x a|, is
+//   hx = (v.(y x a)) |a|        hy = vy|a|^2 - ay(v.a)
+// Dividing by |a|^2 brings them back to (about) raw counts so they can be
+// filtered like the uncompensated components.
+// Returns FALSE (and leaves hx/hy alone) if the reading is far from 1 g.
+static BOOL MAG3110_tiltCompensate(const int32_t *v, const MMA8652_SAMPLE *accel, int32_t *hx, int32_t *hy)
+{
+int64_t ax = MMA8652_MAG_X(accel);
+int64_t ay = MMA8652_MAG_Y(accel);
+int64_t az = MMA8652_MAG_Z(accel);
+int64_t a2, dot, fx, fy;
+
+    a2 = ax * ax + ay * ay + az * az;
+    if((a2 < MAG_TILT_MIN_G2) || (a2 > MAG_TILT_MAX_G2))
+        return FALSE;       // Being shaken about, gravity is not known
+
+    dot = v[0] * ax + v[1] * ay + v[2] * az;
+    fx = (v[0] * az - v[2] * ax) * (int64_t) FixedSqrt((uint32_t) a2);
+    fy = v[1] * a2 - ay * dot;
+
+    *hx = (int32_t) (fx / a2);
+    *hy = (int32_t) (fy / a2);
+    return TRUE;
+}
+
+/* ************************************************************************** */
+// MAG3110_startSampling()
+// Lets the MAG3110 data-ready line trigger a background burst read of the
+// six output registers into the sample ring. The sensor must be active.
+//
+void MAG3110_startSampling(void)
+{
+    sampleReq.dev_id = MAG3110_I2C_ADDRESS;
+    sampleReq.reg_addr = MAG3110_OUT_X_MSB;
+    sampleReq.data = sampleData;
+    sampleReq.len = sizeof(sampleData);
+    sampleReq.done = MAG3110_sampleDone;
+
+    sampleHead = sampleTail = 0;
+    sampleOverruns = 0;
+    sampling = TRUE;
+
+    MAG3110_INT1_INPUT = 1;
+    mINT0ClearIntFlag();
+    ConfigINT0(EXT_INT_PRI_3 | RISING_EDGE_INT | EXT_INT_ENABLE);
+
+    // INT1 is edge triggered and stays high until the data is read, so a
+    // sample that is already waiting has to be fetched by hand
+    MAG3110_kickSample();
+}
+
+/* ************************************************************************** */
+void MAG3110_stopSampling(void)
+{
+    sampling = FALSE;
+    DisableINT0;
+}
+
+/* ************************************************************************** */
+// MAG3110_getSample()
+// Takes the oldest sample out of the ring. Returns FALSE when it is empty.
+// Also runs the I2C watchdog, so a burst read that stalls on the bus is
+// failed and restarted below instead of stopping the sampling for good.
+//
+BOOL MAG3110_getSample(MAG3110_SAMPLE *sample)
+{
+unsigned int tail;
+
+    I2C_AsyncWatchdog();
+    tail = sampleTail;
+    if(tail == sampleHead)
+    {
+        // A failed read leaves INT1 high and no new edge will come, restart
+        if(sampling && MAG3110_INT1 && !sampleReq.busy)
+            MAG3110_kickSample();
+        return FALSE;
+    }
+    *sample = sampleRing[tail];
+    sampleTail = (tail + 1) % MAG3110_SAMPLE_DEPTH;
+    lastSample = *sample;
+    lastValid = TRUE;
+    return TRUE;
+}
+
+/* ************************************************************************** */
+// Samples dropped because the ring was full
+unsigned int MAG3110_getOverruns(void)
+{
+    return sampleOverruns;
+}
+
+/* ************************************************************************** */
+// Background reads that failed, the sample they were for is lost
+unsigned int MAG3110_getErrors(void)
+{
+    return sampleErrors;
+}
+
+/* ************************************************************************** */
+// Waits up to MAG3110_SAMPLE_WAIT ms for the next sample
+static BOOL MAG3110_waitSample(MAG3110_SAMPLE *sample)
+{
+unsigned int tStart = millisec;
+
+    while((millisec - tStart) < MAG3110_SAMPLE_WAIT)
+    {
+        if(MAG3110_getSample(sample))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* ************************************************************************** */
+// Queues the burst read. Safe from both interrupt and loop context.
+static void MAG3110_kickSample(void)
+{
+    sampleStamp = (uint32_t) Clock_micros();
+    I2C_WriteReadAsync(&sampleReq);
+}
+
+/* ************************************************************************** */
+// Called from the I2C interrupt when the burst read finishes
+static void MAG3110_sampleDone(I2C_ASYNC_REQ *req)
+{
+unsigned int next;
+MAG3110_SAMPLE *sample;
+
+    if(req->result != I2C_SUCCESS)
+    {
+        sampleErrors++;         // Bus error, or failed by I2C_AsyncWatchdog
+        return;
+    }
+
+    next = (sampleHead + 1) % MAG3110_SAMPLE_DEPTH;
+    if(next == sampleTail)
+    {
+        sampleOverruns++;       // Consumer is behind, drop the new sample
+    }
+    else
+    {
+        sample = &sampleRing[sampleHead];
+        sample->x = (int16_t)((sampleData[0] << 8) | sampleData[1]);
+        sample->y = (int16_t)((sampleData[2] << 8) | sampleData[3]);
+        sample->z = (int16_t)((sampleData[4] << 8) | sampleData[5]);
+        sample->stamp = sampleStamp;
+        sampleHead = next;
+    }
+
+    // Read the accelerometer in the same slot so tilt matches the sample
+    MMA8652_startRead();
+
+    // The next conversion finished while this one was being read
+    if(sampling && MAG3110_INT1)
+        MAG3110_kickSample();
+}
+
+/* ------------------------------ Int0Handler -------------------------------
+  @ Summary
+    MAG3110 INT1 data ready. Starts the background read of X, Y and Z.
+  @ Parameter:  None, it is an ISR
+  @ Returns:    None
+  ---------------------------------------------------------------------------- */
+void __ISR(_EXTERNAL_0_VECTOR, IPL3SOFT) Int0Handler(void)
+{
+    mINT0ClearIntFlag();
+    if(sampling)
+        MAG3110_kickSample();
 }
\ No newline at end of file
@@ -40,8 +40,17 @@
 	#define Y_GAIN                  (1.0/231.1)
 	#define Z_GAIN                  (1.0/46.0)
 
+	// Uncalibrated soft iron matrix is diagonal: the gains in Q12, normalized
+	// so the larger of X_GAIN/Y_GAIN is 1.0 (atan2 only needs their ratio)
+	#define MAG_GAIN_MAX            ((X_GAIN > Y_GAIN) ? X_GAIN : Y_GAIN)
+	#define MAG_GAIN_Q12(gain)      ((int16_t)((gain) / MAG_GAIN_MAX * MAGCAL_Q12_ONE + 0.5))
+	#define MAG_CORRECT_LIMIT       (1 << 14)   // Keeps the Q12 products in int32
+	#define MAG_TILT_MIN_G2         (512L * 512L)     // Accel |a|^2 window, 0.5 g
+	#define MAG_TILT_MAX_G2         (1536L * 1536L)   // to 1.5 g (1024 counts per g)
+
 	#define RAD2DEG                 (180.0 / 3.14159)
 	#define MAG_DECLINATION         -13
+	#define MAG_DECLINATION_CDEG    (MAG_DECLINATION * 100)
 
 	/* ---------------------- MAG3110 WHO_AM_I Response ---------------------- */
 	#define MAG3110_WHO_AM_I_RSP	0xC4
@@ -81,6 +90,16 @@
 	#define MAG3110_DR_OS_0_16_64		0xF0
 	#define MAG3110_DR_OS_0_08_128		0xF8
 
+	#define MAG3110_DR_OS_MASK			0xF8
+
+	/* --------------------- Background rate changes ------------------------- */
+	#define MAG3110_STANDBY_TIMEOUT		100		// ms to wait for SYSMOD to show standby
+	#define MAG3110_TURN_DR_OS			MAG3110_DR_OS_80_16	// Rate while turning
+	#define MAG3110_CRUISE_DR_OS		MAG3110_DR_OS_20_64	// Rate holding a course
+	#define MAG3110_TURN_RATE			1500	// cdeg/s, at or above this is turning
+	#define MAG3110_CRUISE_RATE			500		// cdeg/s, at or below this is calm
+	#define MAG3110_CRUISE_HOLD			2000	// ms calm before dropping the rate
+
 	/* ---------------------- Other CTRL_REG1 Settings ----------------------- */
 	#define MAG3110_FAST_READ 			0x04
 	#define MAG3110_TRIGGER_MEASUREMENT	0x02
@@ -103,9 +122,24 @@
 	#define MAG3110_Z_AXIS 				5
 
 	#define CALIBRATION_TIMEOUT 		10000 //timeout in milliseconds
+
+	/* -------------------- Data-ready interrupt sampling -------------------- */
+	// MAG3110 INT1 (data ready, active high) is wired to INT0 on RD0
+	#define MAG3110_INT1			PORTDbits.RD0
+	#define MAG3110_INT1_INPUT		TRISDbits.TRISD0
+	#define MAG3110_SAMPLE_DEPTH	8		// Samples held between consumer passes
+	#define MAG3110_SAMPLE_WAIT		100		// ms to wait for one sample
+
+	typedef struct {
+		int16_t x, y, z;		// Raw output registers
+		uint32_t stamp;			// Clock_micros() when data ready was raised, low 32 bits
+	} MAG3110_SAMPLE;
 	#define DEG_PER_RAD 				(180.0/3.14159265358979)
 
 	#include <plib.h>
+	#include <stdint.h>
+	#include "FixedMath.h"
+	#include "MagCal.h"
 
 	// Function Prototypes
 	BOOL       MAG3110_initialize(void);
@@ -114,7 +148,7 @@
 	BOOL 	   MAG3110_dataReady(void);
 	I2C_RESULT MAG3110_readMag(int16_t* x, int16_t* y, int16_t* z);
 	I2C_RESULT MAG3110_readMicroTeslas(float* x, float* y, float* z);
-	I2C_RESULT MAG3110_readHeading(float *heading);
+	I2C_RESULT MAG3110_readHeading(int32_t *heading);
 	I2C_RESULT MAG3110_setDR_OS(BYTE DROS);
 	I2C_RESULT MAG3110_triggerMeasurement();
 	I2C_RESULT MAG3110_rawData(BOOL raw);
@@ -136,6 +170,17 @@
 	I2C_RESULT MAG3110_reset(void);
 
 	void MAG3110_EnvCalibrate();
+
+	void MAG3110_startSampling(void);
+	void MAG3110_stopSampling(void);
+	BOOL MAG3110_getSample(MAG3110_SAMPLE *sample);
+	unsigned int MAG3110_getOverruns(void);
+	unsigned int MAG3110_getErrors(void);
+	BOOL MAG3110_sampleVector(const MAG3110_SAMPLE *sample, int32_t *hx, int32_t *hy);
+
+	void MAG3110_requestDR_OS(BYTE DROS);
+	BOOL MAG3110_service(void);
+	void MAG3110_adaptRate(int32_t headingRate);
 #endif
 
 BOOL error;
@@ -0,0 +1,148 @@
+// File Inclusion
+#include "hardware.h"
+#include <stdint.h>
+#include "i2c_lib.h"
+#include "MMA8652.h"
+#include "Clock.h"
+
+#include <plib.h>
+#include <STDIO.h>
+
+// Function Prototypes
+BOOL       MMA8652_initialize(void);
+I2C_RESULT MMA8652_readAccel(int16_t *x, int16_t *y, int16_t *z);
+void       MMA8652_startRead(void);
+BOOL       MMA8652_getLatest(MMA8652_SAMPLE *sample);
+
+// Global Variables
+static BOOL present = FALSE;
+static BYTE readData[6];
+static I2C_ASYNC_REQ readReq;
+static volatile uint32_t readStamp;
+
+// Newest reading, written by the I2C interrupt. Volatile like latestSeq so
+// the compiler keeps every access to it between the two sequence reads.
+static volatile MMA8652_SAMPLE latest;
+static volatile unsigned int latestSeq = 0;		// Odd while latest is being written
+
+static void MMA8652_readDone(I2C_ASYNC_REQ *req);
+static void MMA8652_unpack(const BYTE *reg, int16_t *x, int16_t *y, int16_t *z);
+
+/* ************************************************************************** */
+// MMA8652_initialize()
+// Checks the part is there and starts it at 100 Hz, +/-2 g
+//
+BOOL MMA8652_initialize(void)
+{
+I2C_RESULT i2c_result;
+BYTE reg[2];
+BYTE who = 0;
+int len;
+
+	i2c_result = I2C_WriteRead(I2C1, MMA8652_I2C_ADDRESS, MMA8652_WHO_AM_I, &who, 1);
+	if((i2c_result != I2C_SUCCESS) || (who != MMA8652_WHO_AM_I_RSP))
+	{
+		printf("Could not find MMA8652 connected!\r\n");
+		return FALSE;
+	}
+
+	// Range and rate can only be changed in standby
+	reg[0] = MMA8652_CTRL_REG1;
+	reg[1] = MMA8652_STANDBY;
+	len = 2;
+	i2c_result |= I2C_Write(I2C1, MMA8652_I2C_ADDRESS, reg, &len);
+	reg[0] = MMA8652_XYZ_DATA_CFG;
+	reg[1] = MMA8652_RANGE_2G;
+	len = 2;
+	i2c_result |= I2C_Write(I2C1, MMA8652_I2C_ADDRESS, reg, &len);
+	reg[0] = MMA8652_CTRL_REG1;
+	reg[1] = MMA8652_DR_100 | MMA8652_ACTIVE;
+	len = 2;
+	i2c_result |= I2C_Write(I2C1, MMA8652_I2C_ADDRESS, reg, &len);
+
+	readReq.dev_id = MMA8652_I2C_ADDRESS;
+	readReq.reg_addr = MMA8652_OUT_X_MSB;
+	readReq.data = readData;
+	readReq.len = sizeof(readData);
+	readReq.done = MMA8652_readDone;
+
+	present = (i2c_result == I2C_SUCCESS);
+	if(present)
+		printf("MMA8652 connected\r\n");
+	return present;
+}
+
+/* ************************************************************************** */
+// MMA8652_readAccel()
+// Blocking read of all three axes
+//
+I2C_RESULT MMA8652_readAccel(int16_t *x, int16_t *y, int16_t *z)
+{
+I2C_RESULT i2c_result;
+BYTE reg[6];
+
+	i2c_result = I2C_WriteRead(I2C1, MMA8652_I2C_ADDRESS, MMA8652_OUT_X_MSB, reg, 6);
+	if(i2c_result == I2C_SUCCESS)
+		MMA8652_unpack(reg, x, y, z);
+	return i2c_result;
+}
+
+/* ************************************************************************** */
+// MMA8652_startRead()
+// Queues a background read of all three axes. Safe from interrupts, the
+// MAG3110 sampling calls it so both sensors are read back to back.
+//
+void MMA8652_startRead(void)
+{
+	if(present && !readReq.busy)
+	{
+		readStamp = (uint32_t) Clock_micros();
+		I2C_WriteReadAsync(&readReq);
+	}
+}
+
+/* ************************************************************************** */
+// MMA8652_getLatest()
+// Copies the newest background reading. Returns FALSE if there is none or
+// it is older than MMA8652_MAX_AGE.
+//
+BOOL MMA8652_getLatest(MMA8652_SAMPLE *sample)
+{
+unsigned int seq;
+
+	// Retry if the interrupt updated it during the copy
+	do
+	{
+		seq = latestSeq;
+		*sample = latest;
+	} while((seq & 1) || (seq != latestSeq));
+
+	return (seq != 0) && (((uint32_t) Clock_micros() - sample->stamp) <= MMA8652_MAX_AGE);
+}
+
+/* ************************************************************************** */
+// Called from the I2C interrupt when the background read finishes
+static void MMA8652_readDone(I2C_ASYNC_REQ *req)
+{
+int16_t x, y, z;
+
+	if(req->result != I2C_SUCCESS)
+		return;
+
+	MMA8652_unpack(readData, &x, &y, &z);
+	latestSeq++;
+	latest.x = x;
+	latest.y = y;
+	latest.z = z;
+	latest.stamp = readStamp;
+	latestSeq++;
+}
+
+/* ************************************************************************** */
+// Output registers hold 12 bit left justified values
+static void MMA8652_unpack(const BYTE *reg, int16_t *x, int16_t *y, int16_t *z)
+{
+	*x = ((int16_t)((reg[0] << 8) | reg[1])) >> 4;
+	*y = ((int16_t)((reg[2] << 8) | reg[3])) >> 4;
+	*z = ((int16_t)((reg[4] << 8) | reg[5])) >> 4;
+}
@@ -0,0 +1,48 @@
+#ifndef __MMA8652_H__
+	#define __MMA8652_H__
+
+	/* ----------------- MMA8652 Registers (Basys MX3 on board) -------------- */
+	#define MMA8652_I2C_ADDRESS		0x1D
+
+	#define MMA8652_STATUS			0x00
+	#define MMA8652_OUT_X_MSB		0x01
+	#define MMA8652_OUT_X_LSB		0x02
+	#define MMA8652_OUT_Y_MSB		0x03
+	#define MMA8652_OUT_Y_LSB		0x04
+	#define MMA8652_OUT_Z_MSB		0x05
+	#define MMA8652_OUT_Z_LSB		0x06
+	#define MMA8652_WHO_AM_I		0x0D
+	#define MMA8652_XYZ_DATA_CFG	0x0E
+	#define MMA8652_CTRL_REG1		0x2A
+	#define MMA8652_CTRL_REG2		0x2B
+
+	/* ---------------------- MMA8652 WHO_AM_I Response ---------------------- */
+	#define MMA8652_WHO_AM_I_RSP	0x4A
+
+	/* ------------------------- Commands & Settings ------------------------- */
+	#define MMA8652_RANGE_2G		0x00	// XYZ_DATA_CFG, 1024 counts per g
+	#define MMA8652_DR_100			0x18	// CTRL_REG1 data rate 100 Hz
+	#define MMA8652_ACTIVE			0x01
+	#define MMA8652_STANDBY			0x00
+	#define MMA8652_MAX_AGE			100000	// us before a reading is too old to use
+
+	// Accelerometer axes expressed in the MAG3110 frame. The MAG3110 board
+	// is mounted square to the Basys MX3, change these if it is rotated.
+	#define MMA8652_MAG_X(s)		((s)->x)
+	#define MMA8652_MAG_Y(s)		((s)->y)
+	#define MMA8652_MAG_Z(s)		((s)->z)
+
+	#include <plib.h>
+	#include <stdint.h>
+
+	typedef struct {
+		int16_t x, y, z;		// 12 bit readings, 1024 per g
+		uint32_t stamp;			// Clock_micros() when the read was started, low 32 bits
+	} MMA8652_SAMPLE;
+
+	// Function Prototypes
+	BOOL       MMA8652_initialize(void);
+	I2C_RESULT MMA8652_readAccel(int16_t *x, int16_t *y, int16_t *z);
+	void       MMA8652_startRead(void);
+	BOOL       MMA8652_getLatest(MMA8652_SAMPLE *sample);
+#endif
@@ -0,0 +1,492 @@
+// File Inclusion
+#include "MagCal.h"
+#include <plib.h>
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* --------------------------------------------------------------------------
+   Ellipsoid fit
+
+   The fit is the least squares solution of d . p = 1 with
+
+       d = [x^2, y^2, z^2, xy, xz, yz, x, y, z]
+
+   i.e. the quadric v'Av + 2g'v = 1, with v measured from the middle of the
+   samples (the origin has to be inside the ellipsoid for this form). The
+   middle is not known until the sweep is over, so every raw moment
+   sum(dx^a dy^b dz^c), a+b+c <= 4, is kept relative to the first sample
+   instead, and the normal equations are rebuilt around the mean when
+   solving. A sample costs the same 34 integer multiply-adds no matter how
+   many have been collected. The solve runs once, in double.
+   -------------------------------------------------------------------------- */
+#define MAGCAL_TERMS	9
+#define MAGCAL_ORDER	4
+#define MAGCAL_MOMENTS	34		// Exponent triples with 1 <= a+b+c <= 4
+
+static const BYTE exponents[MAGCAL_MOMENTS][3] = {
+	{1,0,0}, {0,1,0}, {0,0,1},
+	{2,0,0}, {1,1,0}, {1,0,1}, {0,2,0}, {0,1,1}, {0,0,2},
+	{3,0,0}, {2,1,0}, {2,0,1}, {1,2,0}, {1,1,1}, {1,0,2}, {0,3,0}, {0,2,1},
+	{0,1,2}, {0,0,3},
+	{4,0,0}, {3,1,0}, {3,0,1}, {2,2,0}, {2,1,1}, {2,0,2}, {1,3,0}, {1,2,1},
+	{1,1,2}, {1,0,3}, {0,4,0}, {0,3,1}, {0,2,2}, {0,1,3}, {0,0,4}
+};
+
+// Design terms as exponent triples, same order as d above
+static const BYTE design[MAGCAL_TERMS][3] = {
+	{2,0,0}, {0,2,0}, {0,0,2}, {1,1,0}, {1,0,1}, {0,1,1}, {1,0,0}, {0,1,0}, {0,0,1}
+};
+
+static int64_t moment[MAGCAL_MOMENTS];	// Raw sums, relative to the first sample
+static int16_t ref[3];					// First sample
+static int count = 0;
+static double centered[MAGCAL_ORDER + 1][MAGCAL_ORDER + 1][MAGCAL_ORDER + 1];
+static double mean[3];
+
+///* --- Function Prototyping --- */
+static void CenterMoments(void);
+static double Moment(const BYTE *e1, const BYTE *e2);
+static BOOL SolveSubset(const int *terms, int n, double *p);
+static BOOL CenterAndShape(double A[3][3], const double *g, int n, double *center);
+static void Jacobi3(double A[3][3], double V[3][3], double *lambda);
+static BOOL SquareRootQ12(double M[3][3], int16_t out[3][3]);
+
+/* ------------------------------- MagCal_reset ------------------------------
+ @ Summary
+    Discards all collected samples
+ @ Parameters
+    None
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+void MagCal_reset(void) {
+	memset(moment, 0, sizeof(moment));
+	count = 0;
+}
+
+/* ----------------------------- MagCal_addSample ----------------------------
+ @ Summary
+    Adds one raw magnetometer sample to the fit
+ @ Parameters
+    @ param1-3 : raw X, Y and Z counts
+ @ Return Value
+    BOOL : FALSE if the sample was not used (out of range or the fit is full)
+ @ Notes
+    Samples are made relative to the first one so a 4th power stays below
+    2^48 and MAGCAL_MAX_SAMPLES of them fit an int64 sum.
+  ---------------------------------------------------------------------------- */
+BOOL MagCal_addSample(int16_t x, int16_t y, int16_t z) {
+	int64_t px[MAGCAL_ORDER + 1], py[MAGCAL_ORDER + 1], pz[MAGCAL_ORDER + 1];
+	int32_t dx, dy, dz;
+	int k;
+
+	if (count >= MAGCAL_MAX_SAMPLES) {
+		return FALSE;
+	}
+	if (count == 0) {
+		ref[0] = x;
+		ref[1] = y;
+		ref[2] = z;
+	}
+
+	dx = x - ref[0];
+	dy = y - ref[1];
+	dz = z - ref[2];
+	if ((abs(dx) >= MAGCAL_LIMIT) || (abs(dy) >= MAGCAL_LIMIT) || (abs(dz) >= MAGCAL_LIMIT)) {
+		return FALSE;
+	}
+
+	px[0] = py[0] = pz[0] = 1;
+	for (k = 1; k <= MAGCAL_ORDER; k++) {
+		px[k] = px[k - 1] * dx;
+		py[k] = py[k - 1] * dy;
+		pz[k] = pz[k - 1] * dz;
+	}
+	for (k = 0; k < MAGCAL_MOMENTS; k++) {
+		moment[k] += px[exponents[k][0]] * py[exponents[k][1]] * pz[exponents[k][2]];
+	}
+	count++;
+	return TRUE;
+}
+
+/* ------------------------------- MagCal_count ------------------------------
+ @ Summary
+    Number of samples in the fit so far
+  ---------------------------------------------------------------------------- */
+int MagCal_count(void) {
+	return count;
+}
+
+/* ------------------------------- MagCal_solve ------------------------------
+ @ Summary
+    Turns the collected samples into hard iron offsets and a soft iron
+    correction matrix
+ @ Parameters
+    @ param1 : where to put the result, untouched for MAGCAL_FIT_NONE
+ @ Return Value
+    int : MAGCAL_FIT_3D, MAGCAL_FIT_2D or MAGCAL_FIT_NONE
+ @ Notes
+    A sweep that only turns about Z (the calibration stepper) does not
+    constrain the Z terms, so if the full fit fails a planar ellipse is fitted
+    from the same sums. Z then only gets its mean as offset. The matrix is
+    scaled to unit determinant so corrected vectors keep roughly the raw
+    magnitude. Takes a few ms of soft float, call it outside the control loop.
+  ---------------------------------------------------------------------------- */
+int MagCal_solve(MAGCAL_RESULT *result) {
+	static const int terms3D[9] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+	static const int terms2D[5] = {0, 1, 3, 6, 7};
+	double p[MAGCAL_TERMS];
+	double A[3][3];
+	double g[3];
+	double center[3];
+	int16_t matrix[3][3];
+	int fit = MAGCAL_FIT_NONE;
+	int idx;
+
+	if (count < MAGCAL_MIN_SAMPLES) {
+		return MAGCAL_FIT_NONE;
+	}
+	CenterMoments();
+
+	if (SolveSubset(terms3D, 9, p)) {
+		A[0][0] = p[0];       A[0][1] = p[3] / 2.0; A[0][2] = p[4] / 2.0;
+		A[1][0] = p[3] / 2.0; A[1][1] = p[1];       A[1][2] = p[5] / 2.0;
+		A[2][0] = p[4] / 2.0; A[2][1] = p[5] / 2.0; A[2][2] = p[2];
+		g[0] = p[6] / 2.0; g[1] = p[7] / 2.0; g[2] = p[8] / 2.0;
+		if (CenterAndShape(A, g, 3, center) && SquareRootQ12(A, matrix)) {
+			fit = MAGCAL_FIT_3D;
+		}
+	}
+
+	if ((fit == MAGCAL_FIT_NONE) && SolveSubset(terms2D, 5, p)) {
+		memset(A, 0, sizeof(A));
+		A[0][0] = p[0];       A[0][1] = p[2] / 2.0;
+		A[1][0] = p[2] / 2.0; A[1][1] = p[1];
+		g[0] = p[3] / 2.0; g[1] = p[4] / 2.0;
+		if (CenterAndShape(A, g, 2, center)) {
+			// Give Z the geometric mean of the X/Y scale so its row comes out as 1.0
+			A[2][2] = sqrt(A[0][0] * A[1][1] - A[0][1] * A[1][0]);
+			center[2] = 0.0;		// The mean
+			if (SquareRootQ12(A, matrix)) {
+				fit = MAGCAL_FIT_2D;
+			}
+		}
+	}
+
+	if (fit != MAGCAL_FIT_NONE) {
+		for (idx = 0; idx < 3; idx++) {
+			result->offset[idx] = ref[idx] + (int16_t) floor(mean[idx] + center[idx] + 0.5);
+		}
+		memcpy(result->matrix, matrix, sizeof(matrix));
+	}
+	return fit;
+}
+
+/* ------------------------------- CenterMoments -----------------------------
+ @ Summary
+    Shifts the raw moments from the first sample to the sample mean
+ @ Notes
+    sum((d - m)^a ...) expanded with the binomial theorem per axis.
+  ---------------------------------------------------------------------------- */
+static void CenterMoments(void) {
+	static const BYTE binom[MAGCAL_ORDER + 1][MAGCAL_ORDER + 1] = {
+		{1,0,0,0,0}, {1,1,0,0,0}, {1,2,1,0,0}, {1,3,3,1,0}, {1,4,6,4,1}
+	};
+	double raw[MAGCAL_ORDER + 1][MAGCAL_ORDER + 1][MAGCAL_ORDER + 1];
+	double pm[3][MAGCAL_ORDER + 1];
+	double sum;
+	int a, b, c, i, j, k, axis;
+
+	raw[0][0][0] = (double) count;
+	for (k = 0; k < MAGCAL_MOMENTS; k++) {
+		raw[exponents[k][0]][exponents[k][1]][exponents[k][2]] = (double) moment[k];
+	}
+	mean[0] = raw[1][0][0] / count;
+	mean[1] = raw[0][1][0] / count;
+	mean[2] = raw[0][0][1] / count;
+
+	// Powers of -mean
+	for (axis = 0; axis < 3; axis++) {
+		pm[axis][0] = 1.0;
+		for (k = 1; k <= MAGCAL_ORDER; k++) {
+			pm[axis][k] = pm[axis][k - 1] * -mean[axis];
+		}
+	}
+
+	for (a = 0; a <= MAGCAL_ORDER; a++) {
+		for (b = 0; a + b <= MAGCAL_ORDER; b++) {
+			for (c = 0; a + b + c <= MAGCAL_ORDER; c++) {
+				sum = 0.0;
+				for (i = 0; i <= a; i++) {
+					for (j = 0; j <= b; j++) {
+						for (k = 0; k <= c; k++) {
+							sum += binom[a][i] * binom[b][j] * binom[c][k] *
+								pm[0][a - i] * pm[1][b - j] * pm[2][c - k] * raw[i][j][k];
+						}
+					}
+				}
+				centered[a][b][c] = sum;
+			}
+		}
+	}
+}
+
+/* ---------------------------------- Moment ---------------------------------
+ @ Summary
+    Centered moment for the product of two design terms (0 = constant 1)
+  ---------------------------------------------------------------------------- */
+static double Moment(const BYTE *e1, const BYTE *e2) {
+	static const BYTE one[3] = {0, 0, 0};
+
+	if (e2 == NULL) {
+		e2 = one;
+	}
+	return centered[e1[0] + e2[0]][e1[1] + e2[1]][e1[2] + e2[2]];
+}
+
+/* -------------------------------- SolveSubset ------------------------------
+ @ Summary
+    Solves the normal equations restricted to some of the terms
+ @ Parameters
+    @ param1 : indexes of the terms to use
+    @ param2 : how many terms
+    @ param3 : solution, indexed like param1
+ @ Return Value
+    BOOL : FALSE if the system is singular or badly conditioned
+ @ Notes
+    Quadratic and linear terms differ by ~2^9 in size, so the system is
+    scaled by its diagonal before the Cholesky factorization.
+  ---------------------------------------------------------------------------- */
+static BOOL SolveSubset(const int *terms, int n, double *p) {
+	double L[MAGCAL_TERMS][MAGCAL_TERMS];
+	double scale[MAGCAL_TERMS];
+	double b[MAGCAL_TERMS];
+	double sum;
+	int i, j, k;
+
+	for (i = 0; i < n; i++) {
+		scale[i] = Moment(design[terms[i]], design[terms[i]]);
+		if (scale[i] <= 0.0) {
+			return FALSE;
+		}
+		scale[i] = 1.0 / sqrt(scale[i]);
+	}
+
+	// L L' = S (D'D) S, unit diagonal before factoring
+	for (i = 0; i < n; i++) {
+		for (j = 0; j <= i; j++) {
+			sum = Moment(design[terms[i]], design[terms[j]]) * scale[i] * scale[j];
+			for (k = 0; k < j; k++) {
+				sum -= L[i][k] * L[j][k];
+			}
+			if (i == j) {
+				if (sum < 1e-10) {
+					return FALSE;
+				}
+				L[i][i] = sqrt(sum);
+			}
+			else {
+				L[i][j] = sum / L[j][j];
+			}
+		}
+	}
+
+	// Forward then back substitution
+	for (i = 0; i < n; i++) {
+		sum = Moment(design[terms[i]], NULL) * scale[i];
+		for (k = 0; k < i; k++) {
+			sum -= L[i][k] * b[k];
+		}
+		b[i] = sum / L[i][i];
+	}
+	for (i = n - 1; i >= 0; i--) {
+		sum = b[i];
+		for (k = i + 1; k < n; k++) {
+			sum -= L[k][i] * p[k];
+		}
+		p[i] = sum / L[i][i];
+	}
+	for (i = 0; i < n; i++) {
+		p[i] *= scale[i];
+	}
+	return TRUE;
+}
+
+/* ------------------------------ CenterAndShape -----------------------------
+ @ Summary
+    Finds the center of v'Av + 2g'v = 1 and normalizes A so that
+    (v - c)'A(v - c) = 1
+ @ Parameters
+    @ param1 : quadric matrix, normalized in place
+    @ param2 : linear terms
+    @ param3 : 2 or 3, size of the problem (upper left block of A)
+    @ param4 : center
+ @ Return Value
+    BOOL : FALSE if the quadric is not an ellipse / ellipsoid
+  ---------------------------------------------------------------------------- */
+static BOOL CenterAndShape(double A[3][3], const double *g, int n, double *center) {
+	double inv[3][3];
+	double det, k;
+	int i, j;
+
+	if (n == 2) {
+		det = A[0][0] * A[1][1] - A[0][1] * A[1][0];
+		if (det <= 0.0) {
+			return FALSE;
+		}
+		inv[0][0] = A[1][1] / det;
+		inv[0][1] = -A[0][1] / det;
+		inv[1][0] = -A[1][0] / det;
+		inv[1][1] = A[0][0] / det;
+	}
+	else {
+		inv[0][0] = A[1][1] * A[2][2] - A[1][2] * A[2][1];
+		inv[0][1] = A[0][2] * A[2][1] - A[0][1] * A[2][2];
+		inv[0][2] = A[0][1] * A[1][2] - A[0][2] * A[1][1];
+		inv[1][0] = A[1][2] * A[2][0] - A[1][0] * A[2][2];
+		inv[1][1] = A[0][0] * A[2][2] - A[0][2] * A[2][0];
+		inv[1][2] = A[0][2] * A[1][0] - A[0][0] * A[1][2];
+		inv[2][0] = A[1][0] * A[2][1] - A[1][1] * A[2][0];
+		inv[2][1] = A[0][1] * A[2][0] - A[0][0] * A[2][1];
+		inv[2][2] = A[0][0] * A[1][1] - A[0][1] * A[1][0];
+		det = A[0][0] * inv[0][0] + A[0][1] * inv[1][0] + A[0][2] * inv[2][0];
+		if (det == 0.0) {
+			return FALSE;
+		}
+		for (i = 0; i < 3; i++) {
+			for (j = 0; j < 3; j++) {
+				inv[i][j] /= det;
+			}
+		}
+	}
+
+	// c = -A^-1 g, then k = 1 + c'Ac
+	k = 1.0;
+	for (i = 0; i < n; i++) {
+		center[i] = 0.0;
+		for (j = 0; j < n; j++) {
+			center[i] -= inv[i][j] * g[j];
+		}
+	}
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			k += center[i] * A[i][j] * center[j];
+		}
+	}
+	if (k <= 0.0) {
+		return FALSE;
+	}
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			A[i][j] /= k;
+		}
+	}
+	return TRUE;
+}
+
+/* --------------------------------- Jacobi3 ---------------------------------
+ @ Summary
+    Eigen decomposition of a symmetric 3x3 matrix, A = V diag(lambda) V'
+ @ Parameters
+    @ param1 : matrix, destroyed
+    @ param2 : eigenvectors in the columns
+    @ param3 : eigenvalues
+  ---------------------------------------------------------------------------- */
+static void Jacobi3(double A[3][3], double V[3][3], double *lambda) {
+	double theta, t, c, s, tmp;
+	int sweep, p, q, k;
+
+	for (p = 0; p < 3; p++) {
+		for (q = 0; q < 3; q++) {
+			V[p][q] = (p == q) ? 1.0 : 0.0;
+		}
+	}
+
+	for (sweep = 0; sweep < 10; sweep++) {
+		if ((fabs(A[0][1]) + fabs(A[0][2]) + fabs(A[1][2])) < 1e-15 * (fabs(A[0][0]) + fabs(A[1][1]) + fabs(A[2][2]))) {
+			break;
+		}
+		for (p = 0; p < 2; p++) {
+			for (q = p + 1; q < 3; q++) {
+				if (A[p][q] == 0.0) {
+					continue;
+				}
+				// Rotation that zeroes A[p][q]
+				theta = (A[q][q] - A[p][p]) / (2.0 * A[p][q]);
+				t = ((theta >= 0.0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+				c = 1.0 / sqrt(t * t + 1.0);
+				s = t * c;
+				for (k = 0; k < 3; k++) {
+					tmp = A[k][p];
+					A[k][p] = c * tmp - s * A[k][q];
+					A[k][q] = s * tmp + c * A[k][q];
+				}
+				for (k = 0; k < 3; k++) {
+					tmp = A[p][k];
+					A[p][k] = c * tmp - s * A[q][k];
+					A[q][k] = s * tmp + c * A[q][k];
+				}
+				for (k = 0; k < 3; k++) {
+					tmp = V[k][p];
+					V[k][p] = c * tmp - s * V[k][q];
+					V[k][q] = s * tmp + c * V[k][q];
+				}
+			}
+		}
+	}
+	for (k = 0; k < 3; k++) {
+		lambda[k] = A[k][k];
+	}
+}
+
+/* ------------------------------- SquareRootQ12 -----------------------------
+ @ Summary
+    Symmetric square root of the normalized shape matrix, scaled to unit
+    determinant and converted to Q12
+ @ Parameters
+    @ param1 : shape matrix (positive definite), destroyed
+    @ param2 : Q12 correction matrix
+ @ Return Value
+    BOOL : FALSE if the shape is not a plausible ellipsoid
+  ---------------------------------------------------------------------------- */
+static BOOL SquareRootQ12(double M[3][3], int16_t out[3][3]) {
+	double V[3][3];
+	double lambda[3];
+	double root[3];
+	double lMin, lMax, gain, value;
+	int i, j, k;
+
+	Jacobi3(M, V, lambda);
+
+	lMin = lMax = lambda[0];
+	for (k = 1; k < 3; k++) {
+		if (lambda[k] < lMin) lMin = lambda[k];
+		if (lambda[k] > lMax) lMax = lambda[k];
+	}
+	if ((lMin <= 0.0) || ((lMax / lMin) > MAGCAL_MAX_RATIO)) {
+		return FALSE;
+	}
+
+	// Unit determinant: the product of the roots is 1
+	gain = pow(lambda[0] * lambda[1] * lambda[2], -1.0 / 6.0);
+	for (k = 0; k < 3; k++) {
+		root[k] = sqrt(lambda[k]) * gain;
+	}
+
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) {
+			value = 0.0;
+			for (k = 0; k < 3; k++) {
+				value += V[i][k] * root[k] * V[j][k];
+			}
+			value *= MAGCAL_Q12_ONE;
+			if ((value > 32767.0) || (value < -32768.0)) {
+				return FALSE;
+			}
+			out[i][j] = (int16_t) floor(value + 0.5);
+		}
+	}
+	return TRUE;
+}
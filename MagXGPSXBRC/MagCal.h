@@ -0,0 +1,29 @@
+#ifndef __MAGCAL_H__
+	#define __MAGCAL_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define MAGCAL_MAX_SAMPLES	2048	// Keeps the int64 sums from overflowing
+	#define MAGCAL_MIN_SAMPLES	50		// Fewer than this is not worth solving
+	#define MAGCAL_LIMIT		4096	// Largest distance from the first sample
+	#define MAGCAL_MAX_RATIO	16.0	// Largest allowed eigenvalue spread (axis ratio 4)
+	#define MAGCAL_Q12_ONE		4096	// 1.0 in the correction matrix
+
+	// MagCal_solve results
+	#define MAGCAL_FIT_NONE		0		// Degenerate data, nothing produced
+	#define MAGCAL_FIT_2D		1		// Rotation in one plane only, Z row is identity
+	#define MAGCAL_FIT_3D		2		// Full ellipsoid
+
+	typedef struct {
+		int16_t offset[3];			// Hard iron, raw counts
+		int16_t matrix[3][3];		// Soft iron correction, Q12
+	} MAGCAL_RESULT;
+
+	// Function Prototypes
+	void MagCal_reset(void);
+	BOOL MagCal_addSample(int16_t x, int16_t y, int16_t z);
+	int  MagCal_count(void);
+	int  MagCal_solve(MAGCAL_RESULT *result);
+#endif
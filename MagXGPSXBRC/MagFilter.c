@@ -0,0 +1,239 @@
+// File Inclusion
+#include "MagFilter.h"
+#include "FixedMath.h"
+#include "MAG3110.h"
+#include <plib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+   The horizontal field components (not the angle, which wraps) are filtered
+   sample by sample at the sensor's data rate. Each stage keeps its own
+   window so a sample costs O(1) for the average and IIR and a short
+   insertion sort for the median. Heading and heading rate are worked out
+   from the filter output and can be read at any rate.
+
+   The rate is the turn across the samples of the last MAGFILTER_RATE_SPAN_US
+   over the time between the first and last of them, on the microsecond
+   stamps. Across two neighbouring samples, 12.5 ms apart at 80 Hz, a tenth
+   of a degree of heading noise is 8 degrees per second of rate; across the
+   span it is half a degree per second. The price is that the rate is about
+   half the span old.
+   -------------------------------------------------------------------------- */
+#define AXES		2
+#define IIR_FRAC	8		// IIR state keeps 8 fraction bits
+
+typedef struct {
+	int32_t median[MAGFILTER_MAX_MEDIAN];	// Last inputs, oldest at medianPos
+	int32_t average[MAGFILTER_MAX_AVERAGE];
+	int32_t averageSum;
+	int32_t iir;
+	BYTE medianPos;
+	BYTE medianFill;
+	BYTE averagePos;
+	BYTE averageFill;
+	BOOL iirPrimed;
+} AXIS_STATE;
+
+static MAGFILTER_CONFIG config = MAGFILTER_DEFAULT_CONFIG;
+static AXIS_STATE axis[AXES];
+
+static BOOL haveHeading = FALSE;
+static int32_t heading;				// Centidegrees, 0-35999
+static BOOL haveRate = FALSE;
+static int32_t rate;				// Centidegrees per second
+
+// Rate window: each sample's stamp and its turn from the one before
+static int32_t rateTurn[MAGFILTER_RATE_DEPTH];
+static uint32_t rateStamp[MAGFILTER_RATE_DEPTH];
+static BYTE rateOldest;
+static BYTE rateCount;
+static int32_t windowTurn;			// Sum of rateTurn after the oldest
+
+///* --- Function Prototyping --- */
+static int32_t MedianStage(AXIS_STATE *state, int32_t in);
+static int32_t AverageStage(AXIS_STATE *state, int32_t in);
+static int32_t IIRStage(AXIS_STATE *state, int32_t in);
+
+/* ---------------------------- MagFilter_configure --------------------------
+ @ Summary
+    Sets up the filter chain and clears all filter history
+ @ Parameters
+    @ param1 : chain and window sizes, lengths are clipped to the maximums
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+void MagFilter_configure(const MAGFILTER_CONFIG *newConfig) {
+	config = *newConfig;
+	if (config.median_len > MAGFILTER_MAX_MEDIAN) config.median_len = MAGFILTER_MAX_MEDIAN;
+	if (config.median_len < 1) config.median_len = 1;
+	config.median_len |= 1;			// Odd, so there is a middle value
+	if (config.average_len > MAGFILTER_MAX_AVERAGE) config.average_len = MAGFILTER_MAX_AVERAGE;
+	if (config.average_len < 1) config.average_len = 1;
+
+	memset(axis, 0, sizeof(axis));
+	haveHeading = FALSE;
+	haveRate = FALSE;
+	rateCount = 0;
+}
+
+/* ------------------------------- MagFilter_add -----------------------------
+ @ Summary
+    Runs one sample through the filter chain and updates heading and rate
+ @ Parameters
+    @ param1 : horizontal field across the boat (MAG3110_sampleVector)
+    @ param2 : horizontal field along the boat
+    @ param3 : Clock_micros() time stamp of the sample, low 32 bits
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+void MagFilter_add(int32_t hx, int32_t hy, uint32_t stamp) {
+	int32_t value[AXES];
+	int32_t newHeading, delta;
+	uint32_t span;
+	int idx, stage, newest;
+
+	value[0] = hx;
+	value[1] = hy;
+	for (idx = 0; idx < AXES; idx++) {
+		for (stage = 0; stage < MAGFILTER_MAX_STAGES; stage++) {
+			switch (config.chain[stage]) {
+				case MAGFILTER_MEDIAN:
+					value[idx] = MedianStage(&axis[idx], value[idx]);
+					break;
+				case MAGFILTER_AVERAGE:
+					value[idx] = AverageStage(&axis[idx], value[idx]);
+					break;
+				case MAGFILTER_IIR:
+					value[idx] = IIRStage(&axis[idx], value[idx]);
+					break;
+				default:
+					stage = MAGFILTER_MAX_STAGES;	// End of chain
+			}
+		}
+	}
+
+	newHeading = FixedWrap360(FixedAtan2(value[0], value[1]) + MAG_DECLINATION_CDEG);
+
+	// Shortest turn from the last heading joins the rate window
+	delta = 0;
+	if (haveHeading) {
+		delta = newHeading - heading;
+		if (delta > CDEG_180) delta -= CDEG_360;
+		if (delta < -CDEG_180) delta += CDEG_360;
+	}
+	if (rateCount == MAGFILTER_RATE_DEPTH) {
+		rateOldest = (rateOldest + 1) % MAGFILTER_RATE_DEPTH;
+		windowTurn -= rateTurn[rateOldest];
+		rateCount--;
+	}
+	newest = (rateOldest + rateCount) % MAGFILTER_RATE_DEPTH;
+	rateTurn[newest] = delta;
+	rateStamp[newest] = stamp;
+	if (rateCount > 0) {
+		windowTurn += delta;
+	}
+	else {
+		windowTurn = 0;
+	}
+	rateCount++;
+
+	// Drop the oldest while the one after it still gives the full span
+	while ((rateCount > 2)
+			&& ((stamp - rateStamp[(rateOldest + 1) % MAGFILTER_RATE_DEPTH]) >= MAGFILTER_RATE_SPAN_US)) {
+		rateOldest = (rateOldest + 1) % MAGFILTER_RATE_DEPTH;
+		windowTurn -= rateTurn[rateOldest];
+		rateCount--;
+	}
+
+	span = stamp - rateStamp[rateOldest];
+	if ((rateCount > 1) && (span > 0)) {
+		rate = (int32_t) (((int64_t) windowTurn * 1000000) / (int32_t) span);
+		haveRate = TRUE;
+	}
+
+	heading = newHeading;
+	haveHeading = TRUE;
+}
+
+/* ----------------------------- MagFilter_heading ---------------------------
+ @ Summary
+    Filtered heading in centidegrees, 0-35999
+ @ Return Value
+    BOOL : FALSE until the first sample has been added
+  ---------------------------------------------------------------------------- */
+BOOL MagFilter_heading(int32_t *value) {
+	*value = heading;
+	return haveHeading;
+}
+
+/* ------------------------------ MagFilter_rate -----------------------------
+ @ Summary
+    Heading rate in centidegrees per second, positive turning clockwise
+ @ Return Value
+    BOOL : FALSE until two samples have been added
+  ---------------------------------------------------------------------------- */
+BOOL MagFilter_rate(int32_t *value) {
+	*value = rate;
+	return haveRate;
+}
+
+/* -------------------------------- MedianStage ------------------------------
+ @ Summary
+    Median of the last median_len inputs (fewer while the window fills)
+  ---------------------------------------------------------------------------- */
+static int32_t MedianStage(AXIS_STATE *state, int32_t in) {
+	int32_t sorted[MAGFILTER_MAX_MEDIAN];
+	int32_t tmp;
+	int count, i, j;
+
+	state->median[state->medianPos] = in;
+	state->medianPos = (state->medianPos + 1) % config.median_len;
+	if (state->medianFill < config.median_len) {
+		state->medianFill++;
+	}
+
+	// Insertion sort, at most 7 values
+	count = state->medianFill;
+	for (i = 0; i < count; i++) {
+		tmp = state->median[i];
+		for (j = i; (j > 0) && (sorted[j - 1] > tmp); j--) {
+			sorted[j] = sorted[j - 1];
+		}
+		sorted[j] = tmp;
+	}
+	return sorted[count / 2];
+}
+
+/* ------------------------------- AverageStage ------------------------------
+ @ Summary
+    Running mean of the last average_len inputs, one add and one subtract
+  ---------------------------------------------------------------------------- */
+static int32_t AverageStage(AXIS_STATE *state, int32_t in) {
+	if (state->averageFill < config.average_len) {
+		state->averageFill++;
+	}
+	else {
+		state->averageSum -= state->average[state->averagePos];
+	}
+	state->average[state->averagePos] = in;
+	state->averageSum += in;
+	state->averagePos = (state->averagePos + 1) % config.average_len;
+
+	return state->averageSum / state->averageFill;
+}
+
+/* --------------------------------- IIRStage --------------------------------
+ @ Summary
+    First order low pass, y += (x - y) / 2^iir_shift
+  ---------------------------------------------------------------------------- */
+static int32_t IIRStage(AXIS_STATE *state, int32_t in) {
+	if (!state->iirPrimed) {
+		state->iir = in << IIR_FRAC;
+		state->iirPrimed = TRUE;
+	}
+	else {
+		state->iir += ((in << IIR_FRAC) - state->iir) >> config.iir_shift;
+	}
+	return state->iir >> IIR_FRAC;
+}
@@ -0,0 +1,35 @@
+#ifndef __MAGFILTER_H__
+	#define __MAGFILTER_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define MAGFILTER_MAX_STAGES	4
+	#define MAGFILTER_MAX_MEDIAN	7		// Median window, odd
+	#define MAGFILTER_MAX_AVERAGE	16		// Moving average window
+	#define MAGFILTER_RATE_SPAN_US	200000	// Heading rate baseline
+	#define MAGFILTER_RATE_DEPTH	32		// Samples kept for it, covers 200 ms at 80 Hz
+
+	// Filter stages, run in the order given in MAGFILTER_CONFIG.chain
+	#define MAGFILTER_END			0
+	#define MAGFILTER_MEDIAN		1		// Median of the last median_len
+	#define MAGFILTER_AVERAGE		2		// Mean of the last average_len
+	#define MAGFILTER_IIR			3		// y += (x - y) / 2^iir_shift
+
+	typedef struct {
+		BYTE chain[MAGFILTER_MAX_STAGES];	// Stages, MAGFILTER_END stops early
+		BYTE median_len;
+		BYTE average_len;
+		BYTE iir_shift;
+	} MAGFILTER_CONFIG;
+
+	// Default: knock out single spikes, then smooth
+	#define MAGFILTER_DEFAULT_CONFIG	{ {MAGFILTER_MEDIAN, MAGFILTER_AVERAGE, MAGFILTER_END, MAGFILTER_END}, 3, 4, 0 }
+
+	// Function Prototypes
+	void MagFilter_configure(const MAGFILTER_CONFIG *config);
+	void MagFilter_add(int32_t hx, int32_t hy, uint32_t stamp);
+	BOOL MagFilter_heading(int32_t *heading);
+	BOOL MagFilter_rate(int32_t *rate);
+#endif
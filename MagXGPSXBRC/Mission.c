@@ -0,0 +1,472 @@
+// File Inclusion
+#include "Mission.h"
+#include "Navigate.h"
+#include "Geofence.h"
+#include "Mode.h"
+#include <plib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+   Mission store and upload
+
+   A mission is an array of NAV_WAYPOINTs kept in one of two reserved flash
+   pages; the geofence polygon (GEO_VERTEXs) has two pages of its own and
+   goes through exactly the same upload with F in place of M. The
+   navigator is handed a pointer straight into flash, through the
+   uncached KSEG1 view so it never sees stale prefetch cache lines after a
+   write. An upload always goes to the page that is not holding the stored
+   mission, and its MISSION_INDEX is only written once the whole image has
+   been checked, magic last, so a reset part way leaves the old mission.
+   A stored fence is handed to Geofence_load, which keeps its own tables.
+
+   The XBee link hands over NUL terminated text lines, so the upload is text
+   with hex data. Every reply that is not final is "MR <offset>", the next
+   byte wanted, so the uploader just carries on from there after a lost
+   line, a bad chunk or a dropped link:
+
+     MB <count> <crc>            Begin, crc is CRC-32 of the whole image.
+                                 The same count and crc again resumes.
+     MC <offset> <hex> <crc>     Chunk, at most MISSION_CHUNK_MAX bytes,
+                                 offset and length multiples of 4
+     ME                          End, checks the image and stores the index
+     MS                          Status
+     MG / MX                     Start / stop navigating the stored mission,
+                                 through the mode manager (Mode.c)
+
+   Final replies: "MD <count> <sequence>" stored, "MF <reason>" failed.
+   Fence replies start with F the same way, and a polygon Geofence_load
+   cannot use ends in "FF fence" with the old fence still in force.
+
+   Built with MISSION_FLASH_RAM the pages are a RAM array that behaves like
+   erased flash (writes can only clear bits), for bench and host runs that
+   should not wear the real flash.
+   -------------------------------------------------------------------------- */
+#define BANK_WORDS		(MISSION_PAGE_SIZE / 4)
+#define INDEX_WORDS		(sizeof(MISSION_INDEX) / 4)
+#define STORE_COUNT		2
+
+#ifdef MISSION_FLASH_RAM
+	static uint32_t flashBanks[2 * STORE_COUNT][BANK_WORDS];
+	#define FLASH_VIEW(p)	((const void *) (p))
+#else
+	static const uint32_t flashBanks[2 * STORE_COUNT][BANK_WORDS] __attribute__((aligned(MISSION_PAGE_SIZE))) = {{0}};
+	#define FLASH_VIEW(p)	((const void *) KVA0_TO_KVA1((unsigned int) (p)))
+#endif
+
+/* ------------------------------- Stores ---------------------------------- */
+typedef struct {
+	char letter;					// Command and reply prefix
+	int firstBank;					// Uses firstBank and firstBank + 1
+	unsigned int itemSize;
+	unsigned int maxItems;
+	int storedBank;					// Bank holding the stored copy, -1 for none
+	const MISSION_INDEX *storedIndex;
+	BOOL uploading;
+	int uploadBank;
+	uint32_t uploadCount;
+	uint32_t uploadCrc;
+	uint32_t uploadOffset;			// Next byte wanted
+} MISSION_STORE;
+
+static MISSION_STORE stores[STORE_COUNT] = {
+	{ 'M', 0, sizeof(NAV_WAYPOINT), MISSION_MAX_WAYPOINTS, -1, NULL, FALSE },
+	{ 'F', 2, sizeof(GEO_VERTEX), MISSION_MAX_VERTICES, -1, NULL, FALSE }
+};
+#define MISSION		(&stores[0])
+#define FENCE		(&stores[1])
+
+static int routeBank = -1;			// Bank last handed to the navigator
+
+///* --- Function Prototyping --- */
+static const MISSION_INDEX *BankIndex(const MISSION_STORE *store, int bank);
+static BOOL FlashErase(int bank);
+static BOOL FlashWrite(int bank, unsigned int word, uint32_t value);
+static void Begin(MISSION_STORE *store, uint32_t count, uint32_t crc, char *reply);
+static void Chunk(MISSION_STORE *store, const char *args, char *reply);
+static void End(MISSION_STORE *store, char *reply);
+static void LoadFence(void);
+static int HexNibble(char c);
+
+/* ------------------------------- Mission_init ------------------------------
+ @ Summary
+    Finds the stored mission and fence, and loads the fence
+ @ Notes
+    A bank counts only if its magic, count and CRC all check out. Of two
+    good banks the newer sequence wins.
+  ---------------------------------------------------------------------------- */
+void Mission_init(void) {
+	MISSION_STORE *store;
+	const MISSION_INDEX *index;
+	int bank;
+
+	for (store = stores; store < &stores[STORE_COUNT]; store++) {
+		store->storedBank = -1;
+		store->storedIndex = NULL;
+		store->uploading = FALSE;
+		for (bank = store->firstBank; bank < store->firstBank + 2; bank++) {
+			index = BankIndex(store, bank);
+			if ((index != NULL) && ((store->storedIndex == NULL)
+					|| ((int32_t) (index->sequence - store->storedIndex->sequence) > 0))) {
+				store->storedBank = bank;
+				store->storedIndex = index;
+			}
+		}
+	}
+	LoadFence();
+}
+
+/* ------------------------------ Mission_route ------------------------------
+ @ Summary
+    The stored waypoints, read in place from flash
+ @ Parameters
+    @ param1 : number of waypoints
+ @ Return Value
+    const NAV_WAYPOINT* : first waypoint, NULL with nothing stored
+ @ Notes
+    The pointer stays valid until an upload begins over that bank, which
+    raises MODE_EV_STOP first.
+  ---------------------------------------------------------------------------- */
+const NAV_WAYPOINT *Mission_route(int *count) {
+	if (MISSION->storedIndex == NULL) {
+		*count = 0;
+		return NULL;
+	}
+	routeBank = MISSION->storedBank;
+	*count = (int) MISSION->storedIndex->count;
+	return (const NAV_WAYPOINT *) FLASH_VIEW(&flashBanks[routeBank][INDEX_WORDS]);
+}
+
+/* ----------------------------- Mission_command -----------------------------
+ @ Summary
+    Handles one mission or fence line from the link
+ @ Parameters
+    @ param1 : NUL terminated line
+    @ param2 : reply, at least MISSION_REPLY_MAX chars, set when TRUE
+ @ Return Value
+    BOOL : FALSE if the line is not a mission command
+  ---------------------------------------------------------------------------- */
+BOOL Mission_command(const char *line, char *reply) {
+	char *end;
+	uint32_t count;
+	uint32_t crc;
+	const NAV_WAYPOINT *route;
+	int routeCount;
+	MISSION_STORE *store;
+
+	for (store = stores; store < &stores[STORE_COUNT]; store++) {
+		if (line[0] == store->letter) {
+			break;
+		}
+	}
+	if ((store == &stores[STORE_COUNT]) || (line[1] == 0) || ((line[2] != ' ') && (line[2] != 0))) {
+		return FALSE;
+	}
+
+	switch (line[1]) {
+		case 'B':
+			count = strtoul(&line[2], &end, 10);
+			crc = strtoul(end, NULL, 16);
+			Begin(store, count, crc, reply);
+			break;
+		case 'C':
+			Chunk(store, &line[2], reply);
+			break;
+		case 'E':
+			End(store, reply);
+			break;
+		case 'S':
+			sprintf(reply, "%cS %d %u %d", store->letter,
+					(store->storedIndex != NULL) ? (int) store->storedIndex->count : 0,
+					(store->storedIndex != NULL) ? (unsigned) store->storedIndex->sequence : 0u,
+					store->uploading ? (int) store->uploadOffset : -1);
+			break;
+		case 'G':
+			if (store != MISSION) {
+				return FALSE;
+			}
+			route = Mission_route(&routeCount);
+			if (route == NULL) {
+				strcpy(reply, "MF empty");
+				break;
+			}
+			if (Mode_current() == MODE_AUTONOMOUS) {
+				Navigate_start(route, routeCount);		// From the first waypoint again
+			}
+			else if (Mode_event(MODE_EV_GO) != MODE_AUTONOMOUS) {
+				strcpy(reply, "MF refused");			// No position yet, or failsafe
+				break;
+			}
+			sprintf(reply, "MG %d", routeCount);
+			break;
+		case 'X':
+			if (store != MISSION) {
+				return FALSE;
+			}
+			Mode_event(MODE_EV_STOP);
+			strcpy(reply, "MX");
+			break;
+		default:
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* ------------------------------ Mission_crc32 ------------------------------
+ @ Summary
+    CRC-32 (zlib) of a block, chained through crc
+ @ Parameters
+    @ param1 : 0 to start, or the CRC of the data before
+    @ param2 : data
+    @ param3 : length, bytes
+ @ Return Value
+    uint32_t : CRC-32
+  ---------------------------------------------------------------------------- */
+uint32_t Mission_crc32(uint32_t crc, const void *data, unsigned int length) {
+	const uint8_t *bytes = (const uint8_t *) data;
+	int bit;
+
+	crc = ~crc;
+	while (length--) {
+		crc ^= *bytes++;
+		for (bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+		}
+	}
+	return ~crc;
+}
+
+/* -------------------------------- BankIndex --------------------------------
+ @ Summary
+    The index of a bank, NULL unless it holds a good mission
+  ---------------------------------------------------------------------------- */
+static const MISSION_INDEX *BankIndex(const MISSION_STORE *store, int bank) {
+	const MISSION_INDEX *index = (const MISSION_INDEX *) FLASH_VIEW(flashBanks[bank]);
+
+	if ((index->magic != MISSION_MAGIC) || (index->count == 0) || (index->count > store->maxItems)) {
+		return NULL;
+	}
+	if (Mission_crc32(0, FLASH_VIEW(&flashBanks[bank][INDEX_WORDS]), index->count * store->itemSize)
+			!= index->crc) {
+		return NULL;
+	}
+	return index;
+}
+
+/* -------------------------------- FlashErase -------------------------------
+ @ Summary
+    Erases a bank
+ @ Notes
+    A page erase stalls the CPU (and so every interrupt) for ~20 ms.
+  ---------------------------------------------------------------------------- */
+static BOOL FlashErase(int bank) {
+	unsigned int word;
+	const uint32_t *view = (const uint32_t *) FLASH_VIEW(flashBanks[bank]);
+
+#ifdef MISSION_FLASH_RAM
+	memset(flashBanks[bank], 0xFF, sizeof(flashBanks[bank]));
+#else
+	if (NVMErasePage((void *) flashBanks[bank]) != 0) {
+		return FALSE;
+	}
+#endif
+	for (word = 0; word < BANK_WORDS; word++) {
+		if (view[word] != 0xFFFFFFFF) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* -------------------------------- FlashWrite -------------------------------
+ @ Summary
+    Programs one word of a bank and reads it back
+  ---------------------------------------------------------------------------- */
+static BOOL FlashWrite(int bank, unsigned int word, uint32_t value) {
+#ifdef MISSION_FLASH_RAM
+	flashBanks[bank][word] &= value;
+#else
+	if (NVMWriteWord((void *) &flashBanks[bank][word], value) != 0) {
+		return FALSE;
+	}
+#endif
+	return ((const uint32_t *) FLASH_VIEW(flashBanks[bank]))[word] == value;
+}
+
+/* ---------------------------------- Begin ----------------------------------
+ @ Summary
+    MB / FB: starts or resumes an upload
+  ---------------------------------------------------------------------------- */
+static void Begin(MISSION_STORE *store, uint32_t count, uint32_t crc, char *reply) {
+	if ((count == 0) || (count > store->maxItems)) {
+		sprintf(reply, "%cF count", store->letter);
+		return;
+	}
+
+	// Already stored, or the upload that was cut off
+	if ((store->storedIndex != NULL) && (store->storedIndex->count == count) && (store->storedIndex->crc == crc)) {
+		store->uploading = FALSE;
+		sprintf(reply, "%cD %u %u", store->letter, (unsigned) count, (unsigned) store->storedIndex->sequence);
+		return;
+	}
+	if (store->uploading && (store->uploadCount == count) && (store->uploadCrc == crc)) {
+		sprintf(reply, "%cR %u", store->letter, (unsigned) store->uploadOffset);
+		return;
+	}
+
+	store->uploadBank = (store->storedBank == store->firstBank) ? store->firstBank + 1 : store->firstBank;
+	if (routeBank == store->uploadBank) {
+		// Still following an older mission out of this page. Stopping
+		// goes through the mode manager, so autonomous is left for a
+		// heading hold rather than carrying on with no route.
+		Mode_event(MODE_EV_STOP);
+		routeBank = -1;
+	}
+	if (!FlashErase(store->uploadBank)) {
+		store->uploading = FALSE;
+		sprintf(reply, "%cF erase", store->letter);
+		return;
+	}
+	store->uploading = TRUE;
+	store->uploadCount = count;
+	store->uploadCrc = crc;
+	store->uploadOffset = 0;
+	sprintf(reply, "%cR 0", store->letter);
+}
+
+/* ---------------------------------- Chunk ----------------------------------
+ @ Summary
+    MC / FC: programs the next piece of the image
+ @ Notes
+    Anything but the next wanted piece with a good CRC is dropped and the
+    reply asks for the wanted offset again.
+  ---------------------------------------------------------------------------- */
+static void Chunk(MISSION_STORE *store, const char *args, char *reply) {
+	union {
+		uint8_t bytes[MISSION_CHUNK_MAX];
+		uint32_t words[MISSION_CHUNK_MAX / 4];
+	} data;
+	char *end;
+	uint32_t offset;
+	uint32_t crc;
+	unsigned int length = 0;
+	unsigned int word;
+	int high, low;
+
+	if (!store->uploading) {
+		sprintf(reply, "%cF idle", store->letter);
+		return;
+	}
+
+	offset = strtoul(args, &end, 10);
+	while (*end == ' ') {
+		end++;
+	}
+	while (((high = HexNibble(end[0])) >= 0) && ((low = HexNibble(end[1])) >= 0)) {
+		if (length >= MISSION_CHUNK_MAX) {
+			length = 0;				// Too long, treat as bad
+			break;
+		}
+		data.bytes[length++] = (uint8_t) ((high << 4) | low);
+		end += 2;
+	}
+	crc = strtoul(end, NULL, 16);
+
+	if ((offset == store->uploadOffset) && (length != 0) && ((length & 3) == 0)
+			&& (offset + length <= store->uploadCount * store->itemSize)
+			&& (Mission_crc32(0, data.bytes, length) == crc)) {
+		for (word = 0; word < length / 4; word++) {
+			if (!FlashWrite(store->uploadBank, INDEX_WORDS + offset / 4 + word, data.words[word])) {
+				store->uploading = FALSE;
+				sprintf(reply, "%cF write", store->letter);
+				return;
+			}
+		}
+		store->uploadOffset += length;
+	}
+	sprintf(reply, "%cR %u", store->letter, (unsigned) store->uploadOffset);
+}
+
+/* ----------------------------------- End -----------------------------------
+ @ Summary
+    ME / FE: checks the image in flash and stores its index
+ @ Notes
+    A new fence takes effect straight away. It is loaded before its index
+    is written, so one the geofence refuses is never stored.
+  ---------------------------------------------------------------------------- */
+static void End(MISSION_STORE *store, char *reply) {
+	uint32_t sequence;
+	uint32_t bytes;
+	int bank = store->uploadBank;
+
+	if (!store->uploading) {
+		sprintf(reply, "%cF idle", store->letter);
+		return;
+	}
+	bytes = store->uploadCount * store->itemSize;
+	if (store->uploadOffset != bytes) {
+		sprintf(reply, "%cR %u", store->letter, (unsigned) store->uploadOffset);
+		return;
+	}
+
+	store->uploading = FALSE;
+	if (Mission_crc32(0, FLASH_VIEW(&flashBanks[bank][INDEX_WORDS]), bytes) != store->uploadCrc) {
+		sprintf(reply, "%cF crc", store->letter);
+		return;
+	}
+	if ((store == FENCE) && !Geofence_load((const GEO_VERTEX *) FLASH_VIEW(&flashBanks[bank][INDEX_WORDS]),
+										   (int) store->uploadCount)) {
+		LoadFence();						// Back to the stored one
+		sprintf(reply, "FF fence");
+		return;
+	}
+
+	sequence = (store->storedIndex != NULL) ? store->storedIndex->sequence + 1 : 1;
+	if (!FlashWrite(bank, offsetof(MISSION_INDEX, sequence) / 4, sequence)
+			|| !FlashWrite(bank, offsetof(MISSION_INDEX, count) / 4, store->uploadCount)
+			|| !FlashWrite(bank, offsetof(MISSION_INDEX, crc) / 4, store->uploadCrc)
+			|| !FlashWrite(bank, offsetof(MISSION_INDEX, magic) / 4, MISSION_MAGIC)) {
+		if (store == FENCE) {
+			LoadFence();
+		}
+		sprintf(reply, "%cF write", store->letter);
+		return;
+	}
+
+	store->storedBank = bank;
+	store->storedIndex = (const MISSION_INDEX *) FLASH_VIEW(flashBanks[bank]);
+	sprintf(reply, "%cD %u %u", store->letter, (unsigned) store->uploadCount, (unsigned) sequence);
+}
+
+/* -------------------------------- LoadFence --------------------------------
+ @ Summary
+    Hands the stored fence, if any, to the geofence
+  ---------------------------------------------------------------------------- */
+static void LoadFence(void) {
+	if (FENCE->storedIndex == NULL) {
+		Geofence_load(NULL, 0);
+		return;
+	}
+	Geofence_load((const GEO_VERTEX *) FLASH_VIEW(&flashBanks[FENCE->storedBank][INDEX_WORDS]),
+				  (int) FENCE->storedIndex->count);
+}
+
+/* -------------------------------- HexNibble --------------------------------
+ @ Summary
+    Value of a hex digit, -1 if it is not one
+  ---------------------------------------------------------------------------- */
+static int HexNibble(char c) {
+	if ((c >= '0') && (c <= '9')) {
+		return c - '0';
+	}
+	if ((c >= 'A') && (c <= 'F')) {
+		return c - 'A' + 10;
+	}
+	if ((c >= 'a') && (c <= 'f')) {
+		return c - 'a' + 10;
+	}
+	return -1;
+}
@@ -0,0 +1,33 @@
+#ifndef __MISSION_H__
+	#define __MISSION_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+	#include "Navigate.h"
+	#include "Geofence.h"
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define MISSION_PAGE_SIZE		4096		// PIC32MX3xx flash erase page, bytes
+	#define MISSION_MAGIC			0x4D495331	// "MIS1", written last
+	#define MISSION_MAX_WAYPOINTS	((MISSION_PAGE_SIZE - sizeof(MISSION_INDEX)) / sizeof(NAV_WAYPOINT))
+	#define MISSION_MAX_VERTICES	GEO_MAX_VERTICES
+	#define MISSION_CHUNK_MAX		48			// Bytes per MC line, 4 waypoints
+	#define MISSION_REPLY_MAX		48
+
+	/* ------------------------------ Flash index ----------------------------
+	   Each bank is one flash page: this index, then the waypoints (or fence
+	   vertices). Of a store's two banks, the one holding a valid index with
+	   the higher sequence is the stored copy. */
+	typedef struct {
+		uint32_t magic;
+		uint32_t sequence;		// Bumped on every store
+		uint32_t count;			// Waypoints
+		uint32_t crc;			// CRC-32 of the waypoint bytes
+	} MISSION_INDEX;
+
+	// Function Prototypes
+	void Mission_init(void);
+	const NAV_WAYPOINT *Mission_route(int *count);
+	BOOL Mission_command(const char *line, char *reply);
+	uint32_t Mission_crc32(uint32_t crc, const void *data, unsigned int length);
+#endif
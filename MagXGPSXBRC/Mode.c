@@ -0,0 +1,313 @@
+// File Inclusion
+#include "Mode.h"
+#include "Link.h"
+#include "Mission.h"
+#include "Navigate.h"
+#include "HeadingHold.h"
+#include "Cruise.h"
+#include "FixedMath.h"
+#include "RC.h"
+#include "hardware.h"
+#include <plib.h>
+#include <stdio.h>
+
+/* --------------------------------------------------------------------------
+   Operating modes
+
+   The mode only changes through Mode_event, by a fixed table of mode and
+   event. Two guards sit on top of it: autonomous needs a stored route and
+   a position, and a transition to the mode already in force does nothing.
+   A route that ends while the link is lost goes to failsafe instead of
+   manual: the loss was raised once, while autonomous ignored it, and
+   nothing would raise it again.
+   Crossing out of the geofence sends the gamepad modes to failsafe;
+   autonomous stays, as the fence already holds its speed at 0. The
+   event comes once per crossing, so Back hands the boat to manual to be
+   driven in again.
+   Entering a mode hands the rudder and throttle to whatever owns them in
+   it, so nothing from the mode before is left driving them.
+
+   Each mode also has a task table, the multiple of a job's own period it
+   runs at, 0 for not at all. Manual polls the GPS an eighth as often (32
+   byte chunks every 40 ms still outrun a 5 Hz RMC stream) and runs no
+   steering or cruise control.
+   -------------------------------------------------------------------------- */
+static const MODE transitions[MODE_COUNT][MODE_EV_COUNT] = {
+	//                 START             BACK         GO               STOP            DONE           FAULT          LINK_LOST        FENCE
+	/* MANUAL */     { MODE_ASSISTED,   MODE_MANUAL, MODE_AUTONOMOUS, MODE_MANUAL,    MODE_MANUAL,   MODE_MANUAL,   MODE_FAILSAFE,   MODE_FAILSAFE },
+	/* ASSISTED */   { MODE_AUTONOMOUS, MODE_MANUAL, MODE_AUTONOMOUS, MODE_ASSISTED,  MODE_ASSISTED, MODE_FAILSAFE, MODE_FAILSAFE,   MODE_FAILSAFE },
+	/* AUTONOMOUS */ { MODE_AUTONOMOUS, MODE_MANUAL, MODE_AUTONOMOUS, MODE_ASSISTED,  MODE_MANUAL,   MODE_FAILSAFE, MODE_AUTONOMOUS, MODE_AUTONOMOUS },
+	/* FAILSAFE */   { MODE_FAILSAFE,   MODE_MANUAL, MODE_FAILSAFE,   MODE_FAILSAFE,  MODE_FAILSAFE, MODE_FAILSAFE, MODE_FAILSAFE,   MODE_FAILSAFE }
+};
+
+static const unsigned char taskScale[MODE_COUNT][MODE_TASK_COUNT] = {
+	//                 GAMEPAD GPS FUSION STEER CRUISE DISPLAY TEMP RAMP
+	/* MANUAL */     { 1,      8,  1,     0,    0,     1,      1,   0 },
+	/* ASSISTED */   { 1,      1,  1,     1,    1,     1,      1,   0 },
+	/* AUTONOMOUS */ { 0,      1,  1,     1,    1,     1,      1,   0 },
+	/* FAILSAFE */   { 0,      1,  1,     0,    0,     1,      1,   1 }
+};
+
+static const char *const modeNames[MODE_COUNT] = { "MANUAL", "ASSISTED", "AUTONOMOUS", "FAILSAFE" };
+
+static MODE mode = MODE_MANUAL;
+static BOOL havePosition = FALSE;
+static BOOL holdPending = FALSE;	// Assisted takes the heading at its first steer
+static int32_t hold = 0;			// Assisted hold heading, centidegrees
+static int trim = 0;				// Right trigger less left
+static int32_t trimRemainder = 0;
+
+///* --- Function Prototyping --- */
+static BOOL Enter(MODE next);
+static int Toward(int value, int target, int step);
+
+/* -------------------------------- Mode_init --------------------------------
+ @ Summary
+    Starts in manual with nothing steering
+  ---------------------------------------------------------------------------- */
+void Mode_init(void) {
+	mode = MODE_MANUAL;
+	havePosition = FALSE;
+	trim = 0;
+	Enter(MODE_MANUAL);
+}
+
+/* ------------------------------- Mode_current ------------------------------
+ @ Summary
+    The mode in force
+  ---------------------------------------------------------------------------- */
+MODE Mode_current(void) {
+	return mode;
+}
+
+/* -------------------------------- Mode_name --------------------------------
+ @ Summary
+    Name of a mode for print outs and replies
+  ---------------------------------------------------------------------------- */
+const char *Mode_name(MODE which) {
+	return (which < MODE_COUNT) ? modeNames[which] : "?";
+}
+
+/* -------------------------------- Mode_event -------------------------------
+ @ Summary
+    Applies one event to the mode
+ @ Parameters
+    @ param1 : event
+ @ Return Value
+    MODE : the mode after it
+ @ Notes
+    A transition that a guard refuses leaves the mode as it was.
+  ---------------------------------------------------------------------------- */
+MODE Mode_event(MODE_EVENT event) {
+	MODE next;
+
+	if (event >= MODE_EV_COUNT) {
+		return mode;
+	}
+
+	next = transitions[mode][event];
+	if ((event == MODE_EV_DONE) && (next != mode) && Link_lost()) {
+		next = MODE_FAILSAFE;
+	}
+	if ((next != mode) && Enter(next)) {
+		printf("Mode %s\n\r", modeNames[next]);
+		mode = next;
+	}
+	return mode;
+}
+
+/* ------------------------------- Mode_update -------------------------------
+ @ Summary
+    Raises the events that come from navigation, call every fusion period
+ @ Parameters
+    @ param1 : TRUE while dead reckoning has a position
+    @ param2 : navigation output from the same period
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+void Mode_update(BOOL positionValid, const NAV_OUTPUT *nav) {
+	havePosition = positionValid;
+
+	if (mode != MODE_AUTONOMOUS) {
+		return;
+	}
+	if (!positionValid) {
+		Mode_event(MODE_EV_FAULT);
+	}
+	else if (nav->done) {
+		Mode_event(MODE_EV_DONE);
+	}
+}
+
+/* -------------------------------- Mode_steer -------------------------------
+ @ Summary
+    Sets the heading hold setpoint for the mode, call before each
+    HeadingHold_update
+ @ Parameters
+    @ param1 : fused heading, centidegrees
+    @ param2 : navigation output
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+void Mode_steer(int32_t heading, const NAV_OUTPUT *nav) {
+	int32_t step;
+
+	switch (mode) {
+		case MODE_ASSISTED:
+			if (holdPending) {
+				hold = heading;
+				trimRemainder = 0;
+				holdPending = FALSE;
+			}
+			// Trigger travel turns the hold heading, the remainder keeps
+			// light pressure from being lost to truncation
+			trimRemainder += trim * MODE_TRIM_RATE * (int32_t) HeadingHold_rate();
+			step = trimRemainder / (MODE_TRIM_FULL * 1000);
+			trimRemainder -= step * (MODE_TRIM_FULL * 1000);
+			hold = FixedWrap360(hold + step);
+			HeadingHold_engage(hold);
+			break;
+		case MODE_AUTONOMOUS:
+			if (nav->index >= 0) {
+				HeadingHold_engage(nav->heading);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/* -------------------------------- Mode_hold --------------------------------
+ @ Summary
+    Sets the heading assisted holds, in place of the one it took on entry
+ @ Parameters
+    @ param1 : heading, centidegrees
+  ---------------------------------------------------------------------------- */
+void Mode_hold(int32_t heading) {
+	if (mode != MODE_ASSISTED) {
+		return;
+	}
+	hold = FixedWrap360(heading);
+	trimRemainder = 0;
+	holdPending = FALSE;
+	HeadingHold_engage(hold);
+}
+
+/* -------------------------------- Mode_trim --------------------------------
+ @ Summary
+    Takes the gamepad triggers, 0 to MODE_TRIM_FULL each
+  ---------------------------------------------------------------------------- */
+void Mode_trim(int left, int right) {
+	trim = right - left;
+	if (trim > MODE_TRIM_FULL) {
+		trim = MODE_TRIM_FULL;
+	}
+	else if (trim < -MODE_TRIM_FULL) {
+		trim = -MODE_TRIM_FULL;
+	}
+}
+
+/* -------------------------------- Mode_ramp --------------------------------
+ @ Summary
+    One failsafe step of the throttle towards neutral and the rudder
+    towards center, call every MODE_RAMP_MS
+ @ Notes
+    Goes out through set_rc like every other actuator write, so the
+    servo and speed controller limits still apply.
+  ---------------------------------------------------------------------------- */
+void Mode_ramp(void) {
+	if (mode != MODE_FAILSAFE) {
+		return;
+	}
+	RC2Pos = Toward(RC2Pos, MODE_THROTTLE_NEUTRAL, MODE_RAMP_THROTTLE);
+	RC1Pos = Toward(RC1Pos, HH_RUDDER_CENTER, MODE_RAMP_RUDDER);
+	set_rc(RC2Pos, RC2Pos, RC1Pos, RC1Pos);
+}
+
+/* --------------------------------- Mode_due --------------------------------
+ @ Summary
+    Whether a main loop job runs this pass in the current mode
+ @ Parameters
+    @ param1 : task
+    @ param2 : the job's own period, ms
+    @ param3 : the job's interval mark, advanced when it is due
+ @ Return Value
+    BOOL : TRUE to run the job now
+ @ Notes
+    A job that is off keeps its mark at the present, so it starts a full
+    period after its mode comes in rather than in a burst. One that falls
+    behind skips the missed periods.
+  ---------------------------------------------------------------------------- */
+BOOL Mode_due(MODE_TASK task, unsigned int period, unsigned int *mark) {
+	unsigned int scale = taskScale[mode][task];
+
+	if (scale == 0) {
+		*mark = millisec;
+		return FALSE;
+	}
+
+	period *= scale;
+	if ((millisec - *mark) < period) {
+		return FALSE;
+	}
+	*mark += period;
+	if ((millisec - *mark) >= period) {
+		*mark = millisec;
+	}
+	return TRUE;
+}
+
+/* ---------------------------------- Enter ----------------------------------
+ @ Summary
+    Runs the entry of a mode
+ @ Return Value
+    BOOL : FALSE if a guard refuses it
+  ---------------------------------------------------------------------------- */
+static BOOL Enter(MODE next) {
+	const NAV_WAYPOINT *route;
+	int routeCount;
+
+	switch (next) {
+		case MODE_MANUAL:
+			Navigate_stop();
+			HeadingHold_disengage();
+			Cruise_stop();
+			break;
+		case MODE_ASSISTED:
+			Navigate_stop();
+			Cruise_stop();
+			holdPending = TRUE;		// Heading hold keeps its trim from autonomous
+			break;
+		case MODE_AUTONOMOUS:
+			route = Mission_route(&routeCount);
+			if ((route == NULL) || !havePosition) {
+				return FALSE;
+			}
+			Navigate_start(route, routeCount);
+			break;
+		case MODE_FAILSAFE:
+			// Cruise control is left engaged but no longer runs, so
+			// Mode_ramp has the throttle. Leaving goes through manual,
+			// which stops it.
+			Navigate_stop();
+			HeadingHold_disengage();
+			break;
+		default:
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* ---------------------------------- Toward ---------------------------------
+ @ Summary
+    Moves value at most step towards target
+  ---------------------------------------------------------------------------- */
+static int Toward(int value, int target, int step) {
+	if (value > target + step) {
+		return value - step;
+	}
+	if (value < target - step) {
+		return value + step;
+	}
+	return target;
+}
@@ -0,0 +1,69 @@
+#ifndef __MODE_H__
+	#define __MODE_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+	#include "Navigate.h"
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define MODE_TRIM_RATE		3000	// Cdeg/s of hold heading change at full trigger
+	#define MODE_TRIM_FULL		100		// Trigger reading at full travel
+	#define MODE_RAMP_MS		20		// Failsafe ramp step period
+	#define MODE_RAMP_THROTTLE	2		// Percent per step, 100 %/s
+	#define MODE_RAMP_RUDDER	5		// Percent per step
+	#define MODE_THROTTLE_NEUTRAL	50	// RC2Pos with the speed controllers stopped
+
+	/* ------------------------------- Modes ---------------------------------
+	   MANUAL      Gamepad drives rudder and throttle directly
+	   ASSISTED    Heading hold steers, the triggers turn the held heading,
+	               the gamepad keeps the throttle
+	   AUTONOMOUS  Navigation steers and cruise control sets the speed
+	   FAILSAFE    Throttle ramped to neutral and rudder to center, only
+	               Back leaves it */
+	typedef enum {
+		MODE_MANUAL = 0,
+		MODE_ASSISTED,
+		MODE_AUTONOMOUS,
+		MODE_FAILSAFE,
+		MODE_COUNT
+	} MODE;
+
+	typedef enum {
+		MODE_EV_START = 0,		// Gamepad Start, one mode up
+		MODE_EV_BACK,			// Gamepad Back, to manual from anything
+		MODE_EV_GO,				// MG, run the stored route
+		MODE_EV_STOP,			// MX, stop the route and hold the heading
+		MODE_EV_DONE,			// Last waypoint reached
+		MODE_EV_FAULT,			// Lost what the mode depends on
+		MODE_EV_LINK_LOST,		// No frame from the gamepad link, see Link.c
+		MODE_EV_FENCE,			// Crossed out of the geofence
+		MODE_EV_COUNT
+	} MODE_EVENT;
+
+	/* ------------------------------- Tasks ---------------------------------
+	   Each main loop job asks Mode_due before it runs. The mode's task
+	   table scales the job's own period, or turns it off. */
+	typedef enum {
+		MODE_TASK_GAMEPAD = 0,	// Move(), stick to servos
+		MODE_TASK_GPS,			// GPS_service()
+		MODE_TASK_FUSION,		// Heading fusion, dead reckoning, navigation
+		MODE_TASK_STEER,		// Heading hold
+		MODE_TASK_CRUISE,		// Cruise control
+		MODE_TASK_DISPLAY,		// Heading print out and LCD
+		MODE_TASK_TEMP,			// ADC temperature
+		MODE_TASK_RAMP,			// Failsafe ramp
+		MODE_TASK_COUNT
+	} MODE_TASK;
+
+	// Function Prototypes
+	void Mode_init(void);
+	MODE Mode_current(void);
+	const char *Mode_name(MODE mode);
+	MODE Mode_event(MODE_EVENT event);
+	void Mode_update(BOOL positionValid, const NAV_OUTPUT *nav);
+	void Mode_steer(int32_t heading, const NAV_OUTPUT *nav);
+	void Mode_hold(int32_t heading);
+	void Mode_trim(int left, int right);
+	void Mode_ramp(void);
+	BOOL Mode_due(MODE_TASK task, unsigned int period, unsigned int *mark);
+#endif
@@ -0,0 +1,522 @@
+// File Inclusion
+#include "NMEA.h"
+#include <plib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+   Streaming NMEA 0183 parser
+
+   Bytes go in one at a time as they arrive. Only the current field is
+   buffered; each field is converted when its ',' or '*' arrives, into a
+   scratch copy of the fix. The scratch copy is merged into the caller's
+   fix only once the *hh checksum matches, so a corrupted or truncated
+   sentence never changes the output.
+
+   Any talker is accepted ($GP, $GN, $GL...), the sentence is picked by the
+   three letter code. $PMTK001 command acknowledgements are decoded too.
+   Unknown sentences are skipped up to the next '$'.
+   -------------------------------------------------------------------------- */
+typedef enum {
+	WAIT_START = 0,
+	BODY,
+	CKSUM_HI,
+	CKSUM_LO
+} PARSE_STATE;
+
+static PARSE_STATE state = WAIT_START;
+static NMEA_SENTENCE sentence;
+static BYTE field[NMEA_MAX_FIELD + 1];
+static int fieldLen;
+static int fieldIndex;
+static BYTE checksum;
+static BYTE received;
+static BOOL fieldError;
+static struct gps_time scratch;
+static unsigned int checksumErrors = 0;
+static unsigned int scratchCommand;		// $PMTK001 fields
+static unsigned int scratchFlag;
+static int ackCommand = -1;
+static int ackFlag = 0;
+
+///* --- Function Prototyping --- */
+static void EndField(void);
+static void Commit(struct gps_time *fix);
+static BOOL ParseFixed(int32_t *value, int places);
+static BOOL ParseBounded(int32_t *value, int32_t max);
+static BOOL ParseLetter(char *value, const char *allowed);
+static BOOL ParseCoordinate(int32_t *value);
+static BOOL ParseUnsigned(unsigned int *value);
+static BOOL ParseTime(unsigned int *hhmmss, unsigned int *ms);
+static int HexValue(BYTE c);
+
+/* -------------------------------- NMEA_reset -------------------------------
+ @ Summary
+    Drops any partial sentence
+  ---------------------------------------------------------------------------- */
+void NMEA_reset(void) {
+	state = WAIT_START;
+}
+
+/* -------------------------------- NMEA_parse -------------------------------
+ @ Summary
+    Feeds one received byte to the parser
+ @ Parameters
+    @ param1 : byte from the GPS
+    @ param2 : fix updated when a valid sentence completes
+ @ Return Value
+    NMEA_SENTENCE : type of sentence merged into fix, NMEA_NONE otherwise
+ @ Notes
+    RMC position, speed and course are only taken with status 'A', GGA
+    position only with a non zero quality. Time, status and quality are
+    always taken so the caller can tell the fix is lost.
+  ---------------------------------------------------------------------------- */
+NMEA_SENTENCE NMEA_parse(BYTE c, struct gps_time *fix) {
+	int nibble;
+
+	if (c == '$') {							// Always a fresh start, even mid sentence
+		state = BODY;
+		sentence = NMEA_NONE;
+		fieldLen = 0;
+		fieldIndex = 0;
+		checksum = 0;
+		fieldError = FALSE;
+		memset(&scratch, 0, sizeof(scratch));
+		scratchCommand = 0;
+		scratchFlag = 0;
+		return NMEA_NONE;
+	}
+
+	switch (state) {
+		case BODY:
+			if (c == '*') {
+				EndField();
+				state = (fieldIndex > 0) ? CKSUM_HI : WAIT_START;
+			}
+			else if ((c < ' ') || (c > '~')) {
+				state = WAIT_START;			// CR/LF or noise without a checksum
+			}
+			else {
+				checksum ^= c;
+				if (c == ',') {
+					EndField();
+					if (fieldIndex == 1 && sentence == NMEA_NONE) {
+						state = WAIT_START;	// Not a sentence we decode
+					}
+				}
+				else if (fieldLen < NMEA_MAX_FIELD) {
+					field[fieldLen++] = c;
+				}
+				else {
+					state = WAIT_START;
+				}
+			}
+			break;
+
+		case CKSUM_HI:
+			nibble = HexValue(c);
+			received = (BYTE) (nibble << 4);
+			state = (nibble < 0) ? WAIT_START : CKSUM_LO;
+			break;
+
+		case CKSUM_LO:
+			nibble = HexValue(c);
+			state = WAIT_START;
+			if (nibble < 0) {
+				break;
+			}
+			if ((received | nibble) != checksum) {
+				checksumErrors++;
+				break;
+			}
+			if (!fieldError && (sentence != NMEA_NONE)) {
+				Commit(fix);
+				return sentence;
+			}
+			break;
+
+		default:
+			break;
+	}
+	return NMEA_NONE;
+}
+
+/* --------------------------- NMEA_checksumErrors ---------------------------
+ @ Summary
+    Sentences dropped for a bad checksum since power up
+  ---------------------------------------------------------------------------- */
+unsigned int NMEA_checksumErrors(void) {
+	return checksumErrors;
+}
+
+/* ------------------------------- NMEA_lastAck ------------------------------
+ @ Summary
+    Latest $PMTK001 acknowledgement
+ @ Parameters
+    @ param1 : command number acknowledged, -1 before the first one
+    @ param2 : 0 invalid, 1 unsupported, 2 failed, 3 succeeded
+  ---------------------------------------------------------------------------- */
+void NMEA_lastAck(int *command, int *flag) {
+	*command = ackCommand;
+	*flag = ackFlag;
+}
+
+/* --------------------------------- EndField --------------------------------
+ @ Summary
+    Converts the buffered field according to sentence and position
+ @ Notes
+    Field 0 is the address, e.g. GNRMC. An empty field leaves the scratch
+    value at zero.
+  ---------------------------------------------------------------------------- */
+static void EndField(void) {
+	BOOL ok = TRUE;
+	unsigned int value;
+
+	field[fieldLen] = 0;
+
+	if (fieldIndex == 0) {
+		if ((fieldLen == 7) && (memcmp(field, "PMTK001", 7) == 0)) {
+			sentence = NMEA_PMTK_ACK;
+		}
+		else if (fieldLen == 5) {
+			if (memcmp(&field[2], "RMC", 3) == 0) {
+				sentence = NMEA_RMC;
+			}
+			else if (memcmp(&field[2], "GGA", 3) == 0) {
+				sentence = NMEA_GGA;
+			}
+			else if (memcmp(&field[2], "VTG", 3) == 0) {
+				sentence = NMEA_VTG;
+			}
+		}
+	}
+	else if (fieldLen > 0) {
+		switch (sentence) {
+			case NMEA_RMC:
+				switch (fieldIndex) {
+					case 1:
+						ok = ParseTime(&scratch.utc_time, &scratch.utc_ms);
+						break;
+					case 2:  ok = ParseLetter(&scratch.status, "AV");	break;
+					case 3:  ok = ParseCoordinate(&scratch.lat);		break;
+					case 4:  ok = ParseLetter(&scratch.ns, "NS");		break;
+					case 5:  ok = ParseCoordinate(&scratch.lon);		break;
+					case 6:  ok = ParseLetter(&scratch.ew, "EW");		break;
+					case 7:  ok = ParseBounded(&scratch.speed, INT32_MAX);	break;
+					case 8:  ok = ParseBounded(&scratch.angle, 36000);	break;
+					case 9:  ok = ParseUnsigned(&scratch.date);			break;
+					case 12: ok = ParseLetter(&scratch.mode, NULL);		break;
+					default: break;
+				}
+				break;
+
+			case NMEA_GGA:
+				switch (fieldIndex) {
+					case 1:
+						ok = ParseTime(&scratch.utc_time, &scratch.utc_ms);
+						break;
+					case 2:  ok = ParseCoordinate(&scratch.lat);	break;
+					case 3:  ok = ParseLetter(&scratch.ns, "NS");	break;
+					case 4:  ok = ParseCoordinate(&scratch.lon);	break;
+					case 5:  ok = ParseLetter(&scratch.ew, "EW");	break;
+					case 6:
+						ok = ParseUnsigned(&value);
+						if (ok) scratch.quality = (BYTE) value;
+						break;
+					case 7:
+						ok = ParseUnsigned(&value);
+						if (ok) scratch.satellites = (BYTE) value;
+						break;
+					case 8:  ok = ParseFixed(&scratch.hdop, 2);		break;
+					case 9:  ok = ParseFixed(&scratch.altitude, 2);	break;
+					default: break;
+				}
+				break;
+
+			case NMEA_PMTK_ACK:
+				switch (fieldIndex) {
+					case 1:  ok = ParseUnsigned(&scratchCommand);	break;
+					case 2:  ok = ParseUnsigned(&scratchFlag);		break;
+					default: break;
+				}
+				break;
+
+			case NMEA_VTG:
+				switch (fieldIndex) {
+					case 1:  ok = ParseBounded(&scratch.angle, 36000);		break;
+					case 5:  ok = ParseBounded(&scratch.speed, INT32_MAX);	break;
+					case 9:  ok = ParseLetter(&scratch.mode, NULL);		break;
+					default: break;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	if (!ok) {
+		fieldError = TRUE;
+	}
+	fieldIndex++;
+	fieldLen = 0;
+}
+
+/* ---------------------------------- Commit ---------------------------------
+ @ Summary
+    Merges the fields of the finished sentence into the fix
+  ---------------------------------------------------------------------------- */
+static void Commit(struct gps_time *fix) {
+	BOOL position = FALSE;
+
+	switch (sentence) {
+		case NMEA_RMC:
+			fix->utc_time = scratch.utc_time;
+			fix->utc_ms = scratch.utc_ms;
+			fix->status = scratch.status;
+			fix->date = scratch.date;
+			fix->mode = scratch.mode;
+			if (scratch.status == 'A') {
+				position = TRUE;
+				fix->speed = scratch.speed;
+				fix->angle = scratch.angle;
+			}
+			break;
+
+		case NMEA_GGA:
+			fix->utc_time = scratch.utc_time;
+			fix->utc_ms = scratch.utc_ms;
+			fix->quality = scratch.quality;
+			fix->satellites = scratch.satellites;
+			if (scratch.quality != 0) {
+				position = TRUE;
+				fix->hdop = scratch.hdop;
+				fix->altitude = scratch.altitude;
+			}
+			break;
+
+		case NMEA_PMTK_ACK:
+			ackCommand = (int) scratchCommand;
+			ackFlag = (int) scratchFlag;
+			return;
+
+		case NMEA_VTG:
+			if ((scratch.mode != 'N') && (scratch.mode != 0)) {
+				fix->speed = scratch.speed;
+				fix->angle = scratch.angle;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	if (position) {
+		fix->lat = (scratch.ns == 'S') ? -scratch.lat : scratch.lat;
+		fix->ns = scratch.ns;
+		fix->lon = (scratch.ew == 'W') ? -scratch.lon : scratch.lon;
+		fix->ew = scratch.ew;
+	}
+	fix->cksum = checksum;
+}
+
+/* -------------------------------- ParseFixed -------------------------------
+ @ Summary
+    Converts the field as [-]digits[.digits] scaled by 10^places
+ @ Parameters
+    @ param1 : result
+    @ param2 : decimal places kept, extra digits are truncated
+ @ Return Value
+    BOOL : FALSE if the field holds anything else or overflows
+  ---------------------------------------------------------------------------- */
+static BOOL ParseFixed(int32_t *value, int places) {
+	int32_t result = 0;
+	BOOL negative = FALSE;
+	BOOL point = FALSE;
+	BOOL digits = FALSE;
+	int i = 0;
+
+	if (field[0] == '-') {
+		negative = TRUE;
+		i++;
+	}
+	for (; i < fieldLen; i++) {
+		if ((field[i] >= '0') && (field[i] <= '9')) {
+			digits = TRUE;
+			if (point) {
+				if (places == 0) {
+					continue;
+				}
+				places--;
+			}
+			if (result >= 100000000) {
+				return FALSE;
+			}
+			result = result * 10 + (field[i] - '0');
+		}
+		else if ((field[i] == '.') && !point) {
+			point = TRUE;
+		}
+		else {
+			return FALSE;
+		}
+	}
+	if (!digits) {
+		return FALSE;
+	}
+	for (; places > 0; places--) {			// Pad short fractions
+		if (result >= 100000000) {
+			return FALSE;
+		}
+		result *= 10;
+	}
+	*value = negative ? -result : result;
+	return TRUE;
+}
+
+/* ------------------------------- ParseBounded ------------------------------
+ @ Summary
+    Converts the field to hundredths, 0 to max
+ @ Notes
+    Speed and course. Two flipped bits can leave the checksum intact, so a
+    course outside a full turn is a corrupt field rather than a value.
+  ---------------------------------------------------------------------------- */
+static BOOL ParseBounded(int32_t *value, int32_t max) {
+	int32_t result;
+
+	if (!ParseFixed(&result, 2) || (result < 0) || (result > max)) {
+		return FALSE;
+	}
+	*value = result;
+	return TRUE;
+}
+
+/* ------------------------------- ParseLetter -------------------------------
+ @ Summary
+    Takes a one character field
+ @ Parameters
+    @ param1 : result
+    @ param2 : characters allowed, NULL for any letter
+ @ Return Value
+    BOOL : FALSE for a longer field or a character not allowed
+  ---------------------------------------------------------------------------- */
+static BOOL ParseLetter(char *value, const char *allowed) {
+	if (fieldLen != 1) {
+		return FALSE;
+	}
+	if ((allowed == NULL) ? ((field[0] < 'A') || (field[0] > 'Z')) : (strchr(allowed, field[0]) == NULL)) {
+		return FALSE;
+	}
+	*value = (char) field[0];
+	return TRUE;
+}
+
+/* ----------------------------- ParseCoordinate -----------------------------
+ @ Summary
+    Converts a (d)ddmm.mmmm field to 1e-7 degree
+ @ Return Value
+    BOOL : FALSE if the field is malformed
+ @ Notes
+    Minutes are taken to 1e-7 minute from the digits, then divided by 60
+    with rounding, so the result is exact to the last unit. Sign is applied
+    from the hemisphere field in Commit.
+  ---------------------------------------------------------------------------- */
+static BOOL ParseCoordinate(int32_t *value) {
+	int32_t whole = 0;						// dddmm
+	int32_t fraction = 0;					// Minute fraction, 1e-7
+	int32_t scale = GPS_DEG_SCALE / 10;
+	int i;
+
+	for (i = 0; (i < fieldLen) && (field[i] != '.'); i++) {
+		if ((field[i] < '0') || (field[i] > '9') || (i >= 5)) {
+			return FALSE;
+		}
+		whole = whole * 10 + (field[i] - '0');
+	}
+	if ((i < 3) || ((whole % 100) >= 60) || ((whole / 100) > 180)) {
+		return FALSE;
+	}
+	for (i++; i < fieldLen; i++) {
+		if ((field[i] < '0') || (field[i] > '9')) {
+			return FALSE;
+		}
+		fraction += (field[i] - '0') * scale;
+		scale /= 10;
+	}
+
+	*value = (whole / 100) * GPS_DEG_SCALE
+			+ ((whole % 100) * GPS_DEG_SCALE + fraction + 30) / 60;
+	return TRUE;
+}
+
+/* ------------------------------ ParseUnsigned ------------------------------
+ @ Summary
+    Converts the integer part of the field, the fraction is ignored
+ @ Notes
+    Matches the old sscanf %d on hhmmss.sss time fields.
+  ---------------------------------------------------------------------------- */
+static BOOL ParseUnsigned(unsigned int *value) {
+	unsigned int result = 0;
+	int i;
+
+	if ((field[0] < '0') || (field[0] > '9')) {
+		return FALSE;
+	}
+	for (i = 0; i < fieldLen && field[i] != '.'; i++) {
+		if ((field[i] < '0') || (field[i] > '9') || (result >= 100000000)) {
+			return FALSE;
+		}
+		result = result * 10 + (field[i] - '0');
+	}
+	for (i++; i < fieldLen; i++) {
+		if ((field[i] < '0') || (field[i] > '9')) {
+			return FALSE;
+		}
+	}
+	*value = result;
+	return TRUE;
+}
+
+/* -------------------------------- ParseTime --------------------------------
+ @ Summary
+    Converts an hhmmss.sss field
+ @ Parameters
+    @ param1 : hhmmss
+    @ param2 : milliseconds, digits past the third are dropped
+ @ Return Value
+    BOOL : FALSE if the field is malformed
+  ---------------------------------------------------------------------------- */
+static BOOL ParseTime(unsigned int *hhmmss, unsigned int *ms) {
+	unsigned int scale = 100;
+	unsigned int fraction = 0;
+	int i;
+
+	if (!ParseUnsigned(hhmmss)) {
+		return FALSE;
+	}
+	for (i = 0; (i < fieldLen) && (field[i] != '.'); i++) {
+	}
+	for (i++; i < fieldLen; i++) {
+		fraction += (field[i] - '0') * scale;	// Digits already checked
+		scale /= 10;
+	}
+	*ms = fraction;
+	return TRUE;
+}
+
+/* --------------------------------- HexValue --------------------------------
+ @ Summary
+    Value of one checksum digit, -1 if not hex
+  ---------------------------------------------------------------------------- */
+static int HexValue(BYTE c) {
+	if ((c >= '0') && (c <= '9')) {
+		return c - '0';
+	}
+	if ((c >= 'A') && (c <= 'F')) {
+		return c - 'A' + 10;
+	}
+	if ((c >= 'a') && (c <= 'f')) {
+		return c - 'a' + 10;
+	}
+	return -1;
+}
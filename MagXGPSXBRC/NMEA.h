@@ -0,0 +1,23 @@
+#ifndef __NMEA_H__
+	#define __NMEA_H__
+
+	#include <plib.h>
+	#include "GPS_I2C.h"
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define NMEA_MAX_FIELD		15		// Longest field kept, longer aborts the sentence
+
+	typedef enum {
+		NMEA_NONE = 0,
+		NMEA_RMC,
+		NMEA_GGA,
+		NMEA_VTG,
+		NMEA_PMTK_ACK		// $PMTK001, see NMEA_lastAck
+	} NMEA_SENTENCE;
+
+	// Function Prototypes
+	void NMEA_reset(void);
+	NMEA_SENTENCE NMEA_parse(BYTE c, struct gps_time *fix);
+	unsigned int NMEA_checksumErrors(void);
+	void NMEA_lastAck(int *command, int *flag);
+#endif
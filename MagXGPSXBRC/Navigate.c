@@ -0,0 +1,311 @@
+// File Inclusion
+#include "Navigate.h"
+#include "FixedMath.h"
+#include "GPS_I2C.h"
+#include <plib.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* --------------------------------------------------------------------------
+   Waypoint follower
+
+   Bearing and distance to the active waypoint come from a flat earth
+   (equirectangular) projection: north is the latitude difference, east is
+   the longitude difference times cos of the mean latitude. sin and cos are
+   worked out once when a leg starts, at the waypoint, and each update moves
+   cos to the mean latitude with a first order correction, so an update is a
+   few multiplies, one square root and one CORDIC atan2.
+
+   Over NAV_LONG_LEG_CM the distance is replaced by the haversine, in 64 bit
+   fixed point with series sines of the half angle differences (good to a
+   0.02% for legs up to a few hundred km). The flat bearing is kept: it
+   follows the rhumb line rather than the great circle, which differs by
+   about half the longitude difference times sin of the latitude (5 degrees
+   on a 300 km leg at 75 degrees north), and it is re-aimed every update
+   anyway.
+
+   A waypoint is reached inside its acceptance radius, or once the boat has
+   gone past the line through the waypoint square to the leg, so a missed
+   waypoint does not leave the boat circling.
+   -------------------------------------------------------------------------- */
+static const NAV_WAYPOINT *route = NULL;
+static int routeCount = 0;
+static int active = -1;
+static int32_t legRef;				// Active waypoint latitude rounded to 0.01 degree
+static int32_t legSin;				// sin and cos of legRef, Q15
+static int32_t legCos;
+static int32_t legNorth;			// Leg direction, previous waypoint to active, cm
+static int32_t legEast;
+static BOOL legValid;
+static unsigned int cyclesLast = 0;
+static unsigned int cyclesMax = 0;
+
+///* --- Function Prototyping --- */
+static void StartLeg(int index, int32_t lat, int32_t lon);
+static int32_t MeanCos(int32_t lat1, int32_t lat2, int32_t ref, int32_t sine, int32_t cosine);
+static void Offset(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2, int32_t cosLat,
+				   int32_t *north, int32_t *east);
+static int32_t Haversine(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2);
+static int64_t HalfSine(int32_t units);
+
+/* ------------------------------ Navigate_start -----------------------------
+ @ Summary
+    Starts following a route from its first waypoint
+ @ Parameters
+    @ param1 : waypoints, read in place (may be in flash), must stay valid
+    @ param2 : number of waypoints
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+void Navigate_start(const NAV_WAYPOINT *waypoints, int count) {
+	route = waypoints;
+	routeCount = (waypoints != NULL) ? count : 0;
+	active = (routeCount > 0) ? 0 : -1;
+	legValid = FALSE;
+}
+
+/* ------------------------------- Navigate_stop -----------------------------
+ @ Summary
+    Drops the route
+  ---------------------------------------------------------------------------- */
+void Navigate_stop(void) {
+	route = NULL;
+	routeCount = 0;
+	active = -1;
+}
+
+/* ------------------------------ Navigate_update ----------------------------
+ @ Summary
+    Works out the setpoints for the current position
+ @ Parameters
+    @ param1 : latitude, 1e-7 degree
+    @ param2 : longitude, 1e-7 degree
+    @ param3 : setpoints
+ @ Return Value
+    BOOL : FALSE with no route, out then holds speed 0
+ @ Notes
+    Moves on to the next waypoint when the active one is reached. The core
+    timer ticks each call takes (2 CPU cycles per tick) are kept for
+    Navigate_cycles.
+  ---------------------------------------------------------------------------- */
+BOOL Navigate_update(int32_t lat, int32_t lon, NAV_OUTPUT *out) {
+	unsigned int tStart = ReadCoreTimer();
+	const NAV_WAYPOINT *wp;
+	int32_t north, east;
+	int32_t distance;
+	int64_t along;
+	uint64_t squares;
+	int shift;
+
+	out->index = active;
+	out->speed = 0;
+	out->distance = 0;
+	out->done = (routeCount > 0) && (active < 0);
+	if (active < 0) {
+		return FALSE;
+	}
+
+	for (;;) {
+		wp = &route[active];
+		if (!legValid) {
+			StartLeg(active, lat, lon);
+		}
+
+		Offset(lat, lon, wp->lat, wp->lon, MeanCos(lat, wp->lat, legRef, legSin, legCos), &north, &east);
+
+		// Flat distance, scaled into FixedAtan2's range first (legs over ~2600 km)
+		shift = 0;
+		while ((north > 0x0FFFFFFF) || (north < -0x0FFFFFFF)
+				|| (east > 0x0FFFFFFF) || (east < -0x0FFFFFFF)) {
+			north >>= 1;
+			east >>= 1;
+			shift++;
+		}
+		squares = (uint64_t) ((int64_t) north * north) + (uint64_t) ((int64_t) east * east);
+		distance = (int32_t) FixedSqrt64(squares) << shift;
+		if (distance > NAV_LONG_LEG_CM) {
+			distance = Haversine(lat, lon, wp->lat, wp->lon);
+		}
+
+		// Reached: inside the radius, or past the line square to the leg
+		along = (int64_t) north * legNorth + (int64_t) east * legEast;
+		if ((distance > (int32_t) wp->radius * 10) && (along >= 0)) {
+			break;
+		}
+		if (++active >= routeCount) {
+			active = -1;
+			out->index = -1;
+			out->done = TRUE;
+			cyclesLast = ReadCoreTimer() - tStart;
+			return TRUE;
+		}
+		legValid = FALSE;
+	}
+
+	out->index = active;
+	out->heading = FixedWrap360(FixedAtan2(east, north));
+	out->speed = wp->speed;
+	out->distance = distance;
+
+	cyclesLast = ReadCoreTimer() - tStart;
+	if (cyclesLast > cyclesMax) {
+		cyclesMax = cyclesLast;
+	}
+	return TRUE;
+}
+
+/* ------------------------------ Navigate_cycles ----------------------------
+ @ Summary
+    Core timer ticks taken by the last and the slowest Navigate_update
+  ---------------------------------------------------------------------------- */
+void Navigate_cycles(unsigned int *last, unsigned int *max) {
+	*last = cyclesLast;
+	*max = cyclesMax;
+}
+
+/* ----------------------------- Navigate_distance ---------------------------
+ @ Summary
+    Distance between two points, cm
+ @ Notes
+    Flat earth at the mean latitude, haversine past NAV_LONG_LEG_CM.
+  ---------------------------------------------------------------------------- */
+int32_t Navigate_distance(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2) {
+	int32_t sine, cosine;
+	int32_t north, east;
+	int32_t distance;
+	int32_t ref = lat2 / (GPS_DEG_SCALE / 100);
+
+	FixedSinCos(ref, &sine, &cosine);
+	Offset(lat1, lon1, lat2, lon2, MeanCos(lat1, lat2, ref * (GPS_DEG_SCALE / 100), sine, cosine),
+		   &north, &east);
+	distance = (int32_t) FixedSqrt64((uint64_t) ((int64_t) north * north) + (uint64_t) ((int64_t) east * east));
+	if (distance > NAV_LONG_LEG_CM) {
+		distance = Haversine(lat1, lon1, lat2, lon2);
+	}
+	return distance;
+}
+
+/* --------------------------------- StartLeg --------------------------------
+ @ Summary
+    Precomputes sin and cos of the waypoint latitude and the leg direction
+ @ Notes
+    The first leg runs from where the boat is when it starts.
+  ---------------------------------------------------------------------------- */
+static void StartLeg(int index, int32_t lat, int32_t lon) {
+	int32_t fromLat = lat;
+	int32_t fromLon = lon;
+
+	legRef = route[index].lat / (GPS_DEG_SCALE / 100);
+	FixedSinCos(legRef, &legSin, &legCos);
+	legRef *= GPS_DEG_SCALE / 100;
+	if (index > 0) {
+		fromLat = route[index - 1].lat;
+		fromLon = route[index - 1].lon;
+	}
+	Offset(fromLat, fromLon, route[index].lat, route[index].lon, legCos, &legNorth, &legEast);
+	// Keep the dot product with an offset inside 64 bits
+	while ((legNorth > 0xFFFF) || (legNorth < -0xFFFF) || (legEast > 0xFFFF) || (legEast < -0xFFFF)) {
+		legNorth >>= 1;
+		legEast >>= 1;
+	}
+	legValid = TRUE;
+}
+
+/* --------------------------------- MeanCos ---------------------------------
+ @ Summary
+    cos of the mean of two latitudes, Q15
+ @ Parameters
+    @ param1 : first latitude, 1e-7 degree
+    @ param2 : second latitude
+    @ param3 : reference latitude near both, 1e-7 degree
+    @ param4 : sin of the reference, Q15
+    @ param5 : cos of the reference, Q15
+ @ Notes
+    cos(ref + d) ~ cos(ref) - d sin(ref). d is held to a degree, where the
+    dropped d^2 term is still under 0.02%.
+  ---------------------------------------------------------------------------- */
+static int32_t MeanCos(int32_t lat1, int32_t lat2, int32_t ref, int32_t sine, int32_t cosine) {
+	int64_t delta = ((int64_t) lat1 + lat2) / 2 - ref;
+
+	if (delta > GPS_DEG_SCALE) {
+		delta = GPS_DEG_SCALE;
+	}
+	else if (delta < -GPS_DEG_SCALE) {
+		delta = -GPS_DEG_SCALE;
+	}
+	delta = (delta * NAV_RAD_PER_UNIT_Q50) >> 20;	// Radians, Q30
+	return cosine - (int32_t) ((sine * delta) >> 30);
+}
+
+/* ---------------------------------- Offset ---------------------------------
+ @ Summary
+    North and east cm from point 1 to point 2 on the flat earth
+ @ Notes
+    Longitude differences are wrapped across the date line.
+  ---------------------------------------------------------------------------- */
+static void Offset(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2, int32_t cosLat,
+				   int32_t *north, int32_t *east) {
+	int64_t dLon = (int64_t) lon2 - lon1;
+
+	if (dLon > 180LL * GPS_DEG_SCALE) {
+		dLon -= 360LL * GPS_DEG_SCALE;
+	}
+	else if (dLon < -180LL * GPS_DEG_SCALE) {
+		dLon += 360LL * GPS_DEG_SCALE;
+	}
+	*north = (int32_t) ((((int64_t) lat2 - lat1) * NAV_CM_PER_UNIT_Q16) >> 16);
+	*east = (int32_t) ((((dLon * cosLat) >> 15) * NAV_CM_PER_UNIT_Q16) >> 16);
+}
+
+/* -------------------------------- Haversine --------------------------------
+ @ Summary
+    Great circle distance, cm
+ @ Notes
+    a = sin^2(dlat/2) + cos(lat1) cos(lat2) sin^2(dlon/2), in Q60
+    c = 2 asin(sqrt(a)) ~ 2 sqrt(a) (1 + a/6), exact enough while c is small
+  ---------------------------------------------------------------------------- */
+static int32_t Haversine(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2) {
+	int32_t sine, cos1, cos2;
+	int32_t ref;
+	int64_t s1, s2;
+	int64_t dLon = (int64_t) lon2 - lon1;
+	uint64_t a;
+	uint64_t root;
+	uint64_t c;
+
+	if (dLon > 180LL * GPS_DEG_SCALE) {
+		dLon -= 360LL * GPS_DEG_SCALE;
+	}
+	else if (dLon < -180LL * GPS_DEG_SCALE) {
+		dLon += 360LL * GPS_DEG_SCALE;
+	}
+	// cos at the nearest 0.01 degree, then trimmed to the exact latitude
+	ref = lat1 / (GPS_DEG_SCALE / 100);
+	FixedSinCos(ref, &sine, &cos1);
+	cos1 = MeanCos(lat1, lat1, ref * (GPS_DEG_SCALE / 100), sine, cos1);
+	ref = lat2 / (GPS_DEG_SCALE / 100);
+	FixedSinCos(ref, &sine, &cos2);
+	cos2 = MeanCos(lat2, lat2, ref * (GPS_DEG_SCALE / 100), sine, cos2);
+
+	s1 = HalfSine(lat2 - lat1);				// Q30
+	s2 = HalfSine((int32_t) dLon);
+	a = (uint64_t) (s1 * s1) + (uint64_t) (((s2 * cos1) >> 15) * ((s2 * cos2) >> 15));
+	root = FixedSqrt64(a);					// Q30
+	c = 2 * root + ((2 * root * (a >> 30)) / 6 >> 30);
+	return (int32_t) ((c * NAV_EARTH_RADIUS_CM) >> 30);
+}
+
+/* --------------------------------- HalfSine --------------------------------
+ @ Summary
+    sin(x / 2) in Q30 for an angle x in 1e-7 degree
+ @ Notes
+    x - x^3/6 + x^5/120, well inside Q30 precision below a few degrees.
+  ---------------------------------------------------------------------------- */
+static int64_t HalfSine(int32_t units) {
+	int64_t x = ((int64_t) units * NAV_RAD_PER_UNIT_Q50) >> 21;	// Half angle, Q30
+	int64_t x2 = (x * x) >> 30;
+	int64_t x3 = (x2 * x) >> 30;
+	int64_t x5 = (x3 * x2) >> 30;
+
+	return x - x3 / 6 + x5 / 120;
+}
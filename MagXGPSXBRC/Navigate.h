@@ -0,0 +1,36 @@
+#ifndef __NAVIGATE_H__
+	#define __NAVIGATE_H__
+
+	#include <plib.h>
+	#include <stdint.h>
+
+	/* ------------------------------ Constants ------------------------------ */
+	#define NAV_CM_PER_UNIT_Q16	72873		// cm per 1e-7 degree on the mean radius sphere, Q16
+	#define NAV_LONG_LEG_CM		500000		// Legs over 5 km use the haversine
+	#define NAV_EARTH_RADIUS_CM	637100880LL	// Mean earth radius
+	#define NAV_RAD_PER_UNIT_Q50	1965066LL	// Radians per 1e-7 degree, Q50
+
+	/* ------------------------------- Waypoint ------------------------------ */
+	typedef struct {
+		int32_t lat;			// 1e-7 degree, south negative
+		int32_t lon;			// 1e-7 degree, west negative
+		uint16_t speed;			// Centiknots on the way to this waypoint
+		uint16_t radius;		// Acceptance radius, dm
+	} NAV_WAYPOINT;
+
+	/* ---------------------------- Setpoints out ---------------------------- */
+	typedef struct {
+		int32_t heading;		// Centidegrees to steer
+		int32_t speed;			// Centiknots, 0 when the route is done
+		int32_t distance;		// cm to the active waypoint
+		int index;				// Active waypoint, -1 with no route
+		BOOL done;
+	} NAV_OUTPUT;
+
+	// Function Prototypes
+	void Navigate_start(const NAV_WAYPOINT *route, int count);
+	void Navigate_stop(void);
+	BOOL Navigate_update(int32_t lat, int32_t lon, NAV_OUTPUT *out);
+	void Navigate_cycles(unsigned int *last, unsigned int *max);
+	int32_t Navigate_distance(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2);
+#endif
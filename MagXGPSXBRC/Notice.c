@@ -51,6 +51,7 @@
 #include "hardware.h"
 #include "Gamepad.h"
 #include "main.h"
+#include "Clock.h"
 #include <plib.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -115,8 +116,17 @@ int JA2;
 /* Pins can have the CN ENABLED or DISABLED during run time.*/
    EnableCNC13;    // Enable interrupts for each individual CN pin
    EnableCNC14;    // Enable interrupts for each individual CN pin
-/* All CN interrupts are vectored to a single CN ISR    */
-   ConfigIntCNC((CHANGE_INT_ON | CHANGE_INT_PRI_1));
+
+/* GPS 1PPS on RG9, its rising edge disciplines the system clock */
+  PPS1_INPUT = 1;
+  mCNGOpen((CNG_ON | CNG_IDLE_CON), CNG9_ENABLE, 0);
+  mPORTGRead();   // Read to set the initial pin status
+  EnableCNG9;
+
+/* All CN interrupts are vectored to a single CN ISR. It runs at level 5 so
+   the PPS time stamp is not held up by the timer and I2C interrupts.  */
+   ConfigIntCNC((CHANGE_INT_ON | CHANGE_INT_PRI_5));
+   ConfigIntCNG((CHANGE_INT_ON | CHANGE_INT_PRI_5));
 }
 
 /* ------------------------------ Timer1Handler ------------------------------
@@ -133,17 +143,26 @@ int JA2;
  * CN status register for that port must be checked as well. Reading the IO 
  * port clears all standing CNSTAT bits for the IO port read.
   ---------------------------------------------------------------------------- */
-void __ISR(_CHANGE_NOTICE_VECTOR, IPL1SOFT) ChangeNoticeHandler(void) 
+void __ISR(_CHANGE_NOTICE_VECTOR, IPL5SOFT) ChangeNoticeHandler(void) 
 {
-   
+     unsigned int ppsTick = ReadCoreTimer();   // First, before anything else
      unsigned int JA1;
      unsigned int JA2;
+
+    //PPS1/RG9
+    if(CNSTATG & BIT_9)
+    {
+        if(mPORTGRead() & BIT_9)   // Reading clears CNSTATG, only the rising edge is on time
+        {
+            Clock_ppsEdge(ppsTick);
+        }
+        mCNGClearIntFlag();
+    }
     //JA1/RC2
     if(CNSTATC & BIT_13) // Check to see which pin(s) created the interrupt
     {
         JA1 = mPORTCRead() & BIT_13; // Clear all standing CNSTATA bits.
-        SetDefaultServoPosition();
-        ClearLeftStick();
+        GamepadPostCenter();    // Main loop centers, nothing shared is touched here
         
         Status1++;
         Status1 %= 2;
@@ -154,8 +173,7 @@ void __ISR(_CHANGE_NOTICE_VECTOR, IPL1SOFT) ChangeNoticeHandler(void)
     if(CNSTATC & BIT_14) // Check to see which pin(s) created the interrupt
     {
         JA2 = mPORTCRead() & BIT_14; // Clear all standing CNSTATA bits.
-        SetDefaultServoPosition();
-        ClearLeftStick();
+        GamepadPostCenter();    // Main loop centers, nothing shared is touched here
         
         Status2++;
         Status2 %= 2;
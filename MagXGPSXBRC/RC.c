@@ -81,10 +81,10 @@ void rcUpdateSpeedControllers(void) {
                 rc_output(i, TRUE);	// Turn channel on
             }
             if(rc[0] > 50) {
-                rc1 = RC_SPEED_CONTROLLER_NEUTRAL + (((rc[0] - 50)/50)*(RC_SPEED_CONTROLLER_MAX-RC_SPEED_CONTROLLER_NEUTRAL));
+                rc1 = RC_SPEED_CONTROLLER_NEUTRAL + (((rc[0] - 50)*(RC_SPEED_CONTROLLER_MAX-RC_SPEED_CONTROLLER_NEUTRAL))/50);
             }
             else {
-                rc1 = RC_SPEED_CONTROLLER_NEUTRAL - (((50 - rc[0])/50)*(RC_SPEED_CONTROLLER_NEUTRAL-RC_SPEED_CONTROLLER_MIN));
+                rc1 = RC_SPEED_CONTROLLER_NEUTRAL - (((50 - rc[0])*(RC_SPEED_CONTROLLER_NEUTRAL-RC_SPEED_CONTROLLER_MIN))/50);
             }
 			if (rc1 > RC_SPEED_CONTROLLER_MAX)
 				rc1 = RC_SPEED_CONTROLLER_MAX;
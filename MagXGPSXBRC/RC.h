@@ -27,6 +27,10 @@
 	#define	RC_SPEED_CONTROLLER_PERIOD	1490 //Measured PWM period
 	#define RC_SPAN		100
 
+	/* --------------------------- Current settings -------------------------- */
+	extern int RC1Pos;		// Rudder servos, percent
+	extern int RC2Pos;		// Speed controllers, percent
+
 	/* ---------------------- Public Function Declarations ------------------- */
 	void initRC(void);
 	void rc_output(int ch, int ctrl);
@@ -57,17 +57,17 @@ OBJECTDIR=build/${CND_CONF}/${IMAGE_TYPE}
 DISTDIR=dist/${CND_CONF}/${IMAGE_TYPE}
 
 # Source Files Quoted if spaced
-SOURCEFILES_QUOTED_IF_SPACED=../LCDlib.c ../hardware.c ../led7.c ../main.c ../swDelay.c ../uart2.c ../uart4.c ../RC.c ../Pot.c ../GPS_I2C.c ../i2c_lib.c ../Gamepad.c ../ADC_TEMP.c ../CycleData.c ../Notice.c ../DMA_UART2.c ../MAG3110.c ../Stepper.c
+SOURCEFILES_QUOTED_IF_SPACED=../LCDlib.c ../hardware.c ../led7.c ../main.c ../swDelay.c ../uart2.c ../uart4.c ../RC.c ../Pot.c ../GPS_I2C.c ../i2c_lib.c ../Gamepad.c ../ADC_TEMP.c ../CycleData.c ../Notice.c ../DMA_UART2.c ../MAG3110.c ../Stepper.c ../FixedMath.c ../MagCal.c ../MMA8652.c ../MagFilter.c ../HeadingFusion.c ../NMEA.c ../DeadReckon.c ../Clock.c ../Navigate.c ../Mission.c ../Command.c ../Geofence.c ../HeadingHold.c ../Cruise.c ../Mode.c ../Link.c
 
 # Object Files Quoted if spaced
-OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/_ext/1472/LCDlib.o ${OBJECTDIR}/_ext/1472/hardware.o ${OBJECTDIR}/_ext/1472/led7.o ${OBJECTDIR}/_ext/1472/main.o ${OBJECTDIR}/_ext/1472/swDelay.o ${OBJECTDIR}/_ext/1472/uart2.o ${OBJECTDIR}/_ext/1472/uart4.o ${OBJECTDIR}/_ext/1472/RC.o ${OBJECTDIR}/_ext/1472/Pot.o ${OBJECTDIR}/_ext/1472/GPS_I2C.o ${OBJECTDIR}/_ext/1472/i2c_lib.o ${OBJECTDIR}/_ext/1472/Gamepad.o ${OBJECTDIR}/_ext/1472/ADC_TEMP.o ${OBJECTDIR}/_ext/1472/CycleData.o ${OBJECTDIR}/_ext/1472/Notice.o ${OBJECTDIR}/_ext/1472/DMA_UART2.o ${OBJECTDIR}/_ext/1472/MAG3110.o ${OBJECTDIR}/_ext/1472/Stepper.o
-POSSIBLE_DEPFILES=${OBJECTDIR}/_ext/1472/LCDlib.o.d ${OBJECTDIR}/_ext/1472/hardware.o.d ${OBJECTDIR}/_ext/1472/led7.o.d ${OBJECTDIR}/_ext/1472/main.o.d ${OBJECTDIR}/_ext/1472/swDelay.o.d ${OBJECTDIR}/_ext/1472/uart2.o.d ${OBJECTDIR}/_ext/1472/uart4.o.d ${OBJECTDIR}/_ext/1472/RC.o.d ${OBJECTDIR}/_ext/1472/Pot.o.d ${OBJECTDIR}/_ext/1472/GPS_I2C.o.d ${OBJECTDIR}/_ext/1472/i2c_lib.o.d ${OBJECTDIR}/_ext/1472/Gamepad.o.d ${OBJECTDIR}/_ext/1472/ADC_TEMP.o.d ${OBJECTDIR}/_ext/1472/CycleData.o.d ${OBJECTDIR}/_ext/1472/Notice.o.d ${OBJECTDIR}/_ext/1472/DMA_UART2.o.d ${OBJECTDIR}/_ext/1472/MAG3110.o.d ${OBJECTDIR}/_ext/1472/Stepper.o.d
+OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/_ext/1472/LCDlib.o ${OBJECTDIR}/_ext/1472/hardware.o ${OBJECTDIR}/_ext/1472/led7.o ${OBJECTDIR}/_ext/1472/main.o ${OBJECTDIR}/_ext/1472/swDelay.o ${OBJECTDIR}/_ext/1472/uart2.o ${OBJECTDIR}/_ext/1472/uart4.o ${OBJECTDIR}/_ext/1472/RC.o ${OBJECTDIR}/_ext/1472/Pot.o ${OBJECTDIR}/_ext/1472/GPS_I2C.o ${OBJECTDIR}/_ext/1472/i2c_lib.o ${OBJECTDIR}/_ext/1472/Gamepad.o ${OBJECTDIR}/_ext/1472/ADC_TEMP.o ${OBJECTDIR}/_ext/1472/CycleData.o ${OBJECTDIR}/_ext/1472/Notice.o ${OBJECTDIR}/_ext/1472/DMA_UART2.o ${OBJECTDIR}/_ext/1472/MAG3110.o ${OBJECTDIR}/_ext/1472/Stepper.o ${OBJECTDIR}/_ext/1472/FixedMath.o ${OBJECTDIR}/_ext/1472/MagCal.o ${OBJECTDIR}/_ext/1472/MMA8652.o ${OBJECTDIR}/_ext/1472/MagFilter.o ${OBJECTDIR}/_ext/1472/HeadingFusion.o ${OBJECTDIR}/_ext/1472/NMEA.o ${OBJECTDIR}/_ext/1472/DeadReckon.o ${OBJECTDIR}/_ext/1472/Clock.o ${OBJECTDIR}/_ext/1472/Navigate.o ${OBJECTDIR}/_ext/1472/Mission.o ${OBJECTDIR}/_ext/1472/Command.o ${OBJECTDIR}/_ext/1472/Geofence.o ${OBJECTDIR}/_ext/1472/HeadingHold.o ${OBJECTDIR}/_ext/1472/Cruise.o ${OBJECTDIR}/_ext/1472/Mode.o ${OBJECTDIR}/_ext/1472/Link.o
+POSSIBLE_DEPFILES=${OBJECTDIR}/_ext/1472/LCDlib.o.d ${OBJECTDIR}/_ext/1472/hardware.o.d ${OBJECTDIR}/_ext/1472/led7.o.d ${OBJECTDIR}/_ext/1472/main.o.d ${OBJECTDIR}/_ext/1472/swDelay.o.d ${OBJECTDIR}/_ext/1472/uart2.o.d ${OBJECTDIR}/_ext/1472/uart4.o.d ${OBJECTDIR}/_ext/1472/RC.o.d ${OBJECTDIR}/_ext/1472/Pot.o.d ${OBJECTDIR}/_ext/1472/GPS_I2C.o.d ${OBJECTDIR}/_ext/1472/i2c_lib.o.d ${OBJECTDIR}/_ext/1472/Gamepad.o.d ${OBJECTDIR}/_ext/1472/ADC_TEMP.o.d ${OBJECTDIR}/_ext/1472/CycleData.o.d ${OBJECTDIR}/_ext/1472/Notice.o.d ${OBJECTDIR}/_ext/1472/DMA_UART2.o.d ${OBJECTDIR}/_ext/1472/MAG3110.o.d ${OBJECTDIR}/_ext/1472/Stepper.o.d ${OBJECTDIR}/_ext/1472/FixedMath.o.d ${OBJECTDIR}/_ext/1472/MagCal.o.d ${OBJECTDIR}/_ext/1472/MMA8652.o.d ${OBJECTDIR}/_ext/1472/MagFilter.o.d ${OBJECTDIR}/_ext/1472/HeadingFusion.o.d ${OBJECTDIR}/_ext/1472/NMEA.o.d ${OBJECTDIR}/_ext/1472/DeadReckon.o.d ${OBJECTDIR}/_ext/1472/Clock.o.d ${OBJECTDIR}/_ext/1472/Navigate.o.d ${OBJECTDIR}/_ext/1472/Mission.o.d ${OBJECTDIR}/_ext/1472/Command.o.d ${OBJECTDIR}/_ext/1472/Geofence.o.d ${OBJECTDIR}/_ext/1472/HeadingHold.o.d ${OBJECTDIR}/_ext/1472/Cruise.o.d ${OBJECTDIR}/_ext/1472/Mode.o.d ${OBJECTDIR}/_ext/1472/Link.o.d
 
 # Object Files
-OBJECTFILES=${OBJECTDIR}/_ext/1472/LCDlib.o ${OBJECTDIR}/_ext/1472/hardware.o ${OBJECTDIR}/_ext/1472/led7.o ${OBJECTDIR}/_ext/1472/main.o ${OBJECTDIR}/_ext/1472/swDelay.o ${OBJECTDIR}/_ext/1472/uart2.o ${OBJECTDIR}/_ext/1472/uart4.o ${OBJECTDIR}/_ext/1472/RC.o ${OBJECTDIR}/_ext/1472/Pot.o ${OBJECTDIR}/_ext/1472/GPS_I2C.o ${OBJECTDIR}/_ext/1472/i2c_lib.o ${OBJECTDIR}/_ext/1472/Gamepad.o ${OBJECTDIR}/_ext/1472/ADC_TEMP.o ${OBJECTDIR}/_ext/1472/CycleData.o ${OBJECTDIR}/_ext/1472/Notice.o ${OBJECTDIR}/_ext/1472/DMA_UART2.o ${OBJECTDIR}/_ext/1472/MAG3110.o ${OBJECTDIR}/_ext/1472/Stepper.o
+OBJECTFILES=${OBJECTDIR}/_ext/1472/LCDlib.o ${OBJECTDIR}/_ext/1472/hardware.o ${OBJECTDIR}/_ext/1472/led7.o ${OBJECTDIR}/_ext/1472/main.o ${OBJECTDIR}/_ext/1472/swDelay.o ${OBJECTDIR}/_ext/1472/uart2.o ${OBJECTDIR}/_ext/1472/uart4.o ${OBJECTDIR}/_ext/1472/RC.o ${OBJECTDIR}/_ext/1472/Pot.o ${OBJECTDIR}/_ext/1472/GPS_I2C.o ${OBJECTDIR}/_ext/1472/i2c_lib.o ${OBJECTDIR}/_ext/1472/Gamepad.o ${OBJECTDIR}/_ext/1472/ADC_TEMP.o ${OBJECTDIR}/_ext/1472/CycleData.o ${OBJECTDIR}/_ext/1472/Notice.o ${OBJECTDIR}/_ext/1472/DMA_UART2.o ${OBJECTDIR}/_ext/1472/MAG3110.o ${OBJECTDIR}/_ext/1472/Stepper.o ${OBJECTDIR}/_ext/1472/FixedMath.o ${OBJECTDIR}/_ext/1472/MagCal.o ${OBJECTDIR}/_ext/1472/MMA8652.o ${OBJECTDIR}/_ext/1472/MagFilter.o ${OBJECTDIR}/_ext/1472/HeadingFusion.o ${OBJECTDIR}/_ext/1472/NMEA.o ${OBJECTDIR}/_ext/1472/DeadReckon.o ${OBJECTDIR}/_ext/1472/Clock.o ${OBJECTDIR}/_ext/1472/Navigate.o ${OBJECTDIR}/_ext/1472/Mission.o ${OBJECTDIR}/_ext/1472/Command.o ${OBJECTDIR}/_ext/1472/Geofence.o ${OBJECTDIR}/_ext/1472/HeadingHold.o ${OBJECTDIR}/_ext/1472/Cruise.o ${OBJECTDIR}/_ext/1472/Mode.o ${OBJECTDIR}/_ext/1472/Link.o
 
 # Source Files
-SOURCEFILES=../LCDlib.c ../hardware.c ../led7.c ../main.c ../swDelay.c ../uart2.c ../uart4.c ../RC.c ../Pot.c ../GPS_I2C.c ../i2c_lib.c ../Gamepad.c ../ADC_TEMP.c ../CycleData.c ../Notice.c ../DMA_UART2.c ../MAG3110.c ../Stepper.c
+SOURCEFILES=../LCDlib.c ../hardware.c ../led7.c ../main.c ../swDelay.c ../uart2.c ../uart4.c ../RC.c ../Pot.c ../GPS_I2C.c ../i2c_lib.c ../Gamepad.c ../ADC_TEMP.c ../CycleData.c ../Notice.c ../DMA_UART2.c ../MAG3110.c ../Stepper.c ../FixedMath.c ../MagCal.c ../MMA8652.c ../MagFilter.c ../HeadingFusion.c ../NMEA.c ../DeadReckon.c ../Clock.c ../Navigate.c ../Mission.c ../Command.c ../Geofence.c ../HeadingHold.c ../Cruise.c ../Mode.c ../Link.c
 
 
 CFLAGS=
@@ -208,6 +208,102 @@ ${OBJECTDIR}/_ext/1472/MAG3110.o: ../MAG3110.c  nbproject/Makefile-${CND_CONF}.m
 	@${RM} ${OBJECTDIR}/_ext/1472/MAG3110.o 
 	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/MAG3110.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/MAG3110.o.d" -o ${OBJECTDIR}/_ext/1472/MAG3110.o ../MAG3110.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
 	
+${OBJECTDIR}/_ext/1472/FixedMath.o: ../FixedMath.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/FixedMath.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/FixedMath.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/FixedMath.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/FixedMath.o.d" -o ${OBJECTDIR}/_ext/1472/FixedMath.o ../FixedMath.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/MagCal.o: ../MagCal.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/MagCal.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/MagCal.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/MagCal.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/MagCal.o.d" -o ${OBJECTDIR}/_ext/1472/MagCal.o ../MagCal.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/MMA8652.o: ../MMA8652.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/MMA8652.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/MMA8652.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/MMA8652.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/MMA8652.o.d" -o ${OBJECTDIR}/_ext/1472/MMA8652.o ../MMA8652.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/MagFilter.o: ../MagFilter.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/MagFilter.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/MagFilter.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/MagFilter.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/MagFilter.o.d" -o ${OBJECTDIR}/_ext/1472/MagFilter.o ../MagFilter.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/HeadingFusion.o: ../HeadingFusion.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/HeadingFusion.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/HeadingFusion.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/HeadingFusion.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/HeadingFusion.o.d" -o ${OBJECTDIR}/_ext/1472/HeadingFusion.o ../HeadingFusion.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/NMEA.o: ../NMEA.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/NMEA.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/NMEA.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/NMEA.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/NMEA.o.d" -o ${OBJECTDIR}/_ext/1472/NMEA.o ../NMEA.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/DeadReckon.o: ../DeadReckon.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/DeadReckon.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/DeadReckon.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/DeadReckon.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/DeadReckon.o.d" -o ${OBJECTDIR}/_ext/1472/DeadReckon.o ../DeadReckon.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Clock.o: ../Clock.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Clock.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Clock.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Clock.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Clock.o.d" -o ${OBJECTDIR}/_ext/1472/Clock.o ../Clock.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Navigate.o: ../Navigate.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Navigate.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Navigate.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Navigate.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Navigate.o.d" -o ${OBJECTDIR}/_ext/1472/Navigate.o ../Navigate.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Mission.o: ../Mission.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Mission.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Mission.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Mission.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Mission.o.d" -o ${OBJECTDIR}/_ext/1472/Mission.o ../Mission.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Command.o: ../Command.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Command.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Command.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Command.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Command.o.d" -o ${OBJECTDIR}/_ext/1472/Command.o ../Command.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Geofence.o: ../Geofence.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Geofence.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Geofence.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Geofence.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Geofence.o.d" -o ${OBJECTDIR}/_ext/1472/Geofence.o ../Geofence.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/HeadingHold.o: ../HeadingHold.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/HeadingHold.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/HeadingHold.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/HeadingHold.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/HeadingHold.o.d" -o ${OBJECTDIR}/_ext/1472/HeadingHold.o ../HeadingHold.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Cruise.o: ../Cruise.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Cruise.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Cruise.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Cruise.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Cruise.o.d" -o ${OBJECTDIR}/_ext/1472/Cruise.o ../Cruise.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Mode.o: ../Mode.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Mode.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Mode.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Mode.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Mode.o.d" -o ${OBJECTDIR}/_ext/1472/Mode.o ../Mode.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Link.o: ../Link.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Link.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Link.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Link.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Link.o.d" -o ${OBJECTDIR}/_ext/1472/Link.o ../Link.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
 ${OBJECTDIR}/_ext/1472/Stepper.o: ../Stepper.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
 	@${RM} ${OBJECTDIR}/_ext/1472/Stepper.o.d 
@@ -317,6 +413,102 @@ ${OBJECTDIR}/_ext/1472/MAG3110.o: ../MAG3110.c  nbproject/Makefile-${CND_CONF}.m
 	@${RM} ${OBJECTDIR}/_ext/1472/MAG3110.o 
 	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/MAG3110.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/MAG3110.o.d" -o ${OBJECTDIR}/_ext/1472/MAG3110.o ../MAG3110.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
 	
+${OBJECTDIR}/_ext/1472/FixedMath.o: ../FixedMath.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/FixedMath.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/FixedMath.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/FixedMath.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/FixedMath.o.d" -o ${OBJECTDIR}/_ext/1472/FixedMath.o ../FixedMath.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/MagCal.o: ../MagCal.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/MagCal.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/MagCal.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/MagCal.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/MagCal.o.d" -o ${OBJECTDIR}/_ext/1472/MagCal.o ../MagCal.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/MMA8652.o: ../MMA8652.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/MMA8652.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/MMA8652.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/MMA8652.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/MMA8652.o.d" -o ${OBJECTDIR}/_ext/1472/MMA8652.o ../MMA8652.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/MagFilter.o: ../MagFilter.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/MagFilter.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/MagFilter.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/MagFilter.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/MagFilter.o.d" -o ${OBJECTDIR}/_ext/1472/MagFilter.o ../MagFilter.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/HeadingFusion.o: ../HeadingFusion.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/HeadingFusion.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/HeadingFusion.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/HeadingFusion.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/HeadingFusion.o.d" -o ${OBJECTDIR}/_ext/1472/HeadingFusion.o ../HeadingFusion.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/NMEA.o: ../NMEA.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/NMEA.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/NMEA.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/NMEA.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/NMEA.o.d" -o ${OBJECTDIR}/_ext/1472/NMEA.o ../NMEA.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/DeadReckon.o: ../DeadReckon.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/DeadReckon.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/DeadReckon.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/DeadReckon.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/DeadReckon.o.d" -o ${OBJECTDIR}/_ext/1472/DeadReckon.o ../DeadReckon.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Clock.o: ../Clock.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Clock.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Clock.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Clock.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Clock.o.d" -o ${OBJECTDIR}/_ext/1472/Clock.o ../Clock.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Navigate.o: ../Navigate.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Navigate.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Navigate.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Navigate.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Navigate.o.d" -o ${OBJECTDIR}/_ext/1472/Navigate.o ../Navigate.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Mission.o: ../Mission.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Mission.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Mission.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Mission.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Mission.o.d" -o ${OBJECTDIR}/_ext/1472/Mission.o ../Mission.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Command.o: ../Command.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Command.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Command.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Command.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Command.o.d" -o ${OBJECTDIR}/_ext/1472/Command.o ../Command.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Geofence.o: ../Geofence.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Geofence.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Geofence.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Geofence.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Geofence.o.d" -o ${OBJECTDIR}/_ext/1472/Geofence.o ../Geofence.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/HeadingHold.o: ../HeadingHold.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/HeadingHold.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/HeadingHold.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/HeadingHold.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/HeadingHold.o.d" -o ${OBJECTDIR}/_ext/1472/HeadingHold.o ../HeadingHold.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Cruise.o: ../Cruise.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Cruise.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Cruise.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Cruise.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Cruise.o.d" -o ${OBJECTDIR}/_ext/1472/Cruise.o ../Cruise.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Mode.o: ../Mode.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Mode.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Mode.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Mode.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Mode.o.d" -o ${OBJECTDIR}/_ext/1472/Mode.o ../Mode.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/_ext/1472/Link.o: ../Link.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
+	@${RM} ${OBJECTDIR}/_ext/1472/Link.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1472/Link.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1472/Link.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -MMD -MF "${OBJECTDIR}/_ext/1472/Link.o.d" -o ${OBJECTDIR}/_ext/1472/Link.o ../Link.c    -DXPRJ_default=$(CND_CONF)  -no-legacy-libc  $(COMPARISON_BUILD) 
+	
 ${OBJECTDIR}/_ext/1472/Stepper.o: ../Stepper.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} "${OBJECTDIR}/_ext/1472" 
 	@${RM} ${OBJECTDIR}/_ext/1472/Stepper.o.d 
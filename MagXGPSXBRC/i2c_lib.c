@@ -6,9 +6,86 @@
 #include <plib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 
 ///* -------------------------- Function Prototyping --------------------------- */
+static const I2C_DEV_PROFILE *FindProfile(I2C_MODULE i2c_port, BYTE DeviceAddress);
+static void ApplySpeed(I2C_MODULE i2c_port, const I2C_DEV_PROFILE *profile);
+static const I2C_DEV_PROFILE *BeginTransaction(I2C_MODULE i2c_port, BYTE DeviceAddress);
+static void ClaimBus(I2C_MODULE i2c_port);
+static void ReleaseBus(I2C_MODULE i2c_port);
+static BOOL QueuePush(I2C_ASYNC_REQ *req);
+static I2C_ASYNC_REQ *QueuePop(void);
+static void AsyncStart(I2C_ASYNC_REQ *req);
+static void AsyncFinish(void);
+static I2C_ASYNC_REQ *AsyncAbandon(void);
+static void AsyncFail(I2C_ASYNC_REQ *stuck);
+static BOOL RetryTransaction(const I2C_DEV_PROFILE *profile, I2C_RESULT i2c_result, int *attempt);
+static BOOL WaitExpired(unsigned int tStart);
+static I2C_RESULT WriteOnce(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE *str, int *len);
+static I2C_RESULT ReadOnce(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE *str, int *len);
+static I2C_RESULT WriteReadOnce(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE reg_addr, BYTE *i2cData, int len);
+#ifdef I2C_TRACE
+static void TraceDevice(I2C_MODULE i2c_port, const I2C_DEV_PROFILE *profile, BYTE DeviceAddress);
+static void TraceTransfer(void);
+#endif
+
+// Local Variables
+static I2C_DEV_PROFILE profiles[I2C_MAX_PROFILES];	// Registered device profiles
+static int profileCount = 0;
+static I2C_DEV_PROFILE defaultProfile[2];			// One per I2C port, set by I2C_Init
+static int busSpeed[2];								// Clock currently programmed on each port
+static unsigned int waitTicks;						// Core ticks allowed per bus event
+static BOOL busTimedOut;							// A wait expired during this attempt
+
+// Background (interrupt driven) transfers, I2C1 only
+enum AsyncStates {
+	ASYNC_IDLE,
+	ASYNC_START,
+	ASYNC_ADDR_W,
+	ASYNC_REG,
+	ASYNC_RESTART,
+	ASYNC_ADDR_R,
+	ASYNC_RECV,
+	ASYNC_ACK,
+	ASYNC_STOP
+};
+static volatile BOOL busOwned = FALSE;				// A blocking transaction has the bus
+static I2C_ASYNC_REQ * volatile asyncActive = NULL;	// Background transfer in flight
+static I2C_ASYNC_REQ * volatile asyncQueue[I2C_ASYNC_QUEUE];	// Waiting for the bus
+static volatile int queueHead = 0;
+static volatile int queueCount = 0;
+static volatile int asyncState = ASYNC_IDLE;
+static volatile int asyncIndex;						// Next byte to receive
+static volatile unsigned int asyncTick;				// Core timer at its last bus event
+static unsigned int asyncWaitTicks;					// Its device's per event timeout
+
+#ifdef I2C_TRACE
+typedef struct {
+	unsigned int tick;		// Core timer value when the event happened
+	BYTE event;				// I2C_EV_xxx code
+	BYTE dev_id;			// Device being talked to
+	BYTE data;				// Event specific byte
+	BYTE pad;
+} I2C_TRACE_ENTRY;
+
+typedef struct {
+	BYTE dev_id;
+	unsigned int transfers;			// START to STOP sequences completed
+	unsigned int errors;			// Failed attempts
+	unsigned int timeouts;			// Failed attempts caused by a bus timeout
+	unsigned int max_us;			// Longest START to STOP seen
+	unsigned int hist[I2C_HIST_BINS];	// START to STOP latency histogram
+} I2C_TRACE_STATS;
+
+static I2C_TRACE_ENTRY traceRing[I2C_TRACE_DEPTH];
+static unsigned int traceHead = 0;					// Total events ever recorded
+static I2C_TRACE_STATS traceStats[I2C_MAX_PROFILES + 1];	// Last slot is the default profile
+static I2C_TRACE_STATS *traceDev = &traceStats[I2C_MAX_PROFILES];
+static unsigned int traceStartTick;
+static BYTE traceLastEvent;
+#endif
 
 
 /* --------------------------------- I2C_Init --------------------------------
@@ -36,10 +113,341 @@ I2C_RESULT I2C_Init(I2C_MODULE i2c_port,  int speed) {
 		I2CEnable(i2c_port, TRUE);
 		i2cFlag = I2C_SUCCESS;
 	}
+
+	// Devices without their own profile run at the speed the port was opened at
+	busSpeed[i2c_port] = speed;
+	defaultProfile[i2c_port].i2c_channel = i2c_port;
+	defaultProfile[i2c_port].speed = speed;
+	defaultProfile[i2c_port].timeout_us = I2C_DEFAULT_TIMEOUT_US;
+	defaultProfile[i2c_port].retries = 0;
     
 	return i2cFlag;
 }
 
+/* ------------------------------ I2C_SetProfile -----------------------------
+ @ Summary
+    Registers (or updates) the bus settings used for one device
+ @ Parameters
+    @ param1 : Which I2C port the device is on, I2C1 or I2C2
+    @ param2 : Device address the profile applies to
+    @ param3 : Bus clock to use for this device (e.g. I2C_SPEED_FAST)
+    @ param4 : Longest time in microseconds to wait for any single bus event
+    @ param5 : Number of extra attempts made after a failed transaction
+ @ Return Value
+    I2C_RESULT : I2C_ERROR if the profile table is full
+ @ Notes
+    The profile is applied at the start of every transaction with the device,
+    so devices with different speeds can share one bus.
+  ---------------------------------------------------------------------------- */
+I2C_RESULT I2C_SetProfile(I2C_MODULE i2c_port, BYTE dev_id, int speed, unsigned int timeout_us, int retries) {
+	int idx;
+
+	// Update the device's existing entry, or append a new one
+	for (idx = 0; idx < profileCount; idx++) {
+		if ((profiles[idx].i2c_channel == i2c_port) && (profiles[idx].dev_id == dev_id)) {
+			break;
+		}
+	}
+	if (idx == profileCount) {
+		if (profileCount >= I2C_MAX_PROFILES) {
+			printf("I2C profile table full\n\r");
+			return I2C_ERROR;
+		}
+		profileCount++;
+	}
+
+	profiles[idx].i2c_channel = i2c_port;
+	profiles[idx].dev_id = dev_id;
+	profiles[idx].speed = speed;
+	profiles[idx].timeout_us = timeout_us;
+	profiles[idx].retries = retries;
+
+	return I2C_SUCCESS;
+}
+
+/* ------------------------------ I2C_BusRecover -----------------------------
+ @ Summary
+    Frees a bus that a slave is holding by clocking out its partial byte
+ @ Parameters
+    @ param1 : Which I2C port to recover, I2C1 or I2C2
+ @ Return Value
+    I2C_RESULT : I2C_SUCCESS if SDA was released, I2C_ERROR otherwise
+ @ Notes
+    The module is turned off and SCL is toggled as a GPIO up to nine times
+    until the slave lets go of SDA, then a STOP is generated by hand and the
+    module is re-initialized. Total time is bounded to about 100us. Only the
+    I2C1 pins are defined, other ports are just restarted.
+  ---------------------------------------------------------------------------- */
+I2C_RESULT I2C_BusRecover(I2C_MODULE i2c_port) {
+	I2C_RESULT i2c_result = I2C_SUCCESS;
+	int clk;
+
+	I2CEnable(i2c_port, FALSE);
+
+	if (i2c_port == I2C1) {
+		/* ------------ Take the pins over as open drain outputs ------------- */
+		I2C1_SCL_ODC = 1;
+		I2C1_SDA_ODC = 1;
+		I2C1_SCL_LAT = 1;
+		I2C1_SDA_LAT = 1;
+		I2C1_SCL_TRIS = 0;
+		I2C1_SDA_TRIS = 1;  // SDA only sensed until the STOP
+		usDelay(5);
+
+		/* ---------- Clock out the byte the slave is stuck sending ---------- */
+		for (clk = 0; (clk < I2C_RECOVERY_CLOCKS) && !I2C1_SDA_PORT; clk++) {
+			I2C1_SCL_LAT = 0;
+			usDelay(5);
+			I2C1_SCL_LAT = 1;
+			usDelay(5);
+		}
+
+		/* ---------------- STOP: SDA rises while SCL is high ---------------- */
+		I2C1_SCL_LAT = 0;
+		I2C1_SDA_LAT = 0;
+		I2C1_SDA_TRIS = 0;
+		usDelay(5);
+		I2C1_SCL_LAT = 1;
+		usDelay(5);
+		I2C1_SDA_LAT = 1;
+		usDelay(5);
+
+		if (!I2C1_SDA_PORT) {
+			printf("I2C bus recovery failed, SDA still low\n\r");
+			i2c_result = I2C_ERROR;
+		}
+
+		/* ------------------ Hand the pins back to the module --------------- */
+		I2C1_SCL_TRIS = 1;
+		I2C1_SDA_TRIS = 1;
+	}
+
+	I2CSetFrequency(i2c_port, GetPeripheralClock(), busSpeed[i2c_port]);
+	I2CEnable(i2c_port, TRUE);
+
+	return i2c_result;
+}
+
+/* ------------------------------- FindProfile -------------------------------
+ @ Summary
+    Looks up the profile registered for a device
+ @ Parameters
+    @ param1 : Which I2C port the device is on, I2C1 or I2C2
+    @ param2 : Device address
+ @ Return Value
+    I2C_DEV_PROFILE * : The device's profile, or the port default
+  ---------------------------------------------------------------------------- */
+static const I2C_DEV_PROFILE *FindProfile(I2C_MODULE i2c_port, BYTE DeviceAddress) {
+	int idx;
+
+	for (idx = 0; idx < profileCount; idx++) {
+		if ((profiles[idx].i2c_channel == i2c_port) && (profiles[idx].dev_id == DeviceAddress)) {
+			return &profiles[idx];
+		}
+	}
+	return &defaultProfile[i2c_port];
+}
+
+/* -------------------------------- ApplySpeed -------------------------------
+ @ Summary
+    Sets the bus clock for a profile if it is not already running at it
+ @ Parameters
+    @ param1 : Which I2C port to set, I2C1 or I2C2
+    @ param2 : Profile whose speed should be used
+ @ Return Value
+    None
+ @ Notes
+    BRG may only be changed while the module is off, so this must only be
+    called while the bus is idle.
+  ---------------------------------------------------------------------------- */
+static void ApplySpeed(I2C_MODULE i2c_port, const I2C_DEV_PROFILE *profile) {
+	if (profile->speed != busSpeed[i2c_port]) {
+		I2CEnable(i2c_port, FALSE);
+		I2CSetFrequency(i2c_port, GetPeripheralClock(), profile->speed);
+		I2CEnable(i2c_port, TRUE);
+		busSpeed[i2c_port] = profile->speed;
+	}
+}
+
+/* ----------------------------- BeginTransaction ----------------------------
+ @ Summary
+    Takes the bus and applies the profile of the addressed device before a
+    blocking transaction
+ @ Parameters
+    @ param1 : Which I2C port the transaction is on, I2C1 or I2C2
+    @ param2 : Device address about to be accessed
+ @ Return Value
+    I2C_DEV_PROFILE * : The profile in effect for the transaction
+ @ Notes
+    Every BeginTransaction must be paired with a ReleaseBus.
+  ---------------------------------------------------------------------------- */
+static const I2C_DEV_PROFILE *BeginTransaction(I2C_MODULE i2c_port, BYTE DeviceAddress) {
+	const I2C_DEV_PROFILE *profile = FindProfile(i2c_port, DeviceAddress);
+
+	waitTicks = (CORE_MS_TICK_RATE * profile->timeout_us) / 1000;
+	busTimedOut = FALSE;
+
+	ClaimBus(i2c_port);
+	ApplySpeed(i2c_port, profile);
+
+#ifdef I2C_TRACE
+	TraceDevice(i2c_port, profile, DeviceAddress);
+#endif
+
+	return profile;
+}
+
+/* --------------------------------- ClaimBus --------------------------------
+ @ Summary
+    Waits for any background transfer to finish, then marks the bus as owned
+    by the blocking code
+ @ Parameters
+    @ param1 : Which I2C port is needed, I2C1 or I2C2
+ @ Return Value
+    None
+ @ Notes
+    A background transfer that does not finish within the current timeout is
+    abandoned, its requester is told it failed, and the bus is recovered.
+  ---------------------------------------------------------------------------- */
+static void ClaimBus(I2C_MODULE i2c_port) {
+	unsigned int tStart = ReadCoreTimer();
+	unsigned int intStatus;
+	I2C_ASYNC_REQ *stuck = NULL;
+
+	if (i2c_port != I2C1) {
+		return;
+	}
+
+	do {
+		intStatus = INTDisableInterrupts();
+		if ((asyncActive != NULL) && ((ReadCoreTimer() - tStart) >= waitTicks)) {
+			// Abandon the background transfer, it is not going to finish
+			stuck = AsyncAbandon();
+		}
+		if (asyncActive == NULL) {
+			busOwned = TRUE;
+		}
+		INTRestoreInterrupts(intStatus);
+	} while (!busOwned);
+
+	if (stuck != NULL) {
+		AsyncFail(stuck);
+	}
+}
+
+/* -------------------------------- ReleaseBus -------------------------------
+ @ Summary
+    Ends a blocking transaction and starts any background transfer that was
+    waiting for the bus
+ @ Parameters
+    @ param1 : Which I2C port to release, I2C1 or I2C2
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+static void ReleaseBus(I2C_MODULE i2c_port) {
+	unsigned int intStatus;
+	I2C_ASYNC_REQ *req;
+
+	if (i2c_port != I2C1) {
+		return;
+	}
+
+	intStatus = INTDisableInterrupts();
+	busOwned = FALSE;
+	req = QueuePop();
+	if (req != NULL) {
+		AsyncStart(req);
+	}
+	INTRestoreInterrupts(intStatus);
+}
+
+/* -------------------------------- QueuePush --------------------------------
+ @ Summary
+    Adds a background request to the end of the wait queue
+ @ Parameters
+    @ param1 : Request to queue
+ @ Return Value
+    BOOL : FALSE if the queue is full
+ @ Notes
+    Called with interrupts disabled or from an IPL3 interrupt, as is
+    QueuePop, so the two never interleave.
+  ---------------------------------------------------------------------------- */
+static BOOL QueuePush(I2C_ASYNC_REQ *req) {
+	if (queueCount >= I2C_ASYNC_QUEUE) {
+		return FALSE;
+	}
+	asyncQueue[(queueHead + queueCount) % I2C_ASYNC_QUEUE] = req;
+	queueCount++;
+	return TRUE;
+}
+
+/* --------------------------------- QueuePop --------------------------------
+ @ Summary
+    Takes the oldest waiting background request
+ @ Return Value
+    I2C_ASYNC_REQ* : NULL if none is waiting
+  ---------------------------------------------------------------------------- */
+static I2C_ASYNC_REQ *QueuePop(void) {
+	I2C_ASYNC_REQ *req;
+
+	if (queueCount == 0) {
+		return NULL;
+	}
+	req = asyncQueue[queueHead];
+	queueHead = (queueHead + 1) % I2C_ASYNC_QUEUE;
+	queueCount--;
+	return req;
+}
+
+/* ----------------------------- RetryTransaction ----------------------------
+ @ Summary
+    Decides whether a failed transaction should be attempted again
+ @ Parameters
+    @ param1 : Profile of the device being accessed
+    @ param2 : Result of the attempt that just finished
+    @ param3 : Attempt counter, incremented on each retry
+ @ Return Value
+    TRUE  : Try the transaction again
+    FALSE : Done, either succeeded or out of retries
+ @ Notes
+    An attempt that timed out leaves the bus in an unknown state, so the bus
+    is recovered before the next attempt.
+  ---------------------------------------------------------------------------- */
+static BOOL RetryTransaction(const I2C_DEV_PROFILE *profile, I2C_RESULT i2c_result, int *attempt) {
+	if (i2c_result == I2C_SUCCESS) {
+		return FALSE;
+	}
+#ifdef I2C_TRACE
+	traceDev->errors++;
+	if (busTimedOut) traceDev->timeouts++;
+#endif
+	I2C_TRACE_EVENT(I2C_EV_ERROR, *attempt);
+	if (busTimedOut) {
+		printf("I2C timeout on device 0x%02X\n\r", profile->dev_id);
+		I2C_BusRecover(profile->i2c_channel);
+		busTimedOut = FALSE;
+	}
+
+	return (++(*attempt) <= profile->retries);
+}
+
+/* -------------------------------- WaitExpired ------------------------------
+ @ Summary
+    Checks whether the current bus wait has run past the profile timeout
+ @ Parameters
+    @ param1 : Core timer value captured when the wait began
+ @ Return Value
+    TRUE  : The wait timed out (also latched for RetryTransaction)
+    FALSE : Keep waiting
+  ---------------------------------------------------------------------------- */
+static BOOL WaitExpired(unsigned int tStart) {
+	if ((ReadCoreTimer() - tStart) >= waitTicks) {
+		if (!busTimedOut) I2C_TRACE_EVENT(I2C_EV_TIMEOUT, 0);
+		busTimedOut = TRUE;
+	}
+	return busTimedOut;
+}
+
 /* -------------------------------- I2C_Write --------------------------------
  @ Summary
     Send the provided string through the provided port to the provided device
@@ -52,6 +460,22 @@ I2C_RESULT I2C_Init(I2C_MODULE i2c_port,  int speed) {
     I2C_RESULT : Flag for whether or not the transfer errored or not
   ---------------------------------------------------------------------------- */
 I2C_RESULT I2C_Write(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE *str, int *len) {
+	const I2C_DEV_PROFILE *profile = BeginTransaction(i2c_port, DeviceAddress);
+	I2C_RESULT i2c_result;
+	int attempt = 0;
+	int sent;
+
+	do {
+		sent = *len;
+		i2c_result = WriteOnce(i2c_port, DeviceAddress, str, &sent);
+	} while (RetryTransaction(profile, i2c_result, &attempt));
+	*len = sent;
+	ReleaseBus(i2c_port);
+
+	return i2c_result;
+}
+
+static I2C_RESULT WriteOnce(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE *str, int *len) {
 	I2C_7_BIT_ADDRESS SlaveAddress;
 	int dataIndex		  = 0;
 	I2C_RESULT i2c_result = I2C_SUCCESS;	// Status of I2C action
@@ -97,6 +521,22 @@ I2C_RESULT I2C_Write(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE *str, int *le
     I2C_RESULT : Flag for whether or not the transfer errored or not
   ---------------------------------------------------------------------------- */
 I2C_RESULT I2C_Read(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE *str, int *len) {
+	const I2C_DEV_PROFILE *profile = BeginTransaction(i2c_port, DeviceAddress);
+	I2C_RESULT i2c_result;
+	int attempt = 0;
+	int received;
+
+	do {
+		received = *len;
+		i2c_result = ReadOnce(i2c_port, DeviceAddress, str, &received);
+	} while (RetryTransaction(profile, i2c_result, &attempt));
+	*len = received;
+	ReleaseBus(i2c_port);
+
+	return i2c_result;
+}
+
+static I2C_RESULT ReadOnce(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE *str, int *len) {
 	I2C_7_BIT_ADDRESS SlaveAddress;
 	int dataIndex 		  = 0;
 	I2C_RESULT i2c_result = I2C_SUCCESS;   // Status of I2C action
@@ -139,79 +579,85 @@ I2C_RESULT I2C_Read(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE *str, int *len
 	return i2c_result;
 }
 
-/* ------------------------------- I2CReadRegs -------------------------------
+/* ------------------------------ I2C_WriteRead ------------------------------
  @ Summary
-    Read the specified number of bytes from the EEPROM, starting at the 
-    specified memory address
+    Sets a device's register pointer and reads back a block of registers in
+    one bus transaction
  @ Parameters
     @ param1 : Which I2C port to read, I2C1 or I2C2
     @ param2 : Device address that's being address (i.e. Mag, or GPS, etc.)
-    @ param3 : Register starting address (0x0000 to 0x7FFF)
+    @ param3 : 8-bit register address to start reading from
     @ param4 : Data array that is filled upon data read
-    @ param5 : Number of data bytes to read
+    @ param5 : Number of data bytes to read (at least 1)
  @ Return Value
     I2C_RESULT : Flag for whether or not the transfer errored or not
+ @ Notes
+    The sequence is START, address+W, register, REPEATED START, address+R,
+    len data bytes (NACK on the last one), STOP. Because the bus is never
+    released between the pointer write and the read, the device does not
+    need the settling delays that a separate I2C_Write / I2C_Read pair does.
   ---------------------------------------------------------------------------- */
-I2C_RESULT I2CReadRegs(I2C_MODULE i2c_port, BYTE DeviceAddress, int reg_addr, BYTE *i2cData, int len) {
-	BYTE header[3];
-	I2C_7_BIT_ADDRESS SlaveAddress;
-	int headerIndex = 0;
-	int dataIndex   = 0;
+I2C_RESULT I2C_WriteRead(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE reg_addr, BYTE *i2cData, int len) {
+	const I2C_DEV_PROFILE *profile = BeginTransaction(i2c_port, DeviceAddress);
 	I2C_RESULT i2c_result;
+	int attempt = 0;
+
+	do {
+		i2c_result = WriteReadOnce(i2c_port, DeviceAddress, reg_addr, i2cData, len);
+	} while (RetryTransaction(profile, i2c_result, &attempt));
+	ReleaseBus(i2c_port);
+
+	return i2c_result;
+}
+
+static I2C_RESULT WriteReadOnce(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE reg_addr, BYTE *i2cData, int len) {
+	I2C_7_BIT_ADDRESS SlaveAddress;
+	int dataIndex = 0;
+	I2C_RESULT i2c_result = I2C_SUCCESS;
 	BOOL okay;
 
-	/* ---------------- Setup EEPROM header w/ write sequence ---------------- */
-	I2C_FORMAT_7_BIT_ADDRESS(SlaveAddress, DeviceAddress, I2C_WRITE);
-	header[0]   = SlaveAddress.byte;
-	header[1]   = (BYTE) (reg_addr >> 8);
-	headerIndex = 0;
-
-	/* - Write the starting address. Cannot use a STOP bit, instead a repeat - */
-	/* ------------ START bit will initiate the memory read phase. ----------- */
-    okay = StartTransfer(i2c_port, FALSE); // FALSE - no repeated start
-    i2c_result = I2C_SUCCESS;
-
-	while ((headerIndex < 2) && (i2c_result == I2C_SUCCESS) && okay) {
-		if (TransmitOneByte(i2c_port, header[headerIndex++])) {
-			// Verify that the byte was acknowledged
-			if(!I2CByteWasAcknowledged(i2c_port)) {
-				printf("Error: Sent byte was not acknowledged\n");
-				i2c_result |= I2C_ERROR;
+	/* ------------ Address the device and set its register pointer ---------- */
+	okay = StartTransfer(i2c_port, FALSE); // FALSE - no repeated start
+	if (okay) {
+		I2C_FORMAT_7_BIT_ADDRESS(SlaveAddress, DeviceAddress, I2C_WRITE);
+		if (TransmitOneByte(i2c_port, SlaveAddress.byte) && I2CByteWasAcknowledged(i2c_port)) {
+			if (!(TransmitOneByte(i2c_port, reg_addr) && I2CByteWasAcknowledged(i2c_port))) {
+				i2c_ackError(12);
+				i2c_result = I2C_ERROR;
 			}
 		}
 		else {
-			i2c_result |= I2C_ERROR;
+			i2c_ackError(11);
+			i2c_result = I2C_ERROR;
 		}
 	}
+	else {
+		i2c_result = I2C_ERROR;
+	}
 
-	/* ---------- Continue the read sequence if there was no error ----------- */
-    if (i2c_result == I2C_SUCCESS) {
+	/* ---------- Turn the bus around with a repeated START for the read ------ */
+	if (i2c_result == I2C_SUCCESS) {
 		okay = StartTransfer(i2c_port, TRUE); // TRUE - repeated start
-		if ((i2c_result == I2C_SUCCESS) && okay) {
-			I2C_FORMAT_7_BIT_ADDRESS(SlaveAddress, DeviceAddress, I2C_READ);
-			if (!TransmitOneByte(i2c_port, SlaveAddress.byte)) {
-			    if (!I2CByteWasAcknowledged(i2c_port)) {
-			        printf("Error: Sent byte was not acknowledged\n");
-			        i2c_result = I2C_ERROR;
-			    }
-			}
-			dataIndex = 0;	// Reset the data array index
+		I2C_FORMAT_7_BIT_ADDRESS(SlaveAddress, DeviceAddress, I2C_READ);
+		if (!(okay && TransmitOneByte(i2c_port, SlaveAddress.byte) && I2CByteWasAcknowledged(i2c_port))) {
+			i2c_ackError(13);
+			i2c_result = I2C_ERROR;
 		}
+	}
 
-		/* -------- Read each data byte (except the last) w/ ACK bit --------- */
-		while ((dataIndex < len-1) && (i2c_result == I2C_SUCCESS)) {
-			i2c_result |=  ReceiveOneByte(i2c_port, &i2cData[dataIndex++], TRUE);
-		}
-		/* ------------- Read the last data byte w/o an ACK bit -------------- */
-		if (i2c_result == I2C_SUCCESS) {
-			i2c_result |= ReceiveOneByte(i2c_port, &i2cData[dataIndex], FALSE );
-		}
+	/* ----------- Read each data byte (except the last) w/ ACK bit ---------- */
+	while ((dataIndex < len-1) && (i2c_result == I2C_SUCCESS)) {
+		i2c_result |= ReceiveOneByte(i2c_port, &i2cData[dataIndex++], TRUE);
+	}
+	/* --------------- Read the last data byte w/o an ACK bit ---------------- */
+	if (i2c_result == I2C_SUCCESS) {
+		i2c_result |= ReceiveOneByte(i2c_port, &i2cData[dataIndex], FALSE);
 	}
 
 	/* -------------- Send the stop bit, ending the I2C transfer ------------- */
-    StopTransfer(i2c_port);
-    
-    return i2c_result;
+	StopTransfer(i2c_port);
+
+	return i2c_result;
 }
 
 
@@ -225,19 +671,28 @@ I2C_RESULT I2CReadRegs(I2C_MODULE i2c_port, BYTE DeviceAddress, int reg_addr, BY
     TRUE  : Data was sent successfully
     FALSE : A bus collusion / some error occurred
  @ Notes
- 	This function utilizes a blocking I2C routine
+ 	This function utilizes a blocking I2C routine, bounded by the profile
+ 	timeout of the device being written
   ---------------------------------------------------------------------------- */
 static BOOL TransmitOneByte(I2C_MODULE i2c_port, BYTE data) {
+	unsigned int tStart = ReadCoreTimer();
+
 	// Wait for the transmitter to be ready
-	while(!I2CTransmitterIsReady(i2c_port));
+	while(!I2CTransmitterIsReady(i2c_port)) {
+		if (WaitExpired(tStart)) return FALSE;
+	}
 
 	// Transmit the data byte
+	I2C_TRACE_EVENT(I2C_EV_TX, data);
 	if (I2CSendByte(i2c_port, data) == I2C_MASTER_BUS_COLLISION) {
 		printf("Error: I2C Master Bus Collision\n");
 		return FALSE;
 	}
 	// Wait for the transmission to finish
-	while (!I2CTransmissionHasCompleted(i2c_port));
+	tStart = ReadCoreTimer();
+	while (!I2CTransmissionHasCompleted(i2c_port)) {
+		if (WaitExpired(tStart)) return FALSE;
+	}
 
 	return TRUE;
 }
@@ -252,22 +707,31 @@ static BOOL TransmitOneByte(I2C_MODULE i2c_port, BYTE data) {
  @ Return Value
     I2C_RESULT : Flag of whether or not an error occured
  @ Notes
- 	This function utilizes a blocking I2C routine
+ 	This function utilizes a blocking I2C routine, bounded by the profile
+ 	timeout of the device being read
   ---------------------------------------------------------------------------- */
 static I2C_RESULT ReceiveOneByte(I2C_MODULE i2c_port, BYTE *data, BOOL ack) {
 	I2C_RESULT i2c_result = I2C_SUCCESS;
+	unsigned int tStart;
 	if (I2CReceiverEnable(i2c_port, TRUE) == I2C_RECEIVE_OVERFLOW) {
 		printf("Error: I2C Receive Overflow\n");
 		i2c_result =  I2C_RECEIVE_OVERFLOW;
 	}
     else {
     	// Wait for the bus to become free
-		while (!I2CReceivedDataIsAvailable(i2c_port));
+		tStart = ReadCoreTimer();
+		while (!I2CReceivedDataIsAvailable(i2c_port)) {
+			if (WaitExpired(tStart)) return I2C_ERROR;
+		}
 		// The ACK paramater determines whether or not the EERPOM read was acknowledged
 		I2CAcknowledgeByte(i2c_port, ack);
-		while (!I2CAcknowledgeHasCompleted(i2c_port));
+		tStart = ReadCoreTimer();
+		while (!I2CAcknowledgeHasCompleted(i2c_port)) {
+			if (WaitExpired(tStart)) return I2C_ERROR;
+		}
 		// Read the received data byte
 		*data = I2CGetByte(i2c_port);
+		I2C_TRACE_EVENT(I2C_EV_RX, *data);
 	}
     
 	return i2c_result;
@@ -283,10 +747,12 @@ static I2C_RESULT ReceiveOneByte(I2C_MODULE i2c_port, BYTE *data, BOOL ack) {
     TRUE  : Successful transfer initiated
     FALSE : Unsuccessful transfer was initiated
  @ Notes
- 	This function utilizes a blocking I2C routine
+ 	This function utilizes a blocking I2C routine, bounded by the profile
+ 	timeout of the device being addressed
   ---------------------------------------------------------------------------- */
 static BOOL StartTransfer(I2C_MODULE i2c_port, BOOL restart) {
 	I2C_STATUS  status;
+	unsigned int tStart = ReadCoreTimer();
 
 	/* ------------------- Initialize a I2C Sequence Start ------------------- */
 	if (restart) {
@@ -294,7 +760,12 @@ static BOOL StartTransfer(I2C_MODULE i2c_port, BOOL restart) {
 	}
 	else {
 		// Wait for the bus to be free
-		while (!I2CBusIsIdle(i2c_port));
+		while (!I2CBusIsIdle(i2c_port)) {
+			if (WaitExpired(tStart)) {
+				printf("Error: I2C bus never went idle\n");
+				return FALSE;
+			}
+		}
 
 		if (I2CStart(i2c_port) != I2C_SUCCESS) {
 			printf("Error: Bus collision during transfer Start\n");
@@ -303,10 +774,17 @@ static BOOL StartTransfer(I2C_MODULE i2c_port, BOOL restart) {
 	}
 
 	// Wait for the START or REPEAT START to finish
+	tStart = ReadCoreTimer();
 	do {
 		status = I2CGetStatus(i2c_port);
+		if (WaitExpired(tStart)) return FALSE;
 	} while (!(status & I2C_START));
 
+#ifdef I2C_TRACE
+	if (!restart) traceStartTick = ReadCoreTimer();
+#endif
+	I2C_TRACE_EVENT(restart ? I2C_EV_RESTART : I2C_EV_START, 0);
+
 	return TRUE;
 }
 
@@ -319,18 +797,27 @@ static BOOL StartTransfer(I2C_MODULE i2c_port, BOOL restart) {
     None
  @ Notes
  	This function only works if a transfer has been initialized / started.
- 	This is also implemented with a blocking I2C routine
+ 	This is also implemented with a blocking I2C routine, bounded by the
+ 	profile timeout
   ---------------------------------------------------------------------------- */
 static void StopTransfer( I2C_MODULE i2c_port) {
 	I2C_STATUS  i2c_status;
+	unsigned int tStart;
 
 	// Send the STOP sequence
 	I2CStop(i2c_port);
 
 	// Wait for the STOP sequence to finish
+	tStart = ReadCoreTimer();
 	do {
 		i2c_status = I2CGetStatus(i2c_port);
+		if (WaitExpired(tStart)) return;
 	} while (!(i2c_status & I2C_STOP));
+
+#ifdef I2C_TRACE
+	TraceTransfer();
+#endif
+	I2C_TRACE_EVENT(I2C_EV_STOP, 0);
 }
 
 /* -------------------------------- calc_ck_sum ------------------------------
@@ -395,6 +882,7 @@ I2C_RESULT I2C_WriteDev( I2C_DATA_BLOCK blk)
 
 	i2c_ops = I2C_SUCCESS;
 	data_ptr = blk.data;    // Set up pointer to data array
+	BeginTransaction(blk.i2c_channel, blk.dev_id);
 
 	I2C_FORMAT_7_BIT_ADDRESS(SlaveAddress, blk.dev_id, I2C_WRITE);
 
@@ -447,6 +935,7 @@ I2C_RESULT I2C_WriteDev( I2C_DATA_BLOCK blk)
 		StopTransfer(blk.i2c_channel);
 	}
 	else i2c_ops = I2C_ERROR;   // I2C not started 
+	ReleaseBus(blk.i2c_channel);
 
 	return i2c_ops;
 }
@@ -488,6 +977,7 @@ I2C_RESULT I2C_ReadDev(I2C_DATA_BLOCK  blk)
 	I2C_RESULT i2c_ops = I2C_SUCCESS;     /* Status of I2C action */
 
 										  /* Send device ID with R/W bit set high */
+	BeginTransaction(blk.i2c_channel, blk.dev_id);
 	I2C_FORMAT_7_BIT_ADDRESS(SlaveAddress, blk.dev_id, I2C_READ);
 	i2c_started = StartTransfer(blk.i2c_channel, FALSE); /* Repeated start */
 	if (i2c_started)
@@ -520,9 +1010,441 @@ I2C_RESULT I2C_ReadDev(I2C_DATA_BLOCK  blk)
 		i2c_ops |= ReceiveOneByte(blk.i2c_channel, data_ptr, FALSE);
 	}
 	StopTransfer(blk.i2c_channel); /* Terminate the EEPROM transfer */
+	ReleaseBus(blk.i2c_channel);
 	return i2c_ops;
 }
 
+/* ---------------------------- I2C_WriteReadAsync ---------------------------
+ @ Summary
+    Starts a register block read (same bus sequence as I2C_WriteRead) that
+    runs from the I2C1 master interrupt instead of blocking
+ @ Parameters
+    @ param1 : Request describing the device, register, buffer and length.
+               It must stay valid until its done() function has been called.
+ @ Return Value
+    I2C_RESULT : I2C_ERROR if the request is already queued or
+                 I2C_ASYNC_QUEUE requests are already waiting for the bus
+ @ Notes
+    Safe to call from an interrupt. If a blocking transaction owns the bus
+    the request is held and started as soon as that transaction ends. Only
+    I2C1 is supported. The device's profile speed is applied. Its timeout
+    applies to each bus event and is enforced by I2C_AsyncWatchdog, or by
+    the next blocking transaction that needs the bus if that comes first.
+    With read_only set the register phase is skipped and the device is
+    simply read, as for a byte stream like the GPS.
+  ---------------------------------------------------------------------------- */
+I2C_RESULT I2C_WriteReadAsync(I2C_ASYNC_REQ *req) {
+	I2C_RESULT i2c_result = I2C_SUCCESS;
+	unsigned int intStatus;
+
+	intStatus = INTDisableInterrupts();
+	if (req->busy) {
+		i2c_result = I2C_ERROR;
+	}
+	else if (busOwned || (asyncActive != NULL)) {
+		if (QueuePush(req)) {
+			req->busy = TRUE;
+		}
+		else {
+			i2c_result = I2C_ERROR;
+		}
+	}
+	else {
+		req->busy = TRUE;
+		AsyncStart(req);
+	}
+	INTRestoreInterrupts(intStatus);
+
+	return i2c_result;
+}
+
+/* -------------------------------- AsyncStart -------------------------------
+ @ Summary
+    Issues the START of a background transfer
+ @ Parameters
+    @ param1 : Request to start
+ @ Return Value
+    None
+ @ Notes
+    Called with interrupts disabled (or from the I2C ISR) while the bus is
+    free. The rest of the transfer is sequenced by I2C1Handler.
+  ---------------------------------------------------------------------------- */
+static void AsyncStart(I2C_ASYNC_REQ *req) {
+	const I2C_DEV_PROFILE *profile = FindProfile(I2C1, req->dev_id);
+
+	ApplySpeed(I2C1, profile);
+#ifdef I2C_TRACE
+	TraceDevice(I2C1, profile, req->dev_id);
+#endif
+
+	asyncActive = req;
+	req->result = I2C_SUCCESS;
+	asyncIndex = 0;
+	asyncState = ASYNC_START;
+	asyncWaitTicks = (CORE_MS_TICK_RATE * profile->timeout_us) / 1000;
+	asyncTick = ReadCoreTimer();
+
+	// Bus collisions share the I2C1 vector with the master events. A BCL
+	// left over from an earlier transfer would end this one at once.
+	I2CClearStatus(I2C1, I2C_ARBITRATION_LOSS);
+	INTClearFlag(INT_SOURCE_I2C_MASTER(I2C1));
+	INTClearFlag(INT_I2C1B);
+	INTSetVectorPriority(INT_VECTOR_I2C(I2C1), I2C_ASYNC_PRIORITY);
+	INTEnable(INT_SOURCE_I2C_MASTER(I2C1), INT_ENABLED);
+	INTEnable(INT_I2C1B, INT_ENABLED);
+
+	if (I2CStart(I2C1) != I2C_SUCCESS) {
+		req->result = I2C_ERROR;
+		AsyncFinish();
+	}
+}
+
+/* ------------------------------- AsyncFinish -------------------------------
+ @ Summary
+    Completes the active background transfer and starts the next one
+ @ Parameters
+    None
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+static void AsyncFinish(void) {
+	I2C_ASYNC_REQ *req = asyncActive;
+	I2C_ASYNC_REQ *next;
+
+	INTEnable(INT_SOURCE_I2C_MASTER(I2C1), INT_DISABLED);
+	INTEnable(INT_I2C1B, INT_DISABLED);
+	asyncActive = NULL;
+	asyncState = ASYNC_IDLE;
+	if (req->result != I2C_SUCCESS) {
+#ifdef I2C_TRACE
+		traceDev->errors++;
+#endif
+		I2C_TRACE_EVENT(I2C_EV_ERROR, 0);
+	}
+	req->busy = FALSE;
+	if (req->done != NULL) {
+		req->done(req);
+	}
+
+	// A request queued behind this one gets the bus unless the main loop has it
+	if (!busOwned && (asyncActive == NULL)) {
+		next = QueuePop();
+		if (next != NULL) {
+			AsyncStart(next);
+		}
+	}
+}
+
+/* ------------------------------- AsyncAbandon ------------------------------
+ @ Summary
+    Takes the background transfer off the bus without finishing it
+ @ Parameters
+    None
+ @ Return Value
+    I2C_ASYNC_REQ* : The abandoned request, to be handed to AsyncFail
+ @ Notes
+    Called with interrupts disabled and a transfer in flight.
+  ---------------------------------------------------------------------------- */
+static I2C_ASYNC_REQ *AsyncAbandon(void) {
+	I2C_ASYNC_REQ *stuck = asyncActive;
+
+	INTEnable(INT_SOURCE_I2C_MASTER(I2C1), INT_DISABLED);
+	INTEnable(INT_I2C1B, INT_DISABLED);
+	asyncActive = NULL;
+	asyncState = ASYNC_IDLE;
+	return stuck;
+}
+
+/* -------------------------------- AsyncFail --------------------------------
+ @ Summary
+    Recovers the bus after an abandoned background transfer and tells its
+    requester it failed
+ @ Parameters
+    @ param1 : Request returned by AsyncAbandon
+ @ Return Value
+    None
+ @ Notes
+    The caller must own the bus, so nothing is started on it while it is
+    being recovered. done() is called from the caller's context.
+  ---------------------------------------------------------------------------- */
+static void AsyncFail(I2C_ASYNC_REQ *stuck) {
+	printf("I2C background read of 0x%02X timed out\n\r", stuck->dev_id);
+#ifdef I2C_TRACE
+	traceDev->errors++;
+	traceDev->timeouts++;
+#endif
+	I2C_TRACE_EVENT(I2C_EV_TIMEOUT, 0);
+	I2C_BusRecover(I2C1);
+	stuck->result = I2C_ERROR;
+	stuck->busy = FALSE;
+	if (stuck->done != NULL) {
+		stuck->done(stuck);
+	}
+}
+
+/* ---------------------------- I2C_AsyncWatchdog ----------------------------
+ @ Summary
+    Abandons a background transfer that has stopped making progress
+ @ Parameters
+    None
+ @ Return Value
+    BOOL : TRUE if a transfer was abandoned during this call
+ @ Notes
+    Each interrupt of a background transfer restamps it. One that goes
+    longer than its device's profile timeout without a bus event (a lost
+    interrupt, or a slave holding SCL) is taken off the bus, the bus is
+    recovered, its done() is called with I2C_ERROR, and the next queued
+    request is started. Call every main loop pass; GPS_service and
+    MAG3110_getSample do.
+  ---------------------------------------------------------------------------- */
+BOOL I2C_AsyncWatchdog(void) {
+	unsigned int intStatus;
+	I2C_ASYNC_REQ *stuck = NULL;
+
+	intStatus = INTDisableInterrupts();
+	if ((asyncActive != NULL) && ((ReadCoreTimer() - asyncTick) >= asyncWaitTicks)) {
+		stuck = AsyncAbandon();
+		busOwned = TRUE;		// Keep new requests queued during the recovery
+	}
+	INTRestoreInterrupts(intStatus);
+
+	if (stuck == NULL) {
+		return FALSE;
+	}
+	AsyncFail(stuck);
+	ReleaseBus(I2C1);
+	return TRUE;
+}
+
+/* ------------------------------- I2C1Handler -------------------------------
+ @ Summary
+    Steps a background transfer through START, address+W, register,
+    repeated START, address+R, data bytes and STOP, one bus event per
+    interrupt
+ @ Parameters
+    None, it is an ISR
+ @ Returns
+    None
+ @ Notes
+    A missing ACK ends the transfer with a STOP and an I2C_ERROR result.
+    A bus collision (BCL) ends it with I2C_ERROR straight away: the module
+    has already let go of the bus, so there is no STOP to send.
+  ---------------------------------------------------------------------------- */
+void __ISR(_I2C_1_VECTOR, IPL3SOFT) I2C1Handler(void) {
+	I2C_ASYNC_REQ *req = asyncActive;
+	I2C_7_BIT_ADDRESS SlaveAddress;
+
+	INTClearFlag(INT_SOURCE_I2C_MASTER(I2C1));
+	if (I2CGetStatus(I2C1) & I2C_ARBITRATION_LOSS) {
+		I2CClearStatus(I2C1, I2C_ARBITRATION_LOSS);
+		INTClearFlag(INT_I2C1B);
+		if (req != NULL) {
+			req->result = I2C_ERROR;
+			AsyncFinish();
+		}
+		return;
+	}
+	if (req == NULL) {
+		return;
+	}
+	asyncTick = ReadCoreTimer();
+
+	switch (asyncState) {
+		case ASYNC_START:		// START done, address the device for writing
+#ifdef I2C_TRACE
+			traceStartTick = ReadCoreTimer();
+#endif
+			I2C_TRACE_EVENT(I2C_EV_START, 0);
+			if (req->read_only) {
+				I2C_FORMAT_7_BIT_ADDRESS(SlaveAddress, req->dev_id, I2C_READ);
+				I2C_TRACE_EVENT(I2C_EV_TX, SlaveAddress.byte);
+				I2CSendByte(I2C1, SlaveAddress.byte);
+				asyncState = ASYNC_ADDR_R;
+				break;
+			}
+			I2C_FORMAT_7_BIT_ADDRESS(SlaveAddress, req->dev_id, I2C_WRITE);
+			I2C_TRACE_EVENT(I2C_EV_TX, SlaveAddress.byte);
+			I2CSendByte(I2C1, SlaveAddress.byte);
+			asyncState = ASYNC_ADDR_W;
+			break;
+		case ASYNC_ADDR_W:		// Address sent, set the register pointer
+			if (!I2CByteWasAcknowledged(I2C1)) {
+				req->result = I2C_ERROR;
+				I2CStop(I2C1);
+				asyncState = ASYNC_STOP;
+				break;
+			}
+			I2C_TRACE_EVENT(I2C_EV_TX, req->reg_addr);
+			I2CSendByte(I2C1, req->reg_addr);
+			asyncState = ASYNC_REG;
+			break;
+		case ASYNC_REG:			// Register sent, turn the bus around
+			if (!I2CByteWasAcknowledged(I2C1)) {
+				req->result = I2C_ERROR;
+				I2CStop(I2C1);
+				asyncState = ASYNC_STOP;
+				break;
+			}
+			I2CRepeatStart(I2C1);
+			asyncState = ASYNC_RESTART;
+			break;
+		case ASYNC_RESTART:		// Repeated START done, address for reading
+			I2C_TRACE_EVENT(I2C_EV_RESTART, 0);
+			I2C_FORMAT_7_BIT_ADDRESS(SlaveAddress, req->dev_id, I2C_READ);
+			I2C_TRACE_EVENT(I2C_EV_TX, SlaveAddress.byte);
+			I2CSendByte(I2C1, SlaveAddress.byte);
+			asyncState = ASYNC_ADDR_R;
+			break;
+		case ASYNC_ADDR_R:		// Address sent, clock in the first byte
+			if (!I2CByteWasAcknowledged(I2C1)) {
+				req->result = I2C_ERROR;
+				I2CStop(I2C1);
+				asyncState = ASYNC_STOP;
+				break;
+			}
+			I2CReceiverEnable(I2C1, TRUE);
+			asyncState = ASYNC_RECV;
+			break;
+		case ASYNC_RECV:		// Byte in, ACK all but the last one
+			req->data[asyncIndex] = I2CGetByte(I2C1);
+			I2C_TRACE_EVENT(I2C_EV_RX, req->data[asyncIndex]);
+			asyncIndex++;
+			I2CAcknowledgeByte(I2C1, asyncIndex < req->len);
+			asyncState = ASYNC_ACK;
+			break;
+		case ASYNC_ACK:			// ACK/NACK sent, next byte or STOP
+			if (asyncIndex < req->len) {
+				I2CReceiverEnable(I2C1, TRUE);
+				asyncState = ASYNC_RECV;
+			}
+			else {
+				I2CStop(I2C1);
+				asyncState = ASYNC_STOP;
+			}
+			break;
+		case ASYNC_STOP:		// STOP done, hand the result back
+#ifdef I2C_TRACE
+			TraceTransfer();
+#endif
+			I2C_TRACE_EVENT(I2C_EV_STOP, 0);
+			AsyncFinish();
+			break;
+		default:
+			AsyncFinish();
+	}
+}
+
+#ifdef I2C_TRACE
+/* ------------------------------- TraceDevice -------------------------------
+ @ Summary
+    Points the trace statistics at the device a transfer is about to talk to
+ @ Parameters
+    @ param1 : Which I2C port the transfer is on, I2C1 or I2C2
+    @ param2 : Profile in effect for the device
+    @ param3 : Device address
+ @ Return Value
+    None
+ @ Notes
+    Blocking and background transfers never hold the bus together, so one
+    pointer serves both.
+  ---------------------------------------------------------------------------- */
+static void TraceDevice(I2C_MODULE i2c_port, const I2C_DEV_PROFILE *profile, BYTE DeviceAddress) {
+	traceDev = &traceStats[(profile == &defaultProfile[i2c_port]) ? I2C_MAX_PROFILES : (profile - profiles)];
+	traceDev->dev_id = DeviceAddress;
+}
+
+/* ------------------------------ TraceTransfer ------------------------------
+ @ Summary
+    Adds a completed START to STOP sequence to the device's statistics
+ @ Parameters
+    None
+ @ Return Value
+    None
+  ---------------------------------------------------------------------------- */
+static void TraceTransfer(void) {
+	unsigned int us = (ReadCoreTimer() - traceStartTick) / (CORE_MS_TICK_RATE / 1000);
+	unsigned int edge = I2C_HIST_BASE_US;
+	int bin = 0;
+
+	// Bins double in width: <25us, <50us, <100us ... last bin is open ended
+	while ((us >= edge) && (bin < I2C_HIST_BINS - 1)) {
+		edge <<= 1;
+		bin++;
+	}
+	traceDev->hist[bin]++;
+	traceDev->transfers++;
+	if (us > traceDev->max_us) traceDev->max_us = us;
+}
+
+/* ------------------------------ I2C_TraceEvent -----------------------------
+ @ Summary
+    Records one bus event in the trace ring
+ @ Parameters
+    @ param1 : I2C_EV_xxx event code
+    @ param2 : Event specific data byte
+ @ Return Value
+    None
+ @ Notes
+    The first byte sent after a START or repeated START is logged as the
+    address byte. The ring overwrites its oldest entry when full. Background
+    transfers are logged from I2C1Handler; they never hold the bus at the
+    same time as a blocking transaction, so the two never log at once.
+  ---------------------------------------------------------------------------- */
+void I2C_TraceEvent(BYTE event, BYTE data) {
+	I2C_TRACE_ENTRY *entry = &traceRing[traceHead & (I2C_TRACE_DEPTH - 1)];
+
+	if ((event == I2C_EV_TX) &&
+		((traceLastEvent == I2C_EV_START) || (traceLastEvent == I2C_EV_RESTART))) {
+		event = I2C_EV_ADDR;
+	}
+	entry->tick = ReadCoreTimer();
+	entry->event = event;
+	entry->dev_id = traceDev->dev_id;
+	entry->data = data;
+	traceLastEvent = event;
+	traceHead++;
+}
+
+/* ------------------------------ I2C_TraceDump ------------------------------
+ @ Summary
+    Prints the trace ring and per-device statistics to the monitor UART
+ @ Parameters
+    None
+ @ Return Value
+    None
+ @ Notes
+    Output is one comma separated record per line so i2c_trace_decode.py can
+    read it back on the PC:
+      I2CT,<core tick>,<event>,<device>,<data>
+      I2CH,<device>,<transfers>,<errors>,<timeouts>,<max us>,<bin 0>..<bin 7>
+  ---------------------------------------------------------------------------- */
+void I2C_TraceDump(void) {
+	unsigned int idx;
+	unsigned int first;
+	int dev, bin;
+	I2C_TRACE_ENTRY *entry;
+
+	first = (traceHead > I2C_TRACE_DEPTH) ? (traceHead - I2C_TRACE_DEPTH) : 0;
+	printf("I2CB,%u,%u\n\r", CORE_MS_TICK_RATE, traceHead - first);
+	for (idx = first; idx < traceHead; idx++) {
+		entry = &traceRing[idx & (I2C_TRACE_DEPTH - 1)];
+		printf("I2CT,%u,%d,%d,%d\n\r", entry->tick, entry->event, entry->dev_id, entry->data);
+	}
+
+	for (dev = 0; dev <= I2C_MAX_PROFILES; dev++) {
+		if (traceStats[dev].transfers || traceStats[dev].errors) {
+			printf("I2CH,%d,%u,%u,%u,%u", traceStats[dev].dev_id, traceStats[dev].transfers,
+				   traceStats[dev].errors, traceStats[dev].timeouts, traceStats[dev].max_us);
+			for (bin = 0; bin < I2C_HIST_BINS; bin++) {
+				printf(",%u", traceStats[dev].hist[bin]);
+			}
+			printf("\n\r");
+		}
+	}
+	printf("I2CE\n\r");
+}
+#endif
+
 // 
 // i2c_ackError()
 // Simple error message for failure
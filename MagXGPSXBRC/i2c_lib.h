@@ -15,14 +15,81 @@ typedef struct {
 	BYTE *data;			 // Byte pointer to data array
 } I2C_DATA_BLOCK;
 
+/* ------------------ Per-device bus settings (profiles) ----------------- */
+typedef struct {
+	I2C_MODULE i2c_channel; // I2C channel ? I2C1 or I2C2
+	BYTE dev_id;			// I2C device ID the profile applies to
+	int speed;			  // Bus clock used while talking to the device
+	unsigned int timeout_us; // Longest wait allowed for any one bus event
+	int retries;			// Extra attempts after a failed transaction
+} I2C_DEV_PROFILE;
+
+/* ---------- Register block read that completes in the background ------- */
+typedef struct I2C_ASYNC_REQ {
+	BYTE dev_id;			// I2C device ID
+	BYTE reg_addr;		  // Address of register to start
+	BOOL read_only;		 // Skip the register phase, plain read of a stream
+	BYTE *data;			 // Byte pointer to data array
+	int len;				// Number of bytes to read
+	void (*done)(struct I2C_ASYNC_REQ *req);	// Called from the I2C interrupt
+	volatile I2C_RESULT result;	// Outcome, valid once done() is called
+	volatile BOOL busy;		// Queued or in flight
+} I2C_ASYNC_REQ;
+
 /* ----------------- Public Global Variables / Constants ----------------- */
 #define I2C_SPEED_STANDARD		100000
 #define I2C_SPEED_FAST			400000
 
+#define I2C_MAX_PROFILES		4		// Devices that can have their own profile
+#define I2C_DEFAULT_TIMEOUT_US	1000	// Used for devices without a profile
+#define I2C_RECOVERY_CLOCKS		9		// SCL pulses to free a stuck slave
+#define I2C_ASYNC_PRIORITY		INT_PRIORITY_LEVEL_3	// I2C1 master interrupt level
+#define I2C_ASYNC_QUEUE			4		// Background requests that can wait for the bus
+
+/* ------- I2C1 pins, driven as GPIO only while recovering the bus -------- */
+#define I2C1_SCL_TRIS			TRISGbits.TRISG2
+#define I2C1_SCL_LAT			LATGbits.LATG2
+#define I2C1_SCL_ODC			ODCGbits.ODCG2
+#define I2C1_SDA_TRIS			TRISGbits.TRISG3
+#define I2C1_SDA_LAT			LATGbits.LATG3
+#define I2C1_SDA_ODC			ODCGbits.ODCG3
+#define I2C1_SDA_PORT			PORTGbits.RG3
+
+/* ----------------------- Optional transaction tracer -------------------- */
+/* Define I2C_TRACE (here or in the project's preprocessor macros) to record
+   bus events with core timer stamps. Without it the hooks compile to nothing */
+//#define I2C_TRACE
+#define I2C_TRACE_DEPTH			64		// Events kept in the ring, power of 2
+#define I2C_HIST_BINS			8		// Latency bins, 25us doubling per bin
+#define I2C_HIST_BASE_US		25		// Upper edge of the first latency bin
+
+#define I2C_EV_START			1		// START sent, data = 0
+#define I2C_EV_RESTART			2		// Repeated START sent, data = 0
+#define I2C_EV_ADDR				3		// Address byte sent, data = address + R/W
+#define I2C_EV_TX				4		// Data byte sent, data = byte
+#define I2C_EV_RX				5		// Data byte received, data = byte
+#define I2C_EV_STOP				6		// STOP complete, data = 0
+#define I2C_EV_ERROR			7		// Transaction failed, data = attempt
+#define I2C_EV_TIMEOUT			8		// Bus wait expired, data = 0
+
+#ifdef I2C_TRACE
+	#define I2C_TRACE_EVENT(ev, data)	I2C_TraceEvent((ev), (data))
+	void I2C_TraceEvent(BYTE event, BYTE data);
+	void I2C_TraceDump(void);
+#else
+	#define I2C_TRACE_EVENT(ev, data)
+	#define I2C_TraceDump()
+#endif
+
 // Function Prototypes
 I2C_RESULT I2C_Init(I2C_MODULE i2c_port,  int speed);
+I2C_RESULT I2C_SetProfile(I2C_MODULE i2c_port, BYTE dev_id, int speed, unsigned int timeout_us, int retries);
+I2C_RESULT I2C_BusRecover(I2C_MODULE i2c_port);
+I2C_RESULT I2C_Write(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE *str, int *len);
 I2C_RESULT I2C_Read(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE *str, int *len);
-I2C_RESULT I2CReadRegs(I2C_MODULE i2c_port, BYTE DeviceAddress, int reg_addr, BYTE *i2cData, int len);
+I2C_RESULT I2C_WriteRead(I2C_MODULE i2c_port, BYTE DeviceAddress, BYTE reg_addr, BYTE *i2cData, int len);
+I2C_RESULT I2C_WriteReadAsync(I2C_ASYNC_REQ *req);
+BOOL I2C_AsyncWatchdog(void);
 I2C_RESULT I2C_WriteDev( I2C_DATA_BLOCK blk);
 I2C_RESULT I2C_ReadDev( I2C_DATA_BLOCK  blk);
 void i2c_ackError(int loc);
@@ -26,10 +26,25 @@
 #include "DMA_UART2.h"
 #include "MAG3110.h"
 #include "Stepper.h"
+#include "MMA8652.h"
+#include "MagFilter.h"
+#include "HeadingFusion.h"
+#include "DeadReckon.h"
+#include "Clock.h"
+#include "Navigate.h"
+#include "Geofence.h"
+#include "HeadingHold.h"
+#include "Cruise.h"
+#include "Mission.h"
+#include "Command.h"
+#include "Mode.h"
+#include "Link.h"
 
 #define RC_CW   0   // RC Direction of rotation
 #define RC_CCW  1
 
+#define MAG_STALL_WINDOWS  5    // Display windows with no mag sample before it counts as stalled
+
 char GetMsg(char Char) { return Char;}
 int InitializeModules(I2C_RESULT* I2cResultFlag);
 void print_pretty_table(int use_uart);
@@ -37,6 +52,7 @@ I2C_RESULT InitMag();
 
 // Global variables
 static char Char;
+static const MAGFILTER_CONFIG magFilterConfig = MAGFILTER_DEFAULT_CONFIG;
 int gps_message = 0;        // Active GPS sentence 
 extern int16_t led_value;
 extern BOOL led_flag;
@@ -49,19 +65,35 @@ int main(void)
 	I2C_RESULT I2cResultFlag;   // I2C Init Result flag
     I2C_RESULT I2cReadFlag;   // I2C Init Result flag
     int16_t x, y, z;
-	unsigned GPSInterval = 1000;
 	unsigned MagInterval = 60;
 	unsigned ADCTemperatureInterval = 60000;
 	unsigned MovementInterval = 20;
-	unsigned ActualGPSInterval = GPSInterval;
-	unsigned GPSIntervalMark = 0;
 	unsigned MagIntervalMark = 0;
 	unsigned ADCIntervalMark = 0;
 	unsigned MovementIntervalMark = 0;
 	unsigned ActualMagInterval = MagInterval;
 	unsigned ActualADCInterval = ADCTemperatureInterval;
 	unsigned ActualMovementInterval = MovementInterval;
-    float heading = 0;
+	unsigned FusionIntervalMark = 0;
+	unsigned SteerIntervalMark = 0;
+	unsigned CruiseIntervalMark = 0;
+	unsigned GpsIntervalMark = 0;
+	unsigned RampIntervalMark = 0;
+    int32_t heading = 0;        // Centidegrees
+    int32_t headingRate = 0;    // Centidegrees per second
+    int32_t hx, hy;
+	MAG3110_SAMPLE magSample;
+	BOOL magFresh = FALSE;
+	unsigned magErrors = 0;         // MAG3110_getErrors() at the last display window
+	unsigned magEmptyWindows = 0;   // Display windows in a row without a sample
+    int32_t fusedHeading = 0;   // Centidegrees, mag corrected by GPS course
+    int headingConfidence = 0;  // 0-100
+    int32_t drLat, drLon;       // Position between fixes, 1e-7 degree
+    BOOL drValid = FALSE;
+    uint32_t utcMs = 0;         // UTC ms of day, 0 until the GPS has given the time
+    NAV_OUTPUT navOut = { 0, 0, 0, -1, FALSE };   // Heading and speed setpoints for the active waypoint
+    GEO_STATUS fence = { TRUE, INT32_MAX, GEO_NO_LIMIT, FALSE };  // Where the last fix was against the geofence
+    BOOL fenceHeld = FALSE;     // Last fix was outside the fence
 
 	// Init. the DMA flag
 	DmaIntFlag = 0;
@@ -76,6 +108,12 @@ int main(void)
 	SetDefaultServoPosition();
 
     MAG3110_EnvCalibrate();
+    MagFilter_configure(&magFilterConfig);     // Drop samples from before calibration
+    HeadingFusion_reset();
+    Cruise_reset();
+    Mission_init();                            // Find the stored route, navigation waits for MG
+    Mode_init();                               // Manual until Start or MG
+    Link_reset();                              // Supervised from the first gamepad frame
     
 	while (1)  // Forever process loop	
 	{
@@ -84,8 +122,7 @@ int main(void)
 			DmaIntFlag = 0;                       // Reset DMA Rx block flag
 			printf("message received %s\n", dmaBuff);
 			DmaUartRx();
-			HandleInput();						// Handles all user input from the XB device
-			putsU2("A");
+			Command_dispatch(dmaBuff);			// Mission commands and gamepad input from the XB device
 		}
 
 		if (SW0())
@@ -93,48 +130,120 @@ int main(void)
 			SetDefaultServoPosition();
 		}
 
-		// GPS receives data
-		if ((millisec - GPSIntervalMark) >= GPSInterval)
+		// No frame for the timeout drops the gamepad modes to failsafe
+		Link_check(millisec);
+		GamepadEvents();						// Centering posted by the change notice interrupt
+
+		// Each job below runs at the period its mode's task table gives it
+
+		// GPS streams in over background reads, each new fix corrects the heading
+		if (Mode_due(MODE_TASK_GPS, GPS_CHUNK_MS, &GpsIntervalMark) && GPS_service())
 		{
-			//I2cReadFlag = ReportGPS(TRUE);	
-			//GPSIntervalMark = millisec;
+			if (gps.status == 'A')
+			{
+				HeadingFusion_gps(gps.angle, gps.speed, millisec);
+				DeadReckon_fix(&gps, millisec);
+				Clock_gpsTime(gps.utc_time, gps.utc_ms, gps.date);
+				Geofence_check(gps.lat, gps.lon, &fence);
+				if (fence.hold && !fenceHeld)
+					Mode_event(MODE_EV_FENCE);	// The clamp below only reaches autonomous
+				fenceHeld = fence.hold;
+				Cruise_fix(GPS_MMPS(gps.speed), millisec);
+			}
 		}
 
 		// GPS receives data
-		if ((millisec - MovementIntervalMark) >= MovementInterval)
+		if (Mode_due(MODE_TASK_GAMEPAD, MovementInterval, &MovementIntervalMark))
 		{
 			Move();								// Read from the GPS and display to the screen
-			MovementIntervalMark = millisec;
 		}
 
         
+		// Finish any sensor rate change, one step per pass
+		MAG3110_service();
+
+		// Mag samples arrive on data ready, every one goes through the filter
+		while (MAG3110_getSample(&magSample))
+		{
+			x = magSample.x;
+			y = magSample.y;
+			z = magSample.z;
+			MAG3110_sampleVector(&magSample, &hx, &hy);
+			MagFilter_add(hx, hy, magSample.stamp);
+			magFresh = TRUE;
+		}
+
+		// Fuse at a fixed rate so the GPS correction gain does not depend on loop load
+		if (Mode_due(MODE_TASK_FUSION, FUSION_RATE_MS, &FusionIntervalMark))
+		{
+			if (MagFilter_heading(&heading))
+			{
+				MagFilter_rate(&headingRate);
+				HeadingFusion_update(heading, headingRate, millisec);
+				MAG3110_adaptRate(headingRate);		// Faster sampling while turning
+			}
+			fusedHeading = HeadingFusion_heading(&headingConfidence);
+			DeadReckon_update(fusedHeading, millisec);
+			drValid = DeadReckon_position(&drLat, &drLon);
+			if (drValid)
+				Navigate_update(drLat, drLon, &navOut);
+			if (navOut.speed > fence.speedLimit)
+				navOut.speed = fence.speedLimit;	// Slow near the fence, hold outside it
+			Mode_update(drValid, &navOut);		// Route done or position lost
+		}
+
+		// Heading hold on its own fixed period, to the waypoint or the trimmed hold heading
+		if (Mode_due(MODE_TASK_STEER, HeadingHold_rate(), &SteerIntervalMark))
+		{
+			Mode_steer(fusedHeading, &navOut);
+			HeadingHold_update(fusedHeading, headingRate, millisec);
+		}
+
+		// Cruise control, speed from the fixes and predicted between them
+		if (Mode_due(MODE_TASK_CRUISE, CRUISE_RATE_MS, &CruiseIntervalMark))
+		{
+			if (Mode_current() == MODE_AUTONOMOUS)
+				Cruise_set(GPS_MMPS(navOut.speed));
+			Cruise_update();
+		}
+
+		// Failsafe brings the throttle and rudder back a step at a time
+		if (Mode_due(MODE_TASK_RAMP, MODE_RAMP_MS, &RampIntervalMark))
+		{
+			Mode_ramp();
+		}
+
 		// Mag receives data
-		if ((millisec - MagIntervalMark) >= MagInterval)
+		if (Mode_due(MODE_TASK_DISPLAY, MagInterval, &MagIntervalMark))
 		{
-           I2cResultFlag = MAG3110_readMag(&x,&y,&z);
-            
-           if(I2cResultFlag == I2C_SUCCESS)
+           if(MAG3110_getErrors() != magErrors)
            {
-                MAG3110_readHeading(&heading);
-                if(heading < 0) heading += 360;
-                if(heading >= 360) heading -= 360;
+               magErrors = MAG3110_getErrors();
+               printf("Readmag error\n");
+               I2C_TraceDump();    // Bus history, only when built with I2C_TRACE
+           }
+           if(magFresh)
+           {
+                magFresh = FALSE;
+                magEmptyWindows = 0;
                 clrLCD();
-                printf("%f,%d,%d,%d\n\r", heading, x, y, z);  
+                Clock_toUtc(Clock_widen(magSample.stamp), &utcMs, NULL);	// When x, y, z were sampled
+                printf("%d.%02d,%d,%d,%d,%d,%d.%02d,%d,%u\n\r", heading / 100, heading % 100, x, y, z, headingRate,
+                       fusedHeading / 100, fusedHeading % 100, headingConfidence, utcMs);  
            }
-           else
+           else if(++magEmptyWindows == MAG_STALL_WINDOWS)
            {
-               printf("Readmag error\n");
+               // A rate change can skip a window or two, this many means no data ready
+               printf("Readmag stalled\n");
+               I2C_TraceDump();
            }
-                     
-			MagIntervalMark = millisec;
 		}
          
 
 		// Get data from the ADC temperature sensors
-		if ((millisec - ADCIntervalMark) >= ADCTemperatureInterval)
+		if (Mode_due(MODE_TASK_TEMP, ADCTemperatureInterval, &ADCIntervalMark))
 		{
 			read_temperature_store();			// Reads in the temperature
-			ADCIntervalMark = millisec;
 		}
 
 	}
@@ -188,7 +297,12 @@ int InitializeModules(I2C_RESULT* I2cResultFlag)
 	led_flag = 1;						// Enable 4 digit 7 segment LED display
     int16_t x,y,z;
     
-    *I2cResultFlag = I2C_Init(I2C1, 100000);
+    *I2cResultFlag = I2C_Init(I2C1, I2C_SPEED_STANDARD);
+    // The sensors support fast mode, each gets its own timeout and retries
+    I2C_SetProfile(I2C1, MAG3110_I2C_ADDRESS, I2C_SPEED_FAST, 500, 2);
+    I2C_SetProfile(I2C1, GPS_DEV_ID, I2C_SPEED_FAST, 2000, 1);
+    I2C_SetProfile(I2C1, MMA8652_I2C_ADDRESS, I2C_SPEED_FAST, 500, 2);
+    Clock_init();
     initChangeNotice();
     stepper_init();
     
@@ -197,10 +311,16 @@ int InitializeModules(I2C_RESULT* I2cResultFlag)
      {
          printf("MAG3110 failed to init");
      }
+    // Accelerometer for tilt compensation, heading still works without it
+    if(!MMA8652_initialize())
+    {
+        printf("MMA8652 failed to init, no tilt compensation\n\r");
+    }
     
     
     printf("Magnetometer is calibrating\n\r");
     MAG3110_enterCalMode();
+    MAG3110_startSampling();    // Data ready now fills the sample ring
         
     while(MAG3110_isCalibrating())
     {
@@ -216,6 +336,7 @@ int InitializeModules(I2C_RESULT* I2cResultFlag)
     }
     
     Result = setGPS_RMC();
+    printf("GPS fix rate %d Hz\n\r", GPS_negotiateRate());
     
 	return Result; 
 }
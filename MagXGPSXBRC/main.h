@@ -20,7 +20,7 @@
 
 	#define GPS_BUFFER_SIZE 256
 
-// These GPS signals are not used in this application
+// FIX_3d is not used in this application, PPS1 disciplines the clock (Clock.c)
 	#define FIX_3d			PORTCbits.RC3	   // 3D fix indication
 	#define PPS1			PORTGbits.RG9	   // 1 PPS flag
 	#define FIX_3D_INPUT	TRISCbits.TRISC3
@@ -0,0 +1,88 @@
+import sys	# Used for argv / stdin
+
+# Decodes the output of I2C_TraceDump() (firmware built with I2C_TRACE)
+# Usage: python i2c_trace_decode.py capture.txt   (or pipe the terminal log in)
+
+event_names = {
+	1: "START",
+	2: "RESTART",
+	3: "ADDR",
+	4: "TX",
+	5: "RX",
+	6: "STOP",
+	7: "ERROR",
+	8: "TIMEOUT"
+}
+
+device_names = {
+	0x0E: "MAG3110",
+	0x10: "GPS",
+	0x1D: "MMA8652"
+}
+
+hist_base_us = 25	# Must match I2C_HIST_BASE_US in i2c_lib.h
+
+# Name a device address, falling back to hex
+def devName(dev_id):
+	return device_names.get(dev_id, "0x%02X" % dev_id)
+
+# Print one trace ring dump as a timeline relative to its first event
+def printTrace(ticks_per_ms, events):
+	if not events:
+		return
+	ticks_per_us = ticks_per_ms / 1000.0
+	t0 = events[0][0]
+	last = t0
+	for tick, event, dev_id, data in events:
+		# Core timer is 32 bits, handle the wrap
+		t_us = ((tick - t0) & 0xFFFFFFFF) / ticks_per_us
+		dt_us = ((tick - last) & 0xFFFFFFFF) / ticks_per_us
+		name = event_names.get(event, "EV%d" % event)
+		detail = ""
+		if name == "ADDR":
+			detail = "0x%02X %s" % (data >> 1, "R" if data & 1 else "W")
+		elif name in ("TX", "RX"):
+			detail = "0x%02X" % data
+		elif name == "ERROR":
+			detail = "attempt %d" % data
+		print ("%10.1f us  (+%7.1f)  %-8s %-8s %s" % (t_us, dt_us, devName(dev_id), name, detail))
+		last = tick
+
+# Print the per-device statistics lines
+def printStats(stats):
+	for fields in stats:
+		dev_id, transfers, errors, timeouts, max_us = fields[:5]
+		hist = fields[5:]
+		print ("\n%s: %d transfers, %d errors (%d timeouts), max %d us" % \
+			   (devName(dev_id), transfers, errors, timeouts, max_us))
+		edge = hist_base_us
+		for count in hist[:-1]:
+			print ("   < %6d us : %d" % (edge, count))
+			edge *= 2
+		print ("  >= %6d us : %d" % (edge // 2, hist[-1]))
+
+def decode(lines):
+	ticks_per_ms = 40000
+	events = []
+	stats = []
+	for line in lines:
+		line = line.strip()
+		fields = line.split(",")
+		if fields[0] == "I2CB":
+			ticks_per_ms = int(fields[1])
+			events = []
+			stats = []
+		elif fields[0] == "I2CT":
+			events.append(tuple(int(x) for x in fields[1:5]))
+		elif fields[0] == "I2CH":
+			stats.append([int(x) for x in fields[1:]])
+		elif fields[0] == "I2CE":
+			printTrace(ticks_per_ms, events)
+			printStats(stats)
+			print ("")
+
+if len(sys.argv) > 1:
+	with open(sys.argv[1], "r") as capture:
+		decode(capture.readlines())
+else:
+	decode(sys.stdin.readlines())
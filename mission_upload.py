@@ -0,0 +1,113 @@
+import struct	# Packs the waypoints the way the firmware lays them out
+import binascii	# CRC-32, same as Mission_crc32()
+import sys		# Used for argv / exit()
+
+# Imports for Serial / XBee Communication
+import serial
+import serial.tools.list_ports
+
+# Uploads a route or a geofence to the boat (Mission.c on the board)
+# Usage: python mission_upload.py route.csv [go]
+#        python mission_upload.py fence fence.csv
+# route.csv has one waypoint per line: latitude, longitude, speed (knots), acceptance radius (m)
+# fence.csv has one polygon vertex per line: latitude, longitude
+# Degrees are signed, south and west negative. Lines starting with # are skipped.
+
+chunk_size = 48			# Must match MISSION_CHUNK_MAX in Mission.h
+max_retry_count = 10	# Unanswered lines in a row before giving up
+reply_timeout = 1.0		# Seconds; erasing the flash page stalls the board for ~20 ms
+
+# Read a CSV file, return a list of the number rows
+def readRows(fileName):
+	rows = []
+	with open(fileName, "r") as csv:
+		for line in csv:
+			line = line.strip()
+			if line and not line.startswith("#"):
+				rows.append([float(x) for x in line.split(",")])
+	return rows
+
+# Read the route file, return the packed mission image
+def readRoute(fileName):
+	image = b""
+	for lat, lon, speed, radius in readRows(fileName):
+		# NAV_WAYPOINT: int32 lat, int32 lon (1e-7 degree), uint16 speed (centiknots), uint16 radius (dm)
+		image += struct.pack("<iiHH", int(round(lat * 1e7)), int(round(lon * 1e7)),
+							 int(round(speed * 100)), int(round(radius * 10)))
+	return image
+
+# Read the fence file, return the packed polygon image
+def readFence(fileName):
+	image = b""
+	for lat, lon in readRows(fileName):
+		# GEO_VERTEX: int32 lat, int32 lon (1e-7 degree)
+		image += struct.pack("<ii", int(round(lat * 1e7)), int(round(lon * 1e7)))
+	return image
+
+# Send one NUL terminated line, return the reply line ("" if none came)
+def sendLine(ser_port, text):
+	ser_port.write((text + "\0").encode())
+	return ser_port.readline().decode("utf-8", "replace").strip()
+
+# Send the image, resuming wherever the board says it is
+# letter is M for a route (12 byte waypoints) or F for a fence (8 byte vertices)
+def upload(ser_port, image, letter="M", item_size=12):
+	count = len(image) // item_size
+	crc = binascii.crc32(image) & 0xFFFFFFFF
+	begin = "%sB %d %08X" % (letter, count, crc)
+	reply = sendLine(ser_port, begin)
+	misses = 0
+
+	while True:
+		fields = reply.split()
+		if not fields:
+			# Lost line or reply, start again from where the board is
+			misses += 1
+			if misses > max_retry_count:
+				sys.exit("No answer from the boat.")
+			reply = sendLine(ser_port, begin)
+			continue
+		misses = 0
+
+		if fields[0] == letter + "D":
+			print ("Stored %s items, sequence %s" % (fields[1], fields[2]))
+			return True
+		elif fields[0] == letter + "F":
+			print ("Upload failed: %s" % " ".join(fields[1:]))
+			return False
+		elif fields[0] == letter + "R":
+			offset = int(fields[1])
+			if offset >= len(image):
+				reply = sendLine(ser_port, letter + "E")
+			else:
+				chunk = image[offset:offset + chunk_size]
+				print ("Sending %d/%d bytes" % (offset, len(image)))
+				reply = sendLine(ser_port, "%sC %d %s %08X" % (letter, offset, binascii.hexlify(chunk).decode().upper(),
+															   binascii.crc32(chunk) & 0xFFFFFFFF))
+		else:
+			# Something else on the link (an "A" for a gamepad line), ask again
+			reply = ""
+
+# Find the port with the XBee on it, return the serial object
+def findXbee():
+	for port in serial.tools.list_ports.comports():
+		if "0403" in port[2]:
+			print ("Using %s as XBee COM port." % port[0])
+			return (serial.Serial(port[0], 9600, timeout=reply_timeout))
+	sys.exit("No Serial Port connected.")
+
+if __name__ == "__main__":
+	if len(sys.argv) < 2 or (sys.argv[1] == "fence" and len(sys.argv) < 3):
+		sys.exit("Usage: python mission_upload.py route.csv [go]\n       python mission_upload.py fence fence.csv")
+	if sys.argv[1] == "fence":
+		image = readFence(sys.argv[2])
+		if len(image) < 3 * 8:
+			sys.exit("A fence needs at least 3 vertices")
+		upload(findXbee(), image, "F", 8)
+	else:
+		image = readRoute(sys.argv[1])
+		if not image:
+			sys.exit("No waypoints in %s" % sys.argv[1])
+		xbee_port = findXbee()
+		if upload(xbee_port, image) and len(sys.argv) > 2 and sys.argv[2] == "go":
+			print (sendLine(xbee_port, "MG"))
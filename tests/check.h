@@ -0,0 +1,27 @@
+#ifndef __CHECK_H__
+	#define __CHECK_H__
+
+	#include <stdio.h>
+
+	/* ------------------------------------------------------------------------
+	   Minimal assertions for the host tests. A failed CHECK prints where it
+	   was and lets the test carry on, CHECK_DONE() gives the exit status.
+	   ------------------------------------------------------------------------ */
+	static int checkCount = 0;
+	static int checkFailures = 0;
+
+	#define CHECK(cond)																\
+		do {																		\
+			checkCount++;															\
+			if (!(cond)) {															\
+				checkFailures++;													\
+				printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);	\
+			}																		\
+		} while (0)
+
+	#define CHECK_NEAR(a, b, tol)	CHECK((((a) - (b)) <= (tol)) && (((b) - (a)) <= (tol)))
+
+	#define CHECK_DONE(name)														\
+		(printf("%s: %d checks, %d failed\n", (name), checkCount, checkFailures),	\
+		 (checkFailures != 0))
+#endif
@@ -0,0 +1,157 @@
+// File Inclusion
+#include "host.h"
+#include <string.h>
+
+unsigned int millisec;			// Shared with hardware.h (-fcommon)
+
+unsigned int hostTicks = 0;
+unsigned int hostTickStep = 20;		// Half a microsecond per poll
+BOOL hostPreempt = FALSE;
+
+static BOOL intsOn = TRUE;
+static BOOL flags[INT_SOURCE_COUNT];
+static BOOL enables[INT_SOURCE_COUNT];
+static HOST_ISR isrs[INT_SOURCE_COUNT];
+static BOOL inIsr = FALSE;
+
+/* --------------------------------- Host_reset --------------------------------
+ @ Summary
+    Clears the interrupt controller and restarts the core timer
+  ---------------------------------------------------------------------------- */
+void Host_reset(void) {
+	hostTicks = 0;
+	millisec = 0;
+	hostTickStep = 20;
+	hostPreempt = FALSE;
+	intsOn = TRUE;
+	inIsr = FALSE;
+	memset(flags, 0, sizeof(flags));
+	memset(enables, 0, sizeof(enables));
+	memset(isrs, 0, sizeof(isrs));
+}
+
+/* ------------------------------- Host_advanceUs -----------------------------
+ @ Summary
+    Moves the core timer on without a poll
+  ---------------------------------------------------------------------------- */
+void Host_advanceUs(unsigned int us) {
+	hostTicks += us * HOST_TICKS_PER_US;
+	millisec = hostTicks / (HOST_CORE_HZ / 1000);
+}
+
+/* -------------------------------- Host_setIsr -------------------------------
+ @ Summary
+    Routes an interrupt source to its handler
+  ---------------------------------------------------------------------------- */
+void Host_setIsr(int source, HOST_ISR isr) {
+	isrs[source] = isr;
+}
+
+/* ------------------------------- Host_service -------------------------------
+ @ Summary
+    Runs handlers until no enabled source is pending
+ @ Return Value
+    int : Number of handler calls
+ @ Notes
+    Does nothing with interrupts disabled or from inside a handler, since
+    the CPU would not take the interrupt there either.
+  ---------------------------------------------------------------------------- */
+int Host_service(void) {
+	int calls = 0;
+	int source;
+	BOOL ran;
+
+	if (!intsOn || inIsr) {
+		return 0;
+	}
+	inIsr = TRUE;
+	do {
+		ran = FALSE;
+		for (source = 0; source < INT_SOURCE_COUNT; source++) {
+			if (flags[source] && enables[source] && (isrs[source] != NULL)) {
+				isrs[source]();
+				ran = TRUE;
+				// A handler that never clears its flag would spin forever
+				if (++calls > 100000) {
+					inIsr = FALSE;
+					return calls;
+				}
+			}
+		}
+	} while (ran);
+	inIsr = FALSE;
+	return calls;
+}
+
+BOOL Host_interruptsOn(void) {
+	return intsOn;
+}
+
+/* --------------------------- plib: core timer ------------------------------ */
+unsigned int ReadCoreTimer(void) {
+	unsigned int now;
+
+	hostTicks += hostTickStep;
+	millisec = hostTicks / (HOST_CORE_HZ / 1000);
+	now = hostTicks;
+	if (hostPreempt) {
+		Host_service();
+	}
+	return now;
+}
+
+/* ----------------------- plib: interrupt controller ------------------------ */
+unsigned int INTDisableInterrupts(void) {
+	unsigned int status = intsOn;
+
+	// Lets a loop that only guards a check with interrupts off see time pass
+	if (hostPreempt) {
+		hostTicks += hostTickStep;
+		millisec = hostTicks / (HOST_CORE_HZ / 1000);
+	}
+	intsOn = FALSE;
+	return status;
+}
+
+void INTRestoreInterrupts(unsigned int status) {
+	intsOn = status ? TRUE : FALSE;
+	if (hostPreempt) {
+		Host_service();
+	}
+}
+
+void INTEnableInterrupts(void) {
+	intsOn = TRUE;
+	if (hostPreempt) {
+		Host_service();
+	}
+}
+
+void INTClearFlag(int source) {
+	flags[source] = FALSE;
+}
+
+int INTGetFlag(int source) {
+	return flags[source];
+}
+
+void INTSetFlag(int source) {
+	flags[source] = TRUE;
+}
+
+void INTEnable(int source, int enable) {
+	enables[source] = enable ? TRUE : FALSE;
+}
+
+int INTGetEnable(int source) {
+	return enables[source];
+}
+
+void ConfigINT0(unsigned int config) {
+	enables[INT_SOURCE_EX_INT(0)] = (config & EXT_INT_ENABLE) ? TRUE : FALSE;
+}
+
+void INTSetVectorPriority(int vector, int priority) {
+	(void) vector;
+	(void) priority;
+}
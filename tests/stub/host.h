@@ -0,0 +1,35 @@
+#ifndef __HOST_H__
+	#define __HOST_H__
+
+	#include <plib.h>
+
+	/* ------------------------------------------------------------------------
+	   Simulated time and interrupt controller
+
+	   The core timer is virtual: every ReadCoreTimer() call moves it on by
+	   hostTickStep ticks, so a polling loop costs time the same way it does
+	   on the board and every timeout path runs to completion. millisec
+	   follows it, as the 1 ms timer interrupt would. Interrupts
+	   never preempt; Host_service() runs the ISRs of pending, enabled
+	   sources the way the CPU would between two main loop statements.
+	   With hostPreempt set they do, for code that blocks: ReadCoreTimer()
+	   and turning interrupts back on run Host_service(), and turning them
+	   off costs a poll, so a loop that only checks a flag still sees
+	   millisec move. Host_reset() clears it.
+	   ------------------------------------------------------------------------ */
+	#define HOST_CORE_HZ		40000000u	// Matches GetCoreClock() in hardware.h
+	#define HOST_TICKS_PER_US	(HOST_CORE_HZ / 1000000u)
+
+	extern unsigned int hostTicks;		// Core timer count
+	extern unsigned int hostTickStep;	// Ticks added per ReadCoreTimer() call
+	extern BOOL hostPreempt;			// ISRs run from inside blocking code
+
+	typedef void (*HOST_ISR)(void);
+
+	// Function Prototypes
+	void Host_reset(void);
+	void Host_advanceUs(unsigned int us);
+	void Host_setIsr(int source, HOST_ISR isr);
+	int Host_service(void);
+	BOOL Host_interruptsOn(void);
+#endif
@@ -0,0 +1,345 @@
+// File Inclusion
+#include "i2c_model.h"
+#include "host.h"
+#include <string.h>
+
+#define MODEL_DEVICES	8
+
+enum Phases {
+	PHASE_IDLE,			// STOP seen, bus free
+	PHASE_ADDRESS,		// START seen, next byte is an address
+	PHASE_WRITE,		// Addressed for writing
+	PHASE_READ			// Addressed for reading
+};
+
+I2C_MODEL_FAULTS i2cFaults;
+
+static I2C_MODEL_DEV devices[MODEL_DEVICES];
+static int deviceCount;
+static I2C_MODEL_DEV *current;		// Device addressed since the last START
+static int phase;
+static BOOL pointerSet;				// First written byte has set the pointer
+static BOOL enabled;
+static int speed;
+static I2C_STATUS status;
+static BOOL hung;
+static BOOL txDone, acked, rxAvail, ackDone;
+static BYTE rxByte;
+static unsigned int events;
+static unsigned int recoveries;
+static I2C_MODEL_COUNTS counts;
+
+volatile STUB_PORT_BITS PORTDbits, PORTGbits, TRISDbits, TRISGbits, LATGbits, ODCGbits;
+
+///* --- Function Prototyping --- */
+static int Event(void);
+static void Raise(void);
+
+/* ------------------------------ I2CModel_reset ------------------------------
+ @ Summary
+    Empties the bus and clears every fault
+  ---------------------------------------------------------------------------- */
+void I2CModel_reset(void) {
+	memset(devices, 0, sizeof(devices));
+	deviceCount = 0;
+	current = NULL;
+	phase = PHASE_IDLE;
+	enabled = FALSE;
+	speed = 0;
+	status = I2C_STOP;
+	hung = FALSE;
+	txDone = acked = rxAvail = ackDone = FALSE;
+	events = 0;
+	recoveries = 0;
+	memset(&counts, 0, sizeof(counts));
+	i2cFaults.hangAfter = I2C_MODEL_NEVER;
+	i2cFaults.silentAfter = I2C_MODEL_NEVER;
+	i2cFaults.collideAt = I2C_MODEL_NEVER;
+	i2cFaults.stuck = FALSE;
+	memset((void *) &PORTGbits, 0, sizeof(PORTGbits));
+	memset((void *) &ODCGbits, 0, sizeof(ODCGbits));
+	PORTGbits.RG2 = 1;	// Both lines pulled up
+	PORTGbits.RG3 = 1;
+}
+
+/* ------------------------------- I2CModel_add -------------------------------
+ @ Summary
+    Puts a slave on the bus
+  ---------------------------------------------------------------------------- */
+I2C_MODEL_DEV *I2CModel_add(BYTE addr) {
+	I2C_MODEL_DEV *dev = &devices[deviceCount++];
+
+	dev->addr = addr;
+	dev->present = TRUE;
+	return dev;
+}
+
+unsigned int I2CModel_events(void) {
+	return events;
+}
+
+unsigned int I2CModel_recoveries(void) {
+	return recoveries;
+}
+
+int I2CModel_speed(void) {
+	return speed;
+}
+
+void I2CModel_counts(I2C_MODEL_COUNTS *out) {
+	*out = counts;
+}
+
+/* ----------------------------------- Event ----------------------------------
+ @ Summary
+    Counts one master action and applies the faults to it
+ @ Return Value
+    int : 1 if it completes, 0 if the bus is hung, -1 if it lost arbitration
+  ---------------------------------------------------------------------------- */
+static int Event(void) {
+	int n = (int) events++;
+
+	if (i2cFaults.stuck) {
+		hung = TRUE;
+		PORTGbits.RG3 = 0;
+		return 0;
+	}
+	if (hung || ((i2cFaults.hangAfter >= 0) && (n >= i2cFaults.hangAfter))) {
+		hung = TRUE;
+		return 0;
+	}
+	if (n == i2cFaults.collideAt) {
+		status |= I2C_ARBITRATION_LOSS;
+		phase = PHASE_IDLE;
+		current = NULL;
+		INTSetFlag(INT_I2C1B);
+		return -1;
+	}
+	return 1;
+}
+
+static void Raise(void) {
+	if ((i2cFaults.silentAfter < 0) || ((int) events <= i2cFaults.silentAfter)) {
+		INTSetFlag(INT_SOURCE_I2C_MASTER(I2C1));
+	}
+}
+
+/* ----------------------------- plib: I2C master ---------------------------- */
+unsigned int I2CSetFrequency(I2C_MODULE id, unsigned int sourceClock, unsigned int clock) {
+	(void) id;
+	(void) sourceClock;
+	speed = clock;
+	return clock;
+}
+
+void I2CEnable(I2C_MODULE id, BOOL enable) {
+	(void) id;
+	if (!enable) {
+		enabled = FALSE;
+		phase = PHASE_IDLE;
+		current = NULL;
+		txDone = rxAvail = ackDone = FALSE;
+		return;
+	}
+	// I2C_BusRecover is the only code that sets the open drain bits. The
+	// nine clocks and the STOP it sends free a slave holding the bus.
+	if (ODCGbits.ODCG2) {
+		ODCGbits.ODCG2 = 0;
+		ODCGbits.ODCG3 = 0;
+		recoveries++;
+		if (!i2cFaults.stuck) {
+			hung = FALSE;
+			i2cFaults.hangAfter = I2C_MODEL_NEVER;
+			i2cFaults.silentAfter = I2C_MODEL_NEVER;
+			status = I2C_STOP;
+		}
+	}
+	enabled = TRUE;
+}
+
+BOOL I2CBusIsIdle(I2C_MODULE id) {
+	(void) id;
+	return enabled && !hung && (phase == PHASE_IDLE);
+}
+
+I2C_RESULT I2CStart(I2C_MODULE id) {
+	int done;
+
+	(void) id;
+	status &= ~I2C_START;
+	done = Event();
+	if (done < 0) {
+		return I2C_MASTER_BUS_COLLISION;
+	}
+	if (done) {
+		status = (status & ~I2C_STOP) | I2C_START;
+		phase = PHASE_ADDRESS;
+		current = NULL;
+		counts.starts++;
+		counts.clocks++;
+		Raise();
+	}
+	return I2C_SUCCESS;
+}
+
+void I2CRepeatStart(I2C_MODULE id) {
+	(void) id;
+	status &= ~I2C_START;
+	if (Event() > 0) {
+		status |= I2C_START;
+		phase = PHASE_ADDRESS;
+		counts.restarts++;
+		counts.clocks++;
+		Raise();
+	}
+}
+
+void I2CStop(I2C_MODULE id) {
+	(void) id;
+	status &= ~I2C_STOP;
+	if (Event() > 0) {
+		status = (status & ~I2C_START) | I2C_STOP;
+		if (current != NULL) {
+			current->transfers++;
+		}
+		phase = PHASE_IDLE;
+		current = NULL;
+		counts.stops++;
+		counts.clocks++;
+		Raise();
+	}
+}
+
+I2C_STATUS I2CGetStatus(I2C_MODULE id) {
+	(void) id;
+	return status | (acked ? I2C_BYTE_ACKNOWLEDGED : 0);
+}
+
+void I2CClearStatus(I2C_MODULE id, I2C_STATUS bits) {
+	(void) id;
+	status &= ~bits;
+}
+
+BOOL I2CTransmitterIsReady(I2C_MODULE id) {
+	(void) id;
+	return !hung;
+}
+
+I2C_RESULT I2CSendByte(I2C_MODULE id, BYTE data) {
+	int idx;
+	int done;
+
+	(void) id;
+	txDone = FALSE;
+	done = Event();
+	if (done < 0) {
+		return I2C_MASTER_BUS_COLLISION;
+	}
+	if (!done) {
+		return I2C_SUCCESS;
+	}
+
+	switch (phase) {
+		case PHASE_ADDRESS:
+			current = NULL;
+			for (idx = 0; idx < deviceCount; idx++) {
+				if (devices[idx].present && (devices[idx].addr == (data >> 1))) {
+					current = &devices[idx];
+				}
+			}
+			acked = (current != NULL) && !current->nack;
+			if (!acked) {
+				current = NULL;
+			}
+			phase = (data & 1) ? PHASE_READ : PHASE_WRITE;
+			pointerSet = FALSE;
+			break;
+		case PHASE_WRITE:
+			acked = (current != NULL);
+			if (current != NULL) {
+				if (!pointerSet) {
+					current->ptr = data;
+					pointerSet = TRUE;
+				}
+				else {
+					current->regs[current->ptr] = data;
+					current->lastWriteTick = hostTicks;
+					if (current->access != NULL) {
+						current->access(current, current->ptr, TRUE);
+					}
+					current->ptr++;
+				}
+			}
+			break;
+		default:
+			acked = FALSE;
+	}
+	txDone = TRUE;
+	counts.clocks += 9;
+	Raise();
+	return I2C_SUCCESS;
+}
+
+BOOL I2CTransmissionHasCompleted(I2C_MODULE id) {
+	(void) id;
+	return txDone;
+}
+
+BOOL I2CByteWasAcknowledged(I2C_MODULE id) {
+	(void) id;
+	return acked;
+}
+
+I2C_RESULT I2CReceiverEnable(I2C_MODULE id, BOOL enable) {
+	(void) id;
+	if (!enable) {
+		return I2C_SUCCESS;
+	}
+	ackDone = FALSE;
+	if (Event() <= 0) {
+		return I2C_SUCCESS;
+	}
+	if ((phase == PHASE_READ) && (current != NULL) && (current->stream != NULL)) {
+		rxByte = (BYTE) current->stream();
+	}
+	else if ((phase == PHASE_READ) && (current != NULL)) {
+		rxByte = current->regs[current->ptr];
+		if (current->access != NULL) {
+			current->access(current, current->ptr, FALSE);
+		}
+		current->ptr++;
+	}
+	else {
+		rxByte = 0xFF;		// Nobody driving SDA
+	}
+	rxAvail = TRUE;
+	counts.clocks += 8;
+	Raise();
+	return I2C_SUCCESS;
+}
+
+BOOL I2CReceivedDataIsAvailable(I2C_MODULE id) {
+	(void) id;
+	return rxAvail;
+}
+
+void I2CAcknowledgeByte(I2C_MODULE id, BOOL ack) {
+	(void) id;
+	(void) ack;
+	if (Event() > 0) {
+		ackDone = TRUE;
+		counts.clocks++;
+		Raise();
+	}
+}
+
+BOOL I2CAcknowledgeHasCompleted(I2C_MODULE id) {
+	(void) id;
+	return ackDone;
+}
+
+BYTE I2CGetByte(I2C_MODULE id) {
+	(void) id;
+	rxAvail = FALSE;
+	return rxByte;
+}
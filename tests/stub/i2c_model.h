@@ -0,0 +1,65 @@
+#ifndef __I2C_MODEL_H__
+	#define __I2C_MODEL_H__
+
+	#include <plib.h>
+
+	/* ------------------------------------------------------------------------
+	   I2C1 bus model
+
+	   Stands in for the PIC32 master and the slaves on the bus. Every master
+	   action (START, repeated START, byte out, receive, ACK, STOP) is one bus
+	   event; it completes at once and raises the master interrupt, unless a
+	   fault says otherwise. Slaves are register files with an auto
+	   incrementing pointer, or a byte stream when stream is set.
+
+	   Faults
+	     hangAfter    Events after this many never complete and the bus
+	                  reads busy: a slave holding SCL low. Cleared by a
+	                  bus recovery.
+	     silentAfter  Events after this many complete but raise no
+	                  interrupt: a lost master interrupt. Cleared by a
+	                  bus recovery.
+	     collideAt    That event loses arbitration (BCL).
+	     stuck        Every event hangs and SDA stays low, recovery or not.
+	   ------------------------------------------------------------------------ */
+	#define I2C_MODEL_NEVER		(-1)
+
+	typedef struct I2C_MODEL_DEV {
+		BYTE addr;
+		BOOL present;
+		BOOL nack;					// Address is not acknowledged
+		BYTE regs[256];
+		BYTE ptr;					// Register pointer
+		int (*stream)(void);		// Plain reads come from here if set
+		// Called after each register is read or written, for devices that
+		// act on their registers
+		void (*access)(struct I2C_MODEL_DEV *dev, BYTE reg, BOOL write);
+		unsigned int transfers;		// Addressed START..STOP sequences
+		unsigned int lastWriteTick;	// Core tick of the last register write
+	} I2C_MODEL_DEV;
+
+	typedef struct {
+		int hangAfter;
+		int silentAfter;
+		int collideAt;
+		BOOL stuck;
+	} I2C_MODEL_FAULTS;
+
+	// Bus use since the last reset, completed events only
+	typedef struct {
+		unsigned int starts;		// Not counting repeated STARTs
+		unsigned int restarts;
+		unsigned int stops;
+		unsigned int clocks;		// SCL periods: 9 a byte, 1 a START or STOP
+	} I2C_MODEL_COUNTS;
+
+	extern I2C_MODEL_FAULTS i2cFaults;
+
+	// Function Prototypes
+	void I2CModel_reset(void);
+	I2C_MODEL_DEV *I2CModel_add(BYTE addr);
+	unsigned int I2CModel_events(void);
+	unsigned int I2CModel_recoveries(void);
+	int I2CModel_speed(void);
+	void I2CModel_counts(I2C_MODEL_COUNTS *counts);
+#endif
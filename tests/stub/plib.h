@@ -0,0 +1,116 @@
+#ifndef __STUB_PLIB_H__
+	#define __STUB_PLIB_H__
+
+	/* ------------------------------------------------------------------------
+	   Host stand-in for the XC32 legacy peripheral library
+
+	   Only what the firmware modules under test use is declared. Types and
+	   constants follow plib, the functions are implemented by host.c (core
+	   timer, interrupt controller) and i2c_model.c (I2C master + slaves).
+	   ------------------------------------------------------------------------ */
+	#include <stdint.h>
+
+	/* -------------------------------- Types -------------------------------- */
+	typedef unsigned char	BYTE;
+	typedef unsigned short	WORD;
+	typedef unsigned int	UINT;
+	typedef unsigned int	UINT32;
+	typedef int				BOOL;
+	#define TRUE			1
+	#define FALSE			0
+
+	/* ------------------------------ Core timer ----------------------------- */
+	unsigned int ReadCoreTimer(void);
+
+	/* ------------------------- Interrupt controller ------------------------ */
+	#define __ISR(vector, ipl)
+	#define INT_PRIORITY_LEVEL_3	3
+	#define INT_PRIORITY_LEVEL_4	4
+	#define INT_PRIORITY_LEVEL_5	5
+	#define INT_ENABLED				1
+	#define INT_DISABLED			0
+	#define INT_I2C1B					8		// I2C1 bus collision
+	#define INT_I2C1S					9
+	#define INT_I2C1M					10
+	#define INT_SOURCE_I2C_MASTER(m)	(INT_I2C1M + 3 * (m))
+	#define INT_VECTOR_I2C(m)			(20 + (m))
+	#define INT_SOURCE_EX_INT(n)		(1 + (n))
+	#define INT_SOURCE_COUNT			64
+
+	unsigned int INTDisableInterrupts(void);
+	void INTRestoreInterrupts(unsigned int status);
+	void INTEnableInterrupts(void);
+	void INTClearFlag(int source);
+	int INTGetFlag(int source);
+	void INTSetFlag(int source);
+	void INTEnable(int source, int enable);
+	int INTGetEnable(int source);
+	void INTSetVectorPriority(int vector, int priority);
+
+	// External interrupt 0, as used by the MAG3110 data-ready line
+	#define EXT_INT_PRI_3		3
+	#define RISING_EDGE_INT		(1 << 3)
+	#define EXT_INT_ENABLE		(1 << 15)
+	void ConfigINT0(unsigned int config);
+	#define mINT0ClearIntFlag()	INTClearFlag(INT_SOURCE_EX_INT(0))
+	#define DisableINT0			INTEnable(INT_SOURCE_EX_INT(0), INT_DISABLED)
+
+	/* --------------------------------- I2C --------------------------------- */
+	typedef enum { I2C1 = 0, I2C2 } I2C_MODULE;
+	typedef enum {
+		I2C_SUCCESS = 0,
+		I2C_ERROR,
+		I2C_MASTER_BUS_COLLISION,
+		I2C_RECEIVE_OVERFLOW
+	} I2C_RESULT;
+
+	typedef unsigned int I2C_STATUS;
+	#define I2C_START					0x0008
+	#define I2C_STOP					0x0010
+	#define I2C_ARBITRATION_LOSS		0x0400
+	#define I2C_BYTE_ACKNOWLEDGED		0x8000
+
+	#define I2C_WRITE	0
+	#define I2C_READ	1
+	typedef union {
+		struct {
+			BYTE rw			: 1;
+			BYTE address	: 7;
+		};
+		BYTE byte;
+	} I2C_7_BIT_ADDRESS;
+	#define I2C_FORMAT_7_BIT_ADDRESS(a, adr, dir)	((a).address = (adr), (a).rw = (dir))
+
+	unsigned int I2CSetFrequency(I2C_MODULE id, unsigned int sourceClock, unsigned int clock);
+	void I2CEnable(I2C_MODULE id, BOOL enable);
+	BOOL I2CBusIsIdle(I2C_MODULE id);
+	I2C_RESULT I2CStart(I2C_MODULE id);
+	void I2CRepeatStart(I2C_MODULE id);
+	void I2CStop(I2C_MODULE id);
+	I2C_STATUS I2CGetStatus(I2C_MODULE id);
+	void I2CClearStatus(I2C_MODULE id, I2C_STATUS status);
+	BOOL I2CTransmitterIsReady(I2C_MODULE id);
+	I2C_RESULT I2CSendByte(I2C_MODULE id, BYTE data);
+	BOOL I2CTransmissionHasCompleted(I2C_MODULE id);
+	BOOL I2CByteWasAcknowledged(I2C_MODULE id);
+	I2C_RESULT I2CReceiverEnable(I2C_MODULE id, BOOL enable);
+	BOOL I2CReceivedDataIsAvailable(I2C_MODULE id);
+	void I2CAcknowledgeByte(I2C_MODULE id, BOOL ack);
+	BOOL I2CAcknowledgeHasCompleted(I2C_MODULE id);
+	BYTE I2CGetByte(I2C_MODULE id);
+
+	/* ------------------------- Port and pin latches ------------------------ */
+	typedef struct {
+		unsigned RD0	: 1;
+		unsigned RG2	: 1;
+		unsigned RG3	: 1;
+		unsigned TRISD0	: 1;
+		unsigned TRISG2	: 1;
+		unsigned TRISG3	: 1;
+		unsigned LATG2	: 1;
+		unsigned LATG3	: 1;
+		unsigned ODCG2	: 1;
+		unsigned ODCG3	: 1;
+	} STUB_PORT_BITS;
+	extern volatile STUB_PORT_BITS PORTDbits, PORTGbits, TRISDbits, TRISGbits, LATGbits, ODCGbits;
+#endif
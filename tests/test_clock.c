@@ -0,0 +1,99 @@
+/* --------------------------------------------------------------------------
+   PPS disciplined clock
+
+   The core timer runs 80 ppm fast, pulses carry +/-0.4 us of jitter and
+   the main loop reads the clock just before each pulse interrupt. The
+   phase has to settle onto whole seconds and the clock never go back.
+   Then the mapping of sensor stamps to UTC: a 32 bit stamp widened across
+   the stamp wrap lands on the right microsecond and UTC millisecond.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "Clock.h"
+
+#define CRYSTAL_PPM		80.0
+
+static unsigned long long coreTicks;	// Core timer, not wrapped
+
+static void SetTicks(unsigned long long ticks) {
+	coreTicks = ticks;
+	hostTicks = (unsigned int) ticks;
+}
+
+static void TestDiscipline(void) {
+	double tps = HOST_CORE_HZ * (1.0 + CRYSTAL_PPM * 1e-6);
+	unsigned long long nextPps = (unsigned long long) (tps * 0.3);
+	uint64_t now, prev = 0;
+	long long phase = 0;
+	int backwards = 0;
+	int s;
+
+	for (s = 0; s < 60; s++) {
+		while (coreTicks + 40000 < nextPps) {			// 1 ms main loop passes
+			SetTicks(coreTicks + 40000 + (s * 7) % 13);
+			now = Clock_micros();
+			backwards += (now < prev);
+			prev = now;
+		}
+		SetTicks(nextPps + 200);						// Read after the edge, before its interrupt
+		now = Clock_micros();
+		backwards += (now < prev);
+		prev = now;
+		Clock_ppsEdge((unsigned int) nextPps);
+		SetTicks(nextPps + 400);
+		now = Clock_micros();
+		backwards += (now < prev);
+		prev = now;
+
+		phase = (long long) ((now - 10) % 1000000);		// 400 ticks is 10 us after the pulse
+		if (phase > 500000) {
+			phase -= 1000000;
+		}
+		nextPps += (unsigned long long) tps + ((s % 5) - 2) * 8;
+	}
+	printf("after 60 pulses: phase %lld us, %d backward steps\n", phase, backwards);
+	CHECK(backwards == 0);
+	CHECK((phase >= -2) && (phase <= 2));
+	CHECK(Clock_ppsLocked());
+}
+
+static void TestStamps(void) {
+	uint64_t sampled, widened, pulse;
+	uint32_t dayMs = 0, expected;
+	unsigned int date;
+	int i;
+
+	// A whole second RMC ties the last pulse to UTC 12:34:56.000
+	Clock_gpsTime(123456, 0, 181026);
+	pulse = (Clock_micros() / 1000000) * 1000000;
+
+	for (i = 0; i < 3; i++) {
+		sampled = Clock_micros();
+		SetTicks(coreTicks + 1234567 + i * 40000000ull * 50);	// Later by 31 ms, then 50 s more each
+		widened = Clock_widen((uint32_t) sampled);
+		CHECK(widened == sampled);
+		CHECK(Clock_toUtc(widened, &dayMs, &date));
+		expected = (12 * 3600 + 34 * 60 + 56) * 1000 + (uint32_t) ((sampled - pulse) / 1000);
+		CHECK(dayMs == expected);
+		CHECK(date == 181026);
+	}
+
+	// Across the 32 bit microsecond wrap, 71.6 minutes in
+	while (Clock_micros() < 0x100000000ull + 5000000) {
+		SetTicks(coreTicks + 40000000ull * 30);
+	}
+	sampled = Clock_micros() - 4000000;				// Just before the wrap
+	CHECK(Clock_widen((uint32_t) sampled) == sampled);
+	printf("stamp widened across the 32 bit wrap: %s\n",
+		   (Clock_widen((uint32_t) sampled) == sampled) ? "ok" : "wrong");
+}
+
+int main(void) {
+	Host_reset();
+	hostTickStep = 0;			// The test moves the core timer itself
+	SetTicks(12345);
+	Clock_init();
+	TestDiscipline();
+	TestStamps();
+	return CHECK_DONE("test_clock");
+}
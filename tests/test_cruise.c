@@ -0,0 +1,136 @@
+/* --------------------------------------------------------------------------
+   Cruise control against a simulated boat
+
+   The boat's steady speed goes with the square root of the throttle that
+   reaches the speed controllers (RC2Pos, whole percent), and it gets
+   there as a first order lag. Fixes come in as a GPS would send them,
+   whole centiknots, at 1 and 5 Hz. The plant is made weaker than the
+   starting map, so the integrator and the learning have to make up the
+   difference and the speed predicted between fixes must not drag the
+   loop back towards the map.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "Cruise.h"
+#include "RC.h"
+#include "GPS_I2C.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define TOP_MMPS		((CRUISE_BINS - 1) * CRUISE_BIN_MMPS)	// Full throttle on the starting map
+#define BOAT_TAU_S		1.2
+
+typedef struct {
+	double strength;		// Speed for a throttle, against the starting map
+	unsigned int fixMs;		// Fix period, 0 for no fixes
+	int32_t setpoint;		// mm/s
+	double seconds;
+} RUN;
+
+typedef struct {
+	double bias;			// Mean speed less setpoint over the last 20 s, mm/s
+	double worst;			// Largest error over the last 20 s
+	double settle;			// Seconds to stay within 150 mm/s
+} RESULT;
+
+int RC1Pos = 50;
+int RC2Pos = 50;
+
+/* ----------------------------- RC stand-in -------------------------------- */
+void set_rc(int rc1, int rc2, int rc3, int rc4) {
+	CHECK((rc1 == rc2) && (rc1 == RC2Pos) && (rc3 == RC1Pos));
+}
+
+static void Run(const RUN *run, RESULT *result) {
+	double speed = 0.0, level, target, sum = 0.0;
+	unsigned int now, end = (unsigned int) (run->seconds * 1000);
+	int count = 0;
+
+	Cruise_reset();
+	Cruise_set(run->setpoint);
+	result->worst = 0.0;
+	result->settle = 0.0;
+	for (now = 1; now <= end; now++) {
+		level = (RC2Pos - 50) * CRUISE_THROTTLE_SIGN * 2 / 100.0;
+		target = (level > 0.0) ? run->strength * TOP_MMPS * sqrt(level) : 0.0;
+		speed += (target - speed) / (BOAT_TAU_S * 1000.0);
+
+		if ((run->fixMs != 0) && ((now % run->fixMs) == 0)) {
+			// Whole centiknots, as the RMC speed field is parsed
+			Cruise_fix(GPS_MMPS((int32_t) lround(speed * 90.0 / 463.0)), now);
+		}
+		if ((now % CRUISE_RATE_MS) == 0) {
+			Cruise_update();
+		}
+
+		if (fabs(speed - run->setpoint) > 150.0) {
+			result->settle = now / 1000.0;
+		}
+		if (end - now < 20000) {
+			sum += speed - run->setpoint;
+			count++;
+			if (fabs(speed - run->setpoint) > result->worst) {
+				result->worst = fabs(speed - run->setpoint);
+			}
+		}
+	}
+	result->bias = sum / count;
+}
+
+// The 60 % plant at 1 Hz was held 320 mm/s short of 2 m/s when the
+// prediction went towards the map
+static void TestPlants(void) {
+	static const int32_t setpoints[] = { 1000, 2000 };
+	static const double strengths[] = { 1.0, 0.6 };
+	static const unsigned int fixes[] = { 1000, 200 };
+	RUN run = { 1.0, 200, 2000, 60.0 };
+	RESULT result;
+	unsigned int p, s, f;
+
+	for (p = 0; p < 2; p++) {
+		for (s = 0; s < 2; s++) {
+			for (f = 0; f < 2; f++) {
+				run.setpoint = setpoints[p];
+				run.strength = strengths[s];
+				run.fixMs = fixes[f];
+				Run(&run, &result);
+				printf("%4d mm/s, plant %3.0f %% of the map, %u Hz fixes: settles in %.1f s, bias %+.0f mm/s, worst %.0f mm/s\n",
+					   (int) run.setpoint, run.strength * 100, 1000 / run.fixMs, result.settle, result.bias, result.worst);
+				CHECK((result.bias < 60.0) && (result.bias > -60.0));
+				CHECK(result.worst <= 150.0);
+				CHECK(result.settle <= 10.0);
+			}
+		}
+	}
+}
+
+// Without a fix the speed comes from the map alone, so the loop runs
+// open loop on it rather than winding the throttle up
+static void TestNoFix(void) {
+	RUN run = { 1.0, 0, 2000, 40.0 };
+	RESULT result;
+
+	Run(&run, &result);
+	printf("no fixes: bias %+.0f mm/s, worst %.0f mm/s\n", result.bias, result.worst);
+	CHECK((result.bias < 150.0) && (result.bias > -150.0));
+	CHECK(Cruise_speed() >= 1850);
+	CHECK(Cruise_speed() <= 2150);
+}
+
+// The gamepad keeps off the throttle exactly while this is TRUE
+static void TestEngaged(void) {
+	Cruise_stop();
+	CHECK(!Cruise_engaged());
+	Cruise_set(0);
+	CHECK(Cruise_engaged());
+	Cruise_stop();
+	CHECK(!Cruise_engaged() && (RC2Pos == 50));
+}
+
+int main(void) {
+	Host_reset();
+	TestPlants();
+	TestNoFix();
+	TestEngaged();
+	return CHECK_DONE("test_cruise");
+}
@@ -0,0 +1,135 @@
+/* --------------------------------------------------------------------------
+   Dead reckoning between fixes on replayed trajectories
+
+   A boat runs a straight line and a 5 m radius circle at 2 m/s. Fixes
+   carry the true position rounded to 1e-7 degree and the speed in whole
+   centiknots, as the RMC fields are parsed, at 1, 2, 5 and 10 Hz. The
+   heading is exact and DeadReckon_update runs at the fusion rate. The
+   estimate is compared with the true position every tick in between, in
+   the same flat projection DeadReckon uses, and the worst and RMS error
+   are printed for each rate. Most of it is the fix rounding, about a cm;
+   on the circle each tick also holds one heading for 20 ms, which adds
+   up between fixes, so the slower rates come out a little worse.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "DeadReckon.h"
+#include "GPS_I2C.h"
+#include <math.h>
+
+#define TICK_MS			20		// DeadReckon_update period, the fusion rate
+#define RUN_MS			60000
+#define SPEED_MPS		2.0
+#define RADIUS_M		5.0
+#define LAT0			450000000	// 45 N, 1e-7 degree
+#define LON0			-750000000
+
+typedef struct {
+	double north, east;		// m from the start
+	double heading;			// rad, clockwise from north
+} STATE;
+
+static const double metersPerUnit = DR_UM_PER_LAT / 1e6;	// North, per 1e-7 degree
+
+static void Straight(double t, STATE *s) {
+	s->heading = 30.0 * M_PI / 180.0;
+	s->north = SPEED_MPS * t * cos(s->heading);
+	s->east = SPEED_MPS * t * sin(s->heading);
+}
+
+// Turning clockwise, started heading north at the west side of the circle
+static void Circle(double t, STATE *s) {
+	s->heading = SPEED_MPS * t / RADIUS_M;
+	s->north = RADIUS_M * sin(s->heading);
+	s->east = RADIUS_M * (1.0 - cos(s->heading));
+}
+
+static void Replay(void (*path)(double, STATE *), unsigned int fixMs, double *worst, double *rms) {
+	struct gps_time fix;
+	STATE s;
+	double cosLat = cos(LAT0 / 1e7 * M_PI / 180.0);
+	double dn, de, err, sum = 0.0;
+	int32_t lat, lon, heading;
+	unsigned int now;
+	int count = 0;
+
+	*worst = 0.0;
+	for (now = 0; now <= RUN_MS; now += TICK_MS) {
+		path(now / 1000.0, &s);
+		if ((now % fixMs) == 0) {
+			fix.lat = LAT0 + (int32_t) lround(s.north / metersPerUnit);
+			fix.lon = LON0 + (int32_t) lround(s.east / (metersPerUnit * cosLat));
+			fix.speed = (int32_t) lround(SPEED_MPS * 1000.0 * 90.0 / 463.0);	// Whole centiknots
+			DeadReckon_fix(&fix, now);
+			continue;
+		}
+
+		heading = (int32_t) lround(s.heading * 18000.0 / M_PI) % 36000;
+		DeadReckon_update(heading, now);
+		CHECK(DeadReckon_position(&lat, &lon));
+		dn = (lat - LAT0) * metersPerUnit - s.north;
+		de = (lon - LON0) * metersPerUnit * cosLat - s.east;
+		err = sqrt(dn * dn + de * de);
+		sum += err * err;
+		count++;
+		if (err > *worst) *worst = err;
+	}
+	*rms = sqrt(sum / count);
+}
+
+static void TestTrajectories(void) {
+	static const struct {
+		unsigned int fixMs;
+		double straightCm;		// Worst error allowed
+		double circleCm;
+	} rates[] = {
+		{ 1000, 2.5, 3.0 },
+		{ 500, 2.5, 3.0 },
+		{ 200, 2.5, 2.5 },
+		{ 100, 2.5, 2.5 }
+	};
+	double worst, rms;
+	int i;
+
+	for (i = 0; i < (int) (sizeof(rates) / sizeof(rates[0])); i++) {
+		Replay(Straight, rates[i].fixMs, &worst, &rms);
+		printf("%2u Hz straight: worst %.1f cm, rms %.1f cm", 1000 / rates[i].fixMs, worst * 100, rms * 100);
+		CHECK(worst * 100 <= rates[i].straightCm);
+
+		Replay(Circle, rates[i].fixMs, &worst, &rms);
+		printf("   circle: worst %.1f cm, rms %.1f cm\n", worst * 100, rms * 100);
+		CHECK(worst * 100 <= rates[i].circleCm);
+	}
+}
+
+static void TestSpeedUnits(void) {
+	// One rounding rule for every centiknot to mm/s conversion
+	CHECK(GPS_MMPS(0) == 0);
+	CHECK(GPS_MMPS(1) == 5);		// 5.14
+	CHECK(GPS_MMPS(9) == 46);		// 46.3
+	CHECK(GPS_MMPS(389) == 2001);	// 2001.2
+	CHECK(GPS_MMPS(90) == 463);
+	CHECK(GPS_MMPS(100000) == 514444);
+}
+
+static void TestStale(void) {
+	struct gps_time fix = { 0 };
+	int32_t lat, lon;
+
+	fix.lat = LAT0;
+	fix.lon = LON0;
+	fix.speed = 389;
+	DeadReckon_fix(&fix, 100000);
+	DeadReckon_update(0, 100000 + DR_MAX_AGE);
+	CHECK(DeadReckon_position(&lat, &lon));
+	DeadReckon_update(0, 100000 + DR_MAX_AGE + TICK_MS);
+	CHECK(!DeadReckon_position(&lat, &lon));
+}
+
+int main(void) {
+	Host_reset();
+	TestTrajectories();
+	TestSpeedUnits();
+	TestStale();
+	return CHECK_DONE("test_deadreckon");
+}
@@ -0,0 +1,118 @@
+/* --------------------------------------------------------------------------
+   FixedMath against libm
+
+   FixedAtan2 is swept over a dense small grid and random inputs up to
+   2^26, FixedSinCos over four turns in both directions, and the square
+   roots checked for floor(sqrt). The bounds are the ones the doc comments
+   give. FixedMath_bench only runs here to show it returns, its numbers
+   mean something on the board alone (PF command).
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "FixedMath.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define ATAN2_MAX_CDEG	0.7
+#define SINCOS_MAX_LSB	1
+
+static double AngleError(int32_t angle, double reference) {
+	double err = fabs(angle - reference);
+
+	return (err > 18000.0) ? 36000.0 - err : err;
+}
+
+static void TestAtan2(void) {
+	double worst = 0.0;
+	double err;
+	int32_t x, y;
+	int i;
+
+	for (x = -4096; x <= 4096; x += 7) {
+		for (y = -4096; y <= 4096; y += 5) {
+			if ((x == 0) && (y == 0)) {
+				continue;
+			}
+			err = AngleError(FixedAtan2(y, x), atan2(y, x) * 18000.0 / M_PI);
+			if (err > worst) {
+				worst = err;
+			}
+		}
+	}
+	srand(31);
+	for (i = 0; i < 200000; i++) {
+		x = (rand() % (1 << 27)) - (1 << 26);
+		y = (rand() % (1 << 27)) - (1 << 26);
+		if ((x == 0) && (y == 0)) {
+			continue;
+		}
+		err = AngleError(FixedAtan2(y, x), atan2(y, x) * 18000.0 / M_PI);
+		if (err > worst) {
+			worst = err;
+		}
+	}
+	printf("FixedAtan2 worst error %.3f cdeg\n", worst);
+	CHECK(worst <= ATAN2_MAX_CDEG);
+	CHECK(FixedAtan2(0, 0) == 0);
+	CHECK(FixedAtan2(0, -5) == 18000 || FixedAtan2(0, -5) == -18000);
+	CHECK(FixedAtan2(5, 0) == 9000);
+}
+
+static void TestSinCos(void) {
+	int worst = 0;
+	int32_t angle, s, c;
+	double r;
+
+	for (angle = -72000; angle <= 72000; angle++) {
+		FixedSinCos(angle, &s, &c);
+		r = angle * M_PI / 18000.0;
+		if (abs(s - (int) lround(sin(r) * 32768.0)) > worst) {
+			worst = abs(s - (int) lround(sin(r) * 32768.0));
+		}
+		if (abs(c - (int) lround(cos(r) * 32768.0)) > worst) {
+			worst = abs(c - (int) lround(cos(r) * 32768.0));
+		}
+	}
+	printf("FixedSinCos worst error %d LSB\n", worst);
+	CHECK(worst <= SINCOS_MAX_LSB);
+}
+
+static void TestSqrt(void) {
+	uint64_t v64;
+	uint32_t v, r;
+	int i;
+
+	for (v = 0; v < 70000; v++) {
+		r = FixedSqrt(v);
+		CHECK((uint64_t) r * r <= v && (uint64_t) (r + 1) * (r + 1) > v);
+	}
+	CHECK(FixedSqrt(0xFFFFFFFFu) == 65535);
+
+	srand(64);
+	for (i = 0; i < 100000; i++) {
+		v64 = ((uint64_t) rand() << 33) ^ ((uint64_t) rand() << 11) ^ (uint64_t) rand();
+		r = FixedSqrt64(v64);
+		CHECK((uint64_t) r * r <= v64 && ((uint64_t) r + 1) * ((uint64_t) r + 1) > v64);
+	}
+	CHECK(FixedSqrt64(0xFFFFFFFFFFFFFFFFull) == 0xFFFFFFFFu);
+}
+
+static void TestWrapAndBench(void) {
+	FIXED_BENCH ticks;
+
+	CHECK(FixedWrap360(-1) == 35999);
+	CHECK(FixedWrap360(36000) == 0);
+	CHECK(FixedWrap360(-72001) == 35999);
+
+	FixedMath_bench(&ticks);
+	CHECK(Host_interruptsOn());
+}
+
+int main(void) {
+	Host_reset();
+	TestAtan2();
+	TestSinCos();
+	TestSqrt();
+	TestWrapAndBench();
+	return CHECK_DONE("test_fixedmath");
+}
@@ -0,0 +1,165 @@
+/* --------------------------------------------------------------------------
+   Gamepad report publishing under a racing reader
+
+   The main loop publishes report after report, every field set to the
+   report number, while a second thread and a timer signal (standing in
+   for an interrupt that lands anywhere, including part way through a
+   publish) take snapshots. A snapshot must never mix two reports. A
+   plain copy of the published frame, taken alongside, shows the race is
+   really being hit. The signal also posts center events, which the main
+   loop must pick up every one of. Then lines that are not whole reports
+   must not be published or count as one.
+
+   Gamepad.c is included rather than linked so the published frame and
+   event counters can be read here.
+   -------------------------------------------------------------------------- */
+#include <pthread.h>
+#include <signal.h>
+#include <sys/time.h>
+#include "check.h"
+#include "host.h"
+
+#define REPORTS		4000000
+
+char dmaBuff[512];
+
+/* ------------------------------ Stand-ins --------------------------------- */
+int SetDefaultServoPosition() { return 0; }
+int TurnLeftPos(int movement) { return 0; }
+int TurnRightPos(int movement) { return 0; }
+int ForwardPos(int movement) { return 0; }
+int BackwardPos(int movement) { return 0; }
+
+#include "Gamepad.c"
+
+MODE Mode_event(MODE_EVENT event) { return MODE_MANUAL; }
+MODE Mode_current(void) { return MODE_MANUAL; }
+void Mode_trim(int left, int right) {}
+BOOL Cruise_engaged(void) { return FALSE; }
+
+typedef struct {
+	long reads;
+	long torn;
+	long busy;				// Gave up part way through a publish
+} TALLY;
+
+static volatile int stop;
+static TALLY thread, isr;
+static long plainTorn;
+
+// Every field of report k holds k
+static int Consistent(const GamepadFrame *frame) {
+	int k = frame->m_LeftSticks.m_CompOne;
+
+	return (frame->m_LeftSticks.m_CompTwo == k) && (frame->m_RightSticks.m_CompOne == k)
+		&& (frame->m_RightSticks.m_CompTwo == k) && (frame->m_DirPad.m_CompOne == k)
+		&& (frame->m_Buttons.m_ButtonX == k) && (frame->m_StartButton == k) && ((int) frame->m_RightTrigger == k)
+		&& ((k == 0) || (frame->m_Version == (unsigned int) k + 1));
+}
+
+static void Take(TALLY *tally) {
+	GamepadFrame frame;
+
+	if (GamepadSnapshot(&frame)) {
+		tally->reads++;
+		if (!Consistent(&frame)) {
+			tally->torn++;
+		}
+	}
+	else {
+		tally->busy++;
+	}
+}
+
+static void Interrupt(int signal) {
+	GamepadPostCenter();
+	Take(&isr);
+}
+
+static void *Reader(void *unused) {
+	GamepadFrame frame;
+
+	while (!stop) {
+		Take(&thread);
+		frame = PublishedFrame;			// No sequence check
+		if (!Consistent(&frame)) {
+			plainTorn++;
+		}
+	}
+	return NULL;
+}
+
+// The seventeen fields: send time, triggers and bumpers, sticks and pad,
+// Y B A X, Start and Back
+static int Report(const char *line) {
+	unsigned int seq = PublishedSeq;
+	int whole;
+
+	strcpy(dmaBuff, line);
+	whole = HandleInput();
+	CHECK((PublishedSeq != seq) == (whole == 1));
+	return whole;
+}
+
+static void TestParse(void) {
+	GamepadFrame frame;
+
+	CHECK(Report("123456 10 0 20 0 -35 7 0 0 0 0 0 0 1 0 0 0\n") == 1);
+	CHECK(GamepadSnapshot(&frame));
+	CHECK((frame.m_LeftTrigger == 10) && (frame.m_RightTrigger == 20));
+	CHECK((frame.m_LeftSticks.m_CompOne == -35) && (frame.m_LeftSticks.m_CompTwo == 7));
+	CHECK(frame.m_Buttons.m_ButtonA == 1);
+
+	CHECK(Report("LS") == 0);											// A command
+	CHECK(Report("") == 0);
+	CHECK(Report("123457 10 0 20 0 -35 7 0 0 0 0 0 0 1 0 0") == 0);	// Cut short
+	CHECK(Report("123458 10 0 2O 0 -35 7 0 0 0 0 0 0 1 0 0 0") == 0);	// Letter O
+	CHECK(Report("123459 10 0 20 0 12345678901234567 7 0 0 0 0 0 0 1 0 0 0") == 0);
+	CHECK(Report("9 garbage") == 0);
+
+	// Shorter than the one before: none of its tail is read
+	CHECK(Report("1 0 0 0 0 5 0 0 0 0 0 0 0 0 0 0 0") == 1);
+	CHECK(GamepadSnapshot(&frame));
+	CHECK((frame.m_LeftSticks.m_CompOne == 5) && (frame.m_LeftTrigger == 0));
+}
+
+int main(void) {
+	struct itimerval every = { { 0, 50 }, { 0, 50 } }, off = { { 0, 0 }, { 0, 0 } };
+	pthread_t reader;
+	int k;
+
+	Host_reset();
+	GamepadInit();
+	CHECK(pthread_create(&reader, NULL, Reader, NULL) == 0);
+	signal(SIGALRM, Interrupt);
+	setitimer(ITIMER_REAL, &every, NULL);
+
+	for (k = 1; k <= REPORTS; k++) {
+		GamepadInputManager.m_LeftSticks.m_CompOne = GamepadInputManager.m_LeftSticks.m_CompTwo = k;
+		GamepadInputManager.m_RightSticks.m_CompOne = GamepadInputManager.m_RightSticks.m_CompTwo = k;
+		GamepadInputManager.m_DirPad.m_CompOne = k;
+		GamepadInputManager.m_Buttons.m_ButtonX = k;
+		GamepadInputManager.m_StartButton = k;
+		GamepadInputManager.m_RightTrigger = k;
+		Publish();
+	}
+
+	stop = 1;
+	pthread_join(reader, NULL);
+	setitimer(ITIMER_REAL, &off, NULL);
+	signal(SIGALRM, SIG_IGN);
+
+	printf("thread: %ld snapshots, %ld torn, %ld gave up; plain copies torn %ld\n",
+		   thread.reads, thread.torn, thread.busy, plainTorn);
+	printf("signal: %ld snapshots, %ld torn, %ld gave up mid-publish\n", isr.reads, isr.torn, isr.busy);
+	CHECK(plainTorn > 0);					// The race was really hit
+	CHECK((thread.reads > 0) && (thread.torn == 0));
+	CHECK((isr.reads > 0) && (isr.torn == 0));
+
+	GamepadEvents();
+	printf("center events: %u posted, %u handled\n", CenterPosted, CenterHandled);
+	CHECK((CenterPosted > 0) && (CenterHandled == CenterPosted));
+
+	TestParse();
+	return CHECK_DONE("test_gamepad");
+}
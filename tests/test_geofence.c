@@ -0,0 +1,176 @@
+/* --------------------------------------------------------------------------
+   Geofence against a double precision reference, and its cost
+
+   Random star shaped polygons of 10 to 200 vertices, up to 3 km across,
+   at latitudes to 70 degrees. Each point's inside/outside and distance to
+   the nearest edge are compared with the same flat projection worked in
+   doubles. Points within a few cm of an edge may fall either side of it
+   in fixed point, so their inside answer is not compared. Then the time
+   per check on this machine for each size, which should grow linearly.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "Geofence.h"
+#include "Navigate.h"
+#include "GPS_I2C.h"
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define POLYGONS		50
+#define POINTS			2000
+#define EDGE_BAND_CM	5.0		// Inside not compared this close to an edge
+
+static GEO_VERTEX polygon[GEO_MAX_VERTICES];
+static double px[GEO_MAX_VERTICES];
+static double py[GEO_MAX_VERTICES];
+
+static double Random(double from, double to) {
+	return from + (to - from) * (rand() / (double) RAND_MAX);
+}
+
+// Vertices at sorted random angles and random radii around the center
+static void MakePolygon(int count, int32_t lat, int32_t lon) {
+	double cosLat = cos(lat * M_PI / 180.0 / GPS_DEG_SCALE);
+	double angle[GEO_MAX_VERTICES];
+	double radius;
+	int i, j;
+
+	for (i = 0; i < count; i++) {
+		angle[i] = Random(0.0, 2.0 * M_PI);
+		for (j = i; (j > 0) && (angle[j - 1] > angle[j]); j--) {
+			radius = angle[j];
+			angle[j] = angle[j - 1];
+			angle[j - 1] = radius;
+		}
+	}
+	for (i = 0; i < count; i++) {
+		radius = Random(30000.0, 150000.0);
+		polygon[i].lat = lat + (int32_t) (radius * cos(angle[i]) * 65536.0 / NAV_CM_PER_UNIT_Q16);
+		polygon[i].lon = lon + (int32_t) (radius * sin(angle[i]) * 65536.0 / NAV_CM_PER_UNIT_Q16 / cosLat);
+	}
+	// Reference projection, as Geofence_load makes it
+	cosLat = cos(polygon[0].lat * M_PI / 180.0 / GPS_DEG_SCALE);
+	for (i = 0; i < count; i++) {
+		py[i] = (polygon[i].lat - (double) polygon[0].lat) * NAV_CM_PER_UNIT_Q16 / 65536.0;
+		px[i] = (polygon[i].lon - (double) polygon[0].lon) * cosLat * NAV_CM_PER_UNIT_Q16 / 65536.0;
+	}
+}
+
+static void Reference(int count, int32_t lat, int32_t lon, BOOL *inside, double *distance) {
+	double cosLat = cos(polygon[0].lat * M_PI / 180.0 / GPS_DEG_SCALE);
+	double y = (lat - (double) polygon[0].lat) * NAV_CM_PER_UNIT_Q16 / 65536.0;
+	double x = (lon - (double) polygon[0].lon) * cosLat * NAV_CM_PER_UNIT_Q16 / 65536.0;
+	double dx, dy, t, d;
+	int i, j;
+
+	*inside = FALSE;
+	*distance = INFINITY;
+	for (i = 0; i < count; i++) {
+		j = (i + 1) % count;
+		if (((py[i] <= y) != (py[j] <= y))
+				&& (x < px[i] + (y - py[i]) * (px[j] - px[i]) / (py[j] - py[i]))) {
+			*inside = !*inside;
+		}
+		dx = px[j] - px[i];
+		dy = py[j] - py[i];
+		t = ((x - px[i]) * dx + (y - py[i]) * dy) / (dx * dx + dy * dy);
+		t = (t < 0.0) ? 0.0 : ((t > 1.0) ? 1.0 : t);
+		d = hypot(x - px[i] - t * dx, y - py[i] - t * dy);
+		if (d < *distance) {
+			*distance = d;
+		}
+	}
+}
+
+static void TestAgainstReference(void) {
+	static const int sizes[] = { 10, 50, 100, 200 };
+	GEO_STATUS status;
+	unsigned int last, max;
+	BOOL inside;
+	double distance, error, worst;
+	int32_t lat, lon, pLat, pLon;
+	int mismatches, size, n, i;
+	clock_t start;
+	double ns;
+
+	srand(45);
+	for (size = 0; size < (int) (sizeof(sizes) / sizeof(sizes[0])); size++) {
+		mismatches = 0;
+		worst = 0.0;
+		for (n = 0; n < POLYGONS; n++) {
+			lat = (int32_t) Random(-700000000.0, 700000000.0);
+			lon = (int32_t) Random(-1790000000.0, 1790000000.0);
+			MakePolygon(sizes[size], lat, lon);
+			CHECK(Geofence_load(polygon, sizes[size]));
+			for (i = 0; i < POINTS; i++) {
+				pLat = lat + (int32_t) Random(-2300.0, 2300.0) * 100;		// 2 km either side
+				pLon = lon + (int32_t) (Random(-2300.0, 2300.0) * 100 / cos(lat * M_PI / 180.0 / GPS_DEG_SCALE));
+				CHECK(Geofence_check(pLat, pLon, &status));
+				Reference(sizes[size], pLat, pLon, &inside, &distance);
+				if ((distance > EDGE_BAND_CM) && (status.inside != inside)) {
+					mismatches++;
+				}
+				CHECK(status.hold == !status.inside);
+				error = fabs(status.distance - distance);
+				if (error > worst) {
+					worst = error;
+				}
+			}
+		}
+
+		// Cost of the last polygon, over its own points again
+		start = clock();
+		for (i = 0; i < 200000; i++) {
+			Geofence_check(lat + (i % 4000 - 2000) * 100, lon + (i % 3000 - 1500) * 100, &status);
+		}
+		ns = (double) (clock() - start) * 1e9 / CLOCKS_PER_SEC / 200000.0;
+
+		printf("%3d vertices: %d inside mismatches, distance worst %.1f cm, host %.0f ns/check\n",
+			   sizes[size], mismatches, worst, ns);
+		CHECK(mismatches == 0);
+		CHECK(worst <= 30.0);			// Q15 cos at 70 degrees is 1 part in 11000, 30 cm at 3 km
+	}
+
+	// Host ticks only count timer polls, but the bookkeeping behind PG shows
+	Geofence_cycles(&last, &max);
+	printf("Geofence_check last %u max %u ticks\n", last, max);
+	CHECK((last > 0) && (max >= last));
+}
+
+static void TestLimits(void) {
+	// 100 m square, 20 m margin
+	static const GEO_VERTEX square[4] = {
+		{ 470000000, 85000000 }, { 470009000, 85000000 }, { 470009000, 85013200 }, { 470000000, 85013200 }
+	};
+	GEO_STATUS status;
+
+	CHECK(!Geofence_load(square, 2));
+	CHECK(!Geofence_load(square, GEO_MAX_VERTICES + 1));
+	CHECK(!Geofence_check(470004500, 85006600, &status));
+	CHECK(status.inside && !status.hold && (status.speedLimit == GEO_NO_LIMIT));
+
+	CHECK(Geofence_load(square, 4));
+	CHECK(Geofence_check(470004500, 85006600, &status));				// Middle, 50 m in
+	CHECK(status.inside && (status.speedLimit == GEO_NO_LIMIT));
+	CHECK_NEAR(status.distance, 5000, 10);
+
+	CHECK(Geofence_check(470008100, 85006600, &status));				// 10 m from the north edge
+	CHECK(status.inside && !status.hold);
+	CHECK_NEAR(status.distance, 1000, 10);
+	CHECK_NEAR(status.speedLimit, (GEO_EDGE_SPEED + GEO_MARGIN_SPEED) / 2, 5);
+
+	CHECK(Geofence_check(470009900, 85006600, &status));				// 10 m north of it
+	CHECK(!status.inside && status.hold && (status.speedLimit == 0));
+	CHECK_NEAR(status.distance, 1000, 10);
+
+	CHECK(Geofence_check(480000000, 85006600, &status));				// 110 km off
+	CHECK(!status.inside && status.hold && (status.speedLimit == 0));
+}
+
+int main(void) {
+	Host_reset();
+	TestLimits();
+	TestAgainstReference();
+	return CHECK_DONE("test_geofence");
+}
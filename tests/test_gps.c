@@ -0,0 +1,490 @@
+/* --------------------------------------------------------------------------
+   GPS_service against an I2C module model
+
+   The module model keeps an output buffer that fills as its sentences are
+   due and answers a read with 0x0A filler once the buffer is empty, as
+   the MTK I2C port does. GPS_service reads it in 32 byte chunks. Checks
+   that every fix gets through when the filler lands in the middle of a
+   sentence and when a CR ends one chunk and its LF starts the next. Also
+   checks that reads follow GPS_CHUNK_MS while there is data and back off
+   to GPS_IDLE_MS after a chunk of filler only.
+   The model also takes PMTK sentences written to it and answers them with
+   $PMTK001, and once PMTK220 sets an output rate it puts out an RMC that
+   often, with the fix time moving on no faster than the receiver can fix.
+   GPS_negotiateRate runs against it with host preemption, since it blocks.
+   A script of replies stands in for a module that rejects, fails or
+   ignores commands, to check the resends and the give up in GPS_command.
+   The sentences buildMTKpacket makes are checked against the PMTK_*
+   literals in GPS_I2C.h.
+   GPS_I2C.c is included to restart its stream state between cases.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "i2c_model.h"
+#include "i2c_lib.h"
+#include "NMEA.h"
+#include "GPS_I2C.c"
+
+#define STEP_US			200		// Main loop pass
+#define MODULE_SIZE		65536
+#define MAX_READS		16384
+#define ACK_MS			20		// Module reply to a PMTK sentence
+#define DAY_MS			45296000	// 12:34:56.000
+#define NO_ACK			(-1)
+#define MAX_SCRIPT		8
+
+void I2C1Handler(void);
+
+static I2C_MODEL_DEV *module;
+
+// Module output: each byte and the ms it is ready to be read
+static char moduleText[MODULE_SIZE];
+static unsigned int moduleReady[MODULE_SIZE];
+static int moduleLen;
+static int modulePos;
+
+// Reads as the module saw them
+static int streamBytes;
+static int reads;
+static unsigned int readMs[MAX_READS];		// When each chunk read started
+static BOOL readData[MAX_READS];			// Any of it came from the buffer
+static int readFirst[MAX_READS];			// Buffer index of its first real byte, -1 none
+
+static int fixes;
+
+// Module input and fix engine
+static char moduleIn[GPS_CMD_MAX];
+static int moduleInLen;
+static int fastestFix;			// ms, fixes come no faster than this
+static int fastestAccepted;		// ms, PMTK300 below this is unsupported
+static int fixMs;				// PMTK300
+static int outMs;				// PMTK220, 0 before it is set
+static unsigned int outNext;
+
+// Replies to give in place of Answer, in order, NO_ACK for none
+static int script[MAX_SCRIPT];
+static int scriptLen;
+static int commandsIn;				// Well formed sentences received
+static char lastIn[GPS_CMD_MAX];
+
+/* ------------------------------- Module model ------------------------------ */
+static void Queue(const char *text, unsigned int readyMs) {
+	while (*text && (moduleLen < MODULE_SIZE)) {
+		moduleReady[moduleLen] = readyMs;
+		moduleText[moduleLen++] = *text++;
+	}
+}
+
+// "$GNRMC..." with the checksum and CR LF, time in ms of the day
+static void Rmc(char *out, unsigned int timeMs) {
+	char crc[3];
+
+	sprintf(out, "$GNRMC,%02u%02u%02u.%03u,A,4807.038,N,01131.000,E,022.4,084.4,230394,,,A*",
+		timeMs / 3600000, (timeMs / 60000) % 60, (timeMs / 1000) % 60, timeMs % 1000);
+	calcCRCforMTK(out, crc);
+	strcat(out, crc);
+	strcat(out, "\r\n");
+}
+
+// Sentences due by now, each carrying the latest fix
+static void Output(void) {
+	char rmc[96];
+	int period;
+
+	if (outMs == 0) {
+		return;
+	}
+	period = (fixMs > fastestFix) ? fixMs : fastestFix;
+	while ((int) (millisec - outNext) >= 0) {
+		Rmc(rmc, DAY_MS + outNext - outNext % period);
+		Queue(rmc, outNext);
+		outNext += outMs;
+	}
+}
+
+static int Stream(void) {
+	int chunk;
+
+	Output();
+	if (((streamBytes % GPS_CHUNK_SIZE) == 0) && (reads < MAX_READS)) {
+		readMs[reads] = millisec;
+		readData[reads] = FALSE;
+		readFirst[reads] = -1;
+		reads++;
+	}
+	chunk = reads - 1;
+	streamBytes++;
+
+	if ((modulePos < moduleLen) && (moduleReady[modulePos] <= millisec)) {
+		if (!readData[chunk]) readFirst[chunk] = modulePos;
+		readData[chunk] = TRUE;
+		return (BYTE) moduleText[modulePos++];
+	}
+	return LF;
+}
+
+// The flag the module answers a command with
+static int Answer(int command, int period) {
+	if (scriptLen > 0) {
+		return (commandsIn <= scriptLen) ? script[commandsIn - 1] : NO_ACK;
+	}
+	switch (command) {
+		case 300:
+			if (period < fastestAccepted) {
+				return PMTK_ACK_UNSUPPORTED;
+			}
+			fixMs = period;
+			break;
+		case 220:
+			outMs = period;
+			outNext = millisec + period;
+			break;
+		default:
+			break;
+	}
+	return PMTK_ACK_SUCCESS;
+}
+
+// Collects a written sentence; the first byte of each write went to the
+// register pointer, and that is always the '$'
+static void Receive(I2C_MODEL_DEV *dev, BYTE reg, BOOL write) {
+	char ack[32];
+	char crc[3];
+	int command, flag, period = 0;
+
+	if (!write) {
+		return;
+	}
+	if (moduleInLen == 0) {
+		moduleIn[moduleInLen++] = '$';
+	}
+	if (moduleInLen < GPS_CMD_MAX - 1) {
+		moduleIn[moduleInLen++] = (char) dev->regs[reg];
+	}
+	if ((moduleInLen < 2) || (moduleIn[moduleInLen - 2] != '\r') || (moduleIn[moduleInLen - 1] != '\n')) {
+		return;
+	}
+	moduleIn[moduleInLen] = 0;
+	moduleInLen = 0;
+
+	calcCRCforMTK(moduleIn, crc);
+	if ((sscanf(moduleIn, "$PMTK%d,%d", &command, &period) < 1) ||
+			(strncmp(strchr(moduleIn, '*') + 1, crc, 2) != 0)) {
+		return;		// Not for it, or garbled: no answer
+	}
+	commandsIn++;
+	strcpy(lastIn, moduleIn);
+	flag = Answer(command, period);
+	if (flag == NO_ACK) {
+		return;
+	}
+	sprintf(ack, "$PMTK001,%d,%d*", command, flag);
+	calcCRCforMTK(ack, crc);
+	strcat(ack, crc);
+	strcat(ack, "\r\n");
+	Queue(ack, millisec + ACK_MS);
+}
+
+static void Setup(void) {
+	// Let a read left over from the last case finish before the bus is reset
+	while (streamReq.busy) {
+		Host_service();
+	}
+	Host_reset();
+	I2CModel_reset();
+	module = I2CModel_add(GPS_DEV_ID);
+	module->stream = Stream;
+	module->access = Receive;
+	I2C_Init(I2C1, I2C_SPEED_STANDARD);
+	I2C_SetProfile(I2C1, GPS_DEV_ID, I2C_SPEED_FAST, 2000, 1);
+	Host_setIsr(INT_SOURCE_I2C_MASTER(I2C1), I2C1Handler);
+	Host_setIsr(INT_I2C1B, I2C1Handler);
+
+	NMEA_reset();
+	memset(&gps, 0, sizeof(gps));
+	streamIssued = FALSE;
+	streamNext = 0;
+	streamLast = 0;
+	cmdState = GPS_CMD_IDLE;
+
+	moduleLen = modulePos = 0;
+	streamBytes = reads = 0;
+	fixes = 0;
+	moduleInLen = 0;
+	fastestFix = fastestAccepted = 100;
+	fixMs = 1000;
+	outMs = 0;
+	scriptLen = 0;
+	commandsIn = 0;
+	lastIn[0] = 0;
+}
+
+static void Run(unsigned int ms) {
+	unsigned int end = millisec + ms;
+
+	while ((int) (millisec - end) < 0) {
+		Host_advanceUs(STEP_US);
+		Host_service();
+		if (GPS_service()) {
+			fixes++;
+		}
+	}
+}
+
+// Every read is GPS_CHUNK_MS after one with data, GPS_IDLE_MS after filler only
+static void CheckBackoff(const char *name) {
+	unsigned int gap, want;
+	int bad = 0;
+	int i;
+
+	for (i = 1; i < reads; i++) {
+		gap = readMs[i] - readMs[i - 1];
+		want = readData[i - 1] ? GPS_CHUNK_MS : GPS_IDLE_MS;
+		// The loop pass and the read completing in the next pass add up to 1 ms
+		if ((gap < want) || (gap > want + 1)) {
+			if (bad++ < 3) printf("%s: read %d came %u ms after one %s\n", name, i, gap,
+				readData[i - 1] ? "with data" : "of filler");
+		}
+	}
+	CHECK(bad == 0);
+}
+
+static void TestFillerInSentence(void) {
+	char rmc[96];
+	char half[96];
+	unsigned int t;
+	int k, idle = 0, i;
+
+	Setup();
+	// 5 Hz. Every other sentence leaves the module in two halves 15 ms
+	// apart, so the reads between them find filler mid-sentence
+	for (k = 0; k < 10; k++) {
+		t = 100 + 200 * k;
+		Rmc(rmc, DAY_MS + 200 * k);
+		if (k & 1) {
+			strcpy(half, rmc);
+			half[30] = 0;
+			Queue(half, t);
+			Queue(&rmc[30], t + 15);
+		}
+		else {
+			Queue(rmc, t);
+		}
+	}
+	Run(2100);
+
+	printf("5 Hz stream: %d fixes from %d reads, %d bytes\n", fixes, reads, streamBytes);
+	CHECK(fixes == 10);
+	CHECK(modulePos == moduleLen);
+	CHECK((gps.utc_time == 123457) && (gps.utc_ms == 800));
+	CHECK(NMEA_checksumErrors() == 0);
+	CheckBackoff("5 Hz stream");
+
+	// Idle between fixes at GPS_IDLE_MS, not hammering the bus
+	for (i = 0; i < reads; i++) {
+		if (!readData[i]) idle++;
+	}
+	CHECK(reads - idle <= 10 * 4);
+	CHECK(reads <= 2100 / GPS_IDLE_MS + 10 * 5);
+}
+
+static void TestLineEndSplit(void) {
+	char rmc[96];
+	char text[192];
+	int pad, len, i, splitRead = -1;
+
+	Setup();
+	Run(100);
+	CHECK(reads > 0);
+	CHECK(!readData[reads - 1]);
+
+	// Stray bytes ahead of the '$' (ignored by the parser) put the CR on
+	// the last byte of a chunk and its LF first in the next
+	Rmc(rmc, DAY_MS);
+	len = strlen(rmc);
+	pad = (GPS_CHUNK_SIZE - 1 - (len - 2) % GPS_CHUNK_SIZE + GPS_CHUNK_SIZE) % GPS_CHUNK_SIZE;
+	memset(text, 'x', pad);
+	strcpy(&text[pad], rmc);
+	CHECK(((pad + len - 2) % GPS_CHUNK_SIZE) == GPS_CHUNK_SIZE - 1);
+	Queue(text, millisec);
+	i = reads;
+	Run(200);
+
+	// The read with only the LF in it counts as data
+	for (; i < reads; i++) {
+		if (readData[i] && (readFirst[i] == pad + len - 1)) splitRead = i;
+	}
+	CHECK(splitRead > 0);
+	CHECK(moduleText[pad + len - 2] == '\r');
+	if (splitRead > 0) {
+		CHECK(readMs[splitRead + 1] - readMs[splitRead] <= GPS_CHUNK_MS + 1);
+		printf("LF split from its CR: next read after %u ms\n", readMs[splitRead + 1] - readMs[splitRead]);
+	}
+	CHECK(fixes == 1);
+	CheckBackoff("CR/LF split");
+}
+
+static int Negotiate(const char *name, int fix, int accepted) {
+	unsigned int t;
+	int hz;
+
+	Setup();
+	fastestFix = fix;
+	fastestAccepted = accepted;
+	hostPreempt = TRUE;
+	hostTickStep = 200;		// 5 us a poll keeps the 16 s worst case quick
+	t = millisec;
+	printf("%s:\n", name);
+	hz = GPS_negotiateRate();
+	printf("  settled on %d Hz after %u ms\n", hz, millisec - t);
+
+	// Left running at what it reported
+	CHECK(outMs * hz == 1000);
+	CHECK(fixMs * hz == 1000);
+	CHECK(NMEA_checksumErrors() == 0);
+	hostPreempt = FALSE;
+	return hz;
+}
+
+static void TestNegotiateRate(void) {
+	CHECK(Negotiate("10 Hz receiver", 100, 100) == 10);
+	// Takes PMTK300,100 but only fixes at 5 Hz, so RMC times repeat
+	CHECK(Negotiate("older firmware", 200, 100) == 5);
+	CHECK(Negotiate("10 Hz unsupported", 200, 200) == 5);
+	CHECK(Negotiate("1 Hz receiver", 1000, 1000) == 1);
+}
+
+static void TestBuildPacket(void) {
+	static const struct {
+		const char *literal;
+		int command;
+		const char *format;
+		int arg;
+	} packets[] = {
+		{ PMTK_SET_NMEA_UPDATE_100_MILLIHERTZ, 220, "%d", 10000 },
+		{ PMTK_SET_NMEA_UPDATE_200_MILLIHERTZ, 220, "%d", 5000 },
+		{ PMTK_SET_NMEA_UPDATE_1HZ, 220, "%d", 1000 },
+		{ PMTK_SET_NMEA_UPDATE_2HZ, 220, "%d", 500 },
+		{ PMTK_SET_NMEA_UPDATE_5HZ, 220, "%d", 200 },
+		{ PMTK_SET_NMEA_UPDATE_10HZ, 220, "%d", 100 },
+		{ PMTK_API_SET_FIX_CTL_100_MILLIHERTZ, 300, "%d,0,0,0,0", 10000 },
+		{ PMTK_API_SET_FIX_CTL_200_MILLIHERTZ, 300, "%d,0,0,0,0", 5000 },
+		{ PMTK_API_SET_FIX_CTL_1HZ, 300, "%d,0,0,0,0", 1000 },
+		{ PMTK_API_SET_FIX_CTL_2HZ, 300, "%d,0,0,0,0", 500 },
+		{ PMTK_API_SET_FIX_CTL_5HZ, 300, "%d,0,0,0,0", 200 },
+		{ PMTK_API_SET_FIX_CTL_10HZ, 300, "%d,0,0,0,0", 100 },
+		{ PMTK_SET_BAUD_57600, 251, "%d", 57600 },
+		{ PMTK_SET_BAUD_9600, 251, "%d", 9600 },
+		{ PMTK_SET_NMEA_OUTPUT_RMCONLY, 314, "%d,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", 0 },
+		{ PMTK_SET_NMEA_OUTPUT_RMCGGA, 314, "%d,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", 0 },
+		{ PMTK_SET_NMEA_OUTPUT_ALLDATA, 314, "%d,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0", 1 },
+		{ PMTK_SET_NMEA_OUTPUT_OFF, 314, "%d,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", 0 },
+		{ PMTK_LOCUS_STARTLOG, 185, "%d", 0 },
+		{ PMTK_LOCUS_STOPLOG, 185, "%d", 1 },
+		{ PMTK_LOCUS_STARTSTOPACK, 1, "185,%d", 3 },
+		{ PMTK_LOCUS_QUERY_STATUS, 183, NULL, 0 },
+		{ PMTK_LOCUS_ERASE_FLASH, 184, "%d", 1 },
+		{ PMTK_ENABLE_SBAS, 313, "%d", 1 },
+		{ PMTK_ENABLE_WAAS, 301, "%d", 2 },
+		{ PMTK_STANDBY, 161, "%d", 0 },
+		{ PMTK_STANDBY_SUCCESS, 1, "161,%d", 3 },
+		{ PMTK_AWAKE, 10, "%03d", 2 },
+		{ PMTK_Q_RELEASE, 605, "", 0 }
+	};
+	char packet[GPS_CMD_MAX];
+	int i, len;
+
+	for (i = 0; i < (int) (sizeof(packets) / sizeof(packets[0])); i++) {
+		len = buildMTKpacket(packet, sizeof(packet), packets[i].command, packets[i].format, packets[i].arg);
+		CHECK(len == (int) strlen(packets[i].literal));
+		if (strcmp(packet, packets[i].literal) != 0) {
+			printf("built %s", packet);
+			CHECK(FALSE);
+		}
+	}
+
+	// "$PMTK220,1000*1F\r\n" and its terminator need 19 bytes
+	CHECK(buildMTKpacket(packet, 19, 220, "%d", 1000) == 18);
+	CHECK(buildMTKpacket(packet, 18, 220, "%d", 1000) == 0);
+	CHECK(buildMTKpacket(packet, 8, 220, "%d", 1000) == 0);
+}
+
+// Sends PMTK220,1000 to a module giving the scripted replies
+static BOOL Command(const int *replies, int n, unsigned int *ms) {
+	unsigned int t;
+	BOOL acked;
+
+	Setup();
+	memcpy(script, replies, n * sizeof(int));
+	scriptLen = n;
+	hostPreempt = TRUE;
+	t = millisec;
+	CHECK(GPS_command(220, "%d", 1000) == I2C_SUCCESS);
+	CHECK(GPS_commandState() == GPS_CMD_PENDING);
+	acked = GPS_commandWait();
+	*ms = millisec - t;
+	CHECK(strcmp(lastIn, PMTK_SET_NMEA_UPDATE_1HZ) == 0);
+	CHECK(acked == (GPS_commandState() == GPS_CMD_ACKED));
+	hostPreempt = FALSE;
+	return acked;
+}
+
+static void TestCommandAck(void) {
+	static const int success[] = { PMTK_ACK_SUCCESS };
+	static const int failThenSuccess[] = { PMTK_ACK_FAILED, PMTK_ACK_FAILED, PMTK_ACK_SUCCESS };
+	static const int failed[] = { PMTK_ACK_FAILED, PMTK_ACK_FAILED, PMTK_ACK_FAILED, PMTK_ACK_SUCCESS };
+	static const int invalid[] = { PMTK_ACK_INVALID, PMTK_ACK_SUCCESS };
+	static const int unsupported[] = { PMTK_ACK_UNSUPPORTED, PMTK_ACK_SUCCESS };
+	static const int silent[] = { NO_ACK, NO_ACK, NO_ACK, PMTK_ACK_SUCCESS };
+	static const int lateAck[] = { NO_ACK, PMTK_ACK_SUCCESS };
+	unsigned int ms;
+
+	CHECK(Command(success, 1, &ms));
+	CHECK(commandsIn == 1);
+	CHECK(ms < GPS_ACK_TIMEOUT_MS);
+	printf("ACK after %u ms\n", ms);
+
+	// Failed is sent again at once, up to GPS_CMD_RETRIES times
+	CHECK(Command(failThenSuccess, 3, &ms));
+	CHECK(commandsIn == GPS_CMD_RETRIES + 1);
+	CHECK(ms < GPS_ACK_TIMEOUT_MS);
+	CHECK(!Command(failed, 4, &ms));
+	CHECK(commandsIn == GPS_CMD_RETRIES + 1);
+
+	// Invalid and unsupported will not get better, no resend
+	CHECK(!Command(invalid, 2, &ms));
+	CHECK(commandsIn == 1);
+	CHECK(ms < GPS_ACK_TIMEOUT_MS);
+	CHECK(!Command(unsupported, 2, &ms));
+	CHECK(commandsIn == 1);
+	CHECK(ms < GPS_ACK_TIMEOUT_MS);
+
+	// No answer: resent every GPS_ACK_TIMEOUT_MS, then failed
+	CHECK(!Command(silent, 4, &ms));
+	CHECK(commandsIn == GPS_CMD_RETRIES + 1);
+	CHECK((ms >= (GPS_CMD_RETRIES + 1) * GPS_ACK_TIMEOUT_MS) &&
+		(ms <= (GPS_CMD_RETRIES + 1) * GPS_ACK_TIMEOUT_MS + GPS_IDLE_MS + 1));
+	printf("no ACK: failed after %u ms\n", ms);
+	CHECK(Command(lateAck, 2, &ms));
+	CHECK(commandsIn == 2);
+	CHECK((ms >= GPS_ACK_TIMEOUT_MS) && (ms < 2 * GPS_ACK_TIMEOUT_MS));
+
+	// An ACK for some other command does not count
+	Setup();
+	Queue(PMTK_LOCUS_STARTSTOPACK, 10);
+	script[0] = NO_ACK;
+	scriptLen = 1;
+	GPS_command(220, "%d", 1000);
+	Run(GPS_ACK_TIMEOUT_MS - 10);
+	CHECK(modulePos == moduleLen);
+	CHECK(GPS_commandState() == GPS_CMD_PENDING);
+}
+
+int main(void) {
+	TestBuildPacket();
+	TestCommandAck();
+	TestFillerInSentence();
+	TestLineEndSplit();
+	TestNegotiateRate();
+	return CHECK_DONE("test_gps");
+}
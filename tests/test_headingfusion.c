@@ -0,0 +1,86 @@
+/* --------------------------------------------------------------------------
+   HeadingFusion bias tracking
+
+   The mag reads a fixed bias off the truth and GPS course comes in at
+   1 Hz. A good first fix must be tracked within a degree; a bad first fix
+   must be recovered from once FUSION_RESNAP agreeing fixes disagree with
+   it, while scattered single outliers are still rejected.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "HeadingFusion.h"
+#include "FixedMath.h"
+#include <stdlib.h>
+
+#define MAG_BIAS		1000		// Mag reads 10 degrees high
+#define TRUTH			6000		// Straight line course, cdeg
+#define SPEED			500			// Centiknots
+
+static unsigned int now;
+
+static int32_t Error(void) {
+	int32_t error = FixedWrap360(HeadingFusion_heading(NULL) - TRUTH + CDEG_180) - CDEG_180;
+
+	return (error < 0) ? -error : error;
+}
+
+// One second of mag updates, then a fix with the given course
+static void Second(int32_t course) {
+	int i;
+
+	for (i = 0; i < 1000 / FUSION_RATE_MS; i++) {
+		now += FUSION_RATE_MS;
+		HeadingFusion_update(FixedWrap360(TRUTH + MAG_BIAS), 0, now);
+	}
+	HeadingFusion_gps(FixedWrap360(course), SPEED, now);
+}
+
+static void TestGoodStart(void) {
+	int i;
+
+	HeadingFusion_reset();
+	for (i = 0; i < 30; i++) {
+		Second(TRUTH + ((i & 1) ? 200 : -200));
+	}
+	printf("good first fix: error %d cdeg\n", Error());
+	CHECK(Error() <= 100);
+
+	// One wild fix does not move it
+	Second(TRUTH + 12000);
+	CHECK(Error() <= 100);
+}
+
+static void TestBadStart(void) {
+	int i;
+
+	HeadingFusion_reset();
+	Second(TRUTH + 9000);				// Multipath on the first fix
+	CHECK(Error() >= 8000);
+	for (i = 1; i < FUSION_RESNAP; i++) {
+		Second(TRUTH);
+		CHECK(Error() >= 8000);			// Still outliers until the run is long enough
+	}
+	Second(TRUTH);
+	printf("bad first fix: error %d cdeg after %d good fixes\n", Error(), FUSION_RESNAP);
+	CHECK(Error() <= 100);
+}
+
+static void TestScattered(void) {
+	int i;
+
+	HeadingFusion_reset();
+	Second(TRUTH);
+	srand(36);
+	// Outliers that do not agree with each other never re-snap
+	for (i = 0; i < 40; i++) {
+		Second(TRUTH + ((i & 1) ? 7000 : -7000) + (rand() % 2000) - 1000);
+	}
+	printf("scattered outliers: error %d cdeg\n", Error());
+	CHECK(Error() <= 100);
+}
+
+int main(void) {
+	TestGoodStart();
+	TestBadStart();
+	TestScattered();
+	return CHECK_DONE("test_headingfusion");
+}
@@ -0,0 +1,216 @@
+/* --------------------------------------------------------------------------
+   Heading hold closed loop against a Nomoto yaw model
+
+   The boat turns as T r' + r = K (rudder + offset), worked in doubles at
+   1 ms, the offset standing in for current and a bent rudder. The
+   controller is called the way main does it, by a copy of the Mode_due
+   scheduling, so a main loop that runs late skips ticks rather than
+   bursting. Settling is staying within 2 degrees of the setpoint.
+
+   Cycles per update come from the board (PH), the host core timer here is
+   virtual.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "HeadingHold.h"
+#include "FixedMath.h"
+#include "RC.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define SETTLE_DEG		2.0
+
+typedef struct {
+	double k;				// Deg/s of turn per rudder percent
+	double t;				// Seconds
+	double offset;			// Rudder percent
+	unsigned int period;	// Controller period, ms
+	unsigned int pass;		// Main loop pass, ms
+	double step;			// Setpoint change, degrees
+	double seconds;
+} RUN;
+
+typedef struct {
+	double settle;			// Seconds
+	double overshoot;		// Degrees past the setpoint
+	double peak;			// Largest error after the first second, degrees
+	double final;			// Mean error over the last 5 s, degrees
+	int minRudder;
+	int maxRudder;
+} RESULT;
+
+int RC1Pos = HH_RUDDER_CENTER;
+int RC2Pos = 50;
+static int rcRudder = -1;
+static int rcCalls = 0;
+
+/* ----------------------------- RC stand-in -------------------------------- */
+void set_rc(int rc1, int rc2, int rc3, int rc4) {
+	CHECK((rc3 == rc4) && (rc1 == RC2Pos) && (rc2 == RC2Pos));
+	rcRudder = rc3;
+	rcCalls++;
+}
+
+// Mode_due with the task on at scale 1
+static BOOL Due(unsigned int period, unsigned int *mark, unsigned int now) {
+	if ((now - *mark) < period) {
+		return FALSE;
+	}
+	*mark += period;
+	if ((now - *mark) >= period) {
+		*mark = now;
+	}
+	return TRUE;
+}
+
+static void Run(const RUN *run, RESULT *result) {
+	double yaw = 0.0, r = 0.0, error, lastSum = 0.0;
+	unsigned int now = 1000, mark = now, passMark = now, end = now + (unsigned int) (run->seconds * 1000);
+	int lastCount = 0;
+	int rudder = HH_RUDDER_CENTER;
+
+	HeadingHold_disengage();
+	HeadingHold_setRate(run->period);
+	HeadingHold_engage(FixedWrap360((int32_t) (run->step * 100)));
+	result->settle = 0.0;
+	result->overshoot = 0.0;
+	result->peak = 0.0;
+	result->minRudder = 100;
+	result->maxRudder = 0;
+
+	for (; now != end; now++) {
+		r += ((run->k * ((rudder - HH_RUDDER_CENTER) * HH_RUDDER_SIGN + run->offset)) - r) / (run->t * 1000.0);
+		yaw += r / 1000.0;
+
+		if (((now - passMark) >= run->pass) && Due(run->period, &mark, now)) {
+			rudder = HeadingHold_update(FixedWrap360((int32_t) lround(yaw * 100)),
+										(int32_t) lround(r * 100) + (rand() % 101) - 50, now);
+			if (rudder < result->minRudder) result->minRudder = rudder;
+			if (rudder > result->maxRudder) result->maxRudder = rudder;
+		}
+		if ((now - passMark) >= run->pass) {
+			passMark = now;
+		}
+
+		error = yaw - run->step;
+		if (fabs(error) > SETTLE_DEG) {
+			result->settle = (now + 1 - 1000) / 1000.0;
+		}
+		if ((run->step >= 0.0) ? (error > result->overshoot) : (-error > result->overshoot)) {
+			result->overshoot = fabs(error);
+		}
+		if ((now >= 2000) && (fabs(error) > result->peak)) {
+			result->peak = fabs(error);
+		}
+		if (end - now <= 5000) {
+			lastSum += fabs(error);
+			lastCount++;
+		}
+	}
+	result->final = lastSum / lastCount;
+}
+
+static const RUN standard = { 0.6, 1.5, 5.0, HH_RATE_MS, 1, 90.0, 60.0 };
+
+static void TestStep(void) {
+	static const double ks[] = { 0.3, 0.6, 1.0 };
+	static const double ts[] = { 0.8, 1.5 };
+	RUN run = standard;
+	RESULT result;
+	unsigned int i, j;
+
+	Run(&run, &result);
+	printf("90 deg step, K %.1f T %.1f: settles in %.2f s, overshoot %.2f deg, final %.2f deg\n",
+		   run.k, run.t, result.settle, result.overshoot, result.final);
+	CHECK(result.settle <= 10.0);
+	CHECK(result.overshoot <= 3.0);
+	CHECK(result.final <= 0.3);
+	CHECK((result.minRudder >= HH_RUDDER_CENTER - HH_RUDDER_LIMIT) && (result.maxRudder <= HH_RUDDER_CENTER + HH_RUDDER_LIMIT));
+	CHECK(RC1Pos == rcRudder);
+
+	for (i = 0; i < sizeof(ks) / sizeof(ks[0]); i++) {
+		for (j = 0; j < sizeof(ts) / sizeof(ts[0]); j++) {
+			run.k = ks[i];
+			run.t = ts[j];
+			Run(&run, &result);
+			printf("  K %.1f T %.1f: %.2f s, overshoot %.2f deg\n", run.k, run.t, result.settle, result.overshoot);
+			CHECK(result.settle <= 15.0);
+			CHECK(result.overshoot <= 3.0);
+			CHECK(result.final <= 0.3);
+		}
+	}
+
+	// The long way round the other side, saturated all the way
+	run = standard;
+	run.step = -179.0;
+	Run(&run, &result);
+	printf("179 deg to port: settles in %.2f s, overshoot %.2f deg\n", result.settle, result.overshoot);
+	CHECK(result.settle <= 12.0);
+	CHECK(result.overshoot <= 3.0);
+	CHECK(result.minRudder == HH_RUDDER_CENTER - HH_RUDDER_LIMIT);
+}
+
+static void TestPeriods(void) {
+	static const unsigned int periods[] = { 10, 50 };
+	RUN run = standard;
+	RESULT base, result;
+	unsigned int i;
+
+	Run(&run, &base);
+	for (i = 0; i < sizeof(periods) / sizeof(periods[0]); i++) {
+		run.period = periods[i];
+		Run(&run, &result);
+		printf("%u ms period: settles in %.2f s\n", run.period, result.settle);
+		CHECK(fabs(result.settle - base.settle) <= 0.3);
+	}
+}
+
+// A main loop slower than the period: Mode_due skips ticks, the integrator
+// has to count the time that passed rather than the ticks it saw
+static void TestLateTicks(void) {
+	static const unsigned int passes[] = { 1, 45, 110 };
+	RUN run = standard;
+	RESULT result[3];
+	unsigned int i;
+
+	run.step = 0.0;
+	run.offset = 10.0;
+	run.seconds = 40.0;
+	for (i = 0; i < 3; i++) {
+		run.pass = passes[i];
+		Run(&run, &result[i]);
+		printf("offset %.0f %%, main loop every %3u ms: off by %.2f deg at most, back within %.1f deg in %.2f s\n",
+			   run.offset, run.pass, result[i].peak > result[i].overshoot ? result[i].peak : result[i].overshoot,
+			   SETTLE_DEG, result[i].settle);
+		CHECK(result[i].final <= 0.3);
+	}
+	CHECK(fabs(result[1].settle - result[0].settle) <= 0.25 * result[0].settle);
+	CHECK(fabs(result[2].settle - result[0].settle) <= 0.25 * result[0].settle);
+}
+
+static void TestEngage(void) {
+	int calls;
+
+	HeadingHold_disengage();
+	calls = rcCalls;
+	CHECK(HeadingHold_update(0, 0, 5000) == -1);
+	CHECK(rcCalls == calls);
+
+	// Derivative on the measurement: a new setpoint moves the rudder by P only
+	HeadingHold_setGains(HH_KP_DEFAULT, 0, HH_KD_DEFAULT);
+	HeadingHold_engage(500);
+	CHECK(HeadingHold_update(0, 0, 5020) == HH_RUDDER_CENTER + HH_RUDDER_SIGN * 15);
+	HeadingHold_engage(1000);
+	CHECK(HeadingHold_update(500, 0, 5040) == HH_RUDDER_CENTER + HH_RUDDER_SIGN * 15);
+	HeadingHold_setGains(HH_KP_DEFAULT, HH_KI_DEFAULT, HH_KD_DEFAULT);
+}
+
+int main(void) {
+	Host_reset();
+	srand(46);
+	TestEngage();
+	TestStep();
+	TestPeriods();
+	TestLateTicks();
+	return CHECK_DONE("test_headinghold");
+}
@@ -0,0 +1,522 @@
+/* --------------------------------------------------------------------------
+   i2c_lib blocking transactions against the bus model
+
+   Covers the per-device profiles, the bounded waits and bus recovery: a
+   slave that wedges mid-read is recovered and the retry succeeds, and a
+   bus that stays stuck fails in bounded time instead of hanging the loop.
+   Background transfers are checked for the same: a lost interrupt is
+   caught by I2C_AsyncWatchdog and a bus collision ends the transfer.
+   The sensor reads are costed both ways: the old pointer write, delay and
+   separate read against the one repeated-start I2C_WriteRead.
+   i2c_lib.c is included to reach the tracer: the ring, the latency bins,
+   the error counters and the lines I2C_TraceDump prints for
+   i2c_trace_decode.py.
+   -------------------------------------------------------------------------- */
+#include <unistd.h>
+#include "check.h"
+#include "host.h"
+#include "i2c_model.h"
+#include "i2c_lib.c"
+#include "swDelay.h"
+#include "MAG3110.h"
+#include "MMA8652.h"
+
+#define DEV_ADDR		0x0E
+#define DEV_TIMEOUT_US	500
+#define DEV_RETRIES		2
+#define DUMP_SIZE		8192
+
+// Events of one six byte I2C_WriteRead, in ring order
+static const BYTE readEvents[] = {
+	I2C_EV_START, I2C_EV_ADDR, I2C_EV_TX, I2C_EV_RESTART, I2C_EV_ADDR,
+	I2C_EV_RX, I2C_EV_RX, I2C_EV_RX, I2C_EV_RX, I2C_EV_RX, I2C_EV_RX, I2C_EV_STOP
+};
+#define READ_EVENTS		((int) sizeof(readEvents))
+
+static I2C_MODEL_DEV *dev;
+static int doneCalls;
+
+void I2C1Handler(void);
+
+static void Done(I2C_ASYNC_REQ *req) {
+	(void) req;
+	doneCalls++;
+}
+
+static void AsyncRequest(I2C_ASYNC_REQ *req, BYTE reg, BYTE *buf, int len) {
+	req->dev_id = DEV_ADDR;
+	req->reg_addr = reg;
+	req->read_only = FALSE;
+	req->data = buf;
+	req->len = len;
+	req->done = Done;
+	req->busy = FALSE;
+}
+
+static void Setup(void) {
+	int idx;
+
+	Host_reset();
+	I2CModel_reset();
+	dev = I2CModel_add(DEV_ADDR);
+	for (idx = 0; idx < 256; idx++) {
+		dev->regs[idx] = (BYTE) (0xA0 + idx);
+	}
+	I2C_Init(I2C1, I2C_SPEED_STANDARD);
+	I2C_SetProfile(I2C1, DEV_ADDR, I2C_SPEED_FAST, DEV_TIMEOUT_US, DEV_RETRIES);
+	Host_setIsr(INT_SOURCE_I2C_MASTER(I2C1), I2C1Handler);
+	Host_setIsr(INT_I2C1B, I2C1Handler);
+	doneCalls = 0;
+}
+
+static void TestWriteRead(void) {
+	BYTE buf[6];
+	BYTE reg[2] = { 0x10, 0x5A };
+	int len = 2;
+
+	Setup();
+	CHECK(I2C_WriteRead(I2C1, DEV_ADDR, 0x01, buf, 6) == I2C_SUCCESS);
+	CHECK((buf[0] == 0xA1) && (buf[5] == 0xA6));
+	CHECK(dev->transfers == 1);
+	CHECK(I2CModel_speed() == I2C_SPEED_FAST);		// Profile applied
+
+	CHECK(I2C_Write(I2C1, DEV_ADDR, reg, &len) == I2C_SUCCESS);
+	CHECK((len == 2) && (dev->regs[0x10] == 0x5A));
+	CHECK(I2CModel_recoveries() == 0);
+}
+
+static void TestNack(void) {
+	BYTE buf[2];
+
+	Setup();
+	dev->nack = TRUE;
+	CHECK(I2C_WriteRead(I2C1, DEV_ADDR, 0x01, buf, 2) == I2C_ERROR);
+	// A NACK is an answer, not a wedged bus
+	CHECK(I2CModel_recoveries() == 0);
+}
+
+static void TestHangRecovered(void) {
+	BYTE buf[6];
+	unsigned int start;
+	unsigned int elapsedUs;
+
+	Setup();
+	// START, address, register, repeated START, address, then the first
+	// byte never arrives
+	i2cFaults.hangAfter = I2CModel_events() + 5;
+	start = hostTicks;
+	CHECK(I2C_WriteRead(I2C1, DEV_ADDR, 0x01, buf, 6) == I2C_SUCCESS);
+	elapsedUs = (hostTicks - start) / HOST_TICKS_PER_US;
+
+	CHECK(I2CModel_recoveries() == 1);
+	CHECK((buf[0] == 0xA1) && (buf[5] == 0xA6));
+	// One timed out receive and the STOP after it, then the recovery
+	CHECK(elapsedUs >= DEV_TIMEOUT_US);
+	CHECK(elapsedUs < 3 * DEV_TIMEOUT_US);
+	printf("wedged read recovered in %u us\n", elapsedUs);
+}
+
+static void TestStuckBounded(void) {
+	BYTE buf[6];
+	unsigned int start;
+	unsigned int elapsedUs;
+
+	Setup();
+	i2cFaults.stuck = TRUE;
+	start = hostTicks;
+	CHECK(I2C_WriteRead(I2C1, DEV_ADDR, 0x01, buf, 6) == I2C_ERROR);
+	elapsedUs = (hostTicks - start) / HOST_TICKS_PER_US;
+
+	// Every attempt ends in a recovery, and none of them waits unbounded
+	CHECK(I2CModel_recoveries() == 1 + DEV_RETRIES);
+	CHECK(elapsedUs < (1 + DEV_RETRIES) * 3 * DEV_TIMEOUT_US);
+	printf("stuck bus gave up after %u us\n", elapsedUs);
+
+	// Once the slave lets go the next transaction goes through
+	i2cFaults.stuck = FALSE;
+	PORTGbits.RG3 = 1;
+	I2C_BusRecover(I2C1);
+	CHECK(I2C_WriteRead(I2C1, DEV_ADDR, 0x02, buf, 1) == I2C_SUCCESS);
+	CHECK(buf[0] == 0xA2);
+}
+
+/* Bus use and elapsed time of one six byte sample read. delayUs >= 0 is the
+   old sequence: pointer write, delayUs, then a plain read. */
+static void ReadCost(BYTE addr, int delayUs, const char *name) {
+	BYTE buf[6];
+	BYTE reg = MAG3110_OUT_X_MSB;
+	int len;
+	unsigned int start;
+	unsigned int elapsedUs;
+	unsigned int busUs;
+	I2C_MODEL_COUNTS before;
+	I2C_MODEL_COUNTS counts;
+
+	Setup();		// MAG3110 shares DEV_ADDR
+	I2CModel_add(MMA8652_I2C_ADDRESS)->regs[MMA8652_OUT_X_MSB] = 0xA1;
+	I2C_SetProfile(I2C1, MMA8652_I2C_ADDRESS, I2C_SPEED_FAST, DEV_TIMEOUT_US,
+		DEV_RETRIES);
+
+	I2CModel_counts(&before);
+	start = hostTicks;
+	if (delayUs >= 0) {
+		len = 1;
+		CHECK(I2C_Write(I2C1, addr, &reg, &len) == I2C_SUCCESS);
+		if (delayUs >= 1000) {
+			DelayMs(delayUs / 1000);
+		} else {
+			usDelay(delayUs);
+		}
+		len = 6;
+		CHECK(I2C_Read(I2C1, addr, buf, &len) == I2C_SUCCESS);
+	} else {
+		CHECK(I2C_WriteRead(I2C1, addr, reg, buf, 6) == I2C_SUCCESS);
+	}
+	elapsedUs = (hostTicks - start) / HOST_TICKS_PER_US;
+	CHECK(buf[0] == 0xA1);
+
+	I2CModel_counts(&counts);
+	counts.starts -= before.starts;
+	counts.restarts -= before.restarts;
+	counts.stops -= before.stops;
+	counts.clocks -= before.clocks;
+	busUs = (unsigned int) ((counts.clocks * 1000000ULL) / I2CModel_speed());
+	printf("%-22s START %u RS %u STOP %u  bus %3u us  elapsed %4u us\n",
+		name, counts.starts, counts.restarts, counts.stops, busUs, elapsedUs);
+
+	if (delayUs >= 0) {
+		// Two transactions, the pointer write released the bus between them.
+		// I2C_Write opens with RSEN on the idle bus, so one of the two START
+		// conditions is counted as a repeated START.
+		CHECK(counts.starts + counts.restarts == 2);
+		CHECK(counts.stops == 2);
+		CHECK(counts.clocks == 9 * 9 + 4);
+		CHECK(elapsedUs >= (unsigned int) delayUs);
+	} else {
+		CHECK((counts.starts == 1) && (counts.restarts == 1));
+		CHECK(counts.stops == 1);
+		// addr+W, reg, addr+R and six data bytes, plus START, RS and STOP
+		CHECK(counts.clocks == 9 * 9 + 3);
+		CHECK(elapsedUs < 1000);
+	}
+}
+
+static void TestReadCost(void) {
+	// MAG3110_readMag waited DelayMs(5) and MAG3110_readRegister usDelay(100)
+	// between the two transactions. MMA8652 only ever had the repeated-start
+	// read, so its old sequence is the register read pattern.
+	ReadCost(MAG3110_I2C_ADDRESS, 5000, "MAG3110 write+delay+read");
+	ReadCost(MAG3110_I2C_ADDRESS, -1, "MAG3110 I2C_WriteRead");
+	ReadCost(MMA8652_I2C_ADDRESS, 100, "MMA8652 write+delay+read");
+	ReadCost(MMA8652_I2C_ADDRESS, -1, "MMA8652 I2C_WriteRead");
+}
+
+// Empties the trace ring and statistics
+static void TraceReset(void) {
+	memset(traceRing, 0, sizeof(traceRing));
+	memset(traceStats, 0, sizeof(traceStats));
+	traceHead = 0;
+	traceDev = &traceStats[I2C_MAX_PROFILES];
+	traceLastEvent = 0;
+}
+
+static I2C_TRACE_STATS *TraceStats(BYTE dev_id) {
+	int idx;
+
+	for (idx = 0; idx <= I2C_MAX_PROFILES; idx++) {
+		if ((traceStats[idx].dev_id == dev_id) &&
+			(traceStats[idx].transfers || traceStats[idx].errors)) {
+			return &traceStats[idx];
+		}
+	}
+	return NULL;
+}
+
+// Runs I2C_TraceDump with stdout sent to buf
+static void CaptureDump(char *buf) {
+	FILE *capture = tmpfile();
+	int saved;
+	size_t len;
+
+	fflush(stdout);
+	saved = dup(fileno(stdout));
+	dup2(fileno(capture), fileno(stdout));
+	I2C_TraceDump();
+	fflush(stdout);
+	dup2(saved, fileno(stdout));
+	close(saved);
+
+	rewind(capture);
+	len = fread(buf, 1, DUMP_SIZE - 1, capture);
+	buf[len] = '\0';
+	fclose(capture);
+}
+
+/* Splits a dump into lines the way i2c_trace_decode.py does: the firmware
+   ends each with "\n\r", so the '\r' leads the next line and is stripped */
+static char *NextLine(char **cursor) {
+	char *line = *cursor;
+	char *end;
+
+	while ((*line == '\r') || (*line == '\n')) line++;
+	if (*line == '\0') return NULL;
+	end = strchr(line, '\n');
+	if (end) {
+		*end = '\0';
+		*cursor = end + 1;
+	} else {
+		*cursor = line + strlen(line);
+	}
+	return line;
+}
+
+static int CountFields(const char *line) {
+	int fields = 1;
+
+	while ((line = strchr(line, ',')) != NULL) {
+		fields++;
+		line++;
+	}
+	return fields;
+}
+
+static void TestTraceRing(void) {
+	BYTE buf[6];
+	char dump[DUMP_SIZE];
+	char *cursor = dump;
+	char *line;
+	I2C_TRACE_ENTRY *entry;
+	I2C_TRACE_STATS *stats;
+	unsigned int tick, lastTick = 0;
+	unsigned int ticksPerMs, count, transfers, errors, timeouts, maxUs, bins;
+	int ev, devId, data, hist[I2C_HIST_BINS];
+	int idx, reads, lines;
+	BOOL ordered = TRUE;
+
+	Setup();
+	TraceReset();
+	CHECK(I2C_WriteRead(I2C1, DEV_ADDR, 0x01, buf, 6) == I2C_SUCCESS);
+	CHECK(traceHead == READ_EVENTS);
+	for (idx = 0; idx < READ_EVENTS; idx++) {
+		CHECK((traceRing[idx].event == readEvents[idx]) && (traceRing[idx].dev_id == DEV_ADDR));
+		if (idx) CHECK(traceRing[idx].tick >= traceRing[idx - 1].tick);
+	}
+	CHECK(traceRing[1].data == (DEV_ADDR << 1));
+	CHECK(traceRing[2].data == 0x01);
+	CHECK(traceRing[4].data == ((DEV_ADDR << 1) | 1));
+	CHECK((traceRing[5].data == 0xA1) && (traceRing[10].data == 0xA6));
+
+	// Six reads are 72 events: the last 8 overwrite the oldest slots
+	for (reads = 1; reads < 6; reads++) {
+		CHECK(I2C_WriteRead(I2C1, DEV_ADDR, 0x01, buf, 6) == I2C_SUCCESS);
+	}
+	CHECK(traceHead == 6 * READ_EVENTS);
+	for (idx = 0; idx < I2C_TRACE_DEPTH; idx++) {
+		entry = &traceRing[idx];
+		count = (idx < 8) ? (I2C_TRACE_DEPTH + idx) : idx;		// Event number held
+		CHECK(entry->event == readEvents[count % READ_EVENTS]);
+	}
+	stats = TraceStats(DEV_ADDR);
+	CHECK(stats && (stats->transfers == 6) && (stats->errors == 0));
+
+	CaptureDump(dump);
+	line = NextLine(&cursor);
+	CHECK(line && (sscanf(line, "I2CB,%u,%u", &ticksPerMs, &count) == 2));
+	CHECK((ticksPerMs == CORE_MS_TICK_RATE) && (count == I2C_TRACE_DEPTH));
+
+	// Oldest first: event 8 of the first read, through the last STOP
+	for (lines = 0; (line = NextLine(&cursor)) && (strncmp(line, "I2CT,", 5) == 0); lines++) {
+		CHECK(CountFields(line) == 5);
+		CHECK(sscanf(line, "I2CT,%u,%d,%d,%d", &tick, &ev, &devId, &data) == 4);
+		CHECK(ev == readEvents[(lines + 8) % READ_EVENTS]);
+		CHECK(devId == DEV_ADDR);
+		if (lines && (tick < lastTick)) ordered = FALSE;
+		lastTick = tick;
+	}
+	CHECK(lines == I2C_TRACE_DEPTH);
+	CHECK(ordered);
+
+	CHECK(line && (strncmp(line, "I2CH,", 5) == 0));
+	CHECK(CountFields(line) == 1 + 5 + I2C_HIST_BINS);		// Tag, five counts, the bins
+	CHECK(sscanf(line, "I2CH,%d,%u,%u,%u,%u,%d,%d,%d,%d,%d,%d,%d,%d", &devId, &transfers,
+		&errors, &timeouts, &maxUs, &hist[0], &hist[1], &hist[2], &hist[3], &hist[4],
+		&hist[5], &hist[6], &hist[7]) == 5 + I2C_HIST_BINS);
+	CHECK((devId == DEV_ADDR) && (transfers == 6) && (errors == 0) && (timeouts == 0));
+	CHECK(stats && (maxUs == stats->max_us));
+	for (idx = 0, bins = 0; idx < I2C_HIST_BINS; idx++) {
+		bins += hist[idx];
+	}
+	CHECK(bins == transfers);
+
+	line = NextLine(&cursor);
+	CHECK(line && (strcmp(line, "I2CE") == 0));
+	CHECK(NextLine(&cursor) == NULL);
+}
+
+static void TestTraceHistogram(void) {
+	// START to STOP time against the bin it lands in: 25 us doubling, the
+	// last bin open ended
+	static const unsigned int edges[][2] = {
+		{ 0, 0 }, { 24, 0 }, { 25, 1 }, { 49, 1 }, { 50, 2 }, { 99, 2 },
+		{ 100, 3 }, { 199, 3 }, { 200, 4 }, { 399, 4 }, { 400, 5 }, { 799, 5 },
+		{ 800, 6 }, { 1599, 6 }, { 1600, 7 }, { 100000, 7 }
+	};
+	unsigned int expect[I2C_HIST_BINS] = { 0 };
+	int idx;
+
+	Setup();
+	TraceReset();
+	hostTickStep = 0;		// The STOP is stamped exactly where it was put
+	for (idx = 0; idx < (int) (sizeof(edges) / sizeof(edges[0])); idx++) {
+		traceStartTick = hostTicks - edges[idx][0] * HOST_TICKS_PER_US;
+		TraceTransfer();
+		expect[edges[idx][1]]++;
+	}
+	for (idx = 0; idx < I2C_HIST_BINS; idx++) {
+		CHECK(traceDev->hist[idx] == expect[idx]);
+	}
+	CHECK(traceDev->transfers == sizeof(edges) / sizeof(edges[0]));
+	CHECK(traceDev->max_us == 100000);
+	hostTickStep = 20;
+}
+
+static void TestTraceErrors(void) {
+	BYTE buf[6];
+	char dump[DUMP_SIZE];
+	char *cursor = dump;
+	char *line;
+	I2C_TRACE_STATS *stats;
+	unsigned int idx, errorEvents = 0, timeoutEvents = 0;
+	int devId;
+	unsigned int transfers, errors, timeouts;
+
+	Setup();
+	TraceReset();
+	// A NACK fails every attempt without a timeout
+	dev->nack = TRUE;
+	CHECK(I2C_WriteRead(I2C1, DEV_ADDR, 0x01, buf, 6) == I2C_ERROR);
+	stats = TraceStats(DEV_ADDR);
+	CHECK(stats && (stats->errors == 1 + DEV_RETRIES) && (stats->timeouts == 0));
+
+	// A wedged read times out once, then the retry goes through
+	dev->nack = FALSE;
+	i2cFaults.hangAfter = I2CModel_events() + 5;
+	CHECK(I2C_WriteRead(I2C1, DEV_ADDR, 0x01, buf, 6) == I2C_SUCCESS);
+	CHECK(stats && (stats->errors == 2 + DEV_RETRIES) && (stats->timeouts == 1));
+
+	for (idx = 0; idx < traceHead; idx++) {
+		if (traceRing[idx].event == I2C_EV_ERROR) {
+			// The attempt number, counting from 0 on each call
+			CHECK(traceRing[idx].data == ((errorEvents < 1 + DEV_RETRIES) ? errorEvents : 0));
+			errorEvents++;
+		}
+		if (traceRing[idx].event == I2C_EV_TIMEOUT) timeoutEvents++;
+	}
+	CHECK((errorEvents == 2 + DEV_RETRIES) && (timeoutEvents == 1));
+
+	CaptureDump(dump);
+	while ((line = NextLine(&cursor)) && (strncmp(line, "I2CH,", 5) != 0));
+	CHECK(line && (sscanf(line, "I2CH,%d,%u,%u,%u", &devId, &transfers, &errors, &timeouts) == 4));
+	CHECK((devId == DEV_ADDR) && (errors == 2 + DEV_RETRIES) && (timeouts == 1));
+	CHECK(transfers >= 1);
+}
+
+static void TestDefaultProfile(void) {
+	BYTE buf[1];
+	I2C_MODEL_DEV *other;
+
+	Setup();
+	other = I2CModel_add(0x42);
+	other->regs[7] = 0x77;
+	CHECK(I2C_WriteRead(I2C1, DEV_ADDR, 0x00, buf, 1) == I2C_SUCCESS);
+	CHECK(I2C_WriteRead(I2C1, 0x42, 0x07, buf, 1) == I2C_SUCCESS);
+	CHECK(buf[0] == 0x77);
+	// A device without a profile runs at the speed the port was opened at
+	CHECK(I2CModel_speed() == I2C_SPEED_STANDARD);
+}
+
+static void TestAsync(void) {
+	I2C_ASYNC_REQ req;
+	BYTE buf[4];
+
+	Setup();
+	AsyncRequest(&req, 0x01, buf, 4);
+	CHECK(I2C_WriteReadAsync(&req) == I2C_SUCCESS);
+	CHECK(I2C_WriteReadAsync(&req) == I2C_ERROR);		// Already in flight
+	Host_service();
+	CHECK(!req.busy && (req.result == I2C_SUCCESS) && (doneCalls == 1));
+	CHECK((buf[0] == 0xA1) && (buf[3] == 0xA4));
+	CHECK(!I2C_AsyncWatchdog());
+}
+
+static void TestAsyncLostInterrupt(void) {
+	I2C_ASYNC_REQ first, second;
+	BYTE bufFirst[4], bufSecond[2];
+	unsigned int start;
+	unsigned int elapsedUs;
+
+	Setup();
+	AsyncRequest(&first, 0x01, bufFirst, 4);
+	AsyncRequest(&second, 0x10, bufSecond, 2);
+	// START and the address go through, the interrupt after that is lost
+	i2cFaults.silentAfter = I2CModel_events() + 2;
+	CHECK(I2C_WriteReadAsync(&first) == I2C_SUCCESS);
+	CHECK(I2C_WriteReadAsync(&second) == I2C_SUCCESS);	// Queued behind it
+	Host_service();
+	CHECK(first.busy && second.busy);
+
+	// Poll the watchdog every 50 us, as a busy main loop would
+	start = hostTicks;
+	while (first.busy && ((hostTicks - start) < 10000 * HOST_TICKS_PER_US)) {
+		Host_advanceUs(50);
+		I2C_AsyncWatchdog();
+		Host_service();
+	}
+	elapsedUs = (hostTicks - start) / HOST_TICKS_PER_US;
+	printf("lost interrupt failed after %u us\n", elapsedUs);
+
+	CHECK(!first.busy && (first.result == I2C_ERROR));
+	CHECK(I2CModel_recoveries() == 1);
+	CHECK(elapsedUs >= DEV_TIMEOUT_US);
+	CHECK(elapsedUs < DEV_TIMEOUT_US + 200);
+	// The queued request got the recovered bus
+	CHECK(!second.busy && (second.result == I2C_SUCCESS));
+	CHECK((bufSecond[0] == 0xB0) && (bufSecond[1] == 0xB1));
+	CHECK(doneCalls == 2);
+}
+
+static void TestAsyncCollision(void) {
+	I2C_ASYNC_REQ req;
+	BYTE buf[4];
+
+	Setup();
+	AsyncRequest(&req, 0x01, buf, 4);
+	// The address byte loses arbitration
+	i2cFaults.collideAt = I2CModel_events() + 1;
+	CHECK(I2C_WriteReadAsync(&req) == I2C_SUCCESS);
+	Host_service();
+	CHECK(!req.busy && (req.result == I2C_ERROR) && (doneCalls == 1));
+	CHECK(!(I2CGetStatus(I2C1) & I2C_ARBITRATION_LOSS));
+	CHECK(I2CModel_recoveries() == 0);
+
+	// The bus is usable straight after
+	CHECK(I2C_WriteReadAsync(&req) == I2C_SUCCESS);
+	Host_service();
+	CHECK(!req.busy && (req.result == I2C_SUCCESS) && (buf[0] == 0xA1));
+}
+
+int main(void) {
+	TestWriteRead();
+	TestNack();
+	TestHangRecovered();
+	TestStuckBounded();
+	TestDefaultProfile();
+	TestAsync();
+	TestAsyncLostInterrupt();
+	TestAsyncCollision();
+	TestReadCost();
+	TestTraceRing();
+	TestTraceHistogram();
+	TestTraceErrors();
+	return CHECK_DONE("test_i2c");
+}
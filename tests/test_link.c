@@ -0,0 +1,206 @@
+/* --------------------------------------------------------------------------
+   Link supervisor and mode manager with gaps injected into the link
+
+   Gamepad reports come every 80 to 120 ms and each main loop pass takes
+   1 to 30 ms, the link checked once a pass as main does. Gaps either side
+   of the timeout are injected: the short ones must pass unnoticed, the
+   long ones must be found within a pass of the timeout and ramp the boat
+   to neutral. Then a route that finishes while the link is down has to
+   end in failsafe, not in manual with nobody steering. Crossing out of
+   the geofence must stop the gamepad modes too, and a heading set over
+   the link must be the one assisted holds.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "Link.h"
+#include "Mode.h"
+#include "HeadingHold.h"
+#include "RC.h"
+#include "hardware.h"
+#include <stdlib.h>
+
+#define PASS_MAX_MS		30
+#define REPORT_THROTTLE	10		// RC2Pos the gamepad holds, well forward
+#define REPORT_RUDDER	80
+
+static const NAV_WAYPOINT route[1] = { { 470000000, 85000000, 300, 50 } };
+int RC1Pos = HH_RUDDER_CENTER;
+int RC2Pos = MODE_THROTTLE_NEUTRAL;
+
+/* ------------------------------ Stand-ins --------------------------------- */
+const NAV_WAYPOINT *Mission_route(int *count) {
+	*count = 1;
+	return route;
+}
+void Navigate_start(const NAV_WAYPOINT *waypoints, int count) {}
+void Navigate_stop(void) {}
+static int32_t held = -1;
+void HeadingHold_engage(int32_t heading) {
+	held = heading;
+}
+void HeadingHold_disengage(void) {}
+unsigned int HeadingHold_rate(void) {
+	return HH_RATE_MS;
+}
+void Cruise_stop(void) {}
+void set_rc(int rc1, int rc2, int rc3, int rc4) {}
+void ClearLeftStick(void) {}
+
+static unsigned int nextReport;
+static unsigned int passEnd;
+static unsigned int rampMark;
+
+// Runs the link and the main loop to the given millisec. A report is
+// held back while gapMs has not passed since gapAt.
+static void RunTo(unsigned int end, unsigned int gapAt, unsigned int gapMs, int *detectedAt, int *neutralAt) {
+	for (; millisec < end; millisec++) {
+		if ((millisec >= nextReport) && ((millisec < gapAt) || (millisec >= gapAt + gapMs))) {
+			Link_frame(millisec);
+			if (Mode_current() == MODE_FAILSAFE) {
+				Mode_event(MODE_EV_BACK);			// Whoever holds the gamepad takes it back
+			}
+			if (Mode_current() == MODE_MANUAL) {
+				RC2Pos = REPORT_THROTTLE;
+				RC1Pos = REPORT_RUDDER;
+			}
+			nextReport = millisec + 80 + rand() % 41;
+		}
+		if (millisec < passEnd) {
+			continue;								// Main loop pass still running
+		}
+		passEnd = millisec + 1 + rand() % PASS_MAX_MS;
+		if (Link_check(millisec)) {
+			*detectedAt = (int) millisec;
+		}
+		if (Mode_due(MODE_TASK_RAMP, MODE_RAMP_MS, &rampMark)) {
+			Mode_ramp();
+			if ((*neutralAt < 0) && (*detectedAt >= 0) && (RC2Pos == MODE_THROTTLE_NEUTRAL)
+					&& (RC1Pos == HH_RUDDER_CENTER)) {
+				*neutralAt = (int) millisec;
+			}
+		}
+	}
+}
+
+static void TestGaps(void) {
+	static const unsigned int gaps[] = { 150, 250, LINK_TIMEOUT_MS - 30, LINK_TIMEOUT_MS + 50, 1000, 5000 };
+	// Ramp from the report's throttle and rudder, one step each MODE_RAMP_MS
+	int rampMs = MODE_RAMP_MS * (1 + (MODE_THROTTLE_NEUTRAL - REPORT_THROTTLE) / MODE_RAMP_THROTTLE);
+	int detectedAt, neutralAt;
+	unsigned int i, losses = 0, gapAt;
+	LINK_STATS stats;
+
+	// Nothing is supervised before the first report
+	RunTo(2000, 0, 2000, &detectedAt, &neutralAt);
+	CHECK((Mode_current() == MODE_MANUAL) && !Link_lost() && !Link_up());
+	nextReport = millisec;
+
+	for (i = 0; i < sizeof(gaps) / sizeof(gaps[0]); i++) {
+		detectedAt = neutralAt = -1;
+		RunTo(millisec + 2000, 0, 0, &detectedAt, &neutralAt);
+		gapAt = millisec;
+		RunTo(millisec + gaps[i] + 2000, gapAt, gaps[i], &detectedAt, &neutralAt);
+		if (gaps[i] <= LINK_TIMEOUT_MS - 30) {
+			printf("%4u ms gap: not a loss\n", gaps[i]);
+			CHECK(detectedAt < 0);
+			continue;
+		}
+		// The last frame came before the gap, so detection is bounded from
+		// its start. A link back before the ramp is done stops the ramp.
+		CHECK(detectedAt >= 0);
+		CHECK(detectedAt <= (int) (gapAt + LINK_TIMEOUT_MS + PASS_MAX_MS));
+		if (gaps[i] < LINK_TIMEOUT_MS + rampMs + 2 * PASS_MAX_MS) {
+			printf("%4u ms gap: found %d ms into it, back before neutral\n", gaps[i], detectedAt - (int) gapAt);
+		}
+		else {
+			printf("%4u ms gap: found %d ms into it, neutral %d ms later\n",
+				   gaps[i], detectedAt - (int) gapAt, neutralAt - detectedAt);
+			CHECK((neutralAt >= 0) && (neutralAt - detectedAt <= rampMs + MODE_RAMP_MS + PASS_MAX_MS));
+		}
+		CHECK(Mode_current() == MODE_MANUAL);		// The next report took it back
+		losses++;
+	}
+
+	Link_stats(&stats);
+	printf("%u frames, %u losses, longest gap %u ms, detection at most %u ms past the timeout\n",
+		   stats.frames, stats.losses, stats.maxGap, stats.maxLatency);
+	CHECK(stats.losses == losses);
+	CHECK(stats.maxGap >= 5000);
+	CHECK(stats.maxLatency <= PASS_MAX_MS);
+}
+
+static void TestRouteEnds(void) {
+	NAV_OUTPUT nav = { 0 };
+	int detectedAt = -1, neutralAt = -1;
+
+	// Link up: the route ends in manual
+	CHECK(Mode_event(MODE_EV_START) == MODE_ASSISTED);
+	Mode_update(TRUE, &nav);
+	CHECK(Mode_event(MODE_EV_GO) == MODE_AUTONOMOUS);
+	nav.done = TRUE;
+	Mode_update(TRUE, &nav);
+	CHECK(Mode_current() == MODE_MANUAL);
+
+	// Link lost under way: autonomous carries on, the end goes to failsafe
+	nav.done = FALSE;
+	CHECK(Mode_event(MODE_EV_GO) == MODE_AUTONOMOUS);
+	RunTo(millisec + 1000, millisec, 10000, &detectedAt, &neutralAt);
+	CHECK((detectedAt >= 0) && Link_lost() && (Mode_current() == MODE_AUTONOMOUS));
+	nav.done = TRUE;
+	Mode_update(TRUE, &nav);
+	printf("route done with the link lost: %s\n", Mode_name(Mode_current()));
+	CHECK(Mode_current() == MODE_FAILSAFE);
+	RunTo(millisec + 2000, millisec, 10000, &detectedAt, &neutralAt);
+	CHECK((RC2Pos == MODE_THROTTLE_NEUTRAL) && (RC1Pos == HH_RUDDER_CENTER));
+
+	// The link back and Back on the gamepad leave it
+	RunTo(millisec + 1000, 0, 0, &detectedAt, &neutralAt);
+	CHECK(Link_up() && (Mode_current() == MODE_MANUAL));
+}
+
+static void TestFenceBreach(void) {
+	NAV_OUTPUT nav = { 0 };
+
+	// Manual and assisted drive on the gamepad, the fence speed never
+	// reaches them: both go to failsafe
+	CHECK(Mode_event(MODE_EV_BACK) == MODE_MANUAL);
+	CHECK(Mode_event(MODE_EV_FENCE) == MODE_FAILSAFE);
+	CHECK(Mode_event(MODE_EV_BACK) == MODE_MANUAL);		// Driven back in by hand
+	CHECK(Mode_event(MODE_EV_START) == MODE_ASSISTED);
+	CHECK(Mode_event(MODE_EV_FENCE) == MODE_FAILSAFE);
+
+	// Autonomous already has its speed held at 0 by the fence
+	CHECK(Mode_event(MODE_EV_BACK) == MODE_MANUAL);
+	Mode_update(TRUE, &nav);
+	CHECK(Mode_event(MODE_EV_GO) == MODE_AUTONOMOUS);
+	CHECK(Mode_event(MODE_EV_FENCE) == MODE_AUTONOMOUS);
+	Mode_event(MODE_EV_BACK);
+}
+
+static void TestHold(void) {
+	NAV_OUTPUT nav = { 0 };
+
+	// Only assisted takes it, its first steer must not take the heading
+	// it is on instead
+	Mode_hold(9000);
+	CHECK(held != 9000);
+	CHECK(Mode_event(MODE_EV_START) == MODE_ASSISTED);
+	Mode_hold(-9000);
+	Mode_steer(1234, &nav);
+	CHECK(held == 27000);
+	Mode_steer(1234, &nav);
+	CHECK(held == 27000);
+	Mode_event(MODE_EV_BACK);
+}
+
+int main(void) {
+	Host_reset();
+	srand(49);
+	Link_reset();
+	Mode_init();
+	TestGaps();
+	TestRouteEnds();
+	TestFenceBreach();
+	TestHold();
+	return CHECK_DONE("test_link");
+}
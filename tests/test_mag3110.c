@@ -0,0 +1,223 @@
+/* --------------------------------------------------------------------------
+   MAG3110 data-ready sampling against a sensor model
+
+   The model converts at the rate CTRL_REG1 selects, raises INT1 (RD0) and
+   the INT0 interrupt when a result is ready, and drops INT1 once OUT_Z_LSB
+   has been read, as the part does. The MMA8652 behind it is a register
+   file, read in the same slot as each magnetometer sample.
+
+   Checks that every conversion reaches the sample ring at 80 Hz and after
+   a change to 20 Hz, and that sampling survives a lost I2C interrupt (the
+   async watchdog) and a bus collision (the BCL path in I2C1Handler).
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "i2c_model.h"
+#include "i2c_lib.h"
+#include "MAG3110.h"
+#include "MMA8652.h"
+#include "Clock.h"
+
+#define STEP_US		100		// Main loop pass
+
+void Int0Handler(void);
+void I2C1Handler(void);
+
+// MAG3110_EnvCalibrate turns the stepper, which is not part of this test
+void step(int dir, int mode) {
+	(void) dir;
+	(void) mode;
+}
+
+static I2C_MODEL_DEV *mag;
+static I2C_MODEL_DEV *accel;
+static BOOL magActive;
+static unsigned int magPeriod;		// Core ticks between conversions
+static unsigned int magNext;
+static int magCount;				// Conversions made
+static int magOverwrites;			// Conversions made while INT1 was still high
+
+// Results seen by the main loop
+static int samples;
+static int gaps;					// Conversions that never reached the ring
+static int lastX;
+static unsigned int lastStamp;
+static unsigned int minInterval, maxInterval;
+
+/* ------------------------------- Sensor model ------------------------------ */
+static unsigned int PeriodTicks(BYTE ctrl1) {
+	unsigned int dr = ctrl1 >> 5;
+	unsigned int os = (ctrl1 >> 3) & 3;
+
+	// The ADC runs at 1280 Hz >> DR, each output averages 16 << OS of them
+	return (unsigned int) (((unsigned long long) HOST_CORE_HZ * (16u << os)) / (1280u >> dr));
+}
+
+static void MagAccess(I2C_MODEL_DEV *dev, BYTE reg, BOOL write) {
+	BOOL active;
+
+	if (write && (reg == MAG3110_CTRL_REG1)) {
+		active = (dev->regs[reg] & MAG3110_ACTIVE_MODE) != 0;
+		magPeriod = PeriodTicks(dev->regs[reg]);
+		if (active && !magActive) {
+			magNext = hostTicks + magPeriod;
+		}
+		magActive = active;
+		dev->regs[MAG3110_SYSMOD] = active ? MAG3110_SYSMOD_ACTIVE : MAG3110_SYSMOD_STANDBY;
+	}
+	else if (!write && (reg == MAG3110_OUT_Z_LSB)) {
+		PORTDbits.RD0 = 0;
+		dev->regs[MAG3110_DR_STATUS] = 0;
+	}
+}
+
+static void MagStep(void) {
+	int16_t value;
+
+	while (magActive && ((int) (hostTicks - magNext) >= 0)) {
+		magCount++;
+		value = (int16_t) magCount;
+		mag->regs[MAG3110_OUT_X_MSB] = (BYTE) (value >> 8);
+		mag->regs[MAG3110_OUT_X_LSB] = (BYTE) value;
+		value = (int16_t) -magCount;
+		mag->regs[MAG3110_OUT_Y_MSB] = (BYTE) (value >> 8);
+		mag->regs[MAG3110_OUT_Y_LSB] = (BYTE) value;
+		mag->regs[MAG3110_DR_STATUS] = 0x0F;
+		if (PORTDbits.RD0) {
+			magOverwrites++;
+		}
+		else {
+			PORTDbits.RD0 = 1;
+			INTSetFlag(INT_SOURCE_EX_INT(0));
+		}
+		magNext += magPeriod;
+	}
+}
+
+/* -------------------------------- Main loop -------------------------------- */
+static void Run(unsigned int ms) {
+	MAG3110_SAMPLE sample;
+	unsigned int end = hostTicks + ms * (HOST_CORE_HZ / 1000);
+	unsigned int interval;
+
+	while ((int) (hostTicks - end) < 0) {
+		Host_advanceUs(STEP_US);
+		MagStep();
+		Host_service();
+		while (MAG3110_getSample(&sample)) {
+			if (samples > 0) {
+				gaps += sample.x - lastX - 1;
+				interval = sample.stamp - lastStamp;
+				if (interval < minInterval) minInterval = interval;
+				if (interval > maxInterval) maxInterval = interval;
+			}
+			CHECK(sample.y == -sample.x);
+			lastX = sample.x;
+			lastStamp = sample.stamp;
+			samples++;
+		}
+		MAG3110_service();
+		Host_service();
+	}
+}
+
+static void ResetCounts(void) {
+	samples = 0;
+	gaps = 0;
+	minInterval = 0xFFFFFFFF;
+	maxInterval = 0;
+}
+
+static void Setup(void) {
+	Host_reset();
+	Clock_init();
+	I2CModel_reset();
+	Host_setIsr(INT_SOURCE_EX_INT(0), Int0Handler);
+	Host_setIsr(INT_SOURCE_I2C_MASTER(I2C1), I2C1Handler);
+	Host_setIsr(INT_I2C1B, I2C1Handler);
+
+	mag = I2CModel_add(MAG3110_I2C_ADDRESS);
+	mag->regs[MAG3110_WHO_AM_I] = MAG3110_WHO_AM_I_RSP;
+	mag->access = MagAccess;
+	accel = I2CModel_add(MMA8652_I2C_ADDRESS);
+	accel->regs[MMA8652_WHO_AM_I] = MMA8652_WHO_AM_I_RSP;
+	magActive = FALSE;
+	magCount = 0;
+	magOverwrites = 0;
+	PORTDbits.RD0 = 0;
+
+	I2C_Init(I2C1, I2C_SPEED_STANDARD);
+	I2C_SetProfile(I2C1, MAG3110_I2C_ADDRESS, I2C_SPEED_FAST, 500, 2);
+	I2C_SetProfile(I2C1, MMA8652_I2C_ADDRESS, I2C_SPEED_FAST, 500, 2);
+	CHECK(MAG3110_initialize());
+	CHECK(MMA8652_initialize());
+	MAG3110_start();
+	MAG3110_startSampling();
+}
+
+static void TestRates(void) {
+	MMA8652_SAMPLE a;
+
+	Setup();
+	Run(50);
+	ResetCounts();
+	Run(1000);
+	printf("80 Hz: %d samples, %d missed, %u..%u us apart\n", samples, gaps, minInterval, maxInterval);
+	CHECK((samples >= 79) && (samples <= 81));
+	CHECK(gaps == 0);
+	CHECK((minInterval >= 12300) && (maxInterval <= 12700));
+	CHECK(magOverwrites == 0);
+	CHECK(MAG3110_getOverruns() == 0);
+	CHECK(MAG3110_getErrors() == 0);
+	CHECK(MMA8652_getLatest(&a));		// Read in the same slot
+
+	MAG3110_requestDR_OS(MAG3110_DR_OS_20_64);
+	Run(200);
+	ResetCounts();
+	Run(1000);
+	printf("20 Hz: %d samples, %d missed, %u..%u us apart\n", samples, gaps, minInterval, maxInterval);
+	CHECK((samples >= 19) && (samples <= 21));
+	CHECK(gaps == 0);
+	CHECK((minInterval >= 49800) && (maxInterval <= 50200));
+}
+
+static void TestLostInterrupt(void) {
+	unsigned int errors;
+
+	Setup();
+	Run(50);
+	ResetCounts();
+	errors = MAG3110_getErrors();
+	// The burst read after the next START goes quiet
+	i2cFaults.silentAfter = I2CModel_events() + 2;
+	Run(500);
+	printf("lost interrupt: %d samples, %d missed, %d recoveries\n", samples, gaps, I2CModel_recoveries());
+	CHECK(I2CModel_recoveries() == 1);
+	CHECK(MAG3110_getErrors() == errors + 1);		// Failed by the watchdog
+	CHECK(gaps <= 1);
+	CHECK(samples >= 39);
+}
+
+static void TestCollision(void) {
+	unsigned int errors;
+
+	Setup();
+	Run(50);
+	ResetCounts();
+	errors = MAG3110_getErrors();
+	// Arbitration lost on the register byte of the next burst read
+	i2cFaults.collideAt = I2CModel_events() + 2;
+	Run(500);
+	printf("bus collision: %d samples, %d missed\n", samples, gaps);
+	CHECK(I2CModel_recoveries() == 0);
+	CHECK(MAG3110_getErrors() == errors + 1);
+	CHECK(gaps == 0);
+	CHECK(samples >= 39);
+}
+
+int main(void) {
+	TestRates();
+	TestLostInterrupt();
+	TestCollision();
+	return CHECK_DONE("test_mag3110");
+}
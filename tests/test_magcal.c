@@ -0,0 +1,241 @@
+/* --------------------------------------------------------------------------
+   MagCal ellipsoid fit on synthetic sweeps
+
+   A field of fixed strength goes through a known soft iron distortion D
+   (symmetric, with off diagonal terms) and a hard iron offset, rounded to
+   counts like the MAG3110 gives them. The fit should hand back the offset and, in Q12,
+   D^-1 scaled to unit determinant. A full sphere of headings gives the 3D
+   fit; a stepper sweep about Z leaves Z unconstrained and has to fall back
+   to the planar fit. Degenerate sweeps must give nothing.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "MagCal.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FIELD			400.0	// |h| in counts, about the local field
+#define SPHERE_POINTS	1000
+#define SWEEP_STEPS		200		// Stepper positions in one turn
+#define DIP				0.6		// Vertical part of the field in the sweep, of FIELD
+#define Q12_TOL			4		// Matrix element tolerance, LSB (0.1%)
+
+static const int16_t offset[3] = { 215, -340, 95 };
+
+static void Invert3(const double m[3][3], double inv[3][3], double *det) {
+	int i, j;
+
+	inv[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	inv[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+	inv[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+	inv[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	inv[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+	inv[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+	inv[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	inv[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+	inv[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+	*det = m[0][0] * inv[0][0] + m[0][1] * inv[1][0] + m[0][2] * inv[2][0];
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) {
+			inv[i][j] /= *det;
+		}
+	}
+}
+
+// Raw counts for field h through distortion d and the hard iron offset
+static BOOL AddField(const double d[3][3], const double h[3]) {
+	double v[3];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		v[i] = d[i][0] * h[0] + d[i][1] * h[1] + d[i][2] * h[2] + offset[i];
+	}
+	return MagCal_addSample((int16_t) lround(v[0]), (int16_t) lround(v[1]), (int16_t) lround(v[2]));
+}
+
+// Spreads points evenly over the sphere (golden angle spiral)
+static void AddSphere(const double d[3][3]) {
+	double h[3], z, r, angle;
+	int k;
+
+	for (k = 0; k < SPHERE_POINTS; k++) {
+		z = 1.0 - (2.0 * k + 1.0) / SPHERE_POINTS;
+		r = sqrt(1.0 - z * z);
+		angle = k * M_PI * (3.0 - sqrt(5.0));
+		h[0] = FIELD * r * cos(angle);
+		h[1] = FIELD * r * sin(angle);
+		h[2] = FIELD * z;
+		CHECK(AddField(d, h));
+	}
+}
+
+// Worst |corrected| spread as a fraction of the mean, over a fresh set of points
+static double MagnitudeSpread(const double d[3][3], const MAGCAL_RESULT *cal, BOOL planar) {
+	double h[3], v[3], c, sum = 0.0, lo = 1e9, hi = 0.0, mag;
+	int i, k, n = 360;
+
+	for (k = 0; k < n; k++) {
+		h[0] = FIELD * cos(k * M_PI / 180.0) * (planar ? sqrt(1.0 - DIP * DIP) : sin(k * 0.7));
+		h[1] = FIELD * sin(k * M_PI / 180.0) * (planar ? sqrt(1.0 - DIP * DIP) : sin(k * 0.7));
+		h[2] = FIELD * (planar ? DIP : cos(k * 0.7));
+		for (i = 0; i < 3; i++) {
+			v[i] = lround(d[i][0] * h[0] + d[i][1] * h[1] + d[i][2] * h[2] + offset[i]) - cal->offset[i];
+		}
+		mag = 0.0;
+		for (i = 0; i < (planar ? 2 : 3); i++) {
+			c = (cal->matrix[i][0] * v[0] + cal->matrix[i][1] * v[1] + cal->matrix[i][2] * v[2]) / MAGCAL_Q12_ONE;
+			mag += c * c;
+		}
+		mag = sqrt(mag);
+		sum += mag;
+		if (mag < lo) lo = mag;
+		if (mag > hi) hi = mag;
+	}
+	return (hi - lo) / (sum / n);
+}
+
+static void TestSphere(void) {
+	static const double d[3][3] = {
+		{ 1.20, 0.15, 0.05 },
+		{ 0.15, 0.90, -0.08 },
+		{ 0.05, -0.08, 1.05 }
+	};
+	double inv[3][3], det, expect;
+	MAGCAL_RESULT cal;
+	int i, j, worst = 0;
+
+	MagCal_reset();
+	AddSphere(d);
+	CHECK(MagCal_count() == SPHERE_POINTS);
+	CHECK(MagCal_solve(&cal) == MAGCAL_FIT_3D);
+
+	for (i = 0; i < 3; i++) {
+		CHECK_NEAR(cal.offset[i], offset[i], 1);
+	}
+	// Unit determinant version of D^-1
+	Invert3(d, inv, &det);
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) {
+			expect = inv[i][j] * cbrt(det) * MAGCAL_Q12_ONE;
+			CHECK_NEAR(cal.matrix[i][j], expect, Q12_TOL);
+			if (abs(cal.matrix[i][j] - (int) lround(expect)) > worst) {
+				worst = abs(cal.matrix[i][j] - (int) lround(expect));
+			}
+		}
+	}
+	CHECK(cal.matrix[0][1] == cal.matrix[1][0]);
+	CHECK(MagnitudeSpread(d, &cal, FALSE) < 0.01);
+	printf("sphere: offset %d %d %d, matrix worst %d LSB, |h| spread %.2f%%\n",
+		cal.offset[0], cal.offset[1], cal.offset[2], worst, 100.0 * MagnitudeSpread(d, &cal, FALSE));
+}
+
+static void TestStepperSweep(void) {
+	// Rotation about Z only: the XY block carries the distortion
+	static const double d[3][3] = {
+		{ 1.15, -0.12, 0.0 },
+		{ -0.12, 0.85, 0.0 },
+		{ 0.0, 0.0, 1.0 }
+	};
+	double h[3], det2, expect[2][2], zMean = 0.0;
+	MAGCAL_RESULT cal;
+	int i, j, k;
+
+	MagCal_reset();
+	for (k = 0; k < SWEEP_STEPS; k++) {
+		h[0] = FIELD * sqrt(1.0 - DIP * DIP) * cos(2.0 * M_PI * k / SWEEP_STEPS);
+		h[1] = FIELD * sqrt(1.0 - DIP * DIP) * sin(2.0 * M_PI * k / SWEEP_STEPS);
+		h[2] = FIELD * DIP;
+		CHECK(AddField(d, h));
+		zMean += lround(FIELD * DIP) + offset[2];
+	}
+	zMean /= SWEEP_STEPS;
+
+	// The full fit cannot work without Z moving, the planar one must
+	CHECK(MagCal_solve(&cal) == MAGCAL_FIT_2D);
+	CHECK_NEAR(cal.offset[0], offset[0], 1);
+	CHECK_NEAR(cal.offset[1], offset[1], 1);
+	CHECK(cal.offset[2] == (int) lround(zMean));		// Z only gets its mean
+
+	// XY block is the 2x2 inverse at unit determinant, Z passes straight through
+	det2 = d[0][0] * d[1][1] - d[0][1] * d[1][0];
+	expect[0][0] = d[1][1] / sqrt(det2);
+	expect[0][1] = -d[0][1] / sqrt(det2);
+	expect[1][0] = -d[1][0] / sqrt(det2);
+	expect[1][1] = d[0][0] / sqrt(det2);
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < 2; j++) {
+			CHECK_NEAR(cal.matrix[i][j], expect[i][j] * MAGCAL_Q12_ONE, Q12_TOL);
+		}
+		CHECK(cal.matrix[i][2] == 0);
+		CHECK(cal.matrix[2][i] == 0);
+	}
+	CHECK(cal.matrix[2][2] == MAGCAL_Q12_ONE);
+	CHECK(MagnitudeSpread(d, &cal, TRUE) < 0.01);
+	printf("stepper sweep: offset %d %d %d, matrix %d %d / %d %d / %d\n", cal.offset[0], cal.offset[1],
+		cal.offset[2], cal.matrix[0][0], cal.matrix[0][1], cal.matrix[1][0], cal.matrix[1][1], cal.matrix[2][2]);
+}
+
+static void TestDegenerate(void) {
+	static const double flat[3][3] = {		// Axis ratio 5, past MAGCAL_MAX_RATIO
+		{ 1.0, 0.0, 0.0 },
+		{ 0.0, 0.2, 0.0 },
+		{ 0.0, 0.0, 1.0 }
+	};
+	static const double identity[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+	static const double up[3] = { 0.0, 0.0, FIELD };
+	MAGCAL_RESULT cal, untouched;
+	int k;
+
+	memset(&untouched, 0x5A, sizeof(untouched));
+
+	// Too few samples
+	MagCal_reset();
+	for (k = 0; k < MAGCAL_MIN_SAMPLES - 1; k++) {
+		MagCal_addSample((int16_t) (100 + 3 * k), (int16_t) (k * k % 50), 7);
+	}
+	cal = untouched;
+	CHECK(MagCal_solve(&cal) == MAGCAL_FIT_NONE);
+	CHECK(memcmp(&cal, &untouched, sizeof(cal)) == 0);
+
+	// All on one line: nothing to fit
+	MagCal_reset();
+	for (k = 0; k < 500; k++) {
+		CHECK(MagCal_addSample((int16_t) (k - 250), 40, -20));
+	}
+	cal = untouched;
+	CHECK(MagCal_solve(&cal) == MAGCAL_FIT_NONE);
+	CHECK(memcmp(&cal, &untouched, sizeof(cal)) == 0);
+
+	// Never moved
+	MagCal_reset();
+	for (k = 0; k < 500; k++) {
+		CHECK(MagCal_addSample(120, -80, 300));
+	}
+	CHECK(MagCal_solve(&cal) == MAGCAL_FIT_NONE);
+
+	// A shape too squashed to trust, in 3D and in the plane
+	MagCal_reset();
+	AddSphere(flat);
+	CHECK(MagCal_solve(&cal) == MAGCAL_FIT_NONE);
+
+	// Out of range and full
+	MagCal_reset();
+	CHECK(MagCal_addSample(0, 0, 0));
+	CHECK(!MagCal_addSample(MAGCAL_LIMIT, 0, 0));
+	CHECK(MagCal_count() == 1);
+	MagCal_reset();
+	for (k = 0; k < MAGCAL_MAX_SAMPLES; k++) {
+		MagCal_addSample((int16_t) (k % 64), (int16_t) (k % 37), (int16_t) (k % 23));
+	}
+	CHECK(!AddField(identity, up));
+	CHECK(MagCal_count() == MAGCAL_MAX_SAMPLES);
+}
+
+int main(void) {
+	Host_reset();
+	TestSphere();
+	TestStepperSweep();
+	TestDegenerate();
+	return CHECK_DONE("test_magcal");
+}
@@ -0,0 +1,97 @@
+/* --------------------------------------------------------------------------
+   MagFilter heading rate
+
+   A field turning at a steady rate is fed in at 80 Hz with heading noise
+   and interrupt jitter on the microsecond stamps. The rate has to come out
+   within a degree per second of the true one, straight through north and
+   across the 32 bit stamp wrap, and settle to zero within one baseline
+   and the filter delay once the turn stops.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "MagFilter.h"
+#include "MAG3110.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define FIELD			2000.0		// Horizontal field, counts
+#define SAMPLE_US		12500		// 80 Hz
+#define NOISE_CDEG		10			// Heading noise, +/-
+#define JITTER_US		60			// Stamp jitter, +/-
+
+static uint32_t stamp;
+static double trueHeading;			// Centidegrees, before declination
+
+static int Spread(int range) {
+	return (rand() % (2 * range + 1)) - range;
+}
+
+// Advances the model one sample and feeds it in
+static void Feed(double rateCdeg) {
+	double angle;
+
+	trueHeading += rateCdeg * SAMPLE_US / 1e6;
+	angle = (trueHeading + Spread(NOISE_CDEG)) * M_PI / 18000.0;
+	stamp += SAMPLE_US;
+	// Heading is atan2(hx, hy), clockwise from the boat's bow
+	MagFilter_add((int32_t) lround(FIELD * sin(angle)), (int32_t) lround(FIELD * cos(angle)),
+				  stamp + Spread(JITTER_US));
+}
+
+static void Reset(double heading) {
+	MAGFILTER_CONFIG config = MAGFILTER_DEFAULT_CONFIG;
+
+	MagFilter_configure(&config);
+	trueHeading = heading;
+	stamp = 0xFFFF0000u;			// Wraps about 0.8 s in
+	srand(34);
+}
+
+static void TestTurn(double rateCdeg) {
+	int32_t rate, worst = 0;
+	int i;
+
+	Reset(35000.0);
+	for (i = 0; i < 40; i++) {		// Filters and the rate window fill
+		Feed(rateCdeg);
+	}
+	for (i = 0; i < 800; i++) {
+		Feed(rateCdeg);
+		CHECK(MagFilter_rate(&rate));
+		if (abs(rate - (int32_t) rateCdeg) > worst) {
+			worst = abs(rate - (int32_t) rateCdeg);
+		}
+	}
+	printf("%5.0f cdeg/s: worst rate error %d cdeg/s\n", rateCdeg, worst);
+	CHECK(worst <= 100);
+}
+
+static void TestStop(void) {
+	int32_t rate;
+	int i;
+
+	Reset(1000.0);
+	for (i = 0; i < 80; i++) {
+		Feed(-4500.0);
+	}
+	for (i = 0; i < (MAGFILTER_RATE_SPAN_US / SAMPLE_US) + 6; i++) {	// Plus the filter delay
+		Feed(0.0);
+	}
+	MagFilter_rate(&rate);
+	printf("stopped: rate %d cdeg/s one span later\n", rate);
+	CHECK(abs(rate) <= 100);
+}
+
+int main(void) {
+	int32_t rate;
+	MAGFILTER_CONFIG config = MAGFILTER_DEFAULT_CONFIG;
+
+	MagFilter_configure(&config);
+	CHECK(!MagFilter_rate(&rate));
+
+	TestTurn(0.0);
+	TestTurn(3000.0);
+	TestTurn(-9000.0);
+	TestTurn(36000.0);
+	TestStop();
+	return CHECK_DONE("test_magfilter");
+}
@@ -0,0 +1,240 @@
+/* --------------------------------------------------------------------------
+   Mission and fence upload into the flash stand-in
+
+   Mission.c is built with MISSION_FLASH_RAM, where the banks are RAM that
+   behaves like erased flash. Uploads go through Mission_command exactly
+   as the XBee lines would, with lost and corrupted chunks, a resume, a
+   reset part way through and a corrupted stored bank. A fence the
+   geofence refuses must leave the old one in force. The mode manager
+   is stood in for so the events Mission raises can be checked.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "Mission.h"
+#include "Mode.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WAYPOINTS	25
+
+static NAV_WAYPOINT route[WAYPOINTS];
+static GEO_VERTEX fence[12];
+static char reply[MISSION_REPLY_MAX];
+static MODE mode = MODE_MANUAL;
+static int stopEvents;
+
+/* ------------------------- Mode manager stand-in -------------------------- */
+MODE Mode_current(void) {
+	return mode;
+}
+
+MODE Mode_event(MODE_EVENT event) {
+	const NAV_WAYPOINT *stored;
+	int count;
+
+	if ((event == MODE_EV_GO) && (mode != MODE_FAILSAFE)) {
+		stored = Mission_route(&count);
+		Navigate_start(stored, count);
+		mode = MODE_AUTONOMOUS;
+	}
+	else if ((event == MODE_EV_STOP) && (mode == MODE_AUTONOMOUS)) {
+		stopEvents++;
+		Navigate_stop();
+		mode = MODE_ASSISTED;
+	}
+	return mode;
+}
+
+/* --------------------------------- Uplink --------------------------------- */
+static const char *Send(const char *format, ...) {
+	char line[160];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	reply[0] = 0;
+	CHECK(Mission_command(line, reply));
+	return reply;
+}
+
+static const char *SendChunk(char letter, const void *image, unsigned int offset, unsigned int length, BOOL corrupt) {
+	char hex[2 * MISSION_CHUNK_MAX + 1];
+	const uint8_t *bytes = (const uint8_t *) image + offset;
+	uint32_t crc = Mission_crc32(0, bytes, length);
+	unsigned int i;
+
+	for (i = 0; i < length; i++) {
+		sprintf(&hex[2 * i], "%02X", bytes[i]);
+	}
+	if (corrupt) {
+		hex[3] = (hex[3] == '0') ? '1' : '0';
+	}
+	return Send("%cC %u %s %08X", letter, offset, hex, (unsigned) crc);
+}
+
+// Full upload, dropping every dropEvery'th chunk and corrupting the next
+static const char *Upload(char letter, const void *image, unsigned int count, unsigned int itemSize, int dropEvery) {
+	unsigned int bytes = count * itemSize;
+	unsigned int offset = 0, length;
+	int sent = 0;
+	char expect[16];
+
+	Send("%cB %u %08X", letter, count, (unsigned) Mission_crc32(0, image, bytes));
+	while (offset < bytes) {
+		length = (bytes - offset < MISSION_CHUNK_MAX) ? bytes - offset : MISSION_CHUNK_MAX;
+		sent++;
+		if ((dropEvery > 0) && ((sent % dropEvery) == 0)) {
+			continue;							// Lost on the link, the next one asks again
+		}
+		SendChunk(letter, image, offset, length, (dropEvery > 0) && ((sent % dropEvery) == 1) && (sent > 1));
+		offset = (unsigned int) strtoul(&reply[3], NULL, 10);
+		sprintf(expect, "%cR ", letter);
+		CHECK(strncmp(reply, expect, 3) == 0);
+	}
+	return Send("%cE", letter);
+}
+
+static void MakeImages(void) {
+	int i;
+
+	for (i = 0; i < WAYPOINTS; i++) {
+		route[i].lat = 523000000 + i * 1000;
+		route[i].lon = 45000000 - i * 700;
+		route[i].speed = 300 + i;
+		route[i].radius = 50;
+	}
+	for (i = 0; i < 12; i++) {
+		fence[i].lat = 523000000 + (int32_t) (20000 * ((i < 6) ? i : 11 - i));
+		fence[i].lon = 45000000 + ((i < 6) ? 0 : 30000);
+	}
+}
+
+static void TestUpload(void) {
+	const NAV_WAYPOINT *stored;
+	int count;
+
+	Mission_init();
+	CHECK(Mission_route(&count) == NULL);
+	CHECK(strcmp(Send("MG"), "MF empty") == 0);
+
+	CHECK(strcmp(Upload('M', route, WAYPOINTS, sizeof(NAV_WAYPOINT), 0), "MD 25 1") == 0);
+	stored = Mission_route(&count);
+	CHECK((stored != NULL) && (count == WAYPOINTS));
+	CHECK((stored != NULL) && (memcmp(stored, route, sizeof(route)) == 0));
+
+	// The same image again is already stored
+	CHECK(strcmp(Send("MB %u %08X", WAYPOINTS, (unsigned) Mission_crc32(0, route, sizeof(route))), "MD 25 1") == 0);
+
+	// Lossy link: chunks dropped and corrupted, the replies steer the resends
+	route[3].speed = 999;
+	CHECK(strcmp(Upload('M', route, WAYPOINTS, sizeof(NAV_WAYPOINT), 3), "MD 25 2") == 0);
+	stored = Mission_route(&count);
+	CHECK((stored != NULL) && (memcmp(stored, route, sizeof(route)) == 0));
+	printf("upload: stored, then stored again over a lossy link as sequence 2\n");
+}
+
+static void TestInterrupted(void) {
+	const NAV_WAYPOINT *stored;
+	uint32_t crc;
+	int count;
+
+	route[4].speed = 444;
+	crc = Mission_crc32(0, route, sizeof(route));
+	CHECK(strcmp(Send("MB %u %08X", WAYPOINTS, (unsigned) crc), "MR 0") == 0);
+	SendChunk('M', route, 0, MISSION_CHUNK_MAX, FALSE);
+	SendChunk('M', route, MISSION_CHUNK_MAX, MISSION_CHUNK_MAX, FALSE);
+	CHECK(strcmp(reply, "MR 96") == 0);
+
+	// Link drops, the uploader begins again and resumes where it was
+	CHECK(strcmp(Send("MB %u %08X", WAYPOINTS, (unsigned) crc), "MR 96") == 0);
+	CHECK(strcmp(Send("ME"), "MR 96") == 0);
+
+	// Reset part way: the stored mission is still the last complete one
+	Mission_init();
+	stored = Mission_route(&count);
+	CHECK((stored != NULL) && (count == WAYPOINTS) && (stored[4].speed != 444) && (stored[3].speed == 999));
+	CHECK(strncmp(Send("MS"), "MS 25 2 -1", 10) == 0);
+	CHECK(strcmp(Send("MC 0 00000000 0"), "MF idle") == 0);
+}
+
+static void TestCorruptBank(void) {
+	NAV_WAYPOINT *stored;
+	int count;
+
+	// Store sequence 3 in the other bank, then damage it
+	route[5].speed = 555;
+	CHECK(strcmp(Upload('M', route, WAYPOINTS, sizeof(NAV_WAYPOINT), 0), "MD 25 3") == 0);
+	stored = (NAV_WAYPOINT *) Mission_route(&count);
+	stored[7].lat &= ~0x10;					// Flash bits only clear
+
+	Mission_init();
+	stored = (NAV_WAYPOINT *) Mission_route(&count);
+	CHECK((stored != NULL) && (stored[5].speed != 555) && (stored[3].speed == 999));
+	CHECK(strncmp(Send("MS"), "MS 25 2", 7) == 0);
+	printf("corrupt bank: fell back to sequence 2\n");
+}
+
+static void TestUploadWhileRunning(void) {
+	const NAV_WAYPOINT *stored;
+	NAV_OUTPUT out;
+	int count;
+
+	// Sequence 2 is in bank 0, the next upload erases bank 1: no stop
+	mode = MODE_ASSISTED;
+	CHECK(strcmp(Send("MG"), "MG 25") == 0);
+	CHECK((mode == MODE_AUTONOMOUS) && Navigate_update(route[0].lat, route[0].lon, &out));
+	stopEvents = 0;
+	route[6].speed = 666;
+	CHECK(strcmp(Upload('M', route, WAYPOINTS, sizeof(NAV_WAYPOINT), 0), "MD 25 3") == 0);
+	CHECK((stopEvents == 0) && (mode == MODE_AUTONOMOUS));
+
+	// The one after erases the bank still being followed: the mode manager
+	// stops the route before the page goes
+	route[6].speed = 777;
+	CHECK(strcmp(Send("MB %u %08X", WAYPOINTS, (unsigned) Mission_crc32(0, route, sizeof(route))), "MR 0") == 0);
+	CHECK((stopEvents == 1) && (mode == MODE_ASSISTED));
+	CHECK(Navigate_update(route[0].lat, route[0].lon, &out) == FALSE);
+	CHECK(strcmp(Send("ME"), "MR 0") == 0);
+
+	// Sequence 3 is still the stored mission until this one completes
+	stored = Mission_route(&count);
+	CHECK((stored != NULL) && (stored[6].speed == 666));
+	printf("upload over the running route: %d stop event, left for assisted\n", stopEvents);
+}
+
+static void TestFence(void) {
+	GEO_VERTEX far[12];
+	GEO_STATUS status;
+
+	CHECK(strcmp(Upload('F', fence, 12, sizeof(GEO_VERTEX), 4), "FD 12 1") == 0);
+	CHECK(Geofence_check(523050000, 45015000, &status) && status.inside);
+	CHECK(Geofence_check(523050000, 44900000, &status) && !status.inside);
+
+	Mission_init();								// Loaded again from the stored bank
+	CHECK(Geofence_check(523050000, 45015000, &status) && status.inside);
+	CHECK(strcmp(Send("FB 0 0"), "FF count") == 0);
+	CHECK(strcmp(Send("FB %u 0", GEO_MAX_VERTICES + 1), "FF count") == 0);
+	CHECK(!Mission_command("FG", reply));
+
+	// Good image, but one vertex 111 km out, past GEO_MAX_EXTENT_CM
+	memcpy(far, fence, sizeof(far));
+	far[5].lat += 10000000;
+	CHECK(strcmp(Upload('F', far, 12, sizeof(GEO_VERTEX), 0), "FF fence") == 0);
+	CHECK(Geofence_check(523050000, 45015000, &status) && status.inside);
+	CHECK(strcmp(Send("FS"), "FS 12 1 -1") == 0);
+	Mission_init();
+	CHECK(Geofence_check(523050000, 45015000, &status) && status.inside);
+}
+
+int main(void) {
+	Host_reset();
+	MakeImages();
+	TestUpload();
+	TestInterrupted();
+	TestCorruptBank();
+	TestUploadWhileRunning();
+	TestFence();
+	return CHECK_DONE("test_mission");
+}
@@ -0,0 +1,164 @@
+/* --------------------------------------------------------------------------
+   Navigate against a double precision reference
+
+   Distances are checked against the haversine and bearings against the
+   great circle initial bearing, from the equator to 75 degrees, across
+   the date line, and from a few metres out to 300 km. Short legs use the
+   flat earth, long ones the fixed point haversine. Then a boat driven
+   along the steered heading has to pass every waypoint of a route and
+   finish it, including one where the turn makes it miss the radius.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "host.h"
+#include "Navigate.h"
+#include "GPS_I2C.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define EARTH_CM		637100880.0
+#define RAD(units)		((units) * M_PI / 180.0 / GPS_DEG_SCALE)
+
+typedef struct {
+	double worstDistance;		// cm past the allowed relative error
+	double worstBearing;		// Cdeg
+	BOOL rhumb;					// Bearing against the mean latitude line
+	double relative;			// Distance error allowed, relative
+} WORST;
+
+static int32_t Wrap(double units) {
+	if (units > 180.0 * GPS_DEG_SCALE) units -= 360.0 * GPS_DEG_SCALE;
+	if (units < -180.0 * GPS_DEG_SCALE) units += 360.0 * GPS_DEG_SCALE;
+	return (int32_t) units;
+}
+
+static double RefDistance(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2) {
+	double dLat = RAD((double) lat2 - lat1);
+	double dLon = RAD((double) lon2 - lon1);
+	double a = sin(dLat / 2) * sin(dLat / 2) + cos(RAD(lat1)) * cos(RAD(lat2)) * sin(dLon / 2) * sin(dLon / 2);
+
+	return 2.0 * EARTH_CM * asin(sqrt(a));
+}
+
+static double RefBearing(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2) {
+	double dLon = RAD((double) lon2 - lon1);
+	double y = sin(dLon) * cos(RAD(lat2));
+	double x = cos(RAD(lat1)) * sin(RAD(lat2)) - sin(RAD(lat1)) * cos(RAD(lat2)) * cos(dLon);
+	double bearing = atan2(y, x) * 18000.0 / M_PI;
+
+	return (bearing < 0) ? bearing + 36000.0 : bearing;
+}
+
+// Flat earth at the mean latitude, what Navigate steers along
+static double RefRhumb(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2) {
+	double dLon = RAD((double) Wrap((double) lon2 - lon1));
+	double bearing = atan2(dLon * cos(RAD(((double) lat1 + lat2) / 2)), RAD((double) lat2 - lat1)) * 18000.0 / M_PI;
+
+	return (bearing < 0) ? bearing + 36000.0 : bearing;
+}
+
+// Steers from (lat, lon) to a point range cm away on a random bearing
+static void Compare(int32_t lat, int32_t lon, double range, WORST *worst) {
+	static NAV_WAYPOINT wp[1];
+	NAV_OUTPUT out;
+	double bearing = (rand() % 36000) * M_PI / 18000.0;
+	double err;
+	int32_t lat2 = lat + (int32_t) (range * cos(bearing) / EARTH_CM * 180.0 / M_PI * GPS_DEG_SCALE);
+	int32_t lon2 = Wrap(lon + range * sin(bearing) / EARTH_CM / cos(RAD(lat)) * 180.0 / M_PI * GPS_DEG_SCALE);
+	double ref = RefDistance(lat, lon, lat2, lon2);
+
+	err = fabs(Navigate_distance(lat, lon, lat2, lon2) - ref) - ref * worst->relative;
+	if (err > worst->worstDistance) worst->worstDistance = err;
+
+	wp[0].lat = lat2;
+	wp[0].lon = lon2;
+	wp[0].speed = 500;
+	wp[0].radius = 0;
+	Navigate_start(wp, 1);
+	CHECK(Navigate_update(lat, lon, &out));
+	CHECK(abs(out.distance - Navigate_distance(lat, lon, lat2, lon2)) <= 1);
+	err = fabs(out.heading - (worst->rhumb ? RefRhumb(lat, lon, lat2, lon2) : RefBearing(lat, lon, lat2, lon2)));
+	if (err > 18000.0) err = 36000.0 - err;
+	if (err > worst->worstBearing) worst->worstBearing = err;
+}
+
+static void TestAgainstReference(void) {
+	// Distance within 0.03 % and 3 cm of rounding, bearing in cdeg
+	static const struct {
+		double fromCm, toCm;
+		BOOL rhumb;
+		double bearingTol;
+	} bands[] = {
+		{ 1000.0,    50000.0,    FALSE, 20.0 },	// 10 m..500 m, flat earth, 1 cm steps show in the bearing
+		{ 50000.0,   500000.0,   FALSE, 10.0 },	// To 5 km, flat earth
+		{ 500000.0,  30000000.0, TRUE,  40.0 }	// To 300 km, haversine; MeanCos is held to a degree
+	};
+	WORST worst;
+	unsigned int band;
+	int i;
+
+	srand(43);
+	for (band = 0; band < sizeof(bands) / sizeof(bands[0]); band++) {
+		worst.worstDistance = -1e9;
+		worst.worstBearing = 0.0;
+		worst.rhumb = bands[band].rhumb;
+		worst.relative = 0.0003;
+		for (i = 0; i < 20000; i++) {
+			Compare((rand() % 1500000001) - 750000000, (rand() % 3600000001u) - 1800000000,
+					bands[band].fromCm + (bands[band].toCm - bands[band].fromCm) * (rand() / (double) RAND_MAX),
+					&worst);
+		}
+		printf("%6.0f..%6.0f m: distance worst %.1f cm past 0.03 %%, bearing %.1f cdeg off the %s\n",
+			   bands[band].fromCm / 100, bands[band].toCm / 100, worst.worstDistance, worst.worstBearing,
+			   worst.rhumb ? "rhumb line" : "great circle");
+		CHECK(worst.worstDistance <= 3.0);
+		CHECK(worst.worstBearing <= bands[band].bearingTol);
+	}
+}
+
+static void TestRoute(void) {
+	// A dog leg near the date line, the second waypoint with a radius too
+	// small to hit after the sharp turn
+	static const NAV_WAYPOINT route[] = {
+		{ 523000000, 1799990000, 300, 50 },
+		{ 523010000, -1799990000, 300, 1 },
+		{ 522990000, -1799980000, 300, 50 }
+	};
+	NAV_OUTPUT out;
+	unsigned int last, max;
+	int32_t lat = 522990000, lon = 1799980000;
+	double step = 50.0;			// cm per update
+	int visited[3] = { 0, 0, 0 };
+	int i;
+
+	Navigate_start(route, 3);
+	for (i = 0; i < 200000; i++) {
+		Navigate_update(lat, lon, &out);
+		if (out.done) {
+			break;
+		}
+		visited[out.index] = 1;
+		// Straight along the steered heading; 50 cm steps jump the 10 cm radius
+		lat += (int32_t) (step * cos(out.heading * M_PI / 18000.0) / EARTH_CM * 180.0 / M_PI * GPS_DEG_SCALE);
+		lon = Wrap(lon + step * sin(out.heading * M_PI / 18000.0) / EARTH_CM / cos(RAD(lat)) * 180.0 / M_PI
+				   * GPS_DEG_SCALE);
+	}
+	printf("route: done after %d updates, %.0f m\n", i, i * step / 100.0);
+	// Host ticks only count timer polls, but the bookkeeping behind PN shows
+	Navigate_cycles(&last, &max);
+	printf("route: Navigate_update last %u max %u ticks\n", last, max);
+	CHECK((last > 0) && (max >= last));
+	CHECK(out.done && (out.index == -1) && (out.speed == 0));
+	CHECK(visited[0] && visited[1] && visited[2]);
+	CHECK(fabs(RefDistance(lat, lon, route[2].lat, route[2].lon)) <= 5000.0 + step);
+}
+
+int main(void) {
+	NAV_OUTPUT out;
+
+	Host_reset();
+	Navigate_stop();
+	CHECK(!Navigate_update(0, 0, &out) && !out.done && (out.index == -1));
+	TestAgainstReference();
+	TestRoute();
+	return CHECK_DONE("test_navigate");
+}
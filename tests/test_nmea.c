@@ -0,0 +1,232 @@
+/* --------------------------------------------------------------------------
+   NMEA parser: known sentences, fuzz corpus and throughput
+
+   Known sentences check the fixed point conversions at the edges of their
+   ranges. The corpus is hand made breakage (truncation, nested '$', bad
+   hex, overlong fields, noise) that must be dropped without touching the
+   fix, each followed by a good sentence that must still parse. Random
+   mutations of good sentences are only ever accepted when the mutated
+   bytes still carry a matching checksum, and then with values in range.
+   Throughput is printed for the host only, it is not checked.
+   -------------------------------------------------------------------------- */
+#include "check.h"
+#include "NMEA.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define GOOD_RMC	"$GNRMC,123519.000,A,4807.038,N,01131.000,E,022.4,084.4,230394,,,A*"
+
+typedef struct {
+	const char *body;		// Without the checksum
+	int32_t lat, lon, speed, angle;
+} KNOWN_RMC;
+
+static const KNOWN_RMC known[] = {
+	{ GOOD_RMC, 481173000, 115166667, 2240, 8440 },
+	{ "$GNRMC,000000.000,A,3339.8700000,S,11154.2999999,W,0.02,359.99,010120,,,D*",
+	  -336645000, -1119050000, 2, 35999 },
+	{ "$GNRMC,000000.000,A,0000.0000,N,18000.0000,W,0.0,0.0,010120,,,A*", 0, -1800000000, 0, 0 },
+	{ "$GNRMC,000000.000,A,8959.9999999,N,17959.9999999,E,1,360,010120,,,A*",
+	  900000000, 1800000000, 100, 36000 }	// Rounded to the nearest unit
+};
+
+// Complete sentences that must all be dropped
+static const char *const corpus[] = {
+	"$GNRMC,123519.000,A,4807.038,N,01131.000,E,022.4,084.4,230394,,,A*00\r\n",	// Wrong checksum
+	"$GNRMC,123519.000,A,4807.038,N,01131.000,E,022.4,084.4,230394,,,A*6\r\n",	// One hex digit
+	"$GNRMC,123519.000,A,4807.038,N,01131.000,E,022.4,084.4,230394,,,A*G6\r\n",	// Not hex
+	"$GNRMC,123519.000,A,4807.038,N,01131.000,E,022.4,084.4,230394,,,A\r\n",	// No checksum
+	"$GNRMC,123519.000,A,4807.038,N,011$GNRMC,1235\r\n",						// Nested start
+	"$GNRMC,123519.000,A,4807.0381234567890123,N,01131.000,E,0,0,230394,,,A*",	// Overlong field
+	"$GNRMC,123519.000,A,48x7.038,N,01131.000,E,022.4,084.4,230394,,,A*",		// Junk digit
+	"$GNRMC,123519.000,A,4867.038,N,01131.000,E,022.4,084.4,230394,,,A*",		// 67 minutes
+	"$GNRMC,123519.000,A,4807.038,N,01131.000,E,99999999999,084.4,230394,,,A*",	// Overflow
+	"$GNRMC,12\x01" "3519.000,A,4807.038,N,01131.000,E,022.4,084.4,230394,,,A*",	// Control byte
+	"$*00\r\n",
+	"$\r\n",
+	"*47\r\n",
+	"GNRMC,123519.000,A,4807.038,N,01131.000,E,022.4,084.4,230394,,,A*",		// No '$'
+	"\xff\xfe\x80$\x81\x00",
+	"$GNRMC,123519.000,A,4807.038,N,01131.000,E,022.4,484.4,234394,,,A*",		// Course over 360
+	"$GNRMC,123519.000,A,4807.038,N,01131.000,E(022.4,084.4,230394,,,A*",		// Two letter hemisphere
+	"$GNRMC,123519.000,X,4807.038,N,01131.000,E,022.4,084.4,230394,,,A*",		// Unknown status
+	"$GNRMC,123519.000,A,4807.038,N,01131.000,E,-22.4,084.4,230394,,,A*",		// Negative speed
+	NULL
+};
+
+static char line[256];
+
+// Appends the checksum and CR LF when body ends in '*'
+static const char *Sentence(const char *body) {
+	BYTE sum = 0;
+	const char *p;
+	size_t len = strlen(body);
+
+	if ((len == 0) || (body[len - 1] != '*')) {
+		strcpy(line, body);
+		return line;
+	}
+	for (p = body + 1; *p != '*'; p++) {
+		sum ^= (BYTE) *p;
+	}
+	// Junk in the body gets a correct checksum, so only the field checks stop it
+	sprintf(line, "%s%02X\r\n", body, sum);
+	return line;
+}
+
+static NMEA_SENTENCE Feed(const char *s, size_t len, struct gps_time *fix) {
+	NMEA_SENTENCE got = NMEA_NONE, type;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		type = NMEA_parse((BYTE) s[i], fix);
+		if (type != NMEA_NONE) {
+			got = type;
+		}
+	}
+	return got;
+}
+
+static NMEA_SENTENCE FeedString(const char *s, struct gps_time *fix) {
+	return Feed(s, strlen(s), fix);
+}
+
+static void TestKnown(void) {
+	struct gps_time fix;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(known) / sizeof(known[0]); i++) {
+		memset(&fix, 0, sizeof(fix));
+		CHECK(FeedString(Sentence(known[i].body), &fix) == NMEA_RMC);
+		CHECK(fix.lat == known[i].lat);
+		CHECK(fix.lon == known[i].lon);
+		CHECK(fix.speed == known[i].speed);
+		CHECK(fix.angle == known[i].angle);
+	}
+
+	memset(&fix, 0, sizeof(fix));
+	CHECK(FeedString(Sentence("$GPGGA,123520.000,4807.0381,N,01131.0002,E,1,08,0.9,545.4,M,46.9,M,,*"), &fix)
+		  == NMEA_GGA);
+	CHECK(fix.quality == 1 && fix.satellites == 8 && fix.hdop == 90 && fix.altitude == 54540);
+	CHECK(FeedString(Sentence("$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A*"), &fix) == NMEA_VTG);
+	CHECK(fix.speed == 550 && fix.angle == 5470);
+}
+
+static void TestCorpus(void) {
+	struct gps_time fix, before;
+	unsigned int errors = NMEA_checksumErrors();
+	int i;
+
+	for (i = 0; corpus[i] != NULL; i++) {
+		memset(&fix, 0x5A, sizeof(fix));
+		before = fix;
+		if (FeedString(Sentence(corpus[i]), &fix) != NMEA_NONE) {
+			printf("corpus %d accepted\n", i);
+			CHECK(0);
+		}
+		CHECK(memcmp(&fix, &before, sizeof(fix)) == 0);
+
+		// The very next sentence parses
+		CHECK(FeedString(Sentence(GOOD_RMC), &fix) == NMEA_RMC);
+		CHECK(fix.lat == 481173000 && fix.angle == 8440);
+	}
+	CHECK(NMEA_checksumErrors() == errors + 1);
+}
+
+// TRUE if the bytes from the last '$' before end carry a valid checksum
+static BOOL ChecksumHolds(const char *s, int end) {
+	BYTE sum = 0;
+	unsigned int hex;
+	int start, star, i;
+
+	for (star = end; (star >= 0) && (s[star] != '*'); star--);
+	for (start = star; (start >= 0) && (s[start] != '$'); start--);
+	if ((start < 0) || (star < 0)) {
+		return FALSE;
+	}
+	for (i = start + 1; i < star; i++) {
+		if ((s[i] < ' ') || (s[i] > '~')) {
+			return FALSE;
+		}
+		sum ^= (BYTE) s[i];
+	}
+	return (sscanf(&s[star + 1], "%2X", &hex) == 1) && (hex == sum);
+}
+
+static void TestFuzz(void) {
+	static const char *const seeds[] = {
+		GOOD_RMC,
+		"$GPGGA,123520.000,4807.0381,N,01131.0002,E,1,08,0.9,545.4,M,46.9,M,,*",
+		"$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A*",
+		"$PMTK001,220,3*"
+	};
+	struct gps_time fix;
+	char mutant[256];
+	int accepted = 0, wrong = 0;
+	int run, len, k, j;
+
+	srand(37);
+	for (run = 0; run < 200000; run++) {
+		strcpy(mutant, Sentence(seeds[run % 4]));
+		len = (int) strlen(mutant);
+		for (k = 1 + rand() % 3; k > 0; k--) {
+			switch (rand() % 3) {
+				case 0:
+					mutant[rand() % len] = (char) (rand() % 256);
+					break;
+				case 1:
+					mutant[rand() % len] ^= (char) (1 << (rand() % 8));
+					break;
+				default:
+					len = 1 + rand() % len;		// Truncate
+					break;
+			}
+		}
+		memset(&fix, 0, sizeof(fix));
+		NMEA_reset();					// Each mutant stands alone
+		for (j = 0; j < len; j++) {
+			if (NMEA_parse((BYTE) mutant[j], &fix) != NMEA_NONE) {
+				accepted++;
+				if (!ChecksumHolds(mutant, j - 2)) {
+					wrong++;
+
+				}
+			}
+		}
+		CHECK((fix.lat >= -900000000) && (fix.lat <= 900000000));
+		CHECK((fix.lon >= -1800000000) && (fix.lon <= 1800000000));
+		CHECK((fix.angle >= 0) && (fix.angle <= 36000) && (fix.speed >= 0));
+	}
+	printf("fuzz: %d of 200000 mutants accepted, %d without a valid checksum\n", accepted, wrong);
+	CHECK(wrong == 0);
+
+	// Random bytes, then a good sentence still parses
+	for (run = 0; run < 2000000; run++) {
+		NMEA_parse((BYTE) rand(), &fix);
+	}
+	CHECK(FeedString(Sentence(GOOD_RMC), &fix) == NMEA_RMC);
+}
+
+static void Bench(void) {
+	struct gps_time fix;
+	const char *s = Sentence(GOOD_RMC);
+	size_t len = strlen(s);
+	clock_t start = clock();
+	int i;
+
+	for (i = 0; i < 200000; i++) {
+		Feed(s, len, &fix);
+	}
+	printf("host throughput: %.1f ns/byte\n",
+		   (double) (clock() - start) * 1e9 / CLOCKS_PER_SEC / (200000.0 * len));
+}
+
+int main(void) {
+	NMEA_reset();
+	TestKnown();
+	TestCorpus();
+	TestFuzz();
+	Bench();
+	return CHECK_DONE("test_nmea");
+}